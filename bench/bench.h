@@ -0,0 +1,31 @@
+#ifndef COME_BENCH_H
+#define COME_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// Minimal timing helpers shared by the benchmarks in bench/
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keep the optimizer from discarding a result
+static inline void bench_sink(uintptr_t v) {
+    __asm__ __volatile__("" : : "r"(v) : "memory");
+}
+
+// One result line: name, seconds per iteration and throughput for 'bytes' per iteration
+static inline void bench_report(const char* name, double secs, long iters, size_t bytes) {
+    double per = secs / iters;
+    if (bytes) {
+        printf("  %-40s %10.1f us  %8.2f GB/s\n", name, per * 1e6, bytes / per / 1e9);
+    } else {
+        printf("  %-40s %10.1f us\n", name, per * 1e6);
+    }
+}
+
+#endif
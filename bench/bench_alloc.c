@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// The same allocation-heavy string work under whichever mem_talloc backend
+// it is linked with: run_bench.sh builds it once against talloc and once
+// against the arena (come build --alloc=arena), naming it with ALLOC_BACKEND.
+
+#ifndef ALLOC_BACKEND
+#define ALLOC_BACKEND "talloc"
+#endif
+
+#define REQUESTS 200000
+#define STRINGS 1000000
+#define APPENDS 1000000
+#define ITERS 3
+
+static const char* line = "Accept: text/html, application/xhtml+xml, application/xml;q=0.9, image/avif, image/webp, */*;q=0.8";
+
+// A context per request that splits, trims, upper-cases and joins a header line
+static void bench_requests(void) {
+    TALLOC_CTX* root = mem_talloc_new_ctx(NULL);
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int r = 0; r < REQUESTS; r++) {
+            TALLOC_CTX* ctx = mem_talloc_new_ctx(root);
+            come_string_t* s = come_string_new(ctx, line);
+            come_string_list_t* parts = come_string_split(s, ",");
+            for (uint32_t i = 0; i < parts->count; i++) {
+                parts->items[i] = come_string_upper(come_string_trim(parts->items[i], NULL));
+            }
+            bench_sink(come_string_join(parts, come_string_new(ctx, ";"))->count);
+            mem_talloc_free(ctx);
+        }
+    }
+    bench_report("new_ctx per request", bench_now() - t, ITERS * (long)REQUESTS, 0);
+    mem_talloc_free(root);
+}
+
+// Many small strings on one context, then one free
+static void bench_small(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+        for (int i = 0; i < STRINGS; i++) bench_sink((uintptr_t)come_string_new(ctx, "key"));
+        mem_talloc_free(ctx);
+    }
+    bench_report("1M small strings, then free", bench_now() - t, ITERS, 0);
+}
+
+// One string grown by appends (realloc of the newest allocation)
+static void bench_append(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+        come_string_t* s = come_string_new(ctx, "");
+        for (int i = 0; i < APPENDS; i++) come_string_append_long(s, i);
+        bench_sink(s->count);
+        mem_talloc_free(ctx);
+    }
+    bench_report("1M appends to one string", bench_now() - t, ITERS, 0);
+}
+
+int main(void) {
+    printf("Allocator backend: %s\n", ALLOC_BACKEND);
+    bench_requests();
+    bench_small();
+    bench_append();
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "bench.h"
+#include "come_string.h"
+#include "casemap.h"
+#include "mem/talloc.h"
+
+// Case mapping and case-insensitive compare vs the per-byte ctype loops
+// they replaced, on ASCII and on mixed-script text.
+
+#define BUF_LEN (8u << 20)
+#define ITERS 20
+
+static void upper_ctype(char* d, const char* s, size_t n) {
+    for (size_t i = 0; i < n; i++) d[i] = toupper((unsigned char)s[i]);
+}
+
+static char* make_ascii(void) {
+    char* t = malloc(BUF_LEN);
+    uint32_t x = 12345;
+    for (size_t i = 0; i < BUF_LEN; i++) {
+        x = x * 1103515245u + 12345u;
+        t[i] = (i % 8 == 7) ? ' ' : ((x >> 16) & 1 ? 'a' : 'A') + (x >> 17) % 26;
+    }
+    return t;
+}
+
+// About one non-ASCII letter in eight
+static char* make_mixed(void) {
+    static const char* pieces[] = {"hello ", "World ", "caf\xc3\xa9 ", "\xce\xa3\xce\xbf\xcf\x86\xce\xaf\xce\xb1 ", "Stra\xc3\x9f" "e ", "text ", "\xd0\x9c\xd0\xbe\xd1\x81\xd0\xba\xd0\xb2\xd0\xb0 ", "NAME "};
+    char* t = malloc(BUF_LEN + 32);
+    size_t p = 0;
+    uint32_t x = 12345;
+    while (p < BUF_LEN) {
+        x = x * 1103515245u + 12345u;
+        const char* s = pieces[(x >> 16) % 8];
+        size_t n = strlen(s);
+        memcpy(t + p, s, n);
+        p += n;
+    }
+    while (t[BUF_LEN - 1] & 0x80) t[BUF_LEN - 1] = ' ';
+    return t;
+}
+
+static void bench_map(const char* name, const char* text) {
+    char* out = malloc(BUF_LEN * 2);
+    double t;
+    printf("%s\n", name);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_case_map(out, BUF_LEN * 2, text, BUF_LEN, COME_CASE_UPPER));
+    bench_report("come_case_map upper", bench_now() - t, ITERS, BUF_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) {
+        upper_ctype(out, text, BUF_LEN);
+        bench_sink((uintptr_t)out);
+    }
+    bench_report("toupper loop (ASCII only)", bench_now() - t, ITERS, BUF_LEN);
+
+    // In place over a private copy: no allocation per call
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new_len(ctx, text, BUF_LEN);
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) {
+        if (i & 1) come_string_lower_inplace(s);
+        else come_string_upper_inplace(s);
+    }
+    bench_report("come_string_{upper,lower}_inplace", bench_now() - t, ITERS, BUF_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) {
+        come_string_t* u = come_string_upper(s);
+        bench_sink(u->count);
+        mem_talloc_free(u);
+    }
+    bench_report("come_string_upper (allocating)", bench_now() - t, ITERS, BUF_LEN);
+    mem_talloc_free(ctx);
+    free(out);
+}
+
+// glibc strncasecmp only folds ASCII, so it is timed on ASCII input only
+static void bench_cmp(const char* name, const char* text, bool ascii) {
+    char* other = malloc(BUF_LEN * 2);
+    size_t n = come_case_map(other, BUF_LEN * 2, text, BUF_LEN, COME_CASE_UPPER);
+    double t;
+    printf("%s\n", name);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_case_fold_cmp(text, BUF_LEN, other, n, 0));
+    bench_report("come_case_fold_cmp", bench_now() - t, ITERS, BUF_LEN);
+
+    if (ascii) {
+        t = bench_now();
+        for (int i = 0; i < ITERS; i++) bench_sink(strncasecmp(text, other, BUF_LEN));
+        bench_report("glibc strncasecmp", bench_now() - t, ITERS, BUF_LEN);
+    }
+    free(other);
+}
+
+int main(void) {
+    char* ascii = make_ascii();
+    char* mixed = make_mixed();
+    printf("Case mapping (%u MiB)\n", BUF_LEN >> 20);
+    bench_map("upper, ASCII", ascii);
+    bench_map("upper, mixed text", mixed);
+    bench_cmp("casecmp, ASCII", ascii, true);
+    bench_cmp("casecmp, mixed text", mixed, false);
+    free(ascii);
+    free(mixed);
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bench.h"
+#include "come_sched.h"
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// Channel throughput under contention: producers on threads of their own
+// send MESSAGES longs in total, consumers receive until the channel closes.
+// Each of the four queues (bounded MPMC and SPSC rings, unbounded MPMC and
+// SPSC segment lists) runs 1x1, then the MPMC ones with 2x2, 4x4 and 8x1
+// senders x receivers, against a bounded queue behind one mutex and two
+// condition variables. "select": one receiver over four channels, each
+// with a sender. "strings": 64-byte strings sent from a thread's own
+// context (moved) and from a pool (copied). On a machine with fewer cores
+// than threads the numbers mostly measure how often the sides sleep.
+
+#define MESSAGES (1L << 20)
+#define RING 1024
+
+typedef struct {
+    int (*send)(void* q, long v);
+    int (*recv)(void* q, long* v);
+    void* q;
+    long count;
+    long sum;
+} worker_t;
+
+static int chan_send(void* q, long v) { return come_chan_send(q, &v); }
+static int chan_recv(void* q, long* v) { return come_chan_recv(q, v, NULL) == COME_CHAN_OK; }
+
+// The baseline: a ring under one lock
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+    long items[RING];
+    long head;
+    long tail;
+    int closed;
+} locked_t;
+
+static int locked_send(void* q, long v) {
+    locked_t* l = q;
+    pthread_mutex_lock(&l->lock);
+    while (l->tail - l->head == RING) pthread_cond_wait(&l->not_full, &l->lock);
+    l->items[l->tail++ % RING] = v;
+    pthread_cond_signal(&l->not_empty);
+    pthread_mutex_unlock(&l->lock);
+    return 0;
+}
+
+static int locked_recv(void* q, long* v) {
+    locked_t* l = q;
+    pthread_mutex_lock(&l->lock);
+    while (l->tail == l->head && !l->closed) pthread_cond_wait(&l->not_empty, &l->lock);
+    int ok = l->tail != l->head;
+    if (ok) {
+        *v = l->items[l->head++ % RING];
+        pthread_cond_signal(&l->not_full);
+    }
+    pthread_mutex_unlock(&l->lock);
+    return ok;
+}
+
+static void locked_close(locked_t* l) {
+    pthread_mutex_lock(&l->lock);
+    l->closed = 1;
+    pthread_cond_broadcast(&l->not_empty);
+    pthread_mutex_unlock(&l->lock);
+}
+
+static void* producer(void* arg) {
+    worker_t* w = arg;
+    for (long i = 0; i < w->count; i++) w->send(w->q, i);
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    worker_t* w = arg;
+    long v;
+    while (w->recv(w->q, &v)) {
+        w->sum += v;
+        w->count++;
+    }
+    return NULL;
+}
+
+static void report(const char* name, double secs, long messages) {
+    printf("  %-40s %10.1f ns  %8.2f M/s\n", name, secs / messages * 1e9, messages / secs / 1e6);
+}
+
+// Runs producers x consumers over q; close ends the consumers
+static void run(const char* name, worker_t proto, int producers, int consumers,
+                void (*close)(void* q)) {
+    pthread_t threads[16];
+    worker_t workers[16];
+    double t = bench_now();
+    for (int i = 0; i < producers + consumers; i++) {
+        workers[i] = proto;
+        workers[i].count = i < producers ? MESSAGES / producers : 0;
+        pthread_create(&threads[i], NULL, i < producers ? producer : consumer, &workers[i]);
+    }
+    for (int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+    close(proto.q);
+    long received = 0;
+    for (int i = producers; i < producers + consumers; i++) {
+        pthread_join(threads[i], NULL);
+        received += workers[i].count;
+        bench_sink(workers[i].sum);
+    }
+    double secs = bench_now() - t;
+    char label[64];
+    snprintf(label, sizeof(label), "%s, %dx%d", name, producers, consumers);
+    report(label, secs, received);
+}
+
+static void close_chan(void* q) { come_chan_close(q); }
+static void close_locked(void* q) { locked_close(q); }
+
+static void bench_queues(void* ctx) {
+    static const struct { const char* name; long capacity; int flags; } kinds[] = {
+        { "mpmc ring", RING, 0 },
+        { "spsc ring", RING, COME_CHAN_SPSC },
+        { "mpmc segments", 0, 0 },
+        { "spsc segments", 0, COME_CHAN_SPSC },
+    };
+    static const int shapes[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 }, { 8, 1 } };
+    for (int k = 0; k < 4; k++) {
+        for (int s = 0; s < 4; s++) {
+            if ((kinds[k].flags & COME_CHAN_SPSC) && s > 0) break;
+            come_chan_t* ch = come_chan_new(ctx, sizeof(long), kinds[k].capacity, kinds[k].flags);
+            worker_t proto = { chan_send, chan_recv, ch, 0, 0 };
+            run(kinds[k].name, proto, shapes[s][0], shapes[s][1], close_chan);
+        }
+    }
+    for (int s = 0; s < 4; s++) {
+        locked_t* l = calloc(1, sizeof(locked_t));
+        pthread_mutex_init(&l->lock, NULL);
+        pthread_cond_init(&l->not_full, NULL);
+        pthread_cond_init(&l->not_empty, NULL);
+        worker_t proto = { locked_send, locked_recv, l, 0, 0 };
+        run("mutex ring", proto, shapes[s][0], shapes[s][1], close_locked);
+        free(l);
+    }
+}
+
+// select: four senders, one receiver taking from whichever is ready
+static void bench_select(void* ctx) {
+    come_chan_t* chans[4];
+    pthread_t threads[4];
+    worker_t workers[4];
+    come_chan_case_t cases[4];
+    long values[4];
+    for (int i = 0; i < 4; i++) {
+        chans[i] = come_chan_new(ctx, sizeof(long), RING, 0);
+        workers[i] = (worker_t){ chan_send, chan_recv, chans[i], MESSAGES / 4, 0 };
+        cases[i] = (come_chan_case_t){ chans[i], &values[i], 0, 0 };
+    }
+    double t = bench_now();
+    for (int i = 0; i < 4; i++) pthread_create(&threads[i], NULL, producer, &workers[i]);
+    long received = 0, sum = 0;
+    while (received < MESSAGES) {
+        int r = come_chan_select(cases, 4, 1, NULL);
+        sum += values[r];
+        received++;
+    }
+    for (int i = 0; i < 4; i++) pthread_join(threads[i], NULL);
+    bench_sink(sum);
+    report("select over 4, 4x1", bench_now() - t, received);
+}
+
+// Strings: the sender allocates each one, the receiver frees it; from a
+// pool what goes is a copy, and the sender frees its original
+typedef struct {
+    come_chan_t* ch;
+    int pooled;
+} strings_t;
+
+static void* string_producer(void* arg) {
+    strings_t* s = arg;
+    void* ctx = s->pooled ? mem_talloc_pool_new(NULL, 1 << 20) : mem_talloc_new_ctx(NULL);
+    for (long i = 0; i < MESSAGES / 4; i++) {
+        come_string_t* str = come_string_new_len(ctx, "0123456789abcdef0123456789abcdef"
+                                                      "0123456789abcdef0123456789abcdef", 64);
+        come_chan_send(s->ch, &str);
+        if (s->pooled) mem_talloc_free(str);
+    }
+    come_chan_close(s->ch);
+    mem_talloc_free(ctx);
+    return NULL;
+}
+
+static void bench_strings(void* ctx, int pooled) {
+    strings_t s = { come_chan_new(ctx, 0, RING, COME_CHAN_OBJECT), pooled };
+    pthread_t thread;
+    double t = bench_now();
+    pthread_create(&thread, NULL, string_producer, &s);
+    void* dest = mem_talloc_new_ctx(NULL);
+    long received = 0;
+    come_string_t* str;
+    while (come_chan_recv(s.ch, &str, dest) == COME_CHAN_OK) {
+        bench_sink(str->count);
+        mem_talloc_free(str);
+        received++;
+    }
+    pthread_join(thread, NULL);
+    mem_talloc_free(dest);
+    report(pooled ? "strings copied (pool), 1x1" : "strings moved, 1x1", bench_now() - t, received);
+}
+
+int main(void) {
+    mem_talloc_module_init();
+    void* ctx = mem_talloc_new_ctx(NULL);
+    printf("channels, %ld messages (%d core(s))\n", MESSAGES, (int)sysconf(_SC_NPROCESSORS_ONLN));
+    bench_queues(ctx);
+    bench_select(ctx);
+    bench_strings(ctx, 0);
+    bench_strings(ctx, 1);
+    mem_talloc_free(ctx);
+    mem_talloc_module_shutdown();
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "bench.h"
+#include "classify.h"
+
+// Classification and UTF-8 kernels vs the byte loops they replaced.
+// Inputs pass every check, so each call scans the whole buffer.
+
+#define BUF_LEN (16u << 20)
+#define ITERS 20
+
+static bool digits_ctype(const char* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (!isdigit((unsigned char)d[i])) return false;
+    }
+    return true;
+}
+
+static bool ascii_loop(const char* d, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (d[i] & 0x80) return false;
+    }
+    return true;
+}
+
+// Straightforward decoder-style validator
+static bool utf8_loop(const unsigned char* s, size_t n) {
+    size_t i = 0;
+    while (i < n) {
+        unsigned c = s[i];
+        size_t k;
+        if (c < 0x80) { i++; continue; }
+        if (c >= 0xC2 && c <= 0xDF) k = 1;
+        else if (c >= 0xE0 && c <= 0xEF) k = 2;
+        else if (c >= 0xF0 && c <= 0xF4) k = 3;
+        else return false;
+        if (i + k >= n) return false;
+        if (c == 0xE0 && s[i + 1] < 0xA0) return false;
+        if (c == 0xED && s[i + 1] > 0x9F) return false;
+        if (c == 0xF0 && s[i + 1] < 0x90) return false;
+        if (c == 0xF4 && s[i + 1] > 0x8F) return false;
+        for (size_t j = 1; j <= k; j++) {
+            if ((s[i + j] & 0xC0) != 0x80) return false;
+        }
+        i += k + 1;
+    }
+    return true;
+}
+
+static size_t runes_loop(const char* d, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) count += (d[i] & 0xC0) != 0x80;
+    return count;
+}
+
+// Mixed-script text: about one non-ASCII character in eight
+static char* make_text(void) {
+    static const char* pieces[] = {"hello ", "world ", "caf\xc3\xa9 ", "\xe2\x82\xac", "na\xc3\xafve ", "\xf0\x9f\x98\x80", "text ", "\xe6\x97\xa5\xe6\x9c\xac "};
+    char* t = malloc(BUF_LEN + 16);
+    size_t p = 0;
+    uint32_t x = 12345;
+    while (p < BUF_LEN) {
+        x = x * 1103515245u + 12345u;
+        const char* s = pieces[(x >> 16) % 8];
+        size_t n = strlen(s);
+        memcpy(t + p, s, n);
+        p += n;
+    }
+    // Drop a partial sequence at the end
+    while ((t[BUF_LEN - 1] & 0x80)) t[BUF_LEN - 1] = ' ';
+    return t;
+}
+
+int main(void) {
+    char* digits = malloc(BUF_LEN);
+    for (size_t i = 0; i < BUF_LEN; i++) digits[i] = '0' + i % 10;
+    char* text = make_text();
+    double t;
+
+    printf("Classification (%u MiB)\n", BUF_LEN >> 20);
+
+    printf("isdigit\n");
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_classify_all(digits, BUF_LEN, COME_CLASS_DIGIT));
+    bench_report("come_classify_all", bench_now() - t, ITERS, BUF_LEN);
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(digits_ctype(digits, BUF_LEN));
+    bench_report("ctype isdigit loop", bench_now() - t, ITERS, BUF_LEN);
+
+    printf("isascii\n");
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_classify_ascii(digits, BUF_LEN));
+    bench_report("come_classify_ascii", bench_now() - t, ITERS, BUF_LEN);
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(ascii_loop(digits, BUF_LEN));
+    bench_report("byte loop", bench_now() - t, ITERS, BUF_LEN);
+
+    printf("utf8 (mixed text)\n");
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_classify_utf8(text, BUF_LEN));
+    bench_report("come_classify_utf8", bench_now() - t, ITERS, BUF_LEN);
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(utf8_loop((const unsigned char*)text, BUF_LEN));
+    bench_report("decoder loop", bench_now() - t, ITERS, BUF_LEN);
+
+    printf("utf8 (ASCII)\n");
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_classify_utf8(digits, BUF_LEN));
+    bench_report("come_classify_utf8", bench_now() - t, ITERS, BUF_LEN);
+
+    printf("count_runes\n");
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_classify_runes(text, BUF_LEN));
+    bench_report("come_classify_runes", bench_now() - t, ITERS, BUF_LEN);
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(runes_loop(text, BUF_LEN));
+    bench_report("byte loop", bench_now() - t, ITERS, BUF_LEN);
+
+    free(digits);
+    free(text);
+    return 0;
+}
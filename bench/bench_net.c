@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// net.tcp over loopback, client and server on one loop. "stream": the
+// client writes STREAM_BYTES in 64K writes and the server echoes every
+// read straight back, queued by reference and flushed after the handler.
+// The client keeps at most WINDOW bytes in flight, topping up as the echo
+// comes back: with more, both ends could sit above the high-water mark and
+// stop reading. "ping-pong": one 64-byte message in flight at a time,
+// round-trip times reported as p50/p99. Both report the loop's I/O system
+// calls; run with COME_NET_BACKEND=io_uring to compare the backends.
+
+#define PORT 39511
+#define STREAM_BYTES (256L << 20)
+#define WINDOW (2 * COME_NET_TCP_HIGH_WATER)
+#define PINGS 20000
+#define PING_SIZE 64
+
+typedef struct {
+    come_net_tcp_listener_t* listener;
+    come_net_tcp_conn_t* conn;
+} server_t;
+
+typedef struct {
+    come_net_tcp_conn_t* conn;
+    size_t received;
+    size_t sent;
+    int pings;
+    double sent_at;
+    double* rtt;
+    char msg[PING_SIZE];
+} client_t;
+
+static server_t server;
+static client_t client;
+
+static void echo(come_byte_array_t* data, void* env, void* ctx) {
+    (void)env;
+    (void)ctx;
+    come_net_tcp_write(server.conn, data);
+}
+
+static void server_hup(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)env;
+    (void)ctx;
+    come_net_tcp_close(server.listener);
+}
+
+static void server_accept(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)env;
+    (void)ctx;
+    server.conn = come_net_tcp_accept(server.listener);
+    come_net_tcp_on(server.conn, COME_NET_TCP_READABLE, echo, 0);
+    come_net_tcp_on(server.conn, COME_NET_TCP_HUP, server_hup, 0);
+}
+
+static char chunk[64 << 10];
+
+static void stream_fill(void) {
+    while (client.sent < STREAM_BYTES && client.sent + sizeof(chunk) - client.received <= WINDOW) {
+        come_net_tcp_write_bytes(client.conn, chunk, sizeof(chunk));
+        client.sent += sizeof(chunk);
+    }
+}
+
+static void stream_read(come_byte_array_t* data, void* env, void* ctx) {
+    (void)env;
+    (void)ctx;
+    client.received += data->count;
+    if (client.received == STREAM_BYTES) come_net_tcp_close(client.conn);
+    stream_fill();
+}
+
+static void ping_read(come_byte_array_t* data, void* env, void* ctx) {
+    (void)env;
+    (void)ctx;
+    client.received += data->count;
+    if (client.received < PING_SIZE) return;
+    client.received -= PING_SIZE;
+    client.rtt[client.pings++] = bench_now() - client.sent_at;
+    if (client.pings == PINGS) {
+        come_net_tcp_close(client.conn);
+        return;
+    }
+    client.sent_at = bench_now();
+    come_net_tcp_write_bytes(client.conn, client.msg, PING_SIZE);
+}
+
+static void start(come_net_tcp_handler_t client_read) {
+    memset(&server, 0, sizeof(server));
+    server.listener = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+    if (!server.listener) {
+        perror("listen");
+        exit(1);
+    }
+    come_net_tcp_on(server.listener, COME_NET_TCP_ACCEPT, server_accept, 0);
+    client.conn = come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT));
+    come_net_tcp_on(client.conn, COME_NET_TCP_READABLE, client_read, 0);
+    client.received = 0;
+}
+
+static void bench_stream(void) {
+    start(stream_read);
+    client.sent = 0;
+    long calls = come_net_syscalls();
+    double t0 = bench_now();
+    stream_fill();
+    come_net_run();
+    double secs = bench_now() - t0;
+    calls = come_net_syscalls() - calls;
+    if (client.received != STREAM_BYTES) printf("  stream: short echo (%zu bytes)\n", client.received);
+    bench_report("stream echo (256 MB)", secs, 1, STREAM_BYTES);
+    printf("  %-40s %10.1f per MB\n", "  system calls", calls / (double)(STREAM_BYTES >> 20));
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_ping_pong(void) {
+    start(ping_read);
+    client.pings = 0;
+    client.rtt = malloc(PINGS * sizeof(double));
+    long calls = come_net_syscalls();
+    double t0 = bench_now();
+    client.sent_at = t0;
+    come_net_tcp_write_bytes(client.conn, client.msg, PING_SIZE);
+    come_net_run();
+    double secs = bench_now() - t0;
+    calls = come_net_syscalls() - calls;
+    qsort(client.rtt, client.pings, sizeof(double), cmp_double);
+    bench_report("ping-pong round trip (64 B)", secs, client.pings, 0);
+    printf("  %-40s %10.1f us  p99 %.1f us\n", "  rtt p50", client.rtt[client.pings / 2] * 1e6,
+           client.rtt[client.pings * 99 / 100] * 1e6);
+    printf("  %-40s %10.1f per round trip\n", "  system calls", calls / (double)client.pings);
+    free(client.rtt);
+}
+
+int main(void) {
+    mem_talloc_module_init();
+    printf("net.tcp loopback (one loop, %s)\n", come_net_backend());
+    bench_stream();
+    bench_ping_pong();
+    mem_talloc_module_shutdown();
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bench.h"
+#include "come_string.h"
+#include "num.h"
+#include "mem/talloc.h"
+
+// Number parsing and formatting vs the libc calls they replaced: strtol,
+// strtod, and snprintf (which come_string_sprintf runs twice per call).
+
+#define COUNT 1000000
+#define ITERS 5
+
+static uint64_t state = 88172645463325252ull;
+
+static uint64_t next(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// COUNT numbers, one per line, and the offset of each
+static char* make_text(const char* fmt, bool doubles, size_t* offs, size_t* len) {
+    char* t = malloc(COUNT * 32);
+    size_t p = 0;
+    for (int i = 0; i < COUNT; i++) {
+        offs[i] = p;
+        if (doubles) {
+            double v = (double)(next() >> 11) / (1ull << 53) * pow(10, (int)(next() % 40) - 20);
+            p += sprintf(t + p, fmt, v);
+        } else {
+            p += sprintf(t + p, fmt, (long)(next() >> (next() % 64)));
+        }
+        t[p++] = '\n';
+    }
+    offs[COUNT] = p;
+    *len = p;
+    return t;
+}
+
+static void bench_ints(void) {
+    size_t* offs = malloc((COUNT + 1) * sizeof(size_t));
+    size_t len;
+    char* text = make_text("%ld", false, offs, &len);
+    long* vals = malloc(COUNT * sizeof(long));
+    double t;
+    printf("integers (%d per pass)\n", COUNT);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int i = 0; i < COUNT; i++) {
+            come_num_parse_long(text + offs[i], offs[i + 1] - offs[i] - 1, 10, &vals[i]);
+        }
+        bench_sink((uintptr_t)vals[COUNT - 1]);
+    }
+    bench_report("come_num_parse_long", bench_now() - t, ITERS, len);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int i = 0; i < COUNT; i++) vals[i] = strtol(text + offs[i], NULL, 10);
+        bench_sink((uintptr_t)vals[COUNT - 1]);
+    }
+    bench_report("strtol", bench_now() - t, ITERS, len);
+
+    char* out = malloc(COUNT * 32);
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        size_t p = 0;
+        for (int i = 0; i < COUNT; i++) p += come_num_format_long(out + p, vals[i]);
+        bench_sink(p);
+    }
+    bench_report("come_num_format_long", bench_now() - t, ITERS, len);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        size_t p = 0;
+        for (int i = 0; i < COUNT; i++) p += snprintf(out + p, 32, "%ld", vals[i]);
+        bench_sink(p);
+    }
+    bench_report("snprintf %ld", bench_now() - t, ITERS, len);
+
+    // Building one string: appending in place vs a sprintf result per number
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        come_string_t* s = come_string_new(ctx, "");
+        for (int i = 0; i < COUNT; i++) come_string_append_long(s, vals[i]);
+        bench_sink(s->count);
+        mem_talloc_free(s);
+    }
+    bench_report("come_string_append_long", bench_now() - t, ITERS, len);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int i = 0; i < COUNT; i++) {
+            come_string_t* s = come_string_sprintf(ctx, "%ld", vals[i]);
+            bench_sink(s->count);
+            mem_talloc_free(s);
+        }
+    }
+    bench_report("come_string_sprintf %ld", bench_now() - t, ITERS, len);
+    mem_talloc_free(ctx);
+
+    free(out);
+    free(vals);
+    free(text);
+    free(offs);
+}
+
+static void bench_doubles(const char* name, const char* fmt) {
+    size_t* offs = malloc((COUNT + 1) * sizeof(size_t));
+    size_t len;
+    char* text = make_text(fmt, true, offs, &len);
+    double* vals = malloc(COUNT * sizeof(double));
+    double t;
+    printf("%s (%d per pass)\n", name, COUNT);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int i = 0; i < COUNT; i++) {
+            come_num_parse_double(text + offs[i], offs[i + 1] - offs[i] - 1, &vals[i]);
+        }
+        bench_sink((uintptr_t)vals[COUNT - 1]);
+    }
+    bench_report("come_num_parse_double", bench_now() - t, ITERS, len);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int i = 0; i < COUNT; i++) vals[i] = strtod(text + offs[i], NULL);
+        bench_sink((uintptr_t)vals[COUNT - 1]);
+    }
+    bench_report("strtod", bench_now() - t, ITERS, len);
+
+    char* out = malloc(COUNT * 32);
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        size_t p = 0;
+        for (int i = 0; i < COUNT; i++) p += come_num_format_double(out + p, vals[i]);
+        bench_sink(p);
+    }
+    bench_report("come_num_format_double (shortest)", bench_now() - t, ITERS, len);
+
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        size_t p = 0;
+        for (int i = 0; i < COUNT; i++) p += snprintf(out + p, 32, "%.17g", vals[i]);
+        bench_sink(p);
+    }
+    bench_report("snprintf %.17g (not shortest)", bench_now() - t, ITERS, len);
+
+    free(out);
+    free(vals);
+    free(text);
+    free(offs);
+}
+
+int main(void) {
+    printf("Numeric conversion\n");
+    bench_ints();
+    bench_doubles("doubles, 17 digits", "%.17g");
+    bench_doubles("doubles, 6 digits", "%g");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// Allocation-heavy string work on a plain talloc context vs a pool.
+// "request": a context per request that splits, trims, upper-cases and joins
+// a header line, then is freed. "module": many small strings kept on one
+// long-lived context, as generated module contexts do.
+
+#define REQUESTS 200000
+#define STRINGS 1000000
+#define ITERS 3
+
+static const char* line = "Accept: text/html, application/xhtml+xml, application/xml;q=0.9, image/avif, image/webp, */*;q=0.8";
+
+static void request(TALLOC_CTX* ctx) {
+    come_string_t* s = come_string_new(ctx, line);
+    come_string_list_t* parts = come_string_split(s, ",");
+    for (uint32_t i = 0; i < parts->count; i++) {
+        parts->items[i] = come_string_upper(come_string_trim(parts->items[i], NULL));
+    }
+    come_string_t* joined = come_string_join(parts, come_string_new(ctx, ";"));
+    bench_sink(joined->count);
+}
+
+static void bench_requests(const char* name, bool pooled) {
+    TALLOC_CTX* root = mem_talloc_new_ctx(NULL);
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        for (int r = 0; r < REQUESTS; r++) {
+            TALLOC_CTX* ctx = pooled ? mem_talloc_pool_new(root, 4096) : mem_talloc_new_ctx(root);
+            request(ctx);
+            mem_talloc_free(ctx);
+        }
+    }
+    bench_report(name, bench_now() - t, ITERS * (long)REQUESTS, 0);
+    mem_talloc_free(root);
+}
+
+static void bench_module(const char* name, size_t pool) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        TALLOC_CTX* ctx = pool ? mem_talloc_pool_new(NULL, pool) : mem_talloc_new_ctx(NULL);
+        for (int i = 0; i < STRINGS; i++) bench_sink((uintptr_t)come_string_new(ctx, "key"));
+        mem_talloc_free(ctx);
+    }
+    bench_report(name, bench_now() - t, ITERS, 0);
+}
+
+int main(void) {
+    printf("talloc pools (per request)\n");
+    bench_requests("new_ctx per request", false);
+    bench_requests("4 KiB pool per request", true);
+
+    printf("talloc pools (%d small strings, then free)\n", STRINGS);
+    bench_module("new_ctx", 0);
+    bench_module("64 KiB pool (module default)", MEM_TALLOC_MODULE_POOL);
+    bench_module("64 MiB pool (fits all)", 64u << 20);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include "bench.h"
+#include "come_string.h"
+#include "re.h"
+#include "mem/talloc.h"
+
+// Native regex engine vs glibc regexec on a synthetic log corpus.
+// Every pattern is run over every line, the way a log filter uses it.
+
+#define LINES 100000
+#define ITERS 3
+
+static const char* levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+static const char* paths[] = {"/api/v1/users", "/api/v1/orders", "/static/app.js", "/healthz", "/login"};
+
+typedef struct {
+    char* buf;
+    size_t* off;
+    size_t* len;
+    size_t bytes;
+} corpus_t;
+
+static corpus_t make_corpus(void) {
+    corpus_t c;
+    c.buf = malloc(LINES * 160);
+    c.off = malloc(sizeof(size_t) * LINES);
+    c.len = malloc(sizeof(size_t) * LINES);
+    size_t p = 0;
+    uint32_t x = 12345;
+    for (int i = 0; i < LINES; i++) {
+        x = x * 1103515245u + 12345u;
+        int n = snprintf(c.buf + p, 160,
+                         "2024-03-%02u 12:%02u:%02u %s [worker-%u] GET %s status=%u latency=%ums ip=10.%u.%u.%u",
+                         1 + (x >> 8) % 28, (x >> 12) % 60, (x >> 16) % 60, levels[(x >> 20) % 4], (x >> 4) % 16,
+                         paths[(x >> 24) % 5], (x >> 3) % 7 == 0 ? 500 : 200, (x >> 10) % 900,
+                         (x >> 5) % 256, (x >> 13) % 256, (x >> 21) % 256);
+        if (i % 997 == 0) n += snprintf(c.buf + p + n, 40, " timeout after retry");
+        c.off[i] = p;
+        c.len[i] = n;
+        p += n + 1;
+    }
+    c.bytes = p;
+    return c;
+}
+
+static const char* patterns[] = {
+    "ERROR",
+    "status=5[0-9][0-9]",
+    "latency=[0-9]{3}ms",
+    "(WARN|ERROR).*timeout",
+    "^2024-03-0[1-7]",
+    "ip=10\\.[0-9]+\\.[0-9]+\\.1[0-9]{2}$",
+    "[a-z]+@[a-z]+\\.com",
+    "GET /api/v[0-9]+/(users|orders)",
+};
+#define N_PATTERNS (sizeof(patterns) / sizeof(patterns[0]))
+
+static void bench_patterns(const corpus_t* c) {
+    for (size_t k = 0; k < N_PATTERNS; k++) {
+        printf("/%s/\n", patterns[k]);
+        come_re_prog_t* prog = come_re_compile(patterns[k]);
+        regex_t re;
+        regcomp(&re, patterns[k], REG_EXTENDED | REG_NOSUB);
+        size_t hits_native = 0, hits_libc = 0;
+        double t;
+
+        t = bench_now();
+        for (int it = 0; it < ITERS; it++) {
+            for (int i = 0; i < LINES; i++) hits_native += come_re_match(prog, c->buf + c->off[i], c->len[i]);
+        }
+        bench_report("come_re_match", bench_now() - t, ITERS, c->bytes);
+
+        t = bench_now();
+        for (int it = 0; it < ITERS; it++) {
+            for (int i = 0; i < LINES; i++) {
+                regmatch_t m[1] = {{0, (regoff_t)c->len[i]}};
+                hits_libc += regexec(&re, c->buf + c->off[i], 1, m, REG_STARTEND) == 0;
+            }
+        }
+        bench_report("glibc regexec", bench_now() - t, ITERS, c->bytes);
+
+        if (hits_native != hits_libc) printf("  MISMATCH: %zu vs %zu hits\n", hits_native, hits_libc);
+        bench_sink(hits_native);
+        regfree(&re);
+        come_re_free(prog);
+    }
+}
+
+static void bench_set(const corpus_t* c) {
+    printf("all %zu patterns per line\n", N_PATTERNS);
+    come_re_prog_t* set = come_re_compile_set(patterns, N_PATTERNS);
+    regex_t res[N_PATTERNS];
+    for (size_t k = 0; k < N_PATTERNS; k++) regcomp(&res[k], patterns[k], REG_EXTENDED | REG_NOSUB);
+    uint8_t hits[N_PATTERNS];
+    size_t total_set = 0, total_libc = 0;
+    double t;
+
+    t = bench_now();
+    for (int i = 0; i < LINES; i++) total_set += come_re_set_match(set, c->buf + c->off[i], c->len[i], hits);
+    bench_report("come_re_set_match", bench_now() - t, 1, c->bytes);
+
+    t = bench_now();
+    for (int i = 0; i < LINES; i++) {
+        for (size_t k = 0; k < N_PATTERNS; k++) {
+            regmatch_t m[1] = {{0, (regoff_t)c->len[i]}};
+            total_libc += regexec(&res[k], c->buf + c->off[i], 1, m, REG_STARTEND) == 0;
+        }
+    }
+    bench_report("glibc regexec x patterns", bench_now() - t, 1, c->bytes);
+
+    if (total_set != total_libc) printf("  MISMATCH: %zu vs %zu hits\n", total_set, total_libc);
+    for (size_t k = 0; k < N_PATTERNS; k++) regfree(&res[k]);
+    come_re_free(set);
+}
+
+static void bench_replace(const corpus_t* c) {
+    printf("replace digits in every line (string API)\n");
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_regex_t* re = come_regex_compile(ctx, "[0-9]+");
+    come_string_t* s = come_string_new_len(ctx, c->buf, c->bytes - 1);
+    come_string_list_t* lines = come_string_split_view(s, "\n", 0);
+    double t = bench_now();
+    for (uint32_t i = 0; i < lines->count; i++) {
+        come_string_t* r = come_regex_replace(re, lines->items[i], "#", 0);
+        bench_sink(r->count);
+        mem_talloc_free(r);
+    }
+    bench_report("come_regex_replace", bench_now() - t, 1, c->bytes);
+
+    // Baseline: only locating the same matches with regexec
+    regex_t libc;
+    regcomp(&libc, "[0-9]+", REG_EXTENDED);
+    t = bench_now();
+    for (int i = 0; i < LINES; i++) {
+        const char* line = c->buf + c->off[i];
+        regoff_t p = 0, len = (regoff_t)c->len[i];
+        regmatch_t m[1] = {{0, len}};
+        while (p < len && regexec(&libc, line, 1, m, REG_STARTEND) == 0) {
+            p = m[0].rm_eo > m[0].rm_so ? m[0].rm_eo : m[0].rm_so + 1;
+            m[0].rm_so = p;
+            m[0].rm_eo = len;
+        }
+        bench_sink(p);
+    }
+    bench_report("glibc regexec match loop", bench_now() - t, 1, c->bytes);
+    regfree(&libc);
+    mem_talloc_free(ctx);
+}
+
+// (a|aa)*[bc] against a run of 'a': no match, and no literal for the prefilter
+static void bench_pathological(void) {
+    size_t n = 1 << 14;
+    char* s = malloc(n + 1);
+    memset(s, 'a', n);
+    s[n] = '\0';
+    const char* pat = "(a|aa)*[bc]";
+    printf("/%s/ on %zu x 'a'\n", pat, n);
+
+    come_re_prog_t* prog = come_re_compile(pat);
+    double t = bench_now();
+    bench_sink(come_re_match(prog, s, n));
+    bench_report("come_re_match", bench_now() - t, 1, n);
+    come_re_free(prog);
+
+    regex_t re;
+    regcomp(&re, pat, REG_EXTENDED | REG_NOSUB);
+    t = bench_now();
+    regmatch_t m[1] = {{0, (regoff_t)n}};
+    bench_sink(regexec(&re, s, 1, m, REG_STARTEND));
+    bench_report("glibc regexec", bench_now() - t, 1, n);
+    regfree(&re);
+    free(s);
+}
+
+int main(void) {
+    corpus_t c = make_corpus();
+    printf("Regex (%d log lines, %.1f MiB)\n", LINES, c.bytes / 1048576.0);
+    bench_patterns(&c);
+    bench_set(&c);
+    bench_replace(&c);
+    bench_pathological();
+    free(c.buf);
+    free(c.off);
+    free(c.len);
+    return 0;
+}
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "come_sched.h"
+#include "mem/talloc.h"
+
+// Fork/join on the work-stealing scheduler, lowered the way spawn/join is:
+// a closure per task, allocated on the spawning context, joined with
+// come_sched_join. "fib": recursive fib with a sequential cutoff, so the
+// scheduler sees ~10^5 tasks. "sum": divide-and-conquer sum of a 64M-element
+// array in 16K leaves. "parallel for": the same sum lowered the way
+// parallel for is, with static and dynamic chunking, and with reduction
+// slots packed next to each other instead of padded to a cache line (the
+// body accumulates in its slot, as a naive lowering would, to show false
+// sharing). Each runs with 1, 2, 4, ... workers up to the core count;
+// speedup is against 1 worker.
+
+#define FIB_N 36
+#define FIB_CUTOFF 12
+#define SUM_LEN (64L << 20)
+#define SUM_LEAF (16 << 10)
+#define ITERS 3
+
+static __thread void* task_ctx = NULL;
+
+static long fib_seq(int n) {
+    return n < 2 ? n : fib_seq(n - 1) + fib_seq(n - 2);
+}
+
+typedef struct {
+    come_sched_task_t task;
+    int n;
+    long result;
+} fib_task_t;
+
+static long fib(int n);
+
+static void fib_run(come_sched_task_t* task) {
+    fib_task_t* self = (fib_task_t*)task;
+    void* outer = task_ctx;
+    task_ctx = task->ctx;
+    self->result = fib(self->n);
+    task_ctx = outer;
+}
+
+static long fib(int n) {
+    if (n < FIB_CUTOFF) return fib_seq(n);
+    fib_task_t* left = mem_talloc_alloc(task_ctx, sizeof(fib_task_t));
+    memset(left, 0, sizeof(*left));
+    left->task.run = fib_run;
+    left->n = n - 1;
+    come_sched_spawn(&left->task);
+    long right = fib(n - 2);
+    come_sched_join(&left->task, task_ctx);
+    long result = left->result + right;
+    mem_talloc_free(left);
+    return result;
+}
+
+typedef struct {
+    come_sched_task_t task;
+    const int* items;
+    long len;
+    long result;
+} sum_task_t;
+
+static long sum(const int* items, long len);
+
+static void sum_run(come_sched_task_t* task) {
+    sum_task_t* self = (sum_task_t*)task;
+    void* outer = task_ctx;
+    task_ctx = task->ctx;
+    self->result = sum(self->items, self->len);
+    task_ctx = outer;
+}
+
+static long sum(const int* items, long len) {
+    if (len <= SUM_LEAF) {
+        long total = 0;
+        for (long i = 0; i < len; i++) total += items[i];
+        return total;
+    }
+    long half = len / 2;
+    sum_task_t* left = mem_talloc_alloc(task_ctx, sizeof(sum_task_t));
+    memset(left, 0, sizeof(*left));
+    left->task.run = sum_run;
+    left->items = items;
+    left->len = half;
+    come_sched_spawn(&left->task);
+    long right = sum(items + half, len - half);
+    come_sched_join(&left->task, task_ctx);
+    long result = left->result + right;
+    mem_talloc_free(left);
+    return result;
+}
+
+static double run_fib(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(fib(FIB_N));
+    return bench_now() - t;
+}
+
+static const int* sum_items;
+
+static double run_sum(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(sum(sum_items, SUM_LEN));
+    return bench_now() - t;
+}
+
+typedef struct {
+    long sum;
+} __attribute__((aligned(64))) padded_slot_t;
+
+static void sum_body(void** env, long lo, long hi, void* slot, void* ctx) {
+    (void)ctx;
+    const int* items = *(const int**)env[0];
+    long total = 0;
+    for (long i = lo; i < hi; i++) total += items[i];
+    *(long*)slot += total;
+}
+
+static void sum_body_in_slot(void** env, long lo, long hi, void* slot, void* ctx) {
+    (void)ctx;
+    const int* items = *(const int**)env[0];
+    volatile long* sum = slot;
+    for (long i = lo; i < hi; i++) *sum += items[i];
+}
+
+static long pfor_sum(come_parallel_body_t body, int dynamic, size_t slot_size) {
+    int width = come_parallel_width();
+    char* slots = aligned_alloc(64, width * 64);
+    memset(slots, 0, width * 64);
+    void* env[] = { &sum_items, NULL };
+    come_parallel_for(&(come_parallel_for_t){ .lo = 0, .hi = SUM_LEN, .dynamic = dynamic,
+        .body = body, .env = env, .slots = slots, .slot_size = slot_size, .width = width });
+    long total = 0;
+    for (int p = 0; p < width; p++) total += *(long*)(slots + p * slot_size);
+    free(slots);
+    return total;
+}
+
+static double run_pfor_static(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(pfor_sum(sum_body, 0, sizeof(padded_slot_t)));
+    return bench_now() - t;
+}
+
+static double run_pfor_dynamic(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(pfor_sum(sum_body, 1, sizeof(padded_slot_t)));
+    return bench_now() - t;
+}
+
+static double run_pfor_padded(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(pfor_sum(sum_body_in_slot, 0, sizeof(padded_slot_t)));
+    return bench_now() - t;
+}
+
+static double run_pfor_packed(void) {
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(pfor_sum(sum_body_in_slot, 0, sizeof(long)));
+    return bench_now() - t;
+}
+
+static void scale(const char* name, double (*run)(void), int cores) {
+    double base = 0;
+    for (int workers = 1; workers <= cores; workers *= 2) {
+        come_sched_start(workers);
+        double secs = run();
+        come_sched_shutdown();
+        if (workers == 1) base = secs;
+        char label[64];
+        snprintf(label, sizeof(label), "%s, %d worker(s)", name, workers);
+        bench_report(label, secs, ITERS, 0);
+        printf("  %-40s %10.2fx\n", "  speedup", base / secs);
+    }
+}
+
+int main(void) {
+    mem_talloc_module_init();
+    task_ctx = mem_talloc_new_ctx(NULL);
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+
+    printf("scheduler fork/join (%d core(s))\n", cores);
+    double t = bench_now();
+    for (int it = 0; it < ITERS; it++) bench_sink(fib_seq(FIB_N));
+    bench_report("fib(36) sequential", bench_now() - t, ITERS, 0);
+    scale("fib(36) spawn/join", run_fib, cores);
+
+    int* items = malloc(SUM_LEN * sizeof(int));
+    for (long i = 0; i < SUM_LEN; i++) items[i] = (int)(i & 1023);
+    sum_items = items;
+    t = bench_now();
+    for (int it = 0; it < ITERS; it++) {
+        long total = 0;
+        for (long i = 0; i < SUM_LEN; i++) total += items[i];
+        bench_sink(total);
+    }
+    bench_report("sum(64M) sequential", bench_now() - t, ITERS, 0);
+    scale("sum(64M) spawn/join", run_sum, cores);
+    scale("sum(64M) pfor static", run_pfor_static, cores);
+    scale("sum(64M) pfor dynamic", run_pfor_dynamic, cores);
+    scale("sum(64M) pfor padded slots", run_pfor_padded, cores);
+    scale("sum(64M) pfor packed slots", run_pfor_packed, cores);
+    free(items);
+
+    mem_talloc_free(task_ctx);
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "come_array.h"
+#include "come_string.h"
+#include "come_sched.h"
+#include "mem/talloc.h"
+
+// The array sorts against qsort: radix sorts of numbers, pdqsort with a
+// comparator on the inputs that decide a quicksort's fate, the multikey
+// string sort and the parallel merge sort.
+
+#define N 1000000
+#define STRINGS 200000
+#define ITERS 5
+
+static unsigned long rng_state = 88172645463325252UL;
+
+static unsigned long rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static int cmp_int(const void* a, const void* b, void* ctx) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int qsort_int(const void* a, const void* b) {
+    return cmp_int(a, b, NULL);
+}
+
+static int qsort_long(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static int qsort_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int qsort_string(const void* a, const void* b) {
+    const come_string_t* x = *(come_string_t* const*)a;
+    const come_string_t* y = *(come_string_t* const*)b;
+    size_t n = x->count < y->count ? x->count : y->count;
+    int r = memcmp(x->data, y->data, n);
+    return r ? r : (x->count > y->count) - (x->count < y->count);
+}
+
+// Copy the input in and sort it ITERS times; report the time per sort
+#define BENCH_SORT(label, T, input, n, SORT) do { \
+        T* a = malloc((n) * sizeof(T)); \
+        double secs = 0; \
+        for (int it = 0; it < ITERS; it++) { \
+            memcpy(a, input, (n) * sizeof(T)); \
+            double t = bench_now(); \
+            SORT; \
+            secs += bench_now() - t; \
+            bench_sink((uintptr_t)a[(n) / 2]); \
+        } \
+        bench_report(label, secs, ITERS, (n) * sizeof(T)); \
+        free(a); \
+    } while (0)
+
+static void bench_numbers(void) {
+    int* ints = malloc(N * sizeof(int));
+    long* longs = malloc(N * sizeof(long));
+    double* doubles = malloc(N * sizeof(double));
+    uint8_t* bytes = malloc(N);
+    for (long i = 0; i < N; i++) {
+        ints[i] = (int)rng();
+        longs[i] = (long)rng();
+        doubles[i] = (double)(long)rng() / 1e9;
+        bytes[i] = (uint8_t)rng();
+    }
+
+    printf("1M random numbers\n");
+    BENCH_SORT("int qsort", int, ints, N, qsort(a, N, sizeof(int), qsort_int));
+    BENCH_SORT("int pdqsort (comparator)", int, ints, N, come_sort(a, N, sizeof(int), cmp_int, NULL));
+    BENCH_SORT("int radix", int, ints, N, come_radix_sort_i32(a, N));
+    BENCH_SORT("long qsort", long, longs, N, qsort(a, N, sizeof(long), qsort_long));
+    BENCH_SORT("long radix", long, longs, N, come_radix_sort_i64(a, N));
+    BENCH_SORT("double qsort", double, doubles, N, qsort(a, N, sizeof(double), qsort_double));
+    BENCH_SORT("double radix", double, doubles, N, come_radix_sort_f64(a, N));
+    BENCH_SORT("byte counting sort", uint8_t, bytes, N, come_radix_sort_u8(a, N));
+    free(ints);
+    free(longs);
+    free(doubles);
+    free(bytes);
+}
+
+static void bench_patterns(void) {
+    static const char* names[] = { "sorted", "reversed", "few unique", "organ pipe", "sorted + 1% noise" };
+    int* input = malloc(N * sizeof(int));
+    printf("1M ints, comparator sorts by input pattern\n");
+    for (int p = 0; p < 5; p++) {
+        for (long i = 0; i < N; i++) {
+            switch (p) {
+                case 0: input[i] = (int)i; break;
+                case 1: input[i] = (int)(N - i); break;
+                case 2: input[i] = (int)(rng() % 8); break;
+                case 3: input[i] = (int)(i < N / 2 ? i : N - i); break;
+                case 4: input[i] = rng() % 100 ? (int)i : (int)(rng() % N); break;
+            }
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "%s: qsort", names[p]);
+        BENCH_SORT(label, int, input, N, qsort(a, N, sizeof(int), qsort_int));
+        snprintf(label, sizeof(label), "%s: pdqsort", names[p]);
+        BENCH_SORT(label, int, input, N, come_sort(a, N, sizeof(int), cmp_int, NULL));
+    }
+    free(input);
+}
+
+static void bench_strings(void) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t** input = malloc(STRINGS * sizeof(come_string_t*));
+    // URL-like keys: long shared prefixes, where byte-at-a-time comparisons repeat work
+    for (long i = 0; i < STRINGS; i++) {
+        char buf[64];
+        int len = snprintf(buf, sizeof(buf), "https://example.com/api/v1/items/%lu", rng() % 1000000);
+        input[i] = come_string_new_len(ctx, buf, len);
+    }
+    printf("200k strings with shared prefixes\n");
+    BENCH_SORT("qsort (memcmp)", come_string_t*, input, STRINGS,
+               qsort(a, STRINGS, sizeof(come_string_t*), qsort_string));
+    BENCH_SORT("multikey quicksort", come_string_t*, input, STRINGS, come_string_sort(a, STRINGS));
+    free(input);
+    mem_talloc_free(ctx);
+}
+
+static void bench_parallel(int cores) {
+    int* input = malloc(N * sizeof(int));
+    for (long i = 0; i < N; i++) input[i] = (int)rng();
+    printf("1M random ints, parallel merge sort (%d core(s))\n", cores);
+    for (int workers = 1; workers <= cores; workers *= 2) {
+        come_sched_start(workers);
+        char label[64];
+        snprintf(label, sizeof(label), "parallel sort, %d worker(s)", workers);
+        BENCH_SORT(label, int, input, N, come_sort_parallel(a, N, sizeof(int), cmp_int, NULL));
+        come_sched_shutdown();
+    }
+    free(input);
+}
+
+int main(void) {
+    mem_talloc_module_init();
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    bench_numbers();
+    bench_patterns();
+    bench_strings();
+    bench_parallel(cores);
+    mem_talloc_module_shutdown();
+    return 0;
+}
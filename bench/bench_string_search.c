@@ -0,0 +1,126 @@
+#define _GNU_SOURCE // memmem
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "come_string.h"
+#include "search.h"
+#include "mem/talloc.h"
+
+// Substring search kernels vs glibc on a large haystack.
+// The needle sits at the very end so every search scans the whole input.
+
+#define HAY_LEN (16u << 20)
+#define ITERS 20
+
+static char* make_haystack(void) {
+    char* h = malloc(HAY_LEN + 1);
+    uint32_t x = 12345;
+    for (size_t i = 0; i < HAY_LEN; i++) {
+        x = x * 1103515245u + 12345u;
+        h[i] = (i % 64 == 63) ? '\n' : 'a' + (x >> 16) % 26;
+    }
+    h[HAY_LEN] = '\0';
+    return h;
+}
+
+// The old rfind: strncmp at every position from the end
+static const char* rfind_naive(const char* h, size_t hl, const char* n, size_t nl) {
+    for (long i = hl - nl; i >= 0; i--) {
+        if (strncmp(h + i, n, nl) == 0) return h + i;
+    }
+    return NULL;
+}
+
+static void bench_find(char* hay, size_t nl) {
+    char needle[300];
+    for (size_t i = 0; i < nl; i++) needle[i] = 'A' + i % 26; // Never occurs in the haystack
+    needle[nl] = '\0';
+    memcpy(hay + HAY_LEN - nl, needle, nl);
+    char name[64];
+    double t;
+
+    printf("needle %zu bytes\n", nl);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink((uintptr_t)come_search_find(hay, HAY_LEN, needle, nl));
+    snprintf(name, sizeof(name), "come_search_find");
+    bench_report(name, bench_now() - t, ITERS, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink((uintptr_t)memmem(hay, HAY_LEN, needle, nl));
+    bench_report("glibc memmem", bench_now() - t, ITERS, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink((uintptr_t)strstr(hay, needle));
+    bench_report("glibc strstr", bench_now() - t, ITERS, HAY_LEN);
+
+    // Needle moved to the front so rfind scans everything
+    memset(hay + HAY_LEN - nl, 'a', nl);
+    memcpy(hay, needle, nl);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink((uintptr_t)come_search_rfind(hay, HAY_LEN, needle, nl));
+    bench_report("come_search_rfind", bench_now() - t, ITERS, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < 2; i++) bench_sink((uintptr_t)rfind_naive(hay, HAY_LEN, needle, nl));
+    bench_report("strncmp rfind loop", bench_now() - t, 2, HAY_LEN);
+
+    memset(hay, 'a', nl);
+}
+
+static void bench_count_split(char* hay) {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new_len(ctx, hay, HAY_LEN);
+    double t;
+
+    printf("count / split on '\\n' (%u lines)\n", HAY_LEN / 64);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_search_count(hay, HAY_LEN, "\n", 1));
+    bench_report("come_search_count", bench_now() - t, ITERS, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) {
+        size_t c = 0;
+        const char* p = hay;
+        while ((p = memchr(p, '\n', hay + HAY_LEN - p)) != NULL) { c++; p++; }
+        bench_sink(c);
+    }
+    bench_report("glibc memchr loop", bench_now() - t, ITERS, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < 4; i++) {
+        come_string_list_t* l = come_string_split(s, "\n");
+        bench_sink(l->count);
+        mem_talloc_free(l);
+    }
+    bench_report("come_string_split", bench_now() - t, 4, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < 4; i++) {
+        come_string_list_t* l = come_string_split_view(s, "\n", 0);
+        bench_sink(l->count);
+        mem_talloc_free(l);
+    }
+    bench_report("come_string_split_view", bench_now() - t, 4, HAY_LEN);
+
+    t = bench_now();
+    for (int i = 0; i < ITERS; i++) bench_sink(come_search_count(hay, HAY_LEN, "ab", 2));
+    bench_report("come_search_count \"ab\"", bench_now() - t, ITERS, HAY_LEN);
+
+    mem_talloc_free(ctx);
+}
+
+int main(void) {
+    char* hay = make_haystack();
+    printf("String search (%u MiB haystack)\n", HAY_LEN >> 20);
+    size_t lens[] = {1, 4, 16, 64, 256};
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        bench_find(hay, lens[i]);
+    }
+    bench_count_split(hay);
+    free(hay);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Build and run the runtime benchmarks (optimized, not part of `make test`)
+set -e
+mkdir -p build/bench
+CFLAGS="-O2 -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/string -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace"
+TALLOC="src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c"
+
+gcc $CFLAGS bench/bench_string_search.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_string_search -ldl
+./build/bench/bench_string_search
+
+gcc $CFLAGS bench/bench_regex.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_regex -ldl
+./build/bench/bench_regex
+
+gcc $CFLAGS bench/bench_classify.c src/string/classify.c -o build/bench/bench_classify
+./build/bench/bench_classify
+
+gcc $CFLAGS bench/bench_case.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_case -ldl
+./build/bench/bench_case
+
+gcc $CFLAGS bench/bench_numeric.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_numeric -ldl -lm
+./build/bench/bench_numeric
+
+gcc $CFLAGS bench/bench_pool.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_pool -ldl
+./build/bench/bench_pool
+
+gcc $CFLAGS bench/bench_alloc.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_alloc_talloc -ldl
+./build/bench/bench_alloc_talloc
+
+gcc $CFLAGS -DALLOC_BACKEND='"arena"' bench/bench_alloc.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/arena.c src/core/utils.c -o build/bench/bench_alloc_arena
+./build/bench/bench_alloc_arena
+
+gcc $CFLAGS bench/bench_sched.c src/sched/sched.c $TALLOC -o build/bench/bench_sched -ldl
+./build/bench/bench_sched
+
+gcc $CFLAGS bench/bench_chan.c src/sched/chan.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_chan -ldl
+./build/bench/bench_chan
+
+gcc $CFLAGS bench/bench_net.c src/net/tcp.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_net -ldl
+./build/bench/bench_net
+COME_NET_BACKEND=io_uring ./build/bench/bench_net
+
+gcc $CFLAGS bench/bench_http.c src/net/http.c src/net/tcp.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_http -ldl
+./build/bench/bench_http
+COME_NET_BACKEND=io_uring ./build/bench/bench_http
+
+gcc $CFLAGS bench/bench_sort.c src/array/sort.c src/array/array.c src/sched/sched.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c $TALLOC -o build/bench/bench_sort -ldl
+./build/bench/bench_sort
@@ -22,6 +22,7 @@ void* come_array_alloc(TALLOC_CTX* ctx, size_t elem_size, uint32_t count) {
 
 void* come_array_realloc(void* arr, size_t elem_size, uint32_t new_size) {
     size_t header_size = sizeof(uint32_t) * 2;
+    if (arr && (((uint32_t*)arr)[0] & COME_SHARED)) arr = come_array_unshare(arr, elem_size);
     uint32_t old_size = arr ? ((uint32_t*)arr)[0] : 0;
     
     void* new_arr = mem_talloc_realloc(NULL, arr, header_size + elem_size * new_size);
@@ -49,6 +50,18 @@ void* come_byte_array_resize(come_byte_array_t* a, uint32_t n) {
     return (come_byte_array_t*)come_array_realloc(a, sizeof(uint8_t), n);
 }
 
+void* come_long_array_resize(come_long_array_t* a, uint32_t n) {
+    return (come_long_array_t*)come_array_realloc(a, sizeof(long), n);
+}
+
+void* come_float_array_resize(come_float_array_t* a, uint32_t n) {
+    return (come_float_array_t*)come_array_realloc(a, sizeof(float), n);
+}
+
+void* come_double_array_resize(come_double_array_t* a, uint32_t n) {
+    return (come_double_array_t*)come_array_realloc(a, sizeof(double), n);
+}
+
 void* come_string_list_resize(come_string_list_t* a, uint32_t n) {
     return (come_string_list_t*)come_array_realloc(a, sizeof(void*), n);
 }
@@ -83,6 +96,45 @@ come_byte_array_t* come_byte_array_slice(come_byte_array_t* a, uint32_t start, u
     return res;
 }
 
+come_long_array_t* come_long_array_slice(come_long_array_t* a, uint32_t start, uint32_t end) {
+    if (!a || start >= a->count || start >= end) {
+        return (come_long_array_t*)come_array_alloc((void*)a, sizeof(long), 0);
+    }
+    if (end > a->count) end = a->count;
+    uint32_t n = end - start;
+    come_long_array_t* res = (come_long_array_t*)come_array_alloc((void*)a, sizeof(long), n);
+    if (res) {
+        memcpy(res->items, &a->items[start], n * sizeof(long));
+    }
+    return res;
+}
+
+come_float_array_t* come_float_array_slice(come_float_array_t* a, uint32_t start, uint32_t end) {
+    if (!a || start >= a->count || start >= end) {
+        return (come_float_array_t*)come_array_alloc((void*)a, sizeof(float), 0);
+    }
+    if (end > a->count) end = a->count;
+    uint32_t n = end - start;
+    come_float_array_t* res = (come_float_array_t*)come_array_alloc((void*)a, sizeof(float), n);
+    if (res) {
+        memcpy(res->items, &a->items[start], n * sizeof(float));
+    }
+    return res;
+}
+
+come_double_array_t* come_double_array_slice(come_double_array_t* a, uint32_t start, uint32_t end) {
+    if (!a || start >= a->count || start >= end) {
+        return (come_double_array_t*)come_array_alloc((void*)a, sizeof(double), 0);
+    }
+    if (end > a->count) end = a->count;
+    uint32_t n = end - start;
+    come_double_array_t* res = (come_double_array_t*)come_array_alloc((void*)a, sizeof(double), n);
+    if (res) {
+        memcpy(res->items, &a->items[start], n * sizeof(double));
+    }
+    return res;
+}
+
 come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start, uint32_t end) {
     if (!a || start >= a->count || start >= end) {
         return (come_string_list_t*)come_array_alloc((void*)a, sizeof(void*), 0);
@@ -95,3 +147,155 @@ come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start
     }
     return res;
 }
+
+// Header and items in one memcpy; the copy's capacity is its count
+static void* array_dup(TALLOC_CTX* ctx, const void* a, size_t elem_size) {
+    if (!a) return NULL;
+    size_t header_size = sizeof(uint32_t) * 2;
+    uint32_t count = ((const uint32_t*)a)[1];
+    size_t bytes = header_size + elem_size * count;
+    uint32_t* copy = mem_talloc_alloc(ctx, bytes);
+    if (!copy) return NULL;
+    memcpy(copy, a, bytes);
+    copy[0] = count;
+    return copy;
+}
+
+come_int_array_t* come_int_array_dup(TALLOC_CTX* ctx, const come_int_array_t* a, int depth) {
+    return array_dup(ctx, a, sizeof(int));
+}
+
+come_byte_array_t* come_byte_array_dup(TALLOC_CTX* ctx, const come_byte_array_t* a, int depth) {
+    return array_dup(ctx, a, sizeof(uint8_t));
+}
+
+come_long_array_t* come_long_array_dup(TALLOC_CTX* ctx, const come_long_array_t* a, int depth) {
+    return array_dup(ctx, a, sizeof(long));
+}
+
+come_float_array_t* come_float_array_dup(TALLOC_CTX* ctx, const come_float_array_t* a, int depth) {
+    return array_dup(ctx, a, sizeof(float));
+}
+
+come_double_array_t* come_double_array_dup(TALLOC_CTX* ctx, const come_double_array_t* a, int depth) {
+    return array_dup(ctx, a, sizeof(double));
+}
+
+void* come_array_share(TALLOC_CTX* owner, void* a, size_t elem_size) {
+    if (!a) return NULL;
+    if (!mem_talloc_reference(owner, a)) return array_dup(owner, a, elem_size);
+    ((uint32_t*)a)[0] |= COME_SHARED;
+    return a;
+}
+
+// Once the other owners are gone the mark is dropped and a is written in place
+void* come_array_unshare(void* a, size_t elem_size) {
+    uint32_t* h = a;
+    if (!h || !(h[0] & COME_SHARED)) return a;
+    if (!mem_talloc_reference_count(a)) {
+        h[0] &= ~COME_SHARED;
+        return a;
+    }
+    return array_dup(a, a, elem_size);
+}
+
+// Columns of the soa layout, from the front of the block at capacity cap
+#define SOA_COLUMN_ALIGN 64
+
+static size_t soa_header(int fields) {
+    return (sizeof(come_soa_t) + fields * sizeof(void*) + 15) & ~(size_t)15;
+}
+
+static size_t soa_column(size_t width, uint32_t cap) {
+    return (width * cap + SOA_COLUMN_ALIGN - 1) & ~(size_t)(SOA_COLUMN_ALIGN - 1);
+}
+
+static size_t soa_bytes(uint32_t cap, const size_t* widths, int fields) {
+    size_t bytes = soa_header(fields);
+    for (int k = 0; k < fields; k++) bytes += soa_column(widths[k], cap);
+    return bytes;
+}
+
+static void soa_point(come_soa_t* a, uint32_t cap, const size_t* widths, int fields) {
+    char* col = (char*)a + soa_header(fields);
+    for (int k = 0; k < fields; k++) {
+        a->cols[k] = col;
+        col += soa_column(widths[k], cap);
+    }
+}
+
+void* come_soa_alloc(TALLOC_CTX* ctx, uint32_t n, const size_t* widths, int fields) {
+    come_soa_t* a = mem_talloc_alloc(ctx, soa_bytes(n, widths, fields));
+    if (!a) return NULL;
+    a->size = n;
+    a->count = n;
+    soa_point(a, n, widths, fields);
+    for (int k = 0; k < fields; k++) memset(a->cols[k], 0, widths[k] * n);
+    return a;
+}
+
+// Moves the columns to their places at capacity cap. Growing reallocates
+// first and moves the last column first; shrinking moves the first column
+// first and reallocates after, so no column overwrites one not yet moved.
+static come_soa_t* soa_recap(come_soa_t* a, uint32_t cap, const size_t* widths, int fields) {
+    size_t header = soa_header(fields);
+    uint32_t old = a->size;
+    size_t len[fields], from[fields], to[fields];
+    size_t at_old = header, at_new = header;
+    for (int k = 0; k < fields; k++) {
+        len[k] = widths[k] * (a->count < cap ? a->count : cap);
+        from[k] = at_old;
+        to[k] = at_new;
+        at_old += soa_column(widths[k], old);
+        at_new += soa_column(widths[k], cap);
+    }
+    if (cap > old) {
+        come_soa_t* grown = mem_talloc_realloc(NULL, a, at_new);
+        if (!grown) return NULL;
+        a = grown;
+        for (int k = fields - 1; k >= 0; k--) memmove((char*)a + to[k], (char*)a + from[k], len[k]);
+    } else {
+        for (int k = 0; k < fields; k++) memmove((char*)a + to[k], (char*)a + from[k], len[k]);
+        come_soa_t* shrunk = mem_talloc_realloc(NULL, a, at_new);
+        if (shrunk) a = shrunk;
+    }
+    a->size = cap;
+    soa_point(a, cap, widths, fields);
+    return a;
+}
+
+void* come_soa_reserve(void* arr, uint32_t n, const size_t* widths, int fields) {
+    come_soa_t* a = arr;
+    if (!a || n <= a->size) return a;
+    uint32_t cap = a->size < 4 ? 4 : a->size;
+    while (cap < n) cap = cap > UINT32_MAX / 2 ? n : cap * 2;
+    come_soa_t* grown = soa_recap(a, cap, widths, fields);
+    return grown ? grown : a;
+}
+
+void* come_soa_resize(void* arr, uint32_t n, const size_t* widths, int fields) {
+    come_soa_t* a = arr;
+    if (!a) return come_soa_alloc(NULL, n, widths, fields);
+    if (n != a->size) {
+        come_soa_t* moved = soa_recap(a, n, widths, fields);
+        if (!moved) return a;
+        a = moved;
+    }
+    for (int k = 0; n > a->count && k < fields; k++) {
+        memset((char*)a->cols[k] + widths[k] * a->count, 0, widths[k] * (n - a->count));
+    }
+    a->count = n;
+    return a;
+}
+
+void* come_soa_slice(void* arr, uint32_t start, uint32_t end, const size_t* widths, int fields) {
+    come_soa_t* a = arr;
+    if (!a || start >= a->count || start >= end) return come_soa_alloc(a, 0, widths, fields);
+    if (end > a->count) end = a->count;
+    come_soa_t* res = come_soa_alloc(a, end - start, widths, fields);
+    if (!res) return NULL;
+    for (int k = 0; k < fields; k++) {
+        memcpy(res->cols[k], (char*)a->cols[k] + widths[k] * start, widths[k] * (end - start));
+    }
+    return res;
+}
@@ -0,0 +1,734 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "come_array.h"
+#include "come_string.h"
+#include "come_sched.h"
+
+// Sorting and searching. Comparator sorts are pattern-defeating quicksort
+// (Orson Peters): median-of-three pivots (ninther above 128 elements),
+// insertion sort below 24, equal runs split off to the left, a cheap check
+// for already sorted ranges, and heapsort once too many partitions came out
+// lopsided. The default sorts of numeric arrays are LSD radix sorts, of
+// string lists a multikey quicksort.
+
+#define INSERTION_MAX 24
+#define NINTHER_MIN 128
+#define PARTIAL_INSERTION_MOVES 8
+#define RADIX_MIN 64
+#define PARALLEL_SORT_MIN 32768
+
+typedef struct {
+    size_t size;
+    come_cmp_t cmp;
+    void* ctx;
+    char* tmp;      // One element of scratch space each
+    char* pivot;
+} sorter_t;
+
+#define AT(s, base, i) ((base) + (size_t)(i) * (s)->size)
+
+static inline int less(const sorter_t* s, const void* a, const void* b) {
+    return s->cmp(a, b, s->ctx) < 0;
+}
+
+// Element moves; the common sizes become a single load and store
+static inline void copy_elem(void* dst, const void* src, size_t size) {
+    if (size == 8) memcpy(dst, src, 8);
+    else if (size == 4) memcpy(dst, src, 4);
+    else memcpy(dst, src, size);
+}
+
+static inline void swap_elems(char* a, char* b, size_t size) {
+    if (size == 8) {
+        uint64_t t;
+        memcpy(&t, a, 8);
+        memcpy(a, b, 8);
+        memcpy(b, &t, 8);
+        return;
+    }
+    if (size == 4) {
+        uint32_t t;
+        memcpy(&t, a, 4);
+        memcpy(a, b, 4);
+        memcpy(b, &t, 4);
+        return;
+    }
+    char t[64];
+    while (size > 0) {
+        size_t n = size < sizeof(t) ? size : sizeof(t);
+        memcpy(t, a, n);
+        memcpy(a, b, n);
+        memcpy(b, t, n);
+        a += n;
+        b += n;
+        size -= n;
+    }
+}
+
+static int log2_floor(size_t n) {
+    int log = 0;
+    while (n >>= 1) log++;
+    return log;
+}
+
+static void insertion_sort(sorter_t* s, char* base, size_t n) {
+    size_t size = s->size;
+    for (size_t i = 1; i < n; i++) {
+        char* cur = AT(s, base, i);
+        if (!less(s, cur, cur - size)) continue;
+        copy_elem(s->tmp, cur, size);
+        char* hole = cur;
+        do {
+            copy_elem(hole, hole - size, size);
+            hole -= size;
+        } while (hole > base && less(s, s->tmp, hole - size));
+        copy_elem(hole, s->tmp, size);
+    }
+}
+
+// Insertion sort that gives up once it has moved too many elements: whether
+// the range came out sorted
+static int partial_insertion_sort(sorter_t* s, char* base, size_t n) {
+    size_t size = s->size, moved = 0;
+    for (size_t i = 1; i < n; i++) {
+        char* cur = AT(s, base, i);
+        if (!less(s, cur, cur - size)) continue;
+        copy_elem(s->tmp, cur, size);
+        char* hole = cur;
+        do {
+            copy_elem(hole, hole - size, size);
+            hole -= size;
+        } while (hole > base && less(s, s->tmp, hole - size));
+        copy_elem(hole, s->tmp, size);
+        moved += (size_t)(cur - hole) / size;
+        if (moved > PARTIAL_INSERTION_MOVES) return 0;
+    }
+    return 1;
+}
+
+static void sort2(sorter_t* s, char* a, char* b) {
+    if (less(s, b, a)) swap_elems(a, b, s->size);
+}
+
+// Leaves the median of a, b and c in b
+static void sort3(sorter_t* s, char* a, char* b, char* c) {
+    sort2(s, a, b);
+    sort2(s, b, c);
+    sort2(s, a, b);
+}
+
+static void sift_down(sorter_t* s, char* base, size_t i, size_t n) {
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) return;
+        if (child + 1 < n && less(s, AT(s, base, child), AT(s, base, child + 1))) child++;
+        if (!less(s, AT(s, base, i), AT(s, base, child))) return;
+        swap_elems(AT(s, base, i), AT(s, base, child), s->size);
+        i = child;
+    }
+}
+
+static void heap_sort(sorter_t* s, char* base, size_t n) {
+    for (size_t i = n / 2; i-- > 0;) sift_down(s, base, i, n);
+    for (size_t end = n; end-- > 1;) {
+        swap_elems(base, AT(s, base, end), s->size);
+        sift_down(s, base, 0, end);
+    }
+}
+
+// The pivot (base[0]) to a spot with only smaller elements before it and
+// none smaller after; gives its index, and sets *already when no element
+// had to move
+static size_t partition_right(sorter_t* s, char* base, size_t n, int* already) {
+    copy_elem(s->pivot, base, s->size);
+    size_t first = 0, last = n;
+    do first++; while (first < n && less(s, AT(s, base, first), s->pivot));
+    if (first == 1) {
+        while (first < last) {
+            last--;
+            if (less(s, AT(s, base, last), s->pivot)) break;
+        }
+    } else {
+        do last--; while (!less(s, AT(s, base, last), s->pivot));
+    }
+    *already = first >= last;
+    while (first < last) {
+        swap_elems(AT(s, base, first), AT(s, base, last), s->size);
+        do first++; while (less(s, AT(s, base, first), s->pivot));
+        do last--; while (!less(s, AT(s, base, last), s->pivot));
+    }
+    size_t pos = first - 1;
+    copy_elem(base, AT(s, base, pos), s->size);
+    copy_elem(AT(s, base, pos), s->pivot, s->size);
+    return pos;
+}
+
+// The other way round: elements equal to the pivot go left of it. Used when
+// the pivot equals the element before the range, so nothing in the range is
+// smaller and the equal ones are done with.
+static size_t partition_left(sorter_t* s, char* base, size_t n) {
+    copy_elem(s->pivot, base, s->size);
+    size_t first = 0, last = n;
+    do last--; while (less(s, s->pivot, AT(s, base, last)));
+    if (last + 1 == n) {
+        while (first < last) {
+            first++;
+            if (less(s, s->pivot, AT(s, base, first))) break;
+        }
+    } else {
+        do first++; while (!less(s, s->pivot, AT(s, base, first)));
+    }
+    while (first < last) {
+        swap_elems(AT(s, base, first), AT(s, base, last), s->size);
+        do last--; while (less(s, s->pivot, AT(s, base, last)));
+        do first++; while (!less(s, s->pivot, AT(s, base, first)));
+    }
+    copy_elem(base, AT(s, base, last), s->size);
+    copy_elem(AT(s, base, last), s->pivot, s->size);
+    return last;
+}
+
+// Moves the pivot candidate to base[0]
+static void choose_pivot(sorter_t* s, char* base, size_t n) {
+    size_t half = n / 2;
+    if (n > NINTHER_MIN) {
+        sort3(s, base, AT(s, base, half), AT(s, base, n - 1));
+        sort3(s, AT(s, base, 1), AT(s, base, half - 1), AT(s, base, n - 2));
+        sort3(s, AT(s, base, 2), AT(s, base, half + 1), AT(s, base, n - 3));
+        sort3(s, AT(s, base, half - 1), AT(s, base, half), AT(s, base, half + 1));
+        swap_elems(base, AT(s, base, half), s->size);
+    } else {
+        sort3(s, AT(s, base, half), base, AT(s, base, n - 1));
+    }
+}
+
+static void pdqsort_loop(sorter_t* s, char* base, size_t n, int bad_allowed, int leftmost) {
+    size_t size = s->size;
+    for (;;) {
+        if (n < INSERTION_MAX) {
+            insertion_sort(s, base, n);
+            return;
+        }
+        choose_pivot(s, base, n);
+        // Equal to what precedes the range: skip past all the equal ones
+        if (!leftmost && !less(s, base - size, base)) {
+            size_t pos = partition_left(s, base, n);
+            base = AT(s, base, pos + 1);
+            n -= pos + 1;
+            continue;
+        }
+        int already;
+        size_t pos = partition_right(s, base, n, &already);
+        size_t l = pos, r = n - pos - 1;
+        if (l < n / 8 || r < n / 8) {
+            if (--bad_allowed == 0) {
+                heap_sort(s, base, n);
+                return;
+            }
+            // Break up whatever pattern produced this, at every spot the
+            // next pivot is picked from
+            if (l >= INSERTION_MAX) {
+                swap_elems(base, AT(s, base, l / 4), size);
+                swap_elems(AT(s, base, pos - 1), AT(s, base, pos - l / 4), size);
+                if (l > NINTHER_MIN) {
+                    swap_elems(AT(s, base, 1), AT(s, base, l / 4 + 1), size);
+                    swap_elems(AT(s, base, 2), AT(s, base, l / 4 + 2), size);
+                    swap_elems(AT(s, base, pos - 2), AT(s, base, pos - (l / 4 + 1)), size);
+                    swap_elems(AT(s, base, pos - 3), AT(s, base, pos - (l / 4 + 2)), size);
+                }
+            }
+            if (r >= INSERTION_MAX) {
+                swap_elems(AT(s, base, pos + 1), AT(s, base, pos + 1 + r / 4), size);
+                swap_elems(AT(s, base, n - 1), AT(s, base, n - r / 4), size);
+                if (r > NINTHER_MIN) {
+                    swap_elems(AT(s, base, pos + 2), AT(s, base, pos + 2 + r / 4), size);
+                    swap_elems(AT(s, base, pos + 3), AT(s, base, pos + 3 + r / 4), size);
+                    swap_elems(AT(s, base, n - 2), AT(s, base, n - (1 + r / 4)), size);
+                    swap_elems(AT(s, base, n - 3), AT(s, base, n - (2 + r / 4)), size);
+                }
+            }
+        } else if (already && partial_insertion_sort(s, base, l) &&
+                   partial_insertion_sort(s, AT(s, base, pos + 1), r)) {
+            return;
+        }
+        pdqsort_loop(s, base, l, bad_allowed, leftmost);
+        base = AT(s, base, pos + 1);
+        n = r;
+        leftmost = 0;
+    }
+}
+
+static int sorter_init(sorter_t* s, char* stack, size_t stack_size, size_t size, come_cmp_t cmp, void* ctx) {
+    s->size = size;
+    s->cmp = cmp;
+    s->ctx = ctx;
+    s->tmp = 2 * size <= stack_size ? stack : malloc(2 * size);
+    if (!s->tmp) return 0;
+    s->pivot = s->tmp + size;
+    return 1;
+}
+
+static void sorter_done(sorter_t* s, char* stack) {
+    if (s->tmp != stack) free(s->tmp);
+}
+
+void come_sort(void* base, size_t n, size_t size, come_cmp_t cmp, void* ctx) {
+    if (n < 2 || size == 0) return;
+    char stack[256];
+    sorter_t s;
+    if (!sorter_init(&s, stack, sizeof(stack), size, cmp, ctx)) return;
+    pdqsort_loop(&s, base, n, log2_floor(n), 1);
+    sorter_done(&s, stack);
+}
+
+// Quickselect on the same partitions, heapsort once it stops converging
+void come_nth_element(void* base, size_t n, size_t size, size_t k, come_cmp_t cmp, void* ctx) {
+    if (k >= n || n < 2 || size == 0) return;
+    char stack[256];
+    sorter_t s;
+    if (!sorter_init(&s, stack, sizeof(stack), size, cmp, ctx)) return;
+    char* b = base;
+    size_t lo = 0, hi = n;
+    int budget = 2 * log2_floor(n);
+    while (hi - lo > INSERTION_MAX) {
+        char* range = AT(&s, b, lo);
+        size_t len = hi - lo;
+        if (budget-- == 0) {
+            heap_sort(&s, range, len);
+            sorter_done(&s, stack);
+            return;
+        }
+        choose_pivot(&s, range, len);
+        size_t pos;
+        if (lo > 0 && !less(&s, range - size, range)) {
+            pos = lo + partition_left(&s, range, len);
+            if (k <= pos) break;
+        } else {
+            int already;
+            pos = lo + partition_right(&s, range, len, &already);
+            if (k == pos) break;
+            if (k < pos) {
+                hi = pos;
+                continue;
+            }
+        }
+        lo = pos + 1;
+    }
+    if (hi - lo <= INSERTION_MAX) insertion_sort(&s, AT(&s, b, lo), hi - lo);
+    sorter_done(&s, stack);
+}
+
+void come_partial_sort(void* base, size_t n, size_t size, size_t k, come_cmp_t cmp, void* ctx) {
+    if (k == 0) return;
+    if (k < n) come_nth_element(base, n, size, k, cmp, ctx);
+    come_sort(base, k < n ? k : n, size, cmp, ctx);
+}
+
+size_t come_lower_bound(const void* base, size_t n, size_t size, const void* key, come_cmp_t cmp, void* ctx) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp((const char*)base + mid * size, key, ctx) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+size_t come_upper_bound(const void* base, size_t n, size_t size, const void* key, come_cmp_t cmp, void* ctx) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (cmp((const char*)base + mid * size, key, ctx) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Parallel merge sort. The input is cut into parts (a power of two, at
+// least one per worker), each sorted as a task; then rounds of merges double
+// the sorted runs. Every round has as many tasks as there are parts: each
+// merge is split at evenly spaced output positions, found by binary search
+// (co-ranking), so the last merge is as parallel as the first.
+typedef struct {
+    char* src;
+    char* dst;
+    size_t n;
+    size_t size;
+    int parts;
+    int run_parts;      // Parts per run being merged this round
+    come_cmp_t cmp;
+    void* ctx;
+} merge_job_t;
+
+static size_t part_start(const merge_job_t* job, long part) {
+    return job->n * (size_t)part / job->parts;
+}
+
+static void sort_parts(void** env, long lo, long hi, void* slot, void* ctx) {
+    merge_job_t* job = env[0];
+    for (long p = lo; p < hi; p++) {
+        size_t start = part_start(job, p);
+        come_sort(job->src + start * job->size, part_start(job, p + 1) - start, job->size, job->cmp, job->ctx);
+    }
+}
+
+// How many of the first k merged elements come from a (ties go to a)
+static size_t co_rank(const merge_job_t* job, size_t k, const char* a, size_t na, const char* b, size_t nb) {
+    size_t lo = k > nb ? k - nb : 0, hi = k < na ? k : na;
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        if (job->cmp(a + i * job->size, b + (k - i - 1) * job->size, job->ctx) <= 0) lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+static void merge_pieces(void** env, long lo, long hi, void* slot, void* ctx) {
+    merge_job_t* job = env[0];
+    size_t size = job->size;
+    int pieces = 2 * job->run_parts;
+    for (long t = lo; t < hi; t++) {
+        long merge = t / pieces, piece = t % pieces;
+        size_t start = part_start(job, merge * pieces);
+        size_t mid = part_start(job, merge * pieces + job->run_parts);
+        size_t end = part_start(job, (merge + 1) * pieces);
+        const char* a = job->src + start * size;
+        const char* b = job->src + mid * size;
+        size_t na = mid - start, nb = end - mid, len = end - start;
+        size_t k0 = len * piece / pieces, k1 = len * (piece + 1) / pieces;
+        size_t i = co_rank(job, k0, a, na, b, nb), i_end = co_rank(job, k1, a, na, b, nb);
+        size_t j = k0 - i, j_end = k1 - i_end;
+        char* out = job->dst + (start + k0) * size;
+        while (i < i_end && j < j_end) {
+            if (job->cmp(b + j * size, a + i * size, job->ctx) < 0) {
+                copy_elem(out, b + j++ * size, size);
+            } else {
+                copy_elem(out, a + i++ * size, size);
+            }
+            out += size;
+        }
+        memcpy(out, a + i * size, (i_end - i) * size);
+        out += (i_end - i) * size;
+        memcpy(out, b + j * size, (j_end - j) * size);
+    }
+}
+
+static void run_parallel(merge_job_t* job, come_parallel_body_t body, int width) {
+    void* env[1] = { job };
+    come_parallel_for_t loop = { .lo = 0, .hi = job->parts, .chunk = 1, .dynamic = 1,
+                                 .body = body, .env = env, .width = width };
+    come_parallel_for(&loop);
+}
+
+void come_sort_parallel(void* base, size_t n, size_t size, come_cmp_t cmp, void* ctx) {
+    int width = come_parallel_width();
+    char* tmp = n >= PARALLEL_SORT_MIN && width > 1 ? malloc(n * size) : NULL;
+    if (!tmp) {
+        come_sort(base, n, size, cmp, ctx);
+        return;
+    }
+    int parts = 1;
+    while (parts < width && parts < 64) parts *= 2;
+    merge_job_t job = { base, tmp, n, size, parts, 1, cmp, ctx };
+    run_parallel(&job, sort_parts, width);
+    for (; job.run_parts < parts; job.run_parts *= 2) {
+        run_parallel(&job, merge_pieces, width);
+        char* swap = job.src;
+        job.src = job.dst;
+        job.dst = swap;
+    }
+    if (job.src != base) memcpy(base, job.src, n * size);
+    free(tmp);
+}
+
+// LSD radix sorts, a byte per pass, skipping passes where every key has
+// the same byte; src and tmp trade places each pass
+
+static void radix_sort_u32(uint32_t* a, size_t n) {
+    if (n < RADIX_MIN) {
+        for (size_t i = 1; i < n; i++) {
+            uint32_t x = a[i];
+            size_t j = i;
+            for (; j > 0 && a[j - 1] > x; j--) a[j] = a[j - 1];
+            a[j] = x;
+        }
+        return;
+    }
+    uint32_t* tmp = malloc(n * sizeof(uint32_t));
+    if (!tmp) return;
+    size_t counts[4][256] = { { 0 } };
+    for (size_t i = 0; i < n; i++) {
+        uint32_t x = a[i];
+        counts[0][x & 0xff]++;
+        counts[1][(x >> 8) & 0xff]++;
+        counts[2][(x >> 16) & 0xff]++;
+        counts[3][x >> 24]++;
+    }
+    uint32_t* src = a;
+    uint32_t* dst = tmp;
+    for (int pass = 0; pass < 4; pass++) {
+        int shift = pass * 8;
+        if (counts[pass][(src[0] >> shift) & 0xff] == n) continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t c = counts[pass][d];
+            counts[pass][d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++) dst[counts[pass][(src[i] >> shift) & 0xff]++] = src[i];
+        uint32_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(uint32_t));
+    free(tmp);
+}
+
+static void radix_sort_u64(uint64_t* a, size_t n) {
+    if (n < RADIX_MIN) {
+        for (size_t i = 1; i < n; i++) {
+            uint64_t x = a[i];
+            size_t j = i;
+            for (; j > 0 && a[j - 1] > x; j--) a[j] = a[j - 1];
+            a[j] = x;
+        }
+        return;
+    }
+    uint64_t* tmp = malloc(n * sizeof(uint64_t));
+    if (!tmp) return;
+    size_t (*counts)[256] = calloc(8, sizeof(*counts));
+    if (!counts) {
+        free(tmp);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (int pass = 0; pass < 8; pass++) counts[pass][(a[i] >> (pass * 8)) & 0xff]++;
+    }
+    uint64_t* src = a;
+    uint64_t* dst = tmp;
+    for (int pass = 0; pass < 8; pass++) {
+        int shift = pass * 8;
+        if (counts[pass][(src[0] >> shift) & 0xff] == n) continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            size_t c = counts[pass][d];
+            counts[pass][d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++) dst[counts[pass][(src[i] >> shift) & 0xff]++] = src[i];
+        uint64_t* swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != a) memcpy(a, src, n * sizeof(uint64_t));
+    free(counts);
+    free(tmp);
+}
+
+// Signed keys sort as unsigned with the sign bit flipped
+void come_radix_sort_i32(int32_t* items, size_t n) {
+    uint32_t* keys = (uint32_t*)items;
+    for (size_t i = 0; i < n; i++) keys[i] ^= 0x80000000u;
+    radix_sort_u32(keys, n);
+    for (size_t i = 0; i < n; i++) keys[i] ^= 0x80000000u;
+}
+
+void come_radix_sort_i64(int64_t* items, size_t n) {
+    uint64_t* keys = (uint64_t*)items;
+    for (size_t i = 0; i < n; i++) keys[i] ^= 0x8000000000000000ull;
+    radix_sort_u64(keys, n);
+    for (size_t i = 0; i < n; i++) keys[i] ^= 0x8000000000000000ull;
+}
+
+// Counting sort
+void come_radix_sort_u8(uint8_t* items, size_t n) {
+    size_t counts[256] = { 0 };
+    for (size_t i = 0; i < n; i++) counts[items[i]]++;
+    size_t pos = 0;
+    for (int d = 0; d < 256; d++) {
+        memset(items + pos, d, counts[d]);
+        pos += counts[d];
+    }
+}
+
+// Floating point keys: flip every bit of negatives and the sign bit of the
+// rest, and the bits order as the values do (NaNs go to the ends)
+void come_radix_sort_f32(float* items, size_t n) {
+    uint32_t* keys = malloc(n * sizeof(uint32_t));
+    if (!keys) return;
+    memcpy(keys, items, n * sizeof(uint32_t));
+    for (size_t i = 0; i < n; i++) keys[i] ^= (keys[i] >> 31) ? 0xffffffffu : 0x80000000u;
+    radix_sort_u32(keys, n);
+    for (size_t i = 0; i < n; i++) keys[i] ^= (keys[i] >> 31) ? 0x80000000u : 0xffffffffu;
+    memcpy(items, keys, n * sizeof(uint32_t));
+    free(keys);
+}
+
+void come_radix_sort_f64(double* items, size_t n) {
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    if (!keys) return;
+    memcpy(keys, items, n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++) keys[i] ^= (keys[i] >> 63) ? ~0ull : 0x8000000000000000ull;
+    radix_sort_u64(keys, n);
+    for (size_t i = 0; i < n; i++) keys[i] ^= (keys[i] >> 63) ? 0x8000000000000000ull : ~0ull;
+    memcpy(items, keys, n * sizeof(uint64_t));
+    free(keys);
+}
+
+// Strings order by their bytes, unsigned, a prefix before what extends it;
+// NULL sorts as empty. Views read their parent's bytes.
+
+static inline size_t str_len(const come_string_t* s) {
+    return s ? s->count : 0;
+}
+
+static inline const char* str_bytes(const come_string_t* s) {
+    return s ? come_string_data(s) : "";
+}
+
+// Byte d plus one, or 0 past the end
+static inline int str_char(const come_string_t* s, size_t d) {
+    return d < str_len(s) ? (unsigned char)str_bytes(s)[d] + 1 : 0;
+}
+
+static int str_cmp_from(const come_string_t* a, const come_string_t* b, size_t d) {
+    size_t la = str_len(a), lb = str_len(b);
+    size_t n = (la < lb ? la : lb);
+    int r = n > d ? memcmp(str_bytes(a) + d, str_bytes(b) + d, n - d) : 0;
+    if (r) return r;
+    return (la > lb) - (la < lb);
+}
+
+static int str_key_cmp(const come_string_t* a, const char* key) {
+    size_t la = str_len(a), lk = key ? strlen(key) : 0;
+    int r = memcmp(str_bytes(a), key ? key : "", la < lk ? la : lk);
+    if (r) return r;
+    return (la > lk) - (la < lk);
+}
+
+#define string_elem_cmp(a, b) str_cmp_from((a), (b), 0)
+
+// Bytes from d on that every string shares with the first: a pass that
+// spares one partitioning pass per byte of a long shared prefix
+static size_t common_prefix(come_string_t** a, size_t n, size_t d) {
+    size_t len = str_len(a[0]) > d ? str_len(a[0]) - d : 0;
+    const char* first = len ? str_bytes(a[0]) + d : NULL;
+    for (size_t i = 1; i < n && len > 0; i++) {
+        size_t li = str_len(a[i]) > d ? str_len(a[i]) - d : 0;
+        if (li < len) len = li;
+        size_t k = 0;
+        while (k < len && str_bytes(a[i])[d + k] == first[k]) k++;
+        len = k;
+    }
+    return len;
+}
+
+// Bentley-Sedgewick: a three-way partition on byte d, the middle part moving
+// on to byte d + 1, so no two strings' shared prefix is compared twice
+static void multikey_quicksort(come_string_t** a, size_t n, size_t d) {
+    while (n > 1) {
+        if (n < 16) {
+            for (size_t i = 1; i < n; i++) {
+                come_string_t* x = a[i];
+                size_t j = i;
+                for (; j > 0 && str_cmp_from(a[j - 1], x, d) > 0; j--) a[j] = a[j - 1];
+                a[j] = x;
+            }
+            return;
+        }
+        int c0 = str_char(a[0], d), c1 = str_char(a[n / 2], d), c2 = str_char(a[n - 1], d);
+        int v = c0 < c1 ? (c1 < c2 ? c1 : (c0 < c2 ? c2 : c0)) : (c0 < c2 ? c0 : (c1 < c2 ? c2 : c1));
+        size_t lt = 0, gt = n, i = 0;
+        while (i < gt) {
+            int c = str_char(a[i], d);
+            if (c < v) {
+                come_string_t* t = a[lt];
+                a[lt++] = a[i];
+                a[i++] = t;
+            } else if (c > v) {
+                come_string_t* t = a[--gt];
+                a[gt] = a[i];
+                a[i] = t;
+            } else {
+                i++;
+            }
+        }
+        multikey_quicksort(a, lt, d);
+        multikey_quicksort(a + gt, n - gt, d);
+        if (v == 0) return;  // The middle part all ended at d
+        int all_equal = lt == 0 && gt == n;
+        a += lt;
+        n = gt - lt;
+        d++;
+        if (all_equal) d += common_prefix(a, n, d);
+    }
+}
+
+void come_string_sort(struct come_string_t** items, size_t n) {
+    multikey_quicksort((come_string_t**)items, n, 0);
+}
+
+// Array methods: sort() and parallel_sort() in natural order or by a
+// function comparing two elements, nth_element(k), partial_sort(k), and
+// binary searches of sorted arrays. P is the comparator's parameter type.
+#define NUM_CMP(x, y) (((x) > (y)) - ((x) < (y)))
+
+#define ARRAY_ALGORITHMS(X, A, T, P, K, SORT, CMP, KEY_CMP) \
+    static int X##_cmp(const void* a, const void* b, void* ctx) { \
+        return CMP(*(T const*)a, *(T const*)b); \
+    } \
+    static int X##_cmp_by(const void* a, const void* b, void* ctx) { \
+        return (*(int (**)(P, P))ctx)(*(T const*)a, *(T const*)b); \
+    } \
+    void come_##X##_sort(A* a) { \
+        if (a) SORT(a->items, a->count); \
+    } \
+    void come_##X##_sort_by(A* a, int (*cmp)(P, P)) { \
+        if (a) come_sort(a->items, a->count, sizeof(T), X##_cmp_by, &cmp); \
+    } \
+    void come_##X##_parallel_sort(A* a) { \
+        if (a) come_sort_parallel(a->items, a->count, sizeof(T), X##_cmp, NULL); \
+    } \
+    void come_##X##_parallel_sort_by(A* a, int (*cmp)(P, P)) { \
+        if (a) come_sort_parallel(a->items, a->count, sizeof(T), X##_cmp_by, &cmp); \
+    } \
+    void come_##X##_nth_element(A* a, uint32_t k) { \
+        if (a) come_nth_element(a->items, a->count, sizeof(T), k, X##_cmp, NULL); \
+    } \
+    void come_##X##_partial_sort(A* a, uint32_t k) { \
+        if (a) come_partial_sort(a->items, a->count, sizeof(T), k, X##_cmp, NULL); \
+    } \
+    int come_##X##_lower_bound(const A* a, K key) { \
+        uint32_t lo = 0, hi = a ? a->count : 0; \
+        while (lo < hi) { \
+            uint32_t mid = lo + (hi - lo) / 2; \
+            if (KEY_CMP(a->items[mid], key) < 0) lo = mid + 1; \
+            else hi = mid; \
+        } \
+        return lo; \
+    } \
+    int come_##X##_upper_bound(const A* a, K key) { \
+        uint32_t lo = 0, hi = a ? a->count : 0; \
+        while (lo < hi) { \
+            uint32_t mid = lo + (hi - lo) / 2; \
+            if (KEY_CMP(a->items[mid], key) <= 0) lo = mid + 1; \
+            else hi = mid; \
+        } \
+        return lo; \
+    } \
+    int come_##X##_search(const A* a, K key) { \
+        int i = come_##X##_lower_bound(a, key); \
+        return (uint32_t)i < (a ? a->count : 0) && KEY_CMP(a->items[i], key) == 0 ? i : -1; \
+    }
+
+#define SORT_INT(items, n) come_radix_sort_i32((int32_t*)(items), (n))
+#define SORT_LONG(items, n) come_radix_sort_i64((int64_t*)(items), (n))
+
+ARRAY_ALGORITHMS(int_array, come_int_array_t, int, int, int, SORT_INT, NUM_CMP, NUM_CMP)
+ARRAY_ALGORITHMS(long_array, come_long_array_t, long, long, long, SORT_LONG, NUM_CMP, NUM_CMP)
+ARRAY_ALGORITHMS(byte_array, come_byte_array_t, uint8_t, int8_t, uint8_t, come_radix_sort_u8, NUM_CMP, NUM_CMP)
+ARRAY_ALGORITHMS(float_array, come_float_array_t, float, float, float, come_radix_sort_f32, NUM_CMP, NUM_CMP)
+ARRAY_ALGORITHMS(double_array, come_double_array_t, double, double, double, come_radix_sort_f64, NUM_CMP, NUM_CMP)
+ARRAY_ALGORITHMS(string_list, come_string_list_t, come_string_t*, come_string_t*, const char*,
+                 come_string_sort, string_elem_cmp, str_key_cmp)
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include "codegen_sym.h"
 #include <ctype.h>
 #include "codegen.h"
@@ -28,6 +29,8 @@ static void emit_c_string_literal(FILE* f, const char* s) {
 static const char* source_filename = NULL;
 static int last_emitted_line = -1;
 static int g_gen_line_map = 1;
+static int g_memstats = 0;     // COME_MEMSTATS set at build time: record allocation sites
+static int in_function = 0;    // Statements may be emitted (not at file scope)
 
 // Track current function return type for correct return statement generation
 static char current_function_return_type[128] = "";
@@ -39,11 +42,13 @@ static int current_import_count = 0;
 
 // Emit #line directive if needed
 static void emit_line_directive(FILE* f, ASTNode* node) {
-    if (!g_gen_line_map || !source_filename || !node || node->source_line <= 0) return;
-    
+    if (!source_filename || !node || node->source_line <= 0) return;
+
     // Only emit if line changed to avoid clutter
     if (node->source_line != last_emitted_line) {
-        fprintf(f, "\n#line %d \"%s\"\n", node->source_line, source_filename);
+        if (g_gen_line_map) fprintf(f, "\n#line %d \"%s\"\n", node->source_line, source_filename);
+        // Memstats builds tag the allocations made by this statement with its line
+        if (g_memstats && in_function) fprintf(f, "mem_talloc_site = \"%s:%d\";\n", source_filename, node->source_line);
         last_emitted_line = node->source_line;
     }
 }
@@ -67,61 +72,2011 @@ static int is_pointer_expression(ASTNode* node) {
         // If the root is a pointer, assume access on it is a pointer (common for string/list items)
         return is_pointer_expression(node->children[0]);
     }
-    if (node->type == AST_METHOD_CALL) {
-        // Methods like accept(), new() return pointers. 
-        if (strcmp(node->text, "accept") == 0 || strcmp(node->text, "new") == 0 || 
-            strcmp(node->text, "at") == 0 || strcmp(node->text, "byte_array") == 0) return 1;
-        return is_pointer_expression(node->children[0]);
+    if (node->type == AST_METHOD_CALL) {
+        // Methods like accept(), new() return pointers. 
+        if (strcmp(node->text, "accept") == 0 || strcmp(node->text, "new") == 0 || 
+            strcmp(node->text, "at") == 0 || strcmp(node->text, "byte_array") == 0) return 1;
+        return is_pointer_expression(node->children[0]);
+    }
+    return 0;
+}
+
+static int enum_counter = 0;
+static char* seen_structs[256];
+static int seen_count = 0;
+
+static int is_struct_seen(const char* name) {
+    for (int i=0; i<seen_count; i++) {
+        if (strcmp(seen_structs[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+static void mark_struct_seen(const char* name) {
+    if (!is_struct_seen(name) && seen_count < 256) {
+        seen_structs[seen_count++] = strdup(name);
+    }
+}
+
+static const char* infer_const_type(ASTNode* node) {
+    if (!node) return "int";
+    
+    // String literals -> char*
+    if (node->type == AST_STRING_LITERAL) {
+        return "char*";
+    }
+    
+    if (node->type != AST_NUMBER) return "int";
+    
+    char* text = node->text;
+    if (strchr(text, '.') || strstr(text, "f") || strstr(text, "F")) {
+        // Default floating point literals to float per user preference
+        return "float";
+    }
+    
+    int is_unsigned = (strstr(text, "u") != NULL || strstr(text, "U") != NULL);
+    int is_long = (strstr(text, "l") != NULL || strstr(text, "L") != NULL);
+    int is_long_long = (strstr(text, "LL") != NULL || strstr(text, "ll") != NULL);
+    
+    if (is_unsigned) {
+        if (is_long_long) return "unsigned long long";
+        if (is_long) return "unsigned long";
+        return "unsigned int";
+    }
+    if (is_long_long) return "long long";
+    if (is_long) return "long";
+
+    return "int";
+}
+
+// spawn/join lowering. Each spawn site gets a closure struct (the scheduler
+// task, the arguments and the result) and a thunk that runs the call under
+// the task's context; both are emitted at file scope ahead of the function
+// containing the site. The handle is a pointer to the closure.
+static ASTNode* current_program = NULL;
+static int spawn_site_count = 0;
+static int codegen_errors = 0;
+static ASTNode* async_function = NULL;  // The async function being generated, if any
+static int plain_decl = 0;              // The next declaration is generated as in a plain function
+
+static void codegen_error(ASTNode* node, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "%s:%d: error: ", source_filename, node ? node->source_line : 0);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+    codegen_errors++;
+}
+
+static ASTNode* find_function(const char* name) {
+    if (!current_program) return NULL;
+    for (int i = 0; i < current_program->child_count; i++) {
+        ASTNode* child = current_program->children[i];
+        if (child->type == AST_FUNCTION && strcmp(child->text, name) == 0) return child;
+    }
+    return NULL;
+}
+
+// inline, hot, cold and noinline, kept by the parser as children of a
+// function's return type
+static int function_has(ASTNode* fn, const char* attr) {
+    if (fn->child_count == 0 || fn->children[0]->type == AST_BLOCK) return 0;
+    ASTNode* ret = fn->children[0];
+    for (int i = 0; i < ret->child_count; i++) {
+        if (ret->children[i] && strcmp(ret->children[i]->text, attr) == 0) return 1;
+    }
+    return 0;
+}
+
+// An inline function is static in every module that has its body: this one,
+// and its importers if it is exported (see generate_interface)
+static void emit_function_attributes(FILE* f, ASTNode* fn) {
+    if (function_has(fn, "inline")) fprintf(f, "static inline __attribute__((always_inline, unused)) ");
+    if (function_has(fn, "noinline")) fprintf(f, "__attribute__((noinline)) ");
+    if (function_has(fn, "hot")) fprintf(f, "__attribute__((hot)) ");
+    if (function_has(fn, "cold")) fprintf(f, "__attribute__((cold)) ");
+}
+
+// likely(x) and unlikely(x), unless the module has a function of that name
+static int is_expect_call(ASTNode* node) {
+    return node->type == AST_CALL && (strcmp(node->text, "likely") == 0 || strcmp(node->text, "unlikely") == 0) &&
+           !find_function(node->text);
+}
+
+// join(h), unless the module has a function of its own called join
+static int is_join_call(ASTNode* node) {
+    return node->type == AST_CALL && strcmp(node->text, "join") == 0 &&
+           node->child_count == 1 && !find_function("join");
+}
+
+// SIMD vectors: f32x4 and the rest are GCC vector types (come_simd.h)
+typedef struct {
+    const char* name;
+    const char* elem;   // C type of a lane
+    int lanes;
+    const char* mask;   // What a comparison gives
+    const char* array;  // Element type of the Come arrays it loads from, or NULL
+} VectorType;
+
+static const VectorType vector_types[] = {
+    { "f32x4", "float", 4, "i32x4", "float" },
+    { "f32x8", "float", 8, "i32x8", "float" },
+    { "f64x4", "double", 4, "i64x4", "double" },
+    { "i32x4", "int", 4, "i32x4", "int" },
+    { "i32x8", "int", 8, "i32x8", "int" },
+    { "i64x4", "long", 4, "i64x4", NULL },
+    { "u8x16", "uint8_t", 16, "u8x16", "byte" },
+};
+
+static const VectorType* vector_type(const char* name) {
+    for (size_t i = 0; name && i < sizeof(vector_types) / sizeof(vector_types[0]); i++) {
+        if (strcmp(name, vector_types[i].name) == 0) return &vector_types[i];
+    }
+    return NULL;
+}
+
+// C type of a parameter or return value, as the prototypes spell it
+static void come_c_type(const char* type, char* out, size_t size) {
+    size_t len = strlen(type);
+    if (type[0] == '(' || strcmp(type, "void") == 0) {
+        snprintf(out, size, "void");
+    } else if (strncmp(type, "chan<", 5) == 0) {
+        snprintf(out, size, "come_chan_t*");
+    } else if (strncmp(type, "atomic ", 7) == 0) {
+        snprintf(out, size, "_Atomic %s", type + 7);
+    } else if (vector_type(type)) {
+        snprintf(out, size, "come_%s_t", type);
+    } else if (len > 13 && strncmp(type, "struct ", 7) == 0 && strcmp(type + len - 6, "[] soa") == 0) {
+        snprintf(out, size, "come_%s__%.*s__soa_t*", current_module, (int)(len - 13), type + 7);
+    } else if (len > 2 && strcmp(type + len - 2, "[]") == 0) {
+        if (strncmp(type, "int[", 4) == 0) snprintf(out, size, "come_int_array_t*");
+        else if (strncmp(type, "byte[", 5) == 0) snprintf(out, size, "come_byte_array_t*");
+        else if (strncmp(type, "long[", 5) == 0) snprintf(out, size, "come_long_array_t*");
+        else if (strncmp(type, "float[", 6) == 0) snprintf(out, size, "come_float_array_t*");
+        else if (strncmp(type, "double[", 7) == 0) snprintf(out, size, "come_double_array_t*");
+        else if (strncmp(type, "string[", 7) == 0) snprintf(out, size, "come_string_list_t*");
+        else snprintf(out, size, "come_array_t*");
+    } else if (strcmp(type, "string") == 0) {
+        snprintf(out, size, "come_string_t*");
+    } else if (strcmp(type, "net.tcp.Conn") == 0) {
+        snprintf(out, size, "come_net_tcp_conn_t*");
+    } else if (strcmp(type, "net.tcp.Listener") == 0) {
+        snprintf(out, size, "come_net_tcp_listener_t*");
+    } else if (strcmp(type, "net.tcp.Addr") == 0) {
+        snprintf(out, size, "come_net_tcp_addr_t");
+    } else if (strcmp(type, "net.http.Session") == 0) {
+        snprintf(out, size, "come_net_http_session_t*");
+    } else if (strcmp(type, "net.http.Message") == 0) {
+        snprintf(out, size, "come_net_http_message_t*");
+    } else {
+        snprintf(out, size, "%s", type);
+    }
+}
+
+static void emit_spawn_site(FILE* f, ASTNode* spawn) {
+    ASTNode* call = spawn->child_count > 0 ? spawn->children[0] : NULL;
+    ASTNode* fn = (call && call->type == AST_CALL) ? find_function(call->text) : NULL;
+    if (!fn || fn->child_count == 0 || fn->children[0]->type == AST_BLOCK) {
+        codegen_error(spawn, "spawn needs a call to a function of this module");
+        return;
+    }
+    int argc = 0;
+    for (int i = 1; i < fn->child_count && fn->children[i]->type == AST_VAR_DECL; i++) argc++;
+    if (argc != call->child_count) {
+        codegen_error(spawn, "%s takes %d argument(s), spawn passes %d", call->text, argc, call->child_count);
+        return;
+    }
+
+    int site = ++spawn_site_count;
+    snprintf(spawn->text, sizeof(spawn->text), "come_%s__spawn%d", current_module, site);
+    char ret[128], arg[128];
+    come_c_type(fn->children[0]->text, ret, sizeof(ret));
+    int is_void = strcmp(ret, "void") == 0;
+    // Objects other than plain values are handed to the joiner with the result
+    int is_object = strchr(ret, '*') != NULL || strcmp(ret, "map") == 0;
+
+    fprintf(f, "typedef struct {\n    come_sched_task_t task;\n");
+    for (int i = 0; i < argc; i++) {
+        come_c_type(fn->children[i + 1]->children[1]->text, arg, sizeof(arg));
+        fprintf(f, "    %s a%d;\n", arg, i);
+    }
+    fprintf(f, "    %s result;\n} %s_t;\n\n", is_void ? "char" : ret, spawn->text);
+
+    fprintf(f, "static void %s_run(come_sched_task_t* task) {\n", spawn->text);
+    fprintf(f, "    %s_t* self = (%s_t*)task;\n", spawn->text, spawn->text);
+    fprintf(f, "    TALLOC_CTX* outer = COME_CTX;\n");
+    fprintf(f, "    COME_CTX = task->ctx;\n");
+    fprintf(f, "    %scome_%s__%s(", is_void ? "" : "self->result = ", current_module, call->text);
+    for (int i = 0; i < argc; i++) fprintf(f, "%sself->a%d", i ? ", " : "", i);
+    fprintf(f, ");\n");
+    if (is_object) fprintf(f, "    task->result = self->result;\n");
+    fprintf(f, "    COME_CTX = outer;\n}\n\n");
+}
+
+// Emits the closures for every spawn inside node
+static void emit_spawn_sites(FILE* f, ASTNode* node) {
+    if (!node) return;
+    for (int i = 0; i < node->child_count; i++) emit_spawn_sites(f, node->children[i]);
+    if (node->type == AST_SPAWN) emit_spawn_site(f, node);
+}
+
+// Atomics. atomic T is _Atomic T, so plain reads, writes and ++ are
+// sequentially consistent already; the methods lower to the explicit
+// <stdatomic.h> operations and take an order, seq_cst when none is given.
+
+// Come type of a variable: a local, or else one of the module's globals
+static const char* variable_type(const char* name) {
+    const char* type = get_local_variable_type(name);
+    if (type || !current_program) return type;
+    for (int i = 0; i < current_program->child_count; i++) {
+        ASTNode* child = current_program->children[i];
+        if (child->type == AST_VAR_DECL && strcmp(child->text, name) == 0) return child->children[1]->text;
+    }
+    return NULL;
+}
+
+// The module's declaration of a struct type ("struct Counter", "Counter*")
+static ASTNode* find_struct(const char* type) {
+    if (!type || !current_program) return NULL;
+    if (strncmp(type, "struct ", 7) == 0) type += 7;
+    size_t len = strcspn(type, "*");
+    for (int i = 0; i < current_program->child_count; i++) {
+        ASTNode* child = current_program->children[i];
+        if (child->type == AST_STRUCT_DECL && strlen(child->text) == len && strncmp(child->text, type, len) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+static const char* struct_field_type(ASTNode* st, const char* field) {
+    for (int i = 0; st && i < st->child_count; i++) {
+        ASTNode* child = st->children[i];
+        if (child->type == AST_VAR_DECL && strcmp(child->text, field) == 0) return child->children[1]->text;
+    }
+    return NULL;
+}
+
+// Come type of an atomic variable or struct field ("atomic long"), or NULL
+static const char* atomic_type(ASTNode* expr) {
+    const char* type = NULL;
+    if (expr->type == AST_IDENTIFIER) {
+        type = variable_type(expr->text);
+    } else if (expr->type == AST_MEMBER_ACCESS && expr->children[0]->type == AST_IDENTIFIER) {
+        type = struct_field_type(find_struct(variable_type(expr->children[0]->text)), expr->text);
+    }
+    return type && strncmp(type, "atomic ", 7) == 0 ? type : NULL;
+}
+
+// Whether a variable of this type is shared rather than copied when a
+// parallel for body captures it: atomics, and structs holding any
+static int is_shared_type(const char* type) {
+    if (strncmp(type, "atomic ", 7) == 0) return 1;
+    ASTNode* st = strchr(type, '*') ? NULL : find_struct(type);
+    for (int i = 0; st && i < st->child_count; i++) {
+        ASTNode* child = st->children[i];
+        if (child->type == AST_VAR_DECL && strncmp(child->children[1]->text, "atomic ", 7) == 0) return 1;
+    }
+    return 0;
+}
+
+static const char* atomic_orders[] = { "relaxed", "consume", "acquire", "release", "acq_rel", "seq_cst" };
+
+// memory_order_* for an order argument, or seq_cst without one; allowed
+// lists the orders the operation takes
+static const char* atomic_order(ASTNode* call, int index, const char* allowed) {
+    if (index >= call->child_count) return "seq_cst";
+    ASTNode* arg = call->children[index];
+    if (arg->type == AST_IDENTIFIER) {
+        for (int i = 0; i < 6; i++) {
+            if (strcmp(arg->text, atomic_orders[i]) != 0) continue;
+            if (!strstr(allowed, arg->text)) {
+                codegen_error(arg, "%s() does not take order %s (use %s)", call->text, arg->text, allowed);
+            }
+            return atomic_orders[i];
+        }
+    }
+    codegen_error(arg, "%s(): the order is one of %s", call->text, allowed);
+    return "seq_cst";
+}
+
+// x.load(), x.store(v), x.exchange(v), x.fetch_add(v) (_sub, _and, _or,
+// _xor), x.cas(expected, desired) and x.cas_weak(...), which give whether
+// x held expected and now holds desired; each takes an order last.
+// atomic.fence(order) is a thread fence.
+static void generate_atomic_method(FILE* f, ASTNode* node, const char* type) {
+    const char* method = node->text;
+    ASTNode* target = node->children[0];
+    int argc = node->child_count - 1;
+    const char* all = "relaxed, consume, acquire, release, acq_rel, seq_cst";
+    const char* value_type = type + 7;
+
+    if (!type[0]) {
+        if (strcmp(method, "fence") == 0 && argc == 1) {
+            fprintf(f, "atomic_thread_fence(memory_order_%s)", atomic_order(node, 1, "acquire, release, acq_rel, seq_cst"));
+        } else {
+            codegen_error(node, "atomic has fence(order), not %s", method);
+            fprintf(f, "0");
+        }
+        return;
+    }
+    if (strcmp(method, "load") == 0 && argc <= 1) {
+        const char* order = atomic_order(node, 1, "relaxed, consume, acquire, seq_cst");
+        fprintf(f, "atomic_load_explicit(&(");
+        generate_expression(f, target);
+        fprintf(f, "), memory_order_%s)", order);
+    } else if ((strcmp(method, "store") == 0 || strcmp(method, "exchange") == 0 ||
+                strncmp(method, "fetch_", 6) == 0) && argc >= 1 && argc <= 2) {
+        int fetch = strncmp(method, "fetch_", 6) == 0;
+        if (fetch && strcmp(method + 6, "add") && strcmp(method + 6, "sub") && strcmp(method + 6, "and") &&
+            strcmp(method + 6, "or") && strcmp(method + 6, "xor")) {
+            codegen_error(node, "%s has no method %s", type, method);
+        } else if (fetch && strcmp(value_type, "bool") == 0) {
+            codegen_error(node, "%s: atomic bool has load, store, exchange and cas", method);
+        }
+        const char* order = atomic_order(node, 2, strcmp(method, "store") == 0 ? "relaxed, release, seq_cst" : all);
+        fprintf(f, "atomic_%s_explicit(&(", method);
+        generate_expression(f, target);
+        fprintf(f, "), ");
+        generate_expression(f, node->children[1]);
+        fprintf(f, ", memory_order_%s)", order);
+    } else if ((strcmp(method, "cas") == 0 || strcmp(method, "cas_weak") == 0) && argc >= 2 && argc <= 3) {
+        const char* order = atomic_order(node, 3, all);
+        // On failure: no release half, and nothing stronger than on success
+        const char* failure = strcmp(order, "acq_rel") == 0 ? "acquire" :
+                              strcmp(order, "release") == 0 ? "relaxed" : order;
+        char c_type[64];
+        come_c_type(value_type, c_type, sizeof(c_type));
+        fprintf(f, "({ %s __expected = ", c_type);
+        generate_expression(f, node->children[1]);
+        fprintf(f, "; atomic_compare_exchange_%s_explicit(&(", strcmp(method, "cas") == 0 ? "strong" : "weak");
+        generate_expression(f, target);
+        fprintf(f, "), &__expected, ");
+        generate_expression(f, node->children[2]);
+        fprintf(f, ", memory_order_%s, memory_order_%s); })", order, failure);
+    } else {
+        codegen_error(node, "%s has no method %s taking %d argument(s)", type, method, argc);
+        fprintf(f, "0");
+    }
+}
+
+// @align(n) on a declaration: the attribute after its name
+static void emit_align(FILE* f, ASTNode* type_node) {
+    if (type_node->child_count > 0) fprintf(f, " __attribute__((aligned(%s)))", type_node->children[0]->text);
+}
+
+// SIMD vectors. Operators are C's, lane by lane, with literals cast to the
+// lane type so a scalar operand broadcasts; constructors, loads and stores,
+// shuffles and reductions lower to come_simd.h.
+
+static int is_comparison(const char* op) {
+    return strcmp(op, "==") == 0 || strcmp(op, "!=") == 0 || strcmp(op, "<") == 0 ||
+           strcmp(op, ">") == 0 || strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0;
+}
+
+// Vector type of an expression, or NULL for scalars and what it cannot tell
+static const VectorType* vector_expr_type(ASTNode* expr) {
+    const VectorType* vt;
+    switch (expr->type) {
+    case AST_IDENTIFIER:
+        return vector_type(variable_type(expr->text));
+    case AST_MEMBER_ACCESS:
+        if (expr->children[0]->type != AST_IDENTIFIER) return NULL;
+        return vector_type(struct_field_type(find_struct(variable_type(expr->children[0]->text)), expr->text));
+    case AST_CAST:
+        return vector_type(expr->children[0]->text);
+    case AST_UNARY_OP:
+        return vector_expr_type(expr->children[0]);
+    case AST_TERNARY:
+        return vector_expr_type(expr->children[1]);
+    case AST_CALL:
+        // A constructor, a function, or an operator the if parser made a call
+        if (vector_type(expr->text)) return vector_type(expr->text);
+        if (isalpha((unsigned char)expr->text[0]) || expr->text[0] == '_') {
+            ASTNode* fn = find_function(expr->text);
+            return fn && fn->child_count > 0 ? vector_type(fn->children[0]->text) : NULL;
+        }
+        if (expr->child_count != 2) return NULL;
+        /* fall through */
+    case AST_BINARY_OP:
+        vt = vector_expr_type(expr->children[0]);
+        if (!vt) vt = vector_expr_type(expr->children[1]);
+        return vt && is_comparison(expr->text) ? vector_type(vt->mask) : vt;
+    case AST_METHOD_CALL:
+        // f32x4.load(...), f32x4.blend(...), v.shuffle(...)
+        if (expr->children[0]->type == AST_IDENTIFIER && vector_type(expr->children[0]->text)) {
+            return vector_type(expr->children[0]->text);
+        }
+        vt = vector_expr_type(expr->children[0]);
+        return vt && strcmp(expr->text, "shuffle") == 0 ? vt : NULL;
+    default:
+        return NULL;
+    }
+}
+
+// An operand next to a vector: literals take the lane type
+static void emit_vector_operand(FILE* f, ASTNode* operand, const VectorType* vt) {
+    if (vt && operand->type == AST_NUMBER) {
+        fprintf(f, "((%s)%s)", vt->elem, operand->text);
+    } else {
+        generate_expression(f, operand);
+    }
+}
+
+// &arr->items[index] for a vector's load or store, checking the array holds
+// the vector's lanes
+static void emit_vector_items(FILE* f, ASTNode* call, const VectorType* vt, ASTNode* array, ASTNode* index) {
+    const char* type = array->type == AST_IDENTIFIER ? variable_type(array->text) : NULL;
+    size_t len = vt->array ? strlen(vt->array) : 0;
+    if (!vt->array) {
+        codegen_error(call, "%s has no array type to %s", vt->name, call->text);
+    } else if (type && (strncmp(type, vt->array, len) != 0 || strcmp(type + len, "[]") != 0)) {
+        codegen_error(call, "%s.%s needs a %s[], not %s", vt->name, call->text, vt->array, type);
+    }
+    fprintf(f, "&(");
+    generate_expression(f, array);
+    fprintf(f, ")->items[");
+    if (index) generate_expression(f, index);
+    else fprintf(f, "0");
+    fprintf(f, "]");
+}
+
+// f32x4(x) has x in every lane, f32x4(a, b, c, d) one value per lane
+static void generate_vector_new(FILE* f, ASTNode* node, const VectorType* vt) {
+    if (node->child_count == 1) {
+        fprintf(f, "come_%s_splat(", vt->name);
+        generate_expression(f, node->children[0]);
+        fprintf(f, ")");
+        return;
+    }
+    if (node->child_count != vt->lanes) {
+        codegen_error(node, "%s takes one value, for every lane, or %d, not %d",
+                      vt->name, vt->lanes, node->child_count);
+    }
+    fprintf(f, "((come_%s_t){ ", vt->name);
+    for (int i = 0; i < node->child_count; i++) {
+        if (i > 0) fprintf(f, ", ");
+        generate_expression(f, node->children[i]);
+    }
+    fprintf(f, " })");
+}
+
+// f32x4.load(xs, i) and f32x4.blend(mask, a, b); on a vector v.store(xs, i),
+// v.shuffle([other,] indices...), v.sum(), v.min(), v.max(), and for integer
+// vectors (masks) v.any() and v.all()
+static void generate_vector_method(FILE* f, ASTNode* node, const VectorType* vt, int on_type) {
+    const char* method = node->text;
+    ASTNode* target = node->children[0];
+    int argc = node->child_count - 1;
+    int integer = vt->elem[0] != 'f' && vt->elem[0] != 'd';
+
+    if (on_type && strcmp(method, "load") == 0 && (argc == 1 || argc == 2)) {
+        fprintf(f, "come_%s_load(", vt->name);
+        emit_vector_items(f, node, vt, node->children[1], argc == 2 ? node->children[2] : NULL);
+        fprintf(f, ")");
+    } else if (on_type && strcmp(method, "blend") == 0 && argc == 3) {
+        fprintf(f, "come_%s_blend(", vt->name);
+        for (int i = 1; i <= 3; i++) {
+            if (i > 1) fprintf(f, ", ");
+            generate_expression(f, node->children[i]);
+        }
+        fprintf(f, ")");
+    } else if (on_type) {
+        codegen_error(node, "%s has load(array, index) and blend(mask, a, b), not %s", vt->name, method);
+        fprintf(f, "0");
+    } else if (strcmp(method, "store") == 0 && (argc == 1 || argc == 2)) {
+        fprintf(f, "(come_array_cow(");
+        generate_expression(f, node->children[1]);
+        fprintf(f, "), come_%s_store(", vt->name);
+        generate_expression(f, target);
+        fprintf(f, ", ");
+        emit_vector_items(f, node, vt, node->children[1], argc == 2 ? node->children[2] : NULL);
+        fprintf(f, "))");
+    } else if (strcmp(method, "shuffle") == 0 && (argc == vt->lanes || argc == vt->lanes + 1)) {
+        // Indices must be literals: __builtin_shufflevector wants constants
+        int two = argc > vt->lanes;
+        int limit = two ? 2 * vt->lanes : vt->lanes;
+        fprintf(f, "({ __auto_type __a = ");
+        generate_expression(f, target);
+        fprintf(f, "; __auto_type __b = ");
+        generate_expression(f, two ? node->children[1] : target);
+        fprintf(f, "; COME_SIMD_SHUFFLE(__a, __b, come_%s_t", vt->mask);
+        for (int i = 1 + two; i <= argc; i++) {
+            ASTNode* index = node->children[i];
+            long lane = index->type == AST_NUMBER ? strtol(index->text, NULL, 0) : -1;
+            if (lane < 0 || lane >= limit) {
+                codegen_error(index, "shuffle: a lane index is a literal from 0 to %d", limit - 1);
+            }
+            fprintf(f, ", %ld", lane < 0 ? 0 : lane);
+        }
+        fprintf(f, "); })");
+    } else if (argc == 0 && (strcmp(method, "sum") == 0 || strcmp(method, "min") == 0 ||
+                             strcmp(method, "max") == 0 ||
+                             (integer && (strcmp(method, "any") == 0 || strcmp(method, "all") == 0)))) {
+        fprintf(f, "come_%s_%s(", vt->name, method);
+        generate_expression(f, target);
+        fprintf(f, ")");
+    } else {
+        codegen_error(node, "%s has no method %s taking %d argument(s)", vt->name, method, argc);
+        fprintf(f, "0");
+    }
+}
+
+// Come type of a variable or of a field of one, or NULL
+static const char* receiver_type(ASTNode* receiver) {
+    if (receiver->type == AST_IDENTIFIER) return variable_type(receiver->text);
+    if (receiver->type == AST_MEMBER_ACCESS && receiver->children[0]->type == AST_IDENTIFIER) {
+        return struct_field_type(find_struct(variable_type(receiver->children[0]->text)), receiver->text);
+    }
+    return NULL;
+}
+
+// Arrays with typed runtime functions: come_int_array_sort and so on, in
+// come_array.h
+typedef struct {
+    const char* elem;    // Come element type
+    const char* prefix;  // come_<prefix>_sort
+} TypedArray;
+
+static const TypedArray typed_arrays[] = {
+    {"int", "int_array"},
+    {"long", "long_array"},
+    {"byte", "byte_array"},
+    {"float", "float_array"},
+    {"double", "double_array"},
+    {"string", "string_list"},
+};
+
+static const TypedArray* typed_array(const char* type) {
+    const char* bracket = type ? strchr(type, '[') : NULL;
+    if (!bracket) return NULL;
+    size_t len = bracket - type;
+    for (size_t i = 0; i < sizeof(typed_arrays) / sizeof(typed_arrays[0]); i++) {
+        if (strlen(typed_arrays[i].elem) == len && strncmp(type, typed_arrays[i].elem, len) == 0) {
+            return &typed_arrays[i];
+        }
+    }
+    return NULL;
+}
+
+// Arrays of structs in the soa layout ("struct S[] soa"). Each struct used so
+// gets a header type, come_<module>__<S>__soa_t, whose cols hold a pointer
+// per field, all into the one come_soa_t allocation. a[i].f is an element of
+// f's column; a[i] alone gathers a struct from the columns (and an
+// assignment to it scatters one back); size(), resize(n), slice(start, end)
+// and push(x) work on every column at once.
+
+// The struct of a "struct S[] soa" type, or NULL
+static ASTNode* soa_struct(const char* type) {
+    size_t len = type ? strlen(type) : 0;
+    if (len < 7 || strcmp(type + len - 6, "[] soa") != 0) return NULL;
+    char name[128];
+    snprintf(name, sizeof(name), "%.*s", (int)(len - 6), type);
+    return find_struct(name);
+}
+
+// The struct of an soa array expression, or NULL
+static ASTNode* soa_array(ASTNode* expr) {
+    return expr ? soa_struct(receiver_type(expr)) : NULL;
+}
+
+static int soa_fields(ASTNode* st) {
+    int fields = 0;
+    for (int i = 0; i < st->child_count; i++) fields += st->children[i]->type == AST_VAR_DECL;
+    return fields;
+}
+
+// Whether anything in node is declared as an soa array of st
+static int uses_soa(ASTNode* node, ASTNode* st) {
+    if (!node) return 0;
+    if (node->type == AST_VAR_DECL && node->child_count > 1 && node->children[1] &&
+        soa_struct(node->children[1]->text) == st) {
+        return 1;
+    }
+    for (int i = 0; i < node->child_count; i++) {
+        if (uses_soa(node->children[i], st)) return 1;
+    }
+    return 0;
+}
+
+static void emit_struct_soa_typedef(FILE* f, ASTNode* st) {
+    if (!uses_soa(current_program, st)) return;
+    fprintf(f, "typedef struct come_%s__%s__soa come_%s__%s__soa_t;\n", current_module, st->text,
+            current_module, st->text);
+}
+
+// The header, the field widths for come_soa_*, and get/set/push
+static void emit_struct_soa(FILE* f, ASTNode* st) {
+    if (!uses_soa(current_program, st)) return;
+    const char* m = current_module;
+    const char* S = st->text;
+    int fields = soa_fields(st);
+    if (fields == 0) {
+        codegen_error(st, "struct %s has no fields to store in soa columns", S);
+        return;
+    }
+
+    fprintf(f, "struct come_%s__%s__soa {\n    uint32_t size;\n    uint32_t count;\n    struct {\n", m, S);
+    for (int i = 0; i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type != AST_VAR_DECL) continue;
+        fprintf(f, "        __typeof__(((struct %s*)0)->%s)* %s;\n", S, field->text, field->text);
+    }
+    fprintf(f, "    } cols;\n};\n");
+
+    fprintf(f, "static const size_t come_%s__%s__soa_widths[] = {", m, S);
+    for (int i = 0; i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type == AST_VAR_DECL) fprintf(f, " sizeof(((struct %s*)0)->%s),", S, field->text);
+    }
+    fprintf(f, " };\n");
+
+    fprintf(f, "static inline __attribute__((unused)) struct %s come_%s__%s__soa_get(const come_%s__%s__soa_t* a, uint32_t i) {\n"
+               "    return (struct %s){", S, m, S, m, S, S);
+    for (int i = 0; i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type == AST_VAR_DECL) fprintf(f, " .%s = a->cols.%s[i],", field->text, field->text);
+    }
+    fprintf(f, " };\n}\n");
+
+    fprintf(f, "static inline __attribute__((unused)) void come_%s__%s__soa_set(come_%s__%s__soa_t* a, uint32_t i, struct %s v) {\n",
+            m, S, m, S, S);
+    for (int i = 0; i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type == AST_VAR_DECL) fprintf(f, "    a->cols.%s[i] = v.%s;\n", field->text, field->text);
+    }
+    fprintf(f, "}\n");
+
+    fprintf(f, "static inline __attribute__((unused)) come_%s__%s__soa_t* come_%s__%s__soa_push(come_%s__%s__soa_t* a, struct %s v) {\n"
+               "    a = come_soa_reserve(a, a->count + 1, come_%s__%s__soa_widths, %d);\n"
+               "    if (a->count < a->size) come_%s__%s__soa_set(a, a->count++, v);\n"
+               "    return a;\n}\n", m, S, m, S, m, S, S, m, S, fields, m, S);
+}
+
+// A struct value for an soa array: aggregates become compound literals
+static void emit_soa_value(FILE* f, ASTNode* st, ASTNode* value) {
+    if (value->type == AST_AGGREGATE_INIT) fprintf(f, "(struct %s)", st->text);
+    generate_expression(f, value);
+}
+
+// struct S xs[] soa, empty or from an expression (a slice, a call) or a list
+static void emit_soa_decl(FILE* f, ASTNode* node, ASTNode* st, int indent) {
+    ASTNode* init = node->children[0];
+    char c_type[256];
+    come_c_type(node->children[1]->text, c_type, sizeof(c_type));
+    int list = init && init->type == AST_AGGREGATE_INIT;
+    if (init && !list && !(init->type == AST_NUMBER && strcmp(init->text, "0") == 0)) {
+        fprintf(f, "%s %s = ", c_type, node->text);
+        generate_expression(f, init);
+        fprintf(f, ";\n");
+        return;
+    }
+    int n = list ? init->child_count : 0;
+    fprintf(f, "%s %s = come_soa_alloc(COME_CTX, %d, come_%s__%s__soa_widths, %d);\n", c_type, node->text, n,
+            current_module, st->text, soa_fields(st));
+    for (int i = 0; i < n; i++) {
+        emit_indent(f, indent);
+        fprintf(f, "come_%s__%s__soa_set(%s, %d, ", current_module, st->text, node->text, i);
+        emit_soa_value(f, st, init->children[i]);
+        fprintf(f, ");\n");
+    }
+}
+
+// a[i] = x scatters x into the columns
+static void generate_soa_store(FILE* f, ASTNode* node, ASTNode* st) {
+    ASTNode* target = node->children[0];
+    if (strcmp(node->text, "=") != 0) {
+        codegen_error(node, "%s on a whole element of an soa array; assign a field instead", node->text);
+    }
+    fprintf(f, "come_%s__%s__soa_set(", current_module, st->text);
+    generate_expression(f, target->children[0]);
+    fprintf(f, ", ");
+    generate_expression(f, target->children[1]);
+    fprintf(f, ", ");
+    emit_soa_value(f, st, node->children[1]);
+    fprintf(f, ")");
+}
+
+static void generate_soa_method(FILE* f, ASTNode* node, ASTNode* st) {
+    const char* method = node->text;
+    ASTNode* target = node->children[0];
+    int argc = node->child_count - 1;
+    const char* m = current_module;
+    const char* S = st->text;
+    int fields = soa_fields(st);
+
+    if (strcmp(method, "size") == 0 && argc == 0) {
+        fprintf(f, "(");
+        generate_expression(f, target);
+        fprintf(f, ")->count");
+    } else if ((strcmp(method, "resize") == 0 && argc == 1) || (strcmp(method, "push") == 0 && argc == 1)) {
+        // Both may move the array
+        fprintf(f, "(");
+        generate_expression(f, target);
+        fprintf(f, " = ");
+        if (method[0] == 'r') fprintf(f, "come_soa_resize(");
+        else fprintf(f, "come_%s__%s__soa_push(", m, S);
+        generate_expression(f, target);
+        fprintf(f, ", ");
+        if (method[0] == 'r') {
+            generate_expression(f, node->children[1]);
+            fprintf(f, ", come_%s__%s__soa_widths, %d))", m, S, fields);
+        } else {
+            emit_soa_value(f, st, node->children[1]);
+            fprintf(f, "))");
+        }
+    } else if (strcmp(method, "slice") == 0 && argc == 2) {
+        fprintf(f, "come_soa_slice(");
+        generate_expression(f, target);
+        fprintf(f, ", ");
+        generate_expression(f, node->children[1]);
+        fprintf(f, ", ");
+        generate_expression(f, node->children[2]);
+        fprintf(f, ", come_%s__%s__soa_widths, %d)", m, S, fields);
+    } else if (strcmp(method, "free") == 0 && argc == 0) {
+        fprintf(f, "come_free(");
+        generate_expression(f, target);
+        fprintf(f, ")");
+    } else {
+        codegen_error(node, "struct %s[] soa has size(), resize(n), slice(start, end), push(x) and free(), not %s "
+                      "with %d argument(s)", S, method, argc);
+        fprintf(f, "0");
+    }
+}
+
+// Copy-on-write: writes to an element of a typed array, and the methods
+// that reorder one, first make it writable with come_array_cow, in case it
+// is shared (.share()). Reads are not checked.
+
+// The typed array whose element an assignment or ++/-- writes, or NULL
+static ASTNode* written_array(ASTNode* target) {
+    if (target->type != AST_ARRAY_ACCESS || vector_expr_type(target->children[0])) return NULL;
+    return typed_array(receiver_type(target->children[0])) ? target->children[0] : NULL;
+}
+
+// Sorting and searching on arrays. Each method lowers to the typed function
+// for the array; a comparator is a function of the module taking two
+// elements.
+
+static int is_array_algorithm(const char* method) {
+    static const char* methods[] = {"sort", "parallel_sort", "nth_element", "partial_sort",
+                                    "lower_bound", "upper_bound", "search"};
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strcmp(method, methods[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// cmp must name a function (T a, T b) of this module returning int
+static void emit_array_comparator(FILE* f, ASTNode* node, ASTNode* cmp, const TypedArray* sa) {
+    ASTNode* fn = cmp->type == AST_IDENTIFIER ? find_function(cmp->text) : NULL;
+    int argc = 0;
+    if (fn && fn->child_count > 0 && fn->children[0]->type != AST_BLOCK) {
+        for (int i = 1; i < fn->child_count && fn->children[i]->type == AST_VAR_DECL; i++) argc++;
+    }
+    if (!fn || argc != 2 || strcmp(fn->children[0]->text, "int") != 0 ||
+        strcmp(fn->children[1]->children[1]->text, sa->elem) != 0 ||
+        strcmp(fn->children[2]->children[1]->text, sa->elem) != 0) {
+        codegen_error(node, "%s: the comparator is a function int(%s a, %s b) of this module",
+                      node->text, sa->elem, sa->elem);
+    }
+    fprintf(f, "come_%s__%s", current_module, cmp->type == AST_IDENTIFIER ? cmp->text : "");
+}
+
+static void generate_array_algorithm(FILE* f, ASTNode* node, const TypedArray* sa) {
+    const char* method = node->text;
+    ASTNode* target = node->children[0];
+    int argc = node->child_count - 1;
+    int sorts = strcmp(method, "sort") == 0 || strcmp(method, "parallel_sort") == 0;
+
+    if ((sorts && argc > 1) || (!sorts && argc != 1)) {
+        codegen_error(node, "%s takes %s", method, sorts ? "an optional comparator" : "one argument");
+        fprintf(f, "0");
+        return;
+    }
+    int reorders = sorts || strcmp(method, "nth_element") == 0 || strcmp(method, "partial_sort") == 0;
+    if (reorders) {
+        fprintf(f, "(come_array_cow(");
+        generate_expression(f, target);
+        fprintf(f, "), ");
+    }
+    fprintf(f, "come_%s_%s%s(", sa->prefix, method, sorts && argc == 1 ? "_by" : "");
+    generate_expression(f, target);
+    if (argc == 1) {
+        ASTNode* arg = node->children[1];
+        fprintf(f, ", ");
+        if (sorts) {
+            emit_array_comparator(f, node, arg, sa);
+        } else if (strcmp(sa->elem, "string") == 0 && arg->type != AST_STRING_LITERAL &&
+                   strcmp(method, "nth_element") != 0 && strcmp(method, "partial_sort") != 0) {
+            // Keys of string[] searches are C strings
+            fprintf(f, "come_string_cstr(");
+            generate_expression(f, arg);
+            fprintf(f, ")");
+        } else {
+            generate_expression(f, arg);
+        }
+    }
+    fprintf(f, reorders ? "))" : ")");
+}
+
+// .dup(depth). Strings and arrays of numbers are flat and copy with one
+// memcpy; string lists and maps copy in the runtime. Each struct gets a
+// generated come_<module>__<Struct>__dup_into(ctx, dst, src, depth): depth 1
+// copies the struct alone; otherwise its strings, arrays and maps are copied
+// too, a level down (0 stays 0: everything), and struct members, being part
+// of it, are filled the same way at its own depth.
+
+static ASTNode* find_union(const char* type) {
+    if (!type || !current_program) return NULL;
+    if (strncmp(type, "union ", 6) == 0) type += 6;
+    for (int i = 0; i < current_program->child_count; i++) {
+        ASTNode* child = current_program->children[i];
+        if (child->type == AST_UNION_DECL && strcmp(child->text, type) == 0) return child;
+    }
+    return NULL;
+}
+
+// Whether a member of this type holds objects to copy: a struct member
+// does if any of its own members do
+static int is_dup_member(const char* type) {
+    if (strcmp(type, "string") == 0 || strcmp(type, "map") == 0 || typed_array(type)) return 1;
+    ASTNode* st = find_struct(type);
+    for (int i = 0; st && i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type == AST_VAR_DECL && is_dup_member(field->children[1]->text)) return 1;
+    }
+    return 0;
+}
+
+static void emit_struct_dup_prototype(FILE* f, ASTNode* st) {
+    fprintf(f, "static __attribute__((unused)) void come_%s__%s__dup_into(TALLOC_CTX* ctx, struct %s* dst, "
+               "const struct %s* src, int depth);\n", current_module, st->text, st->text, st->text);
+}
+
+static void emit_struct_dup(FILE* f, ASTNode* st) {
+    int members = 0;
+    for (int i = 0; i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type == AST_VAR_DECL && is_dup_member(field->children[1]->text)) members++;
+    }
+
+    fprintf(f, "static void come_%s__%s__dup_into(TALLOC_CTX* ctx, struct %s* dst, const struct %s* src, int depth) {\n",
+            current_module, st->text, st->text, st->text);
+    fprintf(f, "    *dst = *src;\n");
+    if (members) {
+        fprintf(f, "    if (depth == 1) return;\n");
+        fprintf(f, "    __attribute__((unused)) int next = depth ? depth - 1 : 0;\n");
+    }
+    for (int i = 0; i < st->child_count; i++) {
+        ASTNode* field = st->children[i];
+        if (field->type != AST_VAR_DECL) continue;
+        const char* type = field->children[1]->text;
+        const TypedArray* ta = typed_array(type);
+        ASTNode* nested = find_struct(type);
+        if (strcmp(type, "string") == 0) {
+            fprintf(f, "    dst->%s = come_string_share(ctx, src->%s);\n", field->text, field->text);
+        } else if (strcmp(type, "map") == 0) {
+            fprintf(f, "    dst->%s = come_map_dup(ctx, src->%s, next);\n", field->text, field->text);
+        } else if (ta) {
+            fprintf(f, "    dst->%s = come_%s_dup(ctx, src->%s, next);\n", field->text, ta->prefix, field->text);
+        } else if (nested && is_dup_member(type)) {
+            fprintf(f, "    come_%s__%s__dup_into(ctx, &dst->%s, &src->%s, depth);\n",
+                    current_module, nested->text, field->text, field->text);
+        }
+    }
+    fprintf(f, "}\n");
+}
+
+// Copies anchor to the local scope (COME_CTX); 0 when the type has no .dup
+static int generate_dup(FILE* f, ASTNode* node) {
+    ASTNode* receiver = node->children[0];
+    int argc = node->child_count - 1;
+    const char* type = receiver_type(receiver);
+    if (!type) return 0;
+    const TypedArray* ta = typed_array(type);
+    ASTNode* st = find_struct(type);
+    if (strcmp(type, "string") != 0 && strcmp(type, "map") != 0 && !ta && !st && !find_union(type)) return 0;
+    if (argc > 1) {
+        codegen_error(node, "dup takes an optional depth");
+        fprintf(f, "0");
+        return 1;
+    }
+
+    if (strcmp(type, "string") == 0) {
+        // Strings hold no other objects, and their in-place methods copy a
+        // shared string first: every depth shares the bytes until a write
+        fprintf(f, "come_string_share(COME_CTX, ");
+        generate_expression(f, receiver);
+        fprintf(f, ")");
+        return 1;
+    }
+    if (!st && !ta && strcmp(type, "map") != 0) {
+        // Which member a union holds is unknown, so it copies as plain bytes
+        fprintf(f, "(");
+        generate_expression(f, receiver);
+        fprintf(f, ")");
+        return 1;
+    }
+
+    if (st) {
+        fprintf(f, "({ struct %s __dup; come_%s__%s__dup_into(COME_CTX, &__dup, &(", st->text, current_module, st->text);
+    } else if (ta) {
+        fprintf(f, "come_%s_dup(COME_CTX, ", ta->prefix);
+    } else {
+        fprintf(f, "come_map_dup(COME_CTX, ");
+    }
+    generate_expression(f, receiver);
+    fprintf(f, st ? "), " : ", ");
+    if (argc == 1) generate_expression(f, node->children[1]);
+    else fprintf(f, "0");
+    fprintf(f, st ? "); __dup; })" : ")");
+    return 1;
+}
+
+// .share() and .share(owner): the same string or typed array for another
+// owner (the local scope by default), copied by whichever handle writes it
+// first; 0 when the type has no .share
+static int generate_share(FILE* f, ASTNode* node) {
+    ASTNode* receiver = node->children[0];
+    const char* type = receiver_type(receiver);
+    int is_string = type && strcmp(type, "string") == 0;
+    if (!is_string && !typed_array(type)) return 0;
+    if (node->child_count > 2) {
+        codegen_error(node, "share takes an optional owner");
+        fprintf(f, "0");
+        return 1;
+    }
+
+    fprintf(f, is_string ? "come_string_share(" : "come_array_share(");
+    if (node->child_count == 2) generate_expression(f, node->children[1]);
+    else fprintf(f, "COME_CTX");
+    fprintf(f, ", ");
+    generate_expression(f, receiver);
+    if (!is_string) {
+        fprintf(f, ", sizeof((");
+        generate_expression(f, receiver);
+        fprintf(f, ")->items[0])");
+    }
+    fprintf(f, ")");
+    return 1;
+}
+
+// parallel for lowering. The loop body becomes a function over a sub-range,
+// written to deferred_out and emitted after the enclosing function; the loop
+// becomes a come_parallel_for call with the captured variables passed by
+// address. Each participant copies the captured values in, and keeps its
+// reduction variables locally until it folds them into its own slot.
+static int parallel_site_count = 0;
+static FILE* deferred_out = NULL;
+static char* deferred_buf = NULL;
+static size_t deferred_len = 0;
+
+typedef struct {
+    const char* names[256];
+    int count;
+} NameSet;
+
+static int nameset_has(const NameSet* set, const char* name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+static void nameset_add(NameSet* set, const char* name) {
+    if (!nameset_has(set, name) && set->count < 256) set->names[set->count++] = name;
+}
+
+// Captures of the parallel for body being generated that are pointers to
+// the enclosing function's variable rather than copies of it
+static NameSet parallel_shared = { .count = 0 };
+
+static void collect_decls(ASTNode* node, NameSet* decls) {
+    if (!node) return;
+    if (node->type == AST_VAR_DECL) nameset_add(decls, node->text);
+    for (int i = 0; i < node->child_count; i++) collect_decls(node->children[i], decls);
+}
+
+static void collect_refs(ASTNode* node, NameSet* refs) {
+    if (!node) return;
+    if (node->type == AST_IDENTIFIER) nameset_add(refs, node->text);
+    for (int i = 0; i < node->child_count; i++) collect_refs(node->children[i], refs);
+}
+
+// Arrays whose elements the body writes. Workers hold copies of the array
+// handles, so a shared array is made writable once, before the loop, and
+// the checks in the body then find it unshared.
+static void collect_array_writes(ASTNode* node, NameSet* writes) {
+    if (!node) return;
+    ASTNode* array = NULL;
+    if ((node->type == AST_ASSIGN || node->type == AST_POST_INC || node->type == AST_POST_DEC) &&
+        node->child_count > 0) {
+        array = written_array(node->children[0]);
+    } else if (node->type == AST_METHOD_CALL && strcmp(node->text, "store") == 0 && node->child_count > 1 &&
+               vector_expr_type(node->children[0])) {
+        array = node->children[1];
+    }
+    if (array && array->type == AST_IDENTIFIER) nameset_add(writes, array->text);
+    for (int i = 0; i < node->child_count; i++) collect_array_writes(node->children[i], writes);
+}
+
+// Methods that may move their array or string, re-pointing the handle
+static int moves_receiver(const char* method) {
+    static const char* methods[] = {"resize", "push", "upper_inplace", "lower_inplace",
+                                    "append_long", "append_double"};
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strcmp(method, methods[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// Rejects what cannot run split across threads: writes to variables from
+// outside the body other than reductions, and leaving the loop early
+static void check_parallel_body(ASTNode* node, const NameSet* decls, const NameSet* reductions,
+                                const char* loop_var, int nested) {
+    if (!node) return;
+    ASTNode* target = NULL;
+    if ((node->type == AST_ASSIGN || node->type == AST_POST_INC || node->type == AST_POST_DEC) &&
+        node->child_count > 0) {
+        target = node->children[0];
+    }
+    if (target && target->type == AST_IDENTIFIER && !nameset_has(decls, target->text) &&
+        !nameset_has(reductions, target->text) && !atomic_type(target)) {
+        if (strcmp(target->text, loop_var) == 0) {
+            codegen_error(target, "parallel for: the body changes the loop variable '%s'", loop_var);
+        } else {
+            codegen_error(target, "parallel for: the body writes shared variable '%s'; "
+                                "reduce it, or write to an array element", target->text);
+        }
+    }
+    // Fields of a captured struct: the body has its own copy, so writes would be lost
+    ASTNode* base = target;
+    while (base && (base->type == AST_MEMBER_ACCESS || base->type == AST_ARRAY_ACCESS) &&
+           !written_array(base)) {
+        base = base->children[0];
+    }
+    if (base && base != target && base->type == AST_IDENTIFIER && !nameset_has(decls, base->text) &&
+        !atomic_type(target)) {
+        const char* type = variable_type(base->text);
+        if (type && !strchr(type, '*') && find_struct(type) && !is_shared_type(type)) {
+            codegen_error(target, "parallel for: the body writes a field of shared variable '%s', "
+                                "which it only has a copy of", base->text);
+        }
+    }
+    // The body holds a copy of each captured handle, so a method that moves
+    // the array would leave the caller's pointing at freed memory
+    if (node->type == AST_METHOD_CALL && node->child_count > 0 && moves_receiver(node->text) &&
+        node->children[0]->type == AST_IDENTIFIER && !nameset_has(decls, node->children[0]->text)) {
+        codegen_error(node, "parallel for: the body calls %s() on shared variable '%s', "
+                            "which may move it; size it before the loop", node->text, node->children[0]->text);
+    }
+    if (node->type == AST_RETURN) codegen_error(node, "parallel for: return inside the loop body");
+    if (node->type == AST_BREAK && !nested) codegen_error(node, "parallel for: break out of the loop body");
+    int inner = nested || node->type == AST_FOR || node->type == AST_WHILE ||
+                node->type == AST_DO_WHILE || node->type == AST_SWITCH || node->type == AST_SELECT;
+    for (int i = 0; i < node->child_count; i++) {
+        check_parallel_body(node->children[i], decls, reductions, loop_var, inner);
+    }
+}
+
+// C type of a variable from outside an outlined body, or NULL if unknown;
+// what and where name the construct for errors
+static const char* captured_type(ASTNode* site, const char* name, char* out, size_t size,
+                                 const char* what, const char* where) {
+    const char* type = get_local_variable_type(name);
+    if (!type) return NULL;
+    if (strcmp(type, "var") == 0) {
+        codegen_error(site, "%s: give '%s' an explicit type to use it in %s", what, name, where);
+        return NULL;
+    }
+    come_c_type(type, out, size);
+    return out;
+}
+
+static void generate_parallel_for(FILE* f, ASTNode* node, int indent) {
+    ASTNode* init = node->children[0];
+    ASTNode* cond = node->children[1];
+    ASTNode* iter = node->children[2];
+    ASTNode* body = node->children[3];
+
+    // for (T i = lo; i < hi; i++), or i <= hi
+    const char* var = (init && init->type == AST_VAR_DECL) ? init->text : NULL;
+    int shape_ok = var && cond && cond->type == AST_BINARY_OP && cond->child_count == 2 &&
+                   (strcmp(cond->text, "<") == 0 || strcmp(cond->text, "<=") == 0) &&
+                   cond->children[0]->type == AST_IDENTIFIER && strcmp(cond->children[0]->text, var) == 0 &&
+                   iter && iter->type == AST_POST_INC && iter->children[0]->type == AST_IDENTIFIER &&
+                   strcmp(iter->children[0]->text, var) == 0;
+    if (!shape_ok) {
+        codegen_error(node, "parallel for needs the form for (int i = lo; i < hi; i++)");
+        return;
+    }
+    const char* var_type = init->children[1]->text;
+
+    NameSet reductions = { .count = 0 };
+    const char* reduce_ops[256];
+    ASTNode* chunk = NULL;
+    int dynamic = 0;
+    for (int i = 4; i < node->child_count; i++) {
+        ASTNode* clause = node->children[i];
+        if (strcmp(clause->text, "reduce") == 0) {
+            const char* op = clause->children[0]->text;
+            if (strcmp(op, "+") && strcmp(op, "*") && strcmp(op, "&") && strcmp(op, "|") && strcmp(op, "^")) {
+                codegen_error(node, "parallel for: cannot reduce with '%s' (use + * & | ^)", op);
+                return;
+            }
+            for (int j = 1; j < clause->child_count; j++) {
+                reduce_ops[reductions.count] = op;
+                nameset_add(&reductions, clause->children[j]->text);
+            }
+        } else {
+            dynamic = strcmp(clause->text, "dynamic") == 0;
+            chunk = clause->child_count > 0 ? clause->children[0] : NULL;
+        }
+    }
+
+    NameSet decls = { .count = 0 };
+    collect_decls(body, &decls);
+    int errors = codegen_errors;
+    check_parallel_body(body, &decls, &reductions, var, 0);
+
+    // Captures: names used in the body that are variables of the enclosing function
+    NameSet refs = { .count = 0 }, captures = { .count = 0 };
+    collect_refs(body, &refs);
+    char types[256][128];
+    for (int i = 0; i < refs.count; i++) {
+        const char* name = refs.names[i];
+        if (strcmp(name, var) == 0 || nameset_has(&decls, name) || nameset_has(&reductions, name)) continue;
+        if (captured_type(node, name, types[captures.count], sizeof(types[0]), "parallel for", "the loop body")) {
+            nameset_add(&captures, name);
+        }
+    }
+    char red_types[256][128];
+    for (int i = 0; i < reductions.count; i++) {
+        if (!captured_type(node, reductions.names[i], red_types[i], sizeof(red_types[0]), "parallel for", "the loop body")) {
+            codegen_error(node, "parallel for: reduction variable '%s' is not a local variable", reductions.names[i]);
+        }
+    }
+    if (codegen_errors != errors) return;
+
+    int site = ++parallel_site_count;
+    char fn[300];
+    snprintf(fn, sizeof(fn), "come_%s__pfor%d", current_module, site);
+
+    // The call site
+    emit_line_directive(f, node);
+    emit_indent(f, indent);
+    fprintf(f, "{\n");
+    emit_indent(f, indent + 4);
+    fprintf(f, "void %s(void**, long, long, void*, void*);\n", fn);
+    emit_indent(f, indent + 4);
+    fprintf(f, "int __width = come_parallel_width();\n");
+    if (reductions.count) {
+        emit_indent(f, indent + 4);
+        fprintf(f, "struct %s_slot {", fn);
+        for (int i = 0; i < reductions.count; i++) fprintf(f, " %s %s;", red_types[i], reductions.names[i]);
+        fprintf(f, " } __attribute__((aligned(64))) __slots[__width];\n");
+        emit_indent(f, indent + 4);
+        fprintf(f, "for (int __p = 0; __p < __width; __p++) {");
+        for (int i = 0; i < reductions.count; i++) {
+            const char* op = reduce_ops[i];
+            fprintf(f, " __slots[__p].%s = %s;", reductions.names[i],
+                    strcmp(op, "*") == 0 ? "1" : strcmp(op, "&") == 0 ? "~0" : "0");
+        }
+        fprintf(f, " }\n");
+    }
+    NameSet writes = { .count = 0 };
+    collect_array_writes(body, &writes);
+    for (int i = 0; i < captures.count; i++) {
+        if (!nameset_has(&writes, captures.names[i])) continue;
+        emit_indent(f, indent + 4);
+        fprintf(f, nameset_has(&parallel_shared, captures.names[i]) ? "come_array_cow((*%s));\n" : "come_array_cow(%s);\n",
+                captures.names[i]);
+    }
+    emit_indent(f, indent + 4);
+    fprintf(f, "void* __env[] = {");
+    for (int i = 0; i < captures.count; i++) {
+        fprintf(f, nameset_has(&parallel_shared, captures.names[i]) ? " %s," : " &%s,", captures.names[i]);
+    }
+    fprintf(f, " NULL };\n");
+    emit_indent(f, indent + 4);
+    fprintf(f, "come_parallel_for(&(come_parallel_for_t){ .lo = ");
+    generate_expression(f, init->children[0]);
+    fprintf(f, ", .hi = ");
+    generate_expression(f, cond->children[1]);
+    if (strcmp(cond->text, "<=") == 0) fprintf(f, " + 1");
+    fprintf(f, ", .chunk = ");
+    if (chunk) generate_expression(f, chunk);
+    else fprintf(f, "0");
+    fprintf(f, ", .dynamic = %d, .body = %s, .env = __env, ", dynamic, fn);
+    if (reductions.count) fprintf(f, ".slots = __slots, .slot_size = sizeof(__slots[0]), ");
+    fprintf(f, ".width = __width, .ctx = COME_CTX });\n");
+    if (reductions.count) {
+        emit_indent(f, indent + 4);
+        fprintf(f, "for (int __p = 0; __p < __width; __p++) {");
+        for (int i = 0; i < reductions.count; i++) {
+            fprintf(f, " %s = %s %s __slots[__p].%s;", reductions.names[i], reductions.names[i],
+                    reduce_ops[i], reductions.names[i]);
+        }
+        fprintf(f, " }\n");
+    }
+    emit_indent(f, indent);
+    fprintf(f, "}\n");
+
+    // The body, over [lo, hi)
+    char* text = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&text, &len);
+    fprintf(out, "\nvoid %s(void** __env, long __lo, long __hi, void* __slot, void* __ctx) {\n", fn);
+    NameSet outer_shared = parallel_shared;
+    parallel_shared.count = 0;
+    for (int i = 0; i < captures.count; i++) {
+        if (is_shared_type(variable_type(captures.names[i]))) {
+            fprintf(out, "    %s* %s = __env[%d];\n", types[i], captures.names[i], i);
+            nameset_add(&parallel_shared, captures.names[i]);
+        } else {
+            fprintf(out, "    %s %s = *(%s*)__env[%d];\n", types[i], captures.names[i], types[i], i);
+        }
+    }
+    for (int i = 0; i < reductions.count; i++) {
+        const char* op = reduce_ops[i];
+        fprintf(out, "    %s %s = %s;\n", red_types[i], reductions.names[i],
+                strcmp(op, "*") == 0 ? "1" : strcmp(op, "&") == 0 ? "~0" : "0");
+    }
+    fprintf(out, "    TALLOC_CTX* __outer = COME_CTX;\n");
+    fprintf(out, "    COME_CTX = __ctx;\n");
+    fprintf(out, "    for (%s %s = __lo; %s < __hi; %s++) {\n", var_type, var, var, var);
+    add_local_variable(var, var_type);
+    ASTNode* outer_async = async_function;
+    async_function = NULL;
+    if (body->type == AST_BLOCK) {
+        for (int i = 0; i < body->child_count; i++) generate_node(out, body->children[i], 8);
+    } else {
+        generate_node(out, body, 8);
+    }
+    async_function = outer_async;
+    parallel_shared = outer_shared;
+    fprintf(out, "    }\n");
+    fprintf(out, "    COME_CTX = __outer;\n");
+    if (reductions.count) {
+        fprintf(out, "    struct %s_slot {", fn);
+        for (int i = 0; i < reductions.count; i++) fprintf(out, " %s %s;", red_types[i], reductions.names[i]);
+        fprintf(out, " } __attribute__((aligned(64)))* __mine = __slot;\n");
+        for (int i = 0; i < reductions.count; i++) {
+            fprintf(out, "    __mine->%s = __mine->%s %s %s;\n", reductions.names[i], reductions.names[i],
+                    reduce_ops[i], reductions.names[i]);
+        }
+    } else {
+        fprintf(out, "    (void)__slot;\n");
+    }
+    fprintf(out, "}\n");
+    fclose(out);
+    if (!deferred_out) deferred_out = open_memstream(&deferred_buf, &deferred_len);
+    fputs(text, deferred_out);
+    free(text);
+    last_emitted_line = -1; // The enclosing function picks up its #line again
+}
+
+// conn.on(EVENT) { ... } and msg.on(EVENT) { ... } lowering, for net.tcp
+// handles and net.http messages. The block becomes a handler function,
+// deferred like parallel for bodies, with a wrapper that runs it under the
+// context the loop passes in. The variables it uses from the enclosing
+// function are copied into an environment allocated under the handle when
+// the handler is attached. READABLE handlers see the bytes as data, and
+// net.http handlers the line, header block or body piece as a string.
+static int handler_site_count = 0;
+
+// Come type of a net expression: a variable of a net type, net.http.new()
+// or a session's req/resp; NULL otherwise
+static const char* net_expr_type(ASTNode* node) {
+    if (!node) return NULL;
+    if (node->type == AST_NET_HTTP_NEW) return "net.http.Session";
+    if (node->type == AST_IDENTIFIER) {
+        const char* type = get_local_variable_type(node->text);
+        return type && strncmp(type, "net.", 4) == 0 ? type : NULL;
+    }
+    if (node->type == AST_MEMBER_ACCESS && (strcmp(node->text, "req") == 0 || strcmp(node->text, "resp") == 0)) {
+        const char* type = net_expr_type(node->children[0]);
+        if (type && strcmp(type, "net.http.Session") == 0) return "net.http.Message";
+    }
+    return NULL;
+}
+
+// Come type of a net expression or new channel, for var declarations;
+// "var" otherwise
+static const char* net_var_type(ASTNode* init) {
+    if (!init) return "var";
+    switch (init->type) {
+        case AST_NET_TCP_CONNECT: return "net.tcp.Conn";
+        case AST_NET_TCP_ACCEPT: return "net.tcp.Conn";
+        case AST_NET_TCP_LISTEN: return "net.tcp.Listener";
+        case AST_NET_TCP_ADDR: return "net.tcp.Addr";
+        case AST_CHAN_NEW: return init->text;
+        default: break;
+    }
+    if (init->type == AST_METHOD_CALL && strcmp(init->text, "accept") == 0 &&
+        init->children[0]->type == AST_IDENTIFIER) {
+        const char* type = get_local_variable_type(init->children[0]->text);
+        if (type && strcmp(type, "net.tcp.Listener") == 0) return "net.tcp.Conn";
+    }
+    const char* type = net_expr_type(init);
+    return type ? type : "var";
+}
+
+static const char* net_tcp_events[] = { "ACCEPT", "CONNECT", "READABLE", "WRITABLE", "ERROR", "HUP" };
+static const char* net_http_events[] = { "LINE_READY", "HEADER_READY", "DATA_READY", "READY",
+                                         "HEADER_DONE", "DATA_DONE", "DONE" };
+
+// Methods of net.http messages that return a string
+static int net_http_string_method(ASTNode* call) {
+    const char* type = net_expr_type(call->children[0]);
+    if (!type || strcmp(type, "net.http.Message") != 0) return 0;
+    return strcmp(call->text, "method") == 0 || strcmp(call->text, "path") == 0 ||
+           strcmp(call->text, "version") == 0 || strcmp(call->text, "header") == 0 ||
+           strcmp(call->text, "body") == 0;
+}
+
+// Handlers work on copies: assigning a captured variable would only change
+// the copy, so it is rejected, as is returning a value
+static void check_handler_body(ASTNode* node, const NameSet* captures, const char* event, int nested) {
+    if (!node) return;
+    if ((node->type == AST_ASSIGN || node->type == AST_POST_INC || node->type == AST_POST_DEC) &&
+        node->child_count > 0 && node->children[0]->type == AST_IDENTIFIER &&
+        nameset_has(captures, node->children[0]->text)) {
+        codegen_error(node->children[0], "on(%s): the handler writes captured variable '%s', "
+                      "a copy taken when the handler was attached", event, node->children[0]->text);
+    }
+    if (node->type == AST_RETURN && node->child_count > 0) {
+        codegen_error(node, "on(%s): handlers do not return a value", event);
+    }
+    if (node->type == AST_BREAK && !nested) codegen_error(node, "on(%s): break out of the handler", event);
+    if (node->type == AST_NET_ON) return;  // Checked with its own captures
+    int inner = nested || node->type == AST_FOR || node->type == AST_WHILE ||
+                node->type == AST_DO_WHILE || node->type == AST_SWITCH || node->type == AST_SELECT;
+    for (int i = 0; i < node->child_count; i++) check_handler_body(node->children[i], captures, event, inner);
+}
+
+static void generate_net_on(FILE* f, ASTNode* node, int indent) {
+    ASTNode* receiver = node->children[0];
+    ASTNode* event = node->children[1];
+    ASTNode* body = node->children[2];
+    // net.http messages pass data as a string, net.tcp handles as bytes
+    const char* recv_type = net_expr_type(receiver);
+    int http = recv_type && strcmp(recv_type, "net.http.Message") == 0;
+    const char** events = http ? net_http_events : net_tcp_events;
+    size_t event_count = http ? sizeof(net_http_events) / sizeof(net_http_events[0])
+                              : sizeof(net_tcp_events) / sizeof(net_tcp_events[0]);
+    const char* prefix = http ? "http" : "tcp";
+    const char* data_type = http ? "come_string_t*" : "come_byte_array_t*";
+    int known = 0;
+    for (size_t i = 0; i < event_count; i++) {
+        if (event->type == AST_IDENTIFIER && strcmp(event->text, events[i]) == 0) known = 1;
+    }
+    if (!known) {
+        codegen_error(node, http ? "on(): unknown event '%s' (LINE_READY, HEADER_READY, DATA_READY, READY, "
+                                   "HEADER_DONE, DATA_DONE, DONE)"
+                                 : "on(): unknown event '%s' (ACCEPT, CONNECT, READABLE, WRITABLE, ERROR, HUP)",
+                      event->text);
+        return;
+    }
+
+    NameSet decls = { .count = 0 }, refs = { .count = 0 }, captures = { .count = 0 };
+    collect_decls(body, &decls);
+    nameset_add(&decls, "data");
+    collect_refs(body, &refs);
+    char types[256][128];
+    int errors = codegen_errors;
+    char what[64];
+    snprintf(what, sizeof(what), "on(%.16s)", event->text);
+    for (int i = 0; i < refs.count; i++) {
+        const char* name = refs.names[i];
+        if (nameset_has(&decls, name)) continue;
+        if (captured_type(node, name, types[captures.count], sizeof(types[0]), what, "the handler")) {
+            nameset_add(&captures, name);
+        }
+    }
+    check_handler_body(body, &captures, event->text, 0);
+    if (codegen_errors != errors) return;
+
+    int site = ++handler_site_count;
+    char fn[300];
+    snprintf(fn, sizeof(fn), "come_%s__on%d", current_module, site);
+
+    // The call site
+    emit_line_directive(f, node);
+    emit_indent(f, indent);
+    fprintf(f, "{\n");
+    emit_indent(f, indent + 4);
+    fprintf(f, "void %s(%s, void*, void*);\n", fn, data_type);
+    emit_indent(f, indent + 4);
+    if (captures.count) {
+        fprintf(f, "struct %s_env {", fn);
+        for (int i = 0; i < captures.count; i++) fprintf(f, " %s %s;", types[i], captures.names[i]);
+        fprintf(f, " }* __env = ");
+    }
+    fprintf(f, "come_net_%s_on(", prefix);
+    generate_expression(f, receiver);
+    fprintf(f, ", COME_NET_%s_%s, %s, ", http ? "HTTP" : "TCP", event->text, fn);
+    fprintf(f, captures.count ? "sizeof(*__env));\n" : "0);\n");
+    for (int i = 0; i < captures.count; i++) {
+        emit_indent(f, indent + 4);
+        fprintf(f, "if (__env) __env->%s = %s;\n", captures.names[i], captures.names[i]);
+    }
+    emit_indent(f, indent);
+    fprintf(f, "}\n");
+
+    // The handler: the block in a function of its own, so return works,
+    // and a wrapper that switches contexts around it
+    char* text = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&text, &len);
+    fprintf(out, "\nstatic void %s_body(%s data, void* __envp) {\n", fn, data_type);
+    if (captures.count) {
+        fprintf(out, "    struct %s_env {", fn);
+        for (int i = 0; i < captures.count; i++) fprintf(out, " %s %s;", types[i], captures.names[i]);
+        fprintf(out, " }* __env = __envp;\n");
+        for (int i = 0; i < captures.count; i++) {
+            fprintf(out, "    %s %s = __env->%s;\n", types[i], captures.names[i], captures.names[i]);
+        }
+    } else {
+        fprintf(out, "    (void)__envp;\n");
+    }
+    fprintf(out, "    (void)data;\n");
+    add_local_variable("data", http ? "string" : "byte[]");
+    ASTNode* outer_async = async_function;
+    async_function = NULL;
+    for (int i = 0; i < body->child_count; i++) generate_node(out, body->children[i], 4);
+    async_function = outer_async;
+    fprintf(out, "}\n");
+    fprintf(out, "\nvoid %s(%s data, void* __envp, void* __ctx) {\n", fn, data_type);
+    fprintf(out, "    TALLOC_CTX* __outer = COME_CTX;\n");
+    fprintf(out, "    COME_CTX = __ctx;\n");
+    fprintf(out, "    %s_body(data, __envp);\n", fn);
+    fprintf(out, "    COME_CTX = __outer;\n");
+    fprintf(out, "}\n");
+    fclose(out);
+    if (!deferred_out) deferred_out = open_memstream(&deferred_buf, &deferred_len);
+    fputs(text, deferred_out);
+    free(text);
+    last_emitted_line = -1;
+}
+
+// Outlined bodies go after the function they came from
+static void flush_deferred(FILE* f) {
+    if (!deferred_out) return;
+    fclose(deferred_out);
+    fputs(deferred_buf, f);
+    free(deferred_buf);
+    deferred_out = NULL;
+    deferred_buf = NULL;
+    deferred_len = 0;
+}
+
+// async/await lowering. An async function becomes a frame struct, a step
+// function and a constructor. The frame starts with a head (the task and
+// the result), declared with the prototypes so awaiters anywhere in the
+// file can read the result, then holds the parameters and every local of
+// the body. The step loads all of them into C locals of the same names,
+// so the body is generated as usual, and jumps to the label recorded by
+// the last await; each await stores them back before it suspends. Locals
+// are hoisted: declarations become assignments, and a name declared twice
+// must have the same type both times.
+static int async_resume_count = 0;
+
+static struct {
+    char names[256][64];
+    char types[256][128];  // Come types
+    int count;
+} async_frame;
+
+static ASTNode* find_async_function(const char* name) {
+    if (!current_program) return NULL;
+    for (int i = 0; i < current_program->child_count; i++) {
+        ASTNode* child = current_program->children[i];
+        if (child->type == AST_ASYNC_FUNCTION && strcmp(child->text, name) == 0) return child;
+    }
+    return NULL;
+}
+
+// Channels. chan<T> is a come_chan_t*; values cross it unboxed through a
+// temporary whose address the runtime takes, and object elements (string,
+// int[], byte[]) move to the receiving context instead of being copied.
+static int chan_site_count = 0;
+
+// Come type of a channel expression ("chan<int>"), or NULL
+static const char* chan_type(ASTNode* expr) {
+    if (!expr) return NULL;
+    if (expr->type == AST_CHAN_NEW) return expr->text;
+    if (expr->type == AST_IDENTIFIER) {
+        const char* type = get_local_variable_type(expr->text);
+        if (type && strncmp(type, "chan<", 5) == 0) return type;
+    }
+    return NULL;
+}
+
+// Element type of a chan<T> type, in Come and in C
+static void chan_elem_type(const char* type, char* elem, size_t elem_size, char* c_type, size_t c_size) {
+    snprintf(elem, elem_size, "%.*s", (int)strlen(type) - 6, type + 5);
+    come_c_type(elem, c_type, c_size);
+}
+
+// Whether a chan<elem> carries objects; elements that cannot be moved
+// between threads are errors
+static int chan_object_elem(ASTNode* site, const char* elem) {
+    if (strcmp(elem, "string") == 0 || strcmp(elem, "int[]") == 0 || strcmp(elem, "byte[]") == 0) return 1;
+    if (strchr(elem, '[') || strcmp(elem, "map") == 0 || strncmp(elem, "net.", 4) == 0 ||
+        strcmp(elem, "var") == 0 || strcmp(elem, "void") == 0) {
+        codegen_error(site, "chan<%s>: channels carry values, structs, string, int[] or byte[]", elem);
+    }
+    return 0;
+}
+
+// A value to send on a chan<elem>: string literals become strings, and views
+// are copied since they do not own their bytes
+static void emit_chan_value(FILE* f, const char* elem, ASTNode* value) {
+    if (strcmp(elem, "string") != 0) {
+        generate_expression(f, value);
+    } else if (value->type == AST_STRING_LITERAL) {
+        fprintf(f, "come_string_new(COME_CTX, ");
+        generate_expression(f, value);
+        fprintf(f, ")");
+    } else {
+        fprintf(f, "({ come_string_t* __s = ");
+        generate_expression(f, value);
+        fprintf(f, "; come_string_is_view(__s) ? come_string_new_len(COME_CTX, come_string_data(__s), __s->count) : __s; })");
+    }
+}
+
+// chan<T>(capacity[, SPSC]); no capacity, or 0, is unbounded
+static void generate_chan_new(FILE* f, ASTNode* node) {
+    char elem[128], c_type[128];
+    chan_elem_type(node->text, elem, sizeof(elem), c_type, sizeof(c_type));
+    int object = chan_object_elem(node, elem);
+    int spsc = 0;
+    if (node->child_count > 1) {
+        ASTNode* mode = node->children[1];
+        if (mode->type == AST_IDENTIFIER && strcmp(mode->text, "SPSC") == 0) spsc = 1;
+        else if (!(mode->type == AST_IDENTIFIER && strcmp(mode->text, "MPMC") == 0)) {
+            codegen_error(mode, "%s: the second argument is SPSC or MPMC", node->text);
+        }
+    }
+    if (node->child_count > 2) codegen_error(node, "%s takes a capacity and SPSC or MPMC", node->text);
+    fprintf(f, "come_chan_new(COME_CTX, sizeof(%s), ", c_type);
+    if (node->child_count > 0) generate_expression(f, node->children[0]);
+    else fprintf(f, "0");
+    fprintf(f, ", %s)", spsc && object ? "COME_CHAN_SPSC | COME_CHAN_OBJECT" :
+                        spsc ? "COME_CHAN_SPSC" : object ? "COME_CHAN_OBJECT" : "0");
+}
+
+// c.send(x), c.try_send(x): true once sent, false if closed (or full);
+// c.recv() gives the value (zero once closed and drained); c.recv(v) and
+// c.try_recv(v) store it in v and give true, or false without touching v;
+// c.close(), c.closed()
+static void generate_chan_method(FILE* f, ASTNode* node, const char* type) {
+    const char* method = node->text;
+    ASTNode* chan = node->children[0];
+    char elem[128], c_type[128];
+    chan_elem_type(type, elem, sizeof(elem), c_type, sizeof(c_type));
+    int site = ++chan_site_count;
+    int argc = node->child_count - 1;
+
+    if ((strcmp(method, "send") == 0 || strcmp(method, "try_send") == 0) && argc == 1) {
+        fprintf(f, "({ %s __chan%d = ", c_type, site);
+        emit_chan_value(f, elem, node->children[1]);
+        fprintf(f, "; come_chan_%s(", method);
+        generate_expression(f, chan);
+        fprintf(f, ", &__chan%d) == COME_CHAN_OK; })", site);
+    } else if (strcmp(method, "recv") == 0 && argc == 0) {
+        fprintf(f, "({ %s __chan%d; come_chan_recv(", c_type, site);
+        generate_expression(f, chan);
+        fprintf(f, ", &__chan%d, COME_CTX); __chan%d; })", site, site);
+    } else if ((strcmp(method, "recv") == 0 || strcmp(method, "try_recv") == 0) && argc == 1) {
+        fprintf(f, "({ %s __chan%d; bool __ok%d = come_chan_%s(", c_type, site, site, method);
+        generate_expression(f, chan);
+        fprintf(f, ", &__chan%d, COME_CTX) == COME_CHAN_OK; if (__ok%d) ", site, site);
+        generate_expression(f, node->children[1]);
+        fprintf(f, " = __chan%d; __ok%d; })", site, site);
+    } else if ((strcmp(method, "close") == 0 || strcmp(method, "closed") == 0) && argc == 0) {
+        fprintf(f, "%scome_chan_%s(", strcmp(method, "closed") == 0 ? "(bool)" : "", method);
+        generate_expression(f, chan);
+        fprintf(f, ")");
+    } else {
+        codegen_error(node, "%s has no method %s taking %d argument(s)", type, method, argc);
+        fprintf(f, "0");
+    }
+}
+
+// select: every case's channel operation goes in a come_chan_case_t, and
+// the case come_chan_select() picks runs as a switch case, after a recv
+// case has stored what it got. Both operations take an optional bool that
+// is set false when the case ran because its channel was closed. Without a
+// default case the select waits for one to be ready.
+static void generate_select(FILE* f, ASTNode* node, int indent) {
+    int site = ++chan_site_count;
+    int n = 0, has_default = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        ASTNode* c = node->children[i];
+        if (c->type == AST_DEFAULT) {
+            if (has_default) codegen_error(c, "select has more than one default case");
+            has_default = 1;
+            continue;
+        }
+        ASTNode* op = c->type == AST_CASE ? c->children[0] : NULL;
+        if (!op || op->type != AST_METHOD_CALL || !chan_type(op->children[0]) ||
+            (strcmp(op->text, "send") != 0 && strcmp(op->text, "recv") != 0) ||
+            op->child_count < 2 || op->child_count > 3) {
+            codegen_error(c, "select cases are c.recv(v[, ok]) or c.send(x[, ok]) on a channel c");
+            return;
+        }
+        n++;
+    }
+    if (n == 0) {
+        codegen_error(node, "select needs at least one channel case");
+        return;
+    }
+
+    emit_line_directive(f, node);
+    emit_indent(f, indent);
+    fprintf(f, "{\n");
+    emit_indent(f, indent + 4);
+    fprintf(f, "come_chan_case_t __select%d[%d];\n", site, n);
+    int k = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        ASTNode* op = node->children[i]->children[0];
+        if (node->children[i]->type == AST_DEFAULT) continue;
+        char elem[128], c_type[128];
+        chan_elem_type(chan_type(op->children[0]), elem, sizeof(elem), c_type, sizeof(c_type));
+        int send = strcmp(op->text, "send") == 0;
+        emit_indent(f, indent + 4);
+        fprintf(f, "%s __select%d_%d", c_type, site, k);
+        if (send) {
+            fprintf(f, " = ");
+            emit_chan_value(f, elem, op->children[1]);
+        }
+        fprintf(f, ";\n");
+        emit_indent(f, indent + 4);
+        fprintf(f, "__select%d[%d] = (come_chan_case_t){ ", site, k);
+        generate_expression(f, op->children[0]);
+        fprintf(f, ", &__select%d_%d, %d, 0 };\n", site, k, send);
+        k++;
+    }
+    emit_indent(f, indent + 4);
+    fprintf(f, "switch (come_chan_select(__select%d, %d, %d, COME_CTX)) {\n", site, n, !has_default);
+    k = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        ASTNode* c = node->children[i];
+        int first = 0;
+        emit_indent(f, indent + 4);
+        if (c->type == AST_DEFAULT) {
+            fprintf(f, "default: {\n");
+        } else {
+            ASTNode* op = c->children[0];
+            fprintf(f, "case %d: {\n", k);
+            if (strcmp(op->text, "recv") == 0) {
+                emit_indent(f, indent + 8);
+                generate_expression(f, op->children[1]);
+                fprintf(f, " = __select%d_%d;\n", site, k);
+            }
+            if (op->child_count > 2) {
+                emit_indent(f, indent + 8);
+                generate_expression(f, op->children[2]);
+                fprintf(f, " = !__select%d[%d].closed;\n", site, k);
+            }
+            first = 1;
+            k++;
+        }
+        for (int j = first; j < c->child_count; j++) generate_node(f, c->children[j], indent + 8);
+        emit_indent(f, indent + 8);
+        fprintf(f, "break;\n");
+        emit_indent(f, indent + 4);
+        fprintf(f, "}\n");
+    }
+    emit_indent(f, indent + 4);
+    fprintf(f, "}\n");
+    emit_indent(f, indent);
+    fprintf(f, "}\n");
+}
+
+static void async_name(ASTNode* fn, char* out, size_t size) {
+    snprintf(out, size, "come_%s__%s", current_module, fn->text);
+}
+
+// C type of a frame slot; fixed-size arrays are arrays like any other
+static void frame_c_type(const char* type, char* out, size_t size) {
+    const char* bracket = strchr(type, '[');
+    if (bracket && strncmp(type, "chan<", 5) != 0) {
+        char array[128];
+        snprintf(array, sizeof(array), "%.*s[]", (int)(bracket - type), type);
+        come_c_type(array, out, size);
+    } else {
+        come_c_type(type, out, size);
+    }
+}
+
+// Objects handed from a finished task to its awaiter with the result;
+// net handles stay with the loop
+static int is_owned_object(const char* c_type) {
+    return strcmp(c_type, "map") == 0 ||
+           (strchr(c_type, '*') && strncmp(c_type, "come_", 5) == 0 && strncmp(c_type, "come_net_", 9) != 0);
+}
+
+// Come type of what await x gives, or NULL if x cannot be awaited
+static const char* awaited_type(ASTNode* x) {
+    if (!x) return NULL;
+    if (x->type == AST_CALL) {
+        ASTNode* fn = find_async_function(x->text);
+        return fn ? fn->children[0]->text : NULL;
+    }
+    if (x->type == AST_NET_TCP_CONNECT) return "net.tcp.Conn";
+    if (x->type == AST_METHOD_CALL && x->child_count == 1) {
+        const char* type = net_expr_type(x->children[0]);
+        if (!type) return NULL;
+        if (strcmp(type, "net.tcp.Conn") == 0 && strcmp(x->text, "read") == 0) return "byte[]";
+        if (strcmp(type, "net.tcp.Listener") == 0 && strcmp(x->text, "accept") == 0) return "net.tcp.Conn";
+    }
+    return NULL;
+}
+
+// Come type of a var declaration's initializer, or NULL if it needs spelling out
+static const char* async_var_type(ASTNode* init) {
+    if (!init) return NULL;
+    if (init->type == AST_AWAIT) return init->child_count ? awaited_type(init->children[0]) : NULL;
+    if (init->type == AST_STRING_LITERAL) return "string";
+    if (init->type == AST_NUMBER) return infer_const_type(init);
+    const char* type = net_var_type(init);
+    return strcmp(type, "var") == 0 ? NULL : type;
+}
+
+static void frame_add(ASTNode* site, const char* name, const char* type) {
+    for (int i = 0; i < async_frame.count; i++) {
+        if (strcmp(async_frame.names[i], name) != 0) continue;
+        if (strcmp(async_frame.types[i], type) != 0) {
+            codegen_error(site, "async: '%s' is declared as both %s and %s; locals of an async "
+                          "function share one frame", name, async_frame.types[i], type);
+        }
+        return;
+    }
+    if (async_frame.count == 256) {
+        codegen_error(site, "async: too many locals");
+        return;
+    }
+    snprintf(async_frame.names[async_frame.count], sizeof(async_frame.names[0]), "%s", name);
+    snprintf(async_frame.types[async_frame.count], sizeof(async_frame.types[0]), "%s", type);
+    async_frame.count++;
+    add_local_variable(name, type);
+}
+
+// Handlers and parallel loop bodies are functions of their own
+static void collect_frame_vars(ASTNode* node) {
+    if (!node || node->type == AST_NET_ON) return;
+    if (node->type == AST_FOR && strcmp(node->text, "parallel") == 0) return;
+    for (int i = 0; i < node->child_count; i++) collect_frame_vars(node->children[i]);
+    if (node->type == AST_VAR_DECL && node->child_count > 1) {
+        const char* type = node->children[1]->text;
+        if (strcmp(type, "var") == 0) type = async_var_type(node->children[0]);
+        if (!type) {
+            codegen_error(node, "async: give '%s' an explicit type; it is kept in the frame", node->text);
+            type = "int";
+        }
+        frame_add(node, node->text, type);
+    }
+}
+
+// Declares the head and the functions of an async function, ahead of the bodies
+static void emit_async_prototypes(FILE* f, ASTNode* fn) {
+    char name[256], ret[128], arg[128];
+    async_name(fn, name, sizeof(name));
+    come_c_type(fn->children[0]->text, ret, sizeof(ret));
+    fprintf(f, "typedef struct {\n    come_async_t __task;\n");
+    if (strcmp(ret, "void") != 0) fprintf(f, "    %s __result;\n", ret);
+    fprintf(f, "} %s_head_t;\n", name);
+    fprintf(f, "int %s_step(come_async_t* __task);\n", name);
+    fprintf(f, "come_async_t* %s(", name);
+    int argc = 0;
+    for (int i = 1; i < fn->child_count && fn->children[i]->type == AST_VAR_DECL; i++) {
+        come_c_type(fn->children[i]->children[1]->text, arg, sizeof(arg));
+        fprintf(f, "%s%s", argc++ ? ", " : "", arg);
+    }
+    fprintf(f, "%s);\n", argc ? "" : "void");
+}
+
+// Evaluates an await, suspending the task unless it is already done, and
+// stores what it gave in target (if any)
+static void emit_await(FILE* f, ASTNode* node, int indent, const char* target) {
+    ASTNode* x = node->child_count ? node->children[0] : NULL;
+    if (!async_function) {
+        codegen_error(node, "await outside an async function");
+        return;
+    }
+    const char* type = awaited_type(x);
+    if (!type) {
+        codegen_error(node, "await needs a call to an async function, conn.read(), listener.accept() "
+                      "or net.tcp.connect()");
+        return;
+    }
+    char c_type[128];
+    frame_c_type(type, c_type, sizeof(c_type));
+    if (target && strcmp(c_type, "void") == 0) {
+        codegen_error(node, "await: %s returns nothing", x->text);
+        return;
+    }
+    ASTNode* fn = x->type == AST_CALL ? find_async_function(x->text) : NULL;
+    char name[256] = "";
+    if (fn) {
+        int argc = 0;
+        for (int i = 1; i < fn->child_count && fn->children[i]->type == AST_VAR_DECL; i++) argc++;
+        if (argc != x->child_count) {
+            codegen_error(node, "%s takes %d argument(s), await passes %d", x->text, argc, x->child_count);
+            return;
+        }
+        async_name(fn, name, sizeof(name));
+    }
+
+    int site = ++async_resume_count;
+    emit_line_directive(f, node);
+    emit_indent(f, indent);
+    fprintf(f, "__task->resume = &&__resume%d;\n", site);
+    emit_indent(f, indent);
+    if (fn) {
+        fprintf(f, "if (come_async_await(__task, %s(", name);
+        for (int i = 0; i < x->child_count; i++) {
+            if (i > 0) fprintf(f, ", ");
+            generate_expression(f, x->children[i]);
+        }
+        fprintf(f, "))) {\n");
+    } else {
+        fprintf(f, "if (come_async_%s(__task, ", x->type == AST_NET_TCP_CONNECT ? "connect" : x->text);
+        generate_expression(f, x->type == AST_NET_TCP_CONNECT ? x : x->children[0]);
+        fprintf(f, ")) {\n");
+    }
+    for (int i = 0; i < async_frame.count; i++) {
+        emit_indent(f, indent + 4);
+        fprintf(f, "__f->%s = %s;\n", async_frame.names[i], async_frame.names[i]);
+    }
+    emit_indent(f, indent + 4);
+    fprintf(f, "COME_CTX = __outer;\n");
+    emit_indent(f, indent + 4);
+    fprintf(f, "return COME_ASYNC_PENDING;\n");
+    emit_indent(f, indent);
+    fprintf(f, "}\n");
+    emit_indent(f, indent);
+    fprintf(f, "__resume%d: ;\n", site);
+    if (target) {
+        emit_indent(f, indent);
+        if (fn) fprintf(f, "%s = ((%s_head_t*)__task->awaiting)->__result;\n", target, name);
+        else fprintf(f, "%s = (%s)__task->value;\n", target, c_type);
+    }
+    if (fn) {
+        emit_indent(f, indent);
+        fprintf(f, "come_async_release(__task);\n");
     }
-    return 0;
 }
 
-static int enum_counter = 0;
-static char* seen_structs[256];
-static int seen_count = 0;
-
-static int is_struct_seen(const char* name) {
-    for (int i=0; i<seen_count; i++) {
-        if (strcmp(seen_structs[i], name) == 0) return 1;
+// T x = init: x is already a C local loaded from the frame, so the
+// declaration is generated as usual under another name and assigned
+static void generate_async_decl(FILE* f, ASTNode* node, int indent) {
+    ASTNode* init = node->children[0];
+    if (init && init->type == AST_AWAIT) {
+        emit_await(f, init, indent, node->text);
+        return;
     }
-    return 0;
+    char name[64];
+    strncpy(name, node->text, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    emit_indent(f, indent);
+    fprintf(f, "{\n");
+    snprintf(node->text, sizeof(node->text), "__decl_%s", name);
+    plain_decl = 1;
+    generate_node(f, node, indent + 4);
+    snprintf(node->text, sizeof(node->text), "%s", name);
+    emit_indent(f, indent + 4);
+    fprintf(f, "%s = __decl_%s;\n", name, name);
+    emit_indent(f, indent);
+    fprintf(f, "}\n");
 }
 
-static void mark_struct_seen(const char* name) {
-    if (!is_struct_seen(name) && seen_count < 256) {
-        seen_structs[seen_count++] = strdup(name);
+static void generate_async_return(FILE* f, ASTNode* node, int indent) {
+    char ret[128];
+    come_c_type(async_function->children[0]->text, ret, sizeof(ret));
+    ASTNode* value = node->child_count > 0 ? node->children[0] : NULL;
+    if (value && strcmp(ret, "void") == 0) {
+        codegen_error(node, "%s returns nothing", async_function->text);
+        return;
+    }
+    if (value && value->type == AST_AWAIT) {
+        emit_await(f, value, indent, "__f->__head.__result");
+    } else if (value) {
+        emit_line_directive(f, node);
+        emit_indent(f, indent);
+        fprintf(f, "__f->__head.__result = ");
+        if (value->type == AST_STRING_LITERAL && strcmp(ret, "come_string_t*") == 0) {
+            fprintf(f, "come_string_new(COME_CTX, ");
+            generate_expression(f, value);
+            fprintf(f, ")");
+        } else {
+            generate_expression(f, value);
+        }
+        fprintf(f, ";\n");
+    }
+    if (value && is_owned_object(ret)) {
+        emit_indent(f, indent);
+        fprintf(f, "__task->result = __f->__head.__result;\n");
     }
+    emit_indent(f, indent);
+    fprintf(f, "COME_CTX = __outer;\n");
+    emit_indent(f, indent);
+    fprintf(f, "return COME_ASYNC_DONE;\n");
 }
 
-static const char* infer_const_type(ASTNode* node) {
-    if (!node) return "int";
-    
-    // String literals -> char*
-    if (node->type == AST_STRING_LITERAL) {
-        return "char*";
+static void generate_async_function(FILE* f, ASTNode* node, int indent) {
+    ASTNode* body = node->children[node->child_count - 1];
+    const char* reserved[] = { "main", "init", "exit", "module_init" };
+    for (size_t i = 0; i < sizeof(reserved) / sizeof(reserved[0]); i++) {
+        if (strcmp(node->text, reserved[i]) == 0) {
+            codegen_error(node, "%s cannot be async", node->text);
+            return;
+        }
     }
-    
-    if (node->type != AST_NUMBER) return "int";
-    
-    char* text = node->text;
-    if (strchr(text, '.') || strstr(text, "f") || strstr(text, "F")) {
-        // Default floating point literals to float per user preference
-        return "float";
+    if (strchr(node->text, '_') && isupper(node->text[0])) {
+        codegen_error(node, "async methods are not supported");
+        return;
     }
-    
-    int is_unsigned = (strstr(text, "u") != NULL || strstr(text, "U") != NULL);
-    int is_long = (strstr(text, "l") != NULL || strstr(text, "L") != NULL);
-    int is_long_long = (strstr(text, "LL") != NULL || strstr(text, "ll") != NULL);
-    
-    if (is_unsigned) {
-        if (is_long_long) return "unsigned long long";
-        if (is_long) return "unsigned long";
-        return "unsigned int";
+    if (body->type != AST_BLOCK) return;
+
+    char name[256], type[128];
+    async_name(node, name, sizeof(name));
+    emit_spawn_sites(f, node);
+    reset_local_variables();
+    async_frame.count = 0;
+    for (int i = 1; i < node->child_count && node->children[i]->type == AST_VAR_DECL; i++) {
+        frame_add(node->children[i], node->children[i]->text, node->children[i]->children[1]->text);
     }
-    if (is_long_long) return "long long";
-    if (is_long) return "long";
-    
-    return "int";
+    int params = async_frame.count;
+    collect_frame_vars(body);
+    // Registered again from the top as the body is generated
+    reset_local_variables();
+    for (int i = 0; i < async_frame.count; i++) add_local_variable(async_frame.names[i], async_frame.types[i]);
+    strncpy(current_function_return_type, node->children[0]->text, sizeof(current_function_return_type) - 1);
+    current_function_return_type[sizeof(current_function_return_type) - 1] = '\0';
+
+    emit_line_directive(f, node);
+    fprintf(f, "typedef struct {\n    %s_head_t __head;\n", name);
+    for (int i = 0; i < async_frame.count; i++) {
+        frame_c_type(async_frame.types[i], type, sizeof(type));
+        fprintf(f, "    %s %s;\n", type, async_frame.names[i]);
+    }
+    fprintf(f, "} %s_frame_t;\n\n", name);
+
+    fprintf(f, "int %s_step(come_async_t* __task) {\n", name);
+    fprintf(f, "    %s_frame_t* __f = (%s_frame_t*)__task;\n", name, name);
+    fprintf(f, "    TALLOC_CTX* __outer = COME_CTX;\n");
+    fprintf(f, "    COME_CTX = __task->ctx;\n");
+    for (int i = 0; i < async_frame.count; i++) {
+        frame_c_type(async_frame.types[i], type, sizeof(type));
+        fprintf(f, "    %s %s = __f->%s;\n", type, async_frame.names[i], async_frame.names[i]);
+        fprintf(f, "    (void)%s;\n", async_frame.names[i]);
+    }
+    fprintf(f, "    (void)__f;\n");
+    fprintf(f, "    if (__task->resume) goto *__task->resume;\n");
+    async_function = node;
+    in_function = 1;
+    for (int i = 0; i < body->child_count; i++) generate_node(f, body->children[i], indent + 4);
+    in_function = 0;
+    async_function = NULL;
+    fprintf(f, "    COME_CTX = __outer;\n");
+    fprintf(f, "    return COME_ASYNC_DONE;\n}\n\n");
+
+    fprintf(f, "come_async_t* %s(", name);
+    for (int i = 0; i < params; i++) {
+        frame_c_type(async_frame.types[i], type, sizeof(type));
+        fprintf(f, "%s%s %s", i ? ", " : "", type, async_frame.names[i]);
+    }
+    fprintf(f, "%s) {\n", params ? "" : "void");
+    fprintf(f, "    %s_frame_t* __f = come_async_new(COME_CTX, sizeof(%s_frame_t), %s_step);\n", name, name, name);
+    for (int i = 0; i < params; i++) fprintf(f, "    __f->%s = %s;\n", async_frame.names[i], async_frame.names[i]);
+    fprintf(f, "    return &__f->__head.__task;\n}\n");
+    flush_deferred(f);
 }
 
 
@@ -148,11 +2103,26 @@ static void generate_expression(FILE* f, ASTNode* node) {
         fprintf(f, "%s", node->text);
     } else if (node->type == AST_IDENTIFIER) {
         if (strcmp(node->text, "null") == 0) fprintf(f, "NULL");
+        else if (nameset_has(&parallel_shared, node->text)) fprintf(f, "(*%s)", node->text);
         else fprintf(f, "%s", node->text);
     } else if (node->type == AST_UNARY_OP) {
         fprintf(f, "(%s", node->text);
         generate_expression(f, node->children[0]);
         fprintf(f, ")");
+    } else if (node->type == AST_ARRAY_ACCESS && vector_expr_type(node->children[0])) {
+        // A vector's lane
+        fprintf(f, "(");
+        generate_expression(f, node->children[0]);
+        fprintf(f, ")[");
+        generate_expression(f, node->children[1]);
+        fprintf(f, "]");
+    } else if (node->type == AST_ARRAY_ACCESS && soa_array(node->children[0])) {
+        // A whole element of an soa array, gathered from the columns
+        fprintf(f, "come_%s__%s__soa_get(", current_module, soa_array(node->children[0])->text);
+        generate_expression(f, node->children[0]);
+        fprintf(f, ", ");
+        generate_expression(f, node->children[1]);
+        fprintf(f, ")");
     } else if (node->type == AST_ARRAY_ACCESS) {
         // COME_ARR_GET(arr, index)
         fprintf(f, "COME_ARR_GET(");
@@ -160,10 +2130,39 @@ static void generate_expression(FILE* f, ASTNode* node) {
         fprintf(f, ", ");
         generate_expression(f, node->children[1]);
         fprintf(f, ")");
+    } else if (node->type == AST_ASSIGN && node->children[0]->type == AST_ARRAY_ACCESS &&
+               soa_array(node->children[0]->children[0])) {
+        generate_soa_store(f, node, soa_array(node->children[0]->children[0]));
+    } else if (node->type == AST_ASSIGN && written_array(node->children[0])) {
+        fprintf(f, "(come_array_cow(");
+        generate_expression(f, written_array(node->children[0]));
+        fprintf(f, "), ");
+        generate_expression(f, node->children[0]);
+        fprintf(f, " %s ", node->text);
+        generate_expression(f, node->children[1]);
+        fprintf(f, ")");
     } else if (node->type == AST_ASSIGN) {
         generate_expression(f, node->children[0]);
         fprintf(f, " %s ", node->text);
         generate_expression(f, node->children[1]);
+    } else if (node->type == AST_MEMBER_ACCESS && node->children[0]->type == AST_ARRAY_ACCESS &&
+               soa_array(node->children[0]->children[0])) {
+        // a[i].f is element i of f's column
+        ASTNode* element = node->children[0];
+        ASTNode* st = soa_array(element->children[0]);
+        if (!struct_field_type(st, node->text)) {
+            codegen_error(node, "struct %s has no field %s", st->text, node->text);
+        }
+        fprintf(f, "(");
+        generate_expression(f, element->children[0]);
+        fprintf(f, ")->cols.%s[", node->text);
+        generate_expression(f, element->children[1]);
+        fprintf(f, "]");
+    } else if (node->type == AST_MEMBER_ACCESS && net_expr_type(node)) {
+        // A net.http session's req and resp
+        fprintf(f, "come_net_http_%s(", node->text);
+        generate_expression(f, node->children[0]);
+        fprintf(f, ")");
     } else if (node->type == AST_MEMBER_ACCESS) {
         // Special case: "data" access on "scaled"/"dyn"/"buf" array access -> just the value.
         // This fixes the issue where parser/codegen erroneously treats int/byte array access as needing .data
@@ -203,6 +2202,77 @@ static void generate_expression(FILE* f, ASTNode* node) {
         int skip_receiver = 0;
         ASTNode* receiver = node->children[0];
         
+        const char* atomic = atomic_type(receiver);
+        if (atomic || (receiver->type == AST_IDENTIFIER && strcmp(receiver->text, "atomic") == 0)) {
+            generate_atomic_method(f, node, atomic ? atomic : "");
+            return;
+        }
+
+        const char* chan = chan_type(receiver);
+        if (chan) {
+            generate_chan_method(f, node, chan);
+            return;
+        }
+
+        int on_vector_type = receiver->type == AST_IDENTIFIER && vector_type(receiver->text);
+        const VectorType* vector = on_vector_type ? vector_type(receiver->text) : vector_expr_type(receiver);
+        if (vector) {
+            generate_vector_method(f, node, vector, on_vector_type);
+            return;
+        }
+
+        ASTNode* soa = soa_array(receiver);
+        if (soa) {
+            generate_soa_method(f, node, soa);
+            return;
+        }
+
+        const TypedArray* sortable = is_array_algorithm(method) ? typed_array(receiver_type(receiver)) : NULL;
+        if (sortable) {
+            generate_array_algorithm(f, node, sortable);
+            return;
+        }
+
+        if (strcmp(method, "dup") == 0 && generate_dup(f, node)) return;
+        if (strcmp(method, "share") == 0 && generate_share(f, node)) return;
+
+        // Methods of net.tcp connections and listeners, net.http sessions and
+        // messages, and net.run()/net.stop()
+        const char* net_type = net_expr_type(receiver);
+        if (net_type && strncmp(net_type, "net.http.", 9) == 0) {
+            // send() with nothing to send is a message without a body
+            if (strcmp(method, "send") == 0 && node->child_count == 1) {
+                fprintf(f, "come_net_http_send_bytes(");
+                generate_expression(f, receiver);
+                fprintf(f, ", NULL, 0)");
+                return;
+            }
+            fprintf(f, "come_net_http_%s(", method);
+            generate_expression(f, receiver);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            fprintf(f, ")");
+            return;
+        }
+        if ((net_type && strncmp(net_type, "net.tcp.", 8) == 0) ||
+            (receiver->type == AST_IDENTIFIER && strcmp(receiver->text, "net") == 0 &&
+             (strcmp(method, "run") == 0 || strcmp(method, "stop") == 0))) {
+            if (!net_type) {
+                fprintf(f, "come_net_%s()", method);
+                return;
+            }
+            fprintf(f, "come_net_tcp_%s(", method);
+            generate_expression(f, receiver);
+            for (int i = 1; i < node->child_count; i++) {
+                fprintf(f, ", ");
+                generate_expression(f, node->children[i]);
+            }
+            fprintf(f, ")");
+            return;
+        }
+
         // Detect module static calls
         int is_import = 0;
         if (receiver->type == AST_IDENTIFIER) {
@@ -217,11 +2287,31 @@ static void generate_expression(FILE* f, ASTNode* node) {
             strcmp(receiver->text, "mem")==0 ||
             strcmp(receiver->text, "std")==0 ||
             strcmp(receiver->text, "ERR")==0 ||
+            strcmp(receiver->text, "regex")==0 ||
             is_import)) {
             
             skip_receiver = 1;
             
-            if (strcmp(receiver->text, "mem")==0 && strcmp(method, "cpy")==0) {
+            if (strcmp(receiver->text, "mem")==0 && strcmp(method, "pool")==0 && node->child_count > 1) {
+                 ASTNode* body = node->children[node->child_count - 1];
+                 if (body->type == AST_BLOCK && node->child_count > 2) {
+                     // mem.pool(bytes) { ... }: allocations in the block go to a pool freed at block exit
+                     fprintf(f, "({ mem_talloc_scope_t __pool __attribute__((cleanup(mem_talloc_scope_exit))) = mem_talloc_scope_enter(&COME_CTX, ");
+                     generate_expression(f, node->children[1]);
+                     fprintf(f, ");\n");
+                     generate_node(f, body, 4);
+                     fprintf(f, "})");
+                 } else {
+                     fprintf(f, "mem_talloc_pool_new(COME_CTX, ");
+                     generate_expression(f, node->children[1]);
+                     fprintf(f, ")");
+                 }
+                 return;
+             } else if (strcmp(receiver->text, "mem")==0 && strcmp(method, "stats")==0) {
+                 // mem.stats(): the memstats report as a string
+                 fprintf(f, "({ char* __report = mem_talloc_stats_report(NULL); come_string_t* __stats = come_string_new(COME_CTX, __report); mem_talloc_free(__report); __stats; })");
+                 return;
+             } else if (strcmp(receiver->text, "mem")==0 && strcmp(method, "cpy")==0) {
                  strcpy(c_func, "memcpy");
              } else if (strcmp(receiver->text, "std")==0 && strcmp(method, "printf")==0) {
                  strcpy(c_func, "printf"); 
@@ -330,7 +2420,9 @@ static void generate_expression(FILE* f, ASTNode* node) {
                           if (type && (strcmp(type, "string") == 0 || strcmp(type, "come_string_t*") == 0)) {
                               is_str = 1;
                           }
-                      } else if (arg->type == AST_METHOD_CALL || arg->type == AST_CALL) {
+                      } else if (arg->type == AST_METHOD_CALL && net_http_string_method(arg)) {
+                          is_str = 1;
+                      } else if ((arg->type == AST_METHOD_CALL || arg->type == AST_CALL) && !is_join_call(arg)) {
                           // Check methods that return strings
                            // Check methods/functions that return strings (NOT len/size/count which return uint)
                            const char* name = arg->text;
@@ -339,8 +2431,11 @@ static void generate_expression(FILE* f, ASTNode* node) {
                                strcmp(name, "repeat") == 0 || strcmp(name, "replace") == 0 || 
                                strcmp(name, "trim") == 0 || strcmp(name, "ltrim") == 0 || 
                                strcmp(name, "rtrim") == 0 || strcmp(name, "substr") == 0 || 
+                               strcmp(name, "trim_view") == 0 || strcmp(name, "ltrim_view") == 0 || 
+                               strcmp(name, "rtrim_view") == 0 || strcmp(name, "substr_view") == 0 || 
                                strcmp(name, "join") == 0 || strcmp(name, "new") == 0 || 
-                               strcmp(name, "str") == 0 || strcmp(name, "gets") == 0) {
+                               strcmp(name, "str") == 0 || strcmp(name, "gets") == 0 ||
+                               strcmp(name, "stats") == 0) {
                                is_str = 1;
                            }
                      } else if (arg->type == AST_ARRAY_ACCESS) {
@@ -359,9 +2454,9 @@ static void generate_expression(FILE* f, ASTNode* node) {
                      if (is_str) {
                          fprintf(f, "(");
                          generate_expression(f, arg);
-                         fprintf(f, " ? ");
+                         fprintf(f, " ? come_string_cstr(");
                          generate_expression(f, arg);
-                         fprintf(f, "->data : \"NULL\")");
+                         fprintf(f, ") : \"NULL\")");
                      } else {
                          generate_expression(f, arg);
                      }
@@ -433,6 +2528,51 @@ static void generate_expression(FILE* f, ASTNode* node) {
                  strcpy(c_func, "on"); 
              }
         }
+        // Detect compiled regex methods (match, split, groups, replace)
+        else if (receiver->type == AST_IDENTIFIER && get_local_variable_type(receiver->text) &&
+                 (strcmp(get_local_variable_type(receiver->text), "regex") == 0 ||
+                  strcmp(get_local_variable_type(receiver->text), "come_regex_t*") == 0)) {
+             snprintf(c_func, sizeof(c_func), "come_regex_%s", method);
+             fprintf(f, "%s(", c_func);
+             generate_expression(f, receiver);
+             for (int i = 1; i < node->child_count; i++) {
+                 fprintf(f, ", ");
+                 if (node->children[i]->type == AST_STRING_LITERAL && i == 1) {
+                     // Subject string literals become come strings
+                     fprintf(f, "come_string_new(COME_CTX, ");
+                     generate_expression(f, node->children[i]);
+                     fprintf(f, ")");
+                 } else {
+                     generate_expression(f, node->children[i]);
+                 }
+             }
+             if ((strcmp(method, "split") == 0 && node->child_count == 2) ||
+                 (strcmp(method, "replace") == 0 && node->child_count == 3)) {
+                 fputs(", 0", f);
+             }
+             fprintf(f, ")");
+             return;
+        }
+        // Detect regex set methods (match, matches)
+        else if (receiver->type == AST_IDENTIFIER && get_local_variable_type(receiver->text) &&
+                 (strcmp(get_local_variable_type(receiver->text), "regex_set") == 0 ||
+                  strcmp(get_local_variable_type(receiver->text), "come_regex_set_t*") == 0)) {
+             snprintf(c_func, sizeof(c_func), "come_regex_set_%s", method);
+             fprintf(f, "%s(", c_func);
+             generate_expression(f, receiver);
+             for (int i = 1; i < node->child_count; i++) {
+                 fprintf(f, ", ");
+                 if (node->children[i]->type == AST_STRING_LITERAL) {
+                     fprintf(f, "come_string_new(COME_CTX, ");
+                     generate_expression(f, node->children[i]);
+                     fprintf(f, ")");
+                 } else {
+                     generate_expression(f, node->children[i]);
+                 }
+             }
+             fprintf(f, ")");
+             return;
+        }
         // Detect Map methods (put, get, remove only - not len which is shared with string)
         else if (strcmp(method, "put") == 0 || strcmp(method, "get") == 0 || strcmp(method, "remove") == 0) {
              int is_map = 0;
@@ -463,17 +2603,22 @@ static void generate_expression(FILE* f, ASTNode* node) {
         else if (strcmp(method, "length") == 0 || strcmp(method, "len") == 0 || 
                  strcmp(method, "cmp") == 0 || strcmp(method, "casecmp") == 0 ||
                  strcmp(method, "upper") == 0 || strcmp(method, "lower") == 0 ||
+                 strcmp(method, "upper_inplace") == 0 || strcmp(method, "lower_inplace") == 0 ||
                  strcmp(method, "trim") == 0 || strcmp(method, "ltrim") == 0 || strcmp(method, "rtrim") == 0 ||
                  strcmp(method, "replace") == 0 || strcmp(method, "split") == 0 ||
                  strcmp(method, "join") == 0 || strcmp(method, "substr") == 0 || 
+                 strcmp(method, "split_view") == 0 || strcmp(method, "substr_view") == 0 ||
+                 strcmp(method, "trim_view") == 0 || strcmp(method, "ltrim_view") == 0 || strcmp(method, "rtrim_view") == 0 ||
                  strcmp(method, "find") == 0 || strcmp(method, "rfind") == 0 || strcmp(method, "count") == 0 ||
                  strcmp(method, "chr") == 0 || strcmp(method, "rchr") == 0 || strcmp(method, "memchr") == 0 ||
                  strcmp(method, "isdigit") == 0 || strcmp(method, "isalpha") == 0 || 
                  strcmp(method, "isalnum") == 0 || strcmp(method, "isspace") == 0 || strcmp(method, "isascii") == 0 ||
+                 strcmp(method, "utf8") == 0 || strcmp(method, "count_runes") == 0 ||
                  strcmp(method, "repeat") == 0 || strcmp(method, "split_n") == 0 ||
                  strcmp(method, "regex") == 0 || strncmp(method, "regex_", 6) == 0 ||
                  strcmp(method, "chown") == 0 ||
-                 strcmp(method, "tol") == 0 ||
+                 strcmp(method, "tol") == 0 || strcmp(method, "tod") == 0 ||
+                 strcmp(method, "append_long") == 0 || strcmp(method, "append_double") == 0 ||
                  strcmp(method, "byte_array") == 0) {
             
             // Check if receiver is a map for len() - maps also have len()
@@ -565,7 +2710,8 @@ static void generate_expression(FILE* f, ASTNode* node) {
         int first_arg = 1;
         
         // Append ctx for specific functions?
-        if (strcmp(c_func, "come_string_sprintf") == 0) {
+        if (strcmp(c_func, "come_string_sprintf") == 0 || strcmp(c_func, "come_regex_compile") == 0 ||
+            strcmp(c_func, "come_regex_compile_set") == 0) {
             fprintf(f, "COME_CTX");
             first_arg = 0;
         }
@@ -658,7 +2804,79 @@ static void generate_expression(FILE* f, ASTNode* node) {
         if ((strcmp(method, "trim") == 0 || strcmp(method, "ltrim") == 0 || strcmp(method, "rtrim") == 0) && node->child_count == 1) {
             fputs(", NULL", f);
         }
+        if ((strcmp(method, "trim_view") == 0 || strcmp(method, "ltrim_view") == 0 || strcmp(method, "rtrim_view") == 0) && node->child_count == 1) {
+            fputs(", NULL", f);
+        }
+        if (strcmp(method, "split_view") == 0 && node->child_count == 2) {
+            fputs(", 0", f);
+        }
+        if (strcmp(method, "tol") == 0 && node->child_count == 1) {
+            fputs(", 10", f);
+        }
+        fprintf(f, ")");
+    } else if (node->type == AST_NET_TCP_ADDR) {
+        fprintf(f, "come_net_tcp_Addr(");
+        for (int i = 0; i < node->child_count; i++) {
+            if (i > 0) fprintf(f, ", ");
+            generate_expression(f, node->children[i]);
+        }
+        fprintf(f, ")");
+    } else if (node->type == AST_NET_TCP_CONNECT || node->type == AST_NET_TCP_LISTEN) {
+        // net.tcp.listen(addr), or listen(host, port) for short
+        fprintf(f, node->type == AST_NET_TCP_CONNECT ? "come_net_tcp_connect(" : "come_net_tcp_listen(");
+        if (node->child_count == 2) fprintf(f, "come_net_tcp_Addr(");
+        for (int i = 0; i < node->child_count; i++) {
+            if (i > 0) fprintf(f, ", ");
+            generate_expression(f, node->children[i]);
+        }
+        fprintf(f, node->child_count == 2 ? "))" : ")");
+    } else if (node->type == AST_NET_TCP_ACCEPT) {
+        fprintf(f, "come_net_tcp_accept(");
+        if (node->child_count > 0) generate_expression(f, node->children[0]);
         fprintf(f, ")");
+    } else if (node->type == AST_NET_HTTP_NEW) {
+        // Sessions live in the context of the code that made them
+        fprintf(f, "come_net_http_new(COME_CTX)");
+    } else if (node->type == AST_CHAN_NEW) {
+        generate_chan_new(f, node);
+    } else if (node->type == AST_SPAWN) {
+        // spawn f(args): fill in the site's closure and queue it
+        ASTNode* call = node->children[0];
+        fprintf(f, "({ %s_t* __spawn = mem_talloc_alloc(COME_CTX, sizeof(%s_t)); ", node->text, node->text);
+        fprintf(f, "memset(__spawn, 0, sizeof(%s_t)); __spawn->task.run = %s_run; ", node->text, node->text);
+        for (int i = 0; i < call->child_count; i++) {
+            fprintf(f, "__spawn->a%d = ", i);
+            generate_expression(f, call->children[i]);
+            fprintf(f, "; ");
+        }
+        fprintf(f, "come_sched_spawn(&__spawn->task); __spawn; })");
+    } else if (node->type == AST_AWAIT) {
+        codegen_error(node, async_function ? "await only goes as a statement, an initializer, the right side of = or after return"
+                                           : "await outside an async function");
+        fprintf(f, "0");
+    } else if (node->type == AST_CALL && find_async_function(node->text)) {
+        // An async call nobody awaits runs detached
+        char name[256];
+        async_name(find_async_function(node->text), name, sizeof(name));
+        fprintf(f, "come_async_detach(%s(", name);
+        for (int i = 0; i < node->child_count; i++) {
+            if (i > 0) fprintf(f, ", ");
+            generate_expression(f, node->children[i]);
+        }
+        fprintf(f, "))");
+    } else if (is_expect_call(node)) {
+        // A branch hint: the condition is expected to hold, or not
+        if (node->child_count != 1) codegen_error(node, "%s takes one condition", node->text);
+        fprintf(f, "__builtin_expect(!!(");
+        if (node->child_count > 0) generate_expression(f, node->children[0]);
+        fprintf(f, "), %d)", node->text[0] == 'l');
+    } else if (node->type == AST_CALL && vector_type(node->text)) {
+        generate_vector_new(f, node, vector_type(node->text));
+    } else if (is_join_call(node)) {
+        // join(h): wait for the task, take its result into this context and release the handle
+        fprintf(f, "({ __auto_type __joined = ");
+        generate_expression(f, node->children[0]);
+        fprintf(f, "; come_sched_join(&__joined->task, COME_CTX); __auto_type __result = __joined->result; mem_talloc_free(__joined); __result; })");
     } else if (node->type == AST_CALL) {
         // Function call: func(args)
         // node->text is function name (e.g. "print", "foo")
@@ -722,6 +2940,11 @@ static void generate_expression(FILE* f, ASTNode* node) {
             }
         }
         fprintf(f, " }");
+    } else if (node->type == AST_CAST && vector_type(node->children[0]->text)) {
+        // Lane by lane conversion, as (float) is for a scalar
+        fprintf(f, "__builtin_convertvector(");
+        generate_expression(f, node->children[1]);
+        fprintf(f, ", come_%s_t)", node->children[0]->text);
     } else if (node->type == AST_CAST) {
         fprintf(f, "(%s) ", node->children[0]->text);
         generate_expression(f, node->children[1]);
@@ -736,6 +2959,12 @@ static void generate_expression(FILE* f, ASTNode* node) {
     } else if (node->type == AST_UNARY_OP) {
         fprintf(f, "%s", node->text); 
         generate_expression(f, node->children[0]);
+    } else if ((node->type == AST_POST_INC || node->type == AST_POST_DEC) && written_array(node->children[0])) {
+        fprintf(f, "(come_array_cow(");
+        generate_expression(f, written_array(node->children[0]));
+        fprintf(f, "), ");
+        generate_expression(f, node->children[0]);
+        fprintf(f, node->type == AST_POST_INC ? "++)" : "--)");
     } else if (node->type == AST_POST_INC) {
         generate_expression(f, node->children[0]);
         fprintf(f, "++");
@@ -793,10 +3022,12 @@ static void generate_expression(FILE* f, ASTNode* node) {
             generate_expression(f, node->children[1]);
             fprintf(f, "), 0) %s 0)", is_eq ? "==" : "!=");
         } else {
+            const VectorType* vt = vector_expr_type(left);
+            if (!vt) vt = vector_expr_type(right);
             fprintf(f, "(");
-            generate_expression(f, node->children[0]);
+            emit_vector_operand(f, left, vt);
             fprintf(f, " %s ", node->text);
-            generate_expression(f, node->children[1]);
+            emit_vector_operand(f, right, vt);
             fprintf(f, ")");
         }
     } else if (node->type == AST_CALL) {
@@ -854,8 +3085,13 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
           // Ignore exports in C codegen, visibility handled by C static/extern rules or just everything is visible for now
           break;
 
+      case AST_ASYNC_FUNCTION:
+        generate_async_function(f, node, indent);
+        return;
+
       case AST_FUNCTION: {
         // [RetType] [Name] [Args...] [Block/Body]
+        emit_spawn_sites(f, node);
         emit_line_directive(f, node);
 
         reset_local_variables();
@@ -926,10 +3162,15 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
 
 
         emit_indent(f, indent);
+        if (is_main && (function_has(node, "inline") || function_has(node, "noinline"))) {
+            codegen_error(node, "main is called once, from the runtime; inline and @noinline don't apply");
+        }
+        emit_function_attributes(f, node);
         
         // Return type
         // Handle "byte" etc alias?? no, just print text
-        fprintf(f, "%s %s(", ret_type->text, func_name);
+        if (vector_type(ret_type->text)) fprintf(f, "come_%s_t %s(", ret_type->text, func_name);
+        else fprintf(f, "%s %s(", ret_type->text, func_name);
         
         // Args
         int has_args = 0;
@@ -953,19 +3194,33 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 // int x
                 ASTNode* type = arg->children[1];
                 
-                // array?
-                if (strstr(type->text, "[]")) {
+                if (strncmp(type->text, "atomic ", 7) == 0) {
+                    codegen_error(arg, "%s: an atomic parameter would be a copy; share a module-level "
+                                  "atomic instead", arg->text);
+                }
+                if (strncmp(type->text, "chan<", 5) == 0) {
+                    fprintf(f, "come_chan_t* %s", arg->text);
+                } else if (soa_struct(type->text)) {
+                    char c_type[256];
+                    come_c_type(type->text, c_type, sizeof(c_type));
+                    fprintf(f, "%s %s", c_type, arg->text);
+                } else if (strstr(type->text, "[]")) {
                     // int input[] -> come_int_array_t* input
                      char raw[64];
                      strncpy(raw, type->text, strlen(type->text)-2);
                      raw[strlen(type->text)-2] = 0;
                      if (strcmp(raw, "int")==0) fprintf(f, "come_int_array_t* %s", arg->text);
                      else if (strcmp(raw, "byte")==0) fprintf(f, "come_byte_array_t* %s", arg->text);
+                     else if (strcmp(raw, "long")==0) fprintf(f, "come_long_array_t* %s", arg->text);
+                     else if (strcmp(raw, "float")==0) fprintf(f, "come_float_array_t* %s", arg->text);
+                     else if (strcmp(raw, "double")==0) fprintf(f, "come_double_array_t* %s", arg->text);
                      else if (strcmp(raw, "string")==0) fprintf(f, "come_string_list_t* %s", arg->text);
                      else fprintf(f, "come_array_t* %s", arg->text);
                 } else if (is_main && strncmp(arg->text, "args", 4) == 0 && (strcmp(type->text, "string") == 0 || strcmp(type->text, "string[]") == 0)) {
                     // special case for main(string args) -> we pass string list
                     fprintf(f, "come_string_list_t* %s", arg->text);
+                } else if (vector_type(type->text)) {
+                   fprintf(f, "come_%s_t %s", type->text, arg->text);
                 } else {
                    fprintf(f, "%s %s", type->text, arg->text);
                 }
@@ -993,15 +3248,18 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
             }
 
             
+            in_function = 1;
             for (int i = 0; i < body->child_count; i++) {
                 generate_node(f, body->children[i], indent + 4);
             }
+            in_function = 0;
             if (is_main) {
                 emit_indent(f, indent + 4);
                 fprintf(f, "return 0;\n");
             }
             emit_indent(f, indent);
             fprintf(f, "}\n");
+            flush_deferred(f);
         } else {
             fprintf(f, ";\n");
         }
@@ -1018,11 +3276,16 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
 
     
     case AST_VAR_DECL: {
+        if (async_function && !plain_decl) {
+            generate_async_decl(f, node, indent);
+            break;
+        }
+        plain_decl = 0;
         emit_line_directive(f, node);  // Emit #line for variable declaration
         ASTNode* type_node = node->children[1];
-        add_local_variable(node->text, type_node->text);
-
         ASTNode* init_expr = node->children[0];
+        add_local_variable(node->text, strcmp(type_node->text, "var") == 0 ? net_var_type(init_expr) : type_node->text);
+
         
         emit_indent(f, indent);
             if (strcmp(type_node->text, "string") == 0) {
@@ -1046,6 +3309,20 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 // Mark as potentially unused to avoid warnings
                 emit_indent(f, indent);
                 fprintf(f, "(void)%s;\n", node->text);
+            } else if (strncmp(type_node->text, "atomic ", 7) == 0) {
+                fprintf(f, "_Atomic %s %s", type_node->text + 7, node->text);
+                emit_align(f, type_node);
+                fprintf(f, " = ");
+                generate_expression(f, init_expr);
+                fprintf(f, ";\n");
+            } else if (strncmp(type_node->text, "chan<", 5) == 0) {
+                if (init_expr->type == AST_CHAN_NEW && strcmp(init_expr->text, type_node->text) != 0) {
+                    codegen_error(node, "%s declared as %s", init_expr->text, type_node->text);
+                }
+                fprintf(f, "come_chan_t* %s = ", node->text);
+                if (init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0) fprintf(f, "NULL");
+                else generate_expression(f, init_expr);
+                fprintf(f, ";\n");
             } else if (strcmp(type_node->text, "bool") == 0) {
                 fprintf(f, "bool %s = ", node->text);
                 generate_expression(f, init_expr);
@@ -1061,6 +3338,8 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     generate_expression(f, init_expr);
                     fprintf(f, ";\n");
                 }
+            } else if (soa_struct(type_node->text)) {
+                emit_soa_decl(f, node, soa_struct(type_node->text), indent);
             } else {
                 // Generic case: T x = ...
                 // Check if type ends in []
@@ -1080,6 +3359,9 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     strcpy(elem_type, raw_type);
                     if (strcmp(raw_type, "int")==0) { strcpy(arr_type, "come_int_array_t"); }
                     else if (strcmp(raw_type, "byte")==0) { strcpy(arr_type, "come_byte_array_t"); strcpy(elem_type, "uint8_t"); }
+                    else if (strcmp(raw_type, "long")==0) { strcpy(arr_type, "come_long_array_t"); }
+                    else if (strcmp(raw_type, "float")==0) { strcpy(arr_type, "come_float_array_t"); }
+                    else if (strcmp(raw_type, "double")==0) { strcpy(arr_type, "come_double_array_t"); }
                     else if (strcmp(raw_type, "var")==0) { strcpy(arr_type, "come_int_array_t"); strcpy(elem_type, "int"); }
                     else { snprintf(arr_type, sizeof(arr_type), "come_array_%s_t", raw_type); }
                     
@@ -1115,10 +3397,17 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     }
                 }
  else {
+                     const VectorType* vt = vector_type(type_node->text);
                      if (strcmp(type_node->text, "var")==0) {
                          fprintf(f, "int %s = ", node->text);
+                     } else if (vt) {
+                         fprintf(f, "come_%s_t %s", vt->name, node->text);
+                         emit_align(f, type_node);
+                         fprintf(f, " = ");
                      } else {
-                         fprintf(f, "%s %s = ", type_node->text, node->text);
+                         fprintf(f, "%s %s", type_node->text, node->text);
+                         emit_align(f, type_node);
+                         fprintf(f, " = ");
                      }
                      
                      // For struct types with aggregate initializers, preserve the syntax
@@ -1126,6 +3415,9 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                          strncmp(type_node->text, "struct", 6) == 0) {
                          // Just emit the aggregate initializer as-is for structs
                          generate_expression(f, init_expr);
+                     } else if (vt && init_expr && init_expr->type == AST_NUMBER) {
+                         // f32x4 v = 0: every lane
+                         fprintf(f, "come_%s_splat(%s)", vt->name, init_expr->text);
                      } else if (init_expr && init_expr->type == AST_NUMBER && strcmp(init_expr->text, "0") == 0) {
                           // Check if type is struct or union?
                           if (strncmp(type_node->text, "struct", 6) == 0 || strncmp(type_node->text, "union", 5) == 0) {
@@ -1157,7 +3449,7 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     const char* type = get_local_variable_type(arg->text);
                     int is_str = (type && (strcmp(type, "string") == 0 || strcmp(type, "come_string_t*") == 0));
                     if (is_str) {
-                        fprintf(f, "(%s ? %s->data : \"NULL\")", arg->text, arg->text);
+                        fprintf(f, "(%s ? come_string_cstr(%s) : \"NULL\")", arg->text, arg->text);
                     } else {
                         generate_expression(f, arg);
                     }
@@ -1166,10 +3458,11 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     if (strcmp(m, "upper")==0 || strcmp(m, "lower")==0 || strcmp(m, "repeat")==0 || 
                         strcmp(m, "replace")==0 || strcmp(m, "trim")==0 || strcmp(m, "ltrim")==0 || 
                         strcmp(m, "rtrim")==0 || strcmp(m, "join")==0 || strcmp(m, "substr")==0 || 
-                        strcmp(m, "regex_replace")==0 || strcmp(m, "str")==0) {
-                         fprintf(f, "(");
+                        strcmp(m, "trim_view")==0 || strcmp(m, "ltrim_view")==0 || strcmp(m, "rtrim_view")==0 || 
+                        strcmp(m, "substr_view")==0 || strcmp(m, "regex_replace")==0 || strcmp(m, "str")==0) {
+                         fprintf(f, "come_string_cstr(");
                          generate_expression(f, arg);
-                         fprintf(f, ")->data");
+                         fprintf(f, ")");
                     } else {
                         // Cast to int for numeric results to satisfy printf %d
                         fprintf(f, "(int)(");
@@ -1194,9 +3487,9 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     if (is_numeric) {
                         generate_expression(f, arg);
                     } else {
-                        fprintf(f, "(");
+                        fprintf(f, "come_string_cstr(");
                         generate_expression(f, arg);
-                        fprintf(f, ")->data");
+                        fprintf(f, ")");
                     }
                 } else {
                     generate_expression(f, arg);
@@ -1240,6 +3533,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
         }
 
         case AST_RETURN: {
+            if (async_function) {
+                generate_async_return(f, node, indent);
+                break;
+            }
             emit_line_directive(f, node);
             emit_indent(f, indent);
             if (strcmp(current_function_return_type, "void") == 0) {
@@ -1258,6 +3555,7 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
         }
         
         case AST_METHOD_CALL: {
+            emit_line_directive(f, node);
             emit_indent(f, indent);
             generate_expression(f, node);
             fprintf(f, ";\n");
@@ -1296,9 +3594,14 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                          // Or use pointer? byte* items.
                          // But we want to support size?
                          // "byte[]" usually come_byte_array_t* in my codegen.
-                         fprintf(f, "come_%s_array_t* %s;\n", raw_type, field->text);
+                         if (strcmp(raw_type, "string") == 0) fprintf(f, "come_string_list_t* %s;\n", field->text);
+                         else fprintf(f, "come_%s_array_t* %s;\n", raw_type, field->text);
                      } else {
-                         fprintf(f, "%s %s;\n", type->text, field->text);
+                         char c_type[128];
+                         come_c_type(type->text, c_type, sizeof(c_type));
+                         fprintf(f, "%s %s", strncmp(type->text, "atomic ", 7) == 0 ? c_type : type->text, field->text);
+                         emit_align(f, type);
+                         fprintf(f, ";\n");
                      }
                  } else {
                      generate_node(f, field, indent + 4);
@@ -1310,12 +3613,38 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 fprintf(f, "typedef struct %s %s;\n", node->text, node->text);
                 mark_struct_seen(node->text);
             }
+            emit_struct_dup(f, node);
+            emit_struct_soa(f, node);
             break;
         }
 
         case AST_ASSIGN: {
+            if (node->children[1]->type == AST_AWAIT) {
+                if (strcmp(node->text, "=") != 0) {
+                    codegen_error(node, "await goes on the right side of =, not %s", node->text);
+                    break;
+                }
+                char* target = NULL;
+                size_t target_len = 0;
+                FILE* out = open_memstream(&target, &target_len);
+                generate_expression(out, node->children[0]);
+                fclose(out);
+                emit_await(f, node->children[1], indent, target);
+                free(target);
+                break;
+            }
             emit_line_directive(f, node);  // Emit #line for assignment
             emit_indent(f, indent);
+            if (node->children[0]->type == AST_ARRAY_ACCESS && soa_array(node->children[0]->children[0])) {
+                generate_soa_store(f, node, soa_array(node->children[0]->children[0]));
+                fprintf(f, ";\n");
+                break;
+            }
+            if (written_array(node->children[0])) {
+                fprintf(f, "come_array_cow(");
+                generate_expression(f, written_array(node->children[0]));
+                fprintf(f, "); ");
+            }
             generate_expression(f, node->children[0]);
             fprintf(f, " %s ", node->text);
             generate_expression(f, node->children[1]);
@@ -1418,6 +3747,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
             break;
         }
         
+        case AST_SELECT:
+            generate_select(f, node, indent);
+            break;
+
         case AST_CASE: {
             emit_indent(f, indent);
             fprintf(f, "case ");
@@ -1483,7 +3816,20 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
         }
         
         
+        case AST_NET_ON:
+            generate_net_on(f, node, indent);
+            break;
+
+        case AST_AWAIT:
+            emit_await(f, node, indent, NULL);
+            break;
+
         case AST_CALL:
+        case AST_SPAWN:
+        case AST_NET_TCP_CONNECT:
+        case AST_NET_TCP_LISTEN:
+        case AST_NET_TCP_ACCEPT:
+        case AST_NET_HTTP_NEW:
         case AST_POST_INC:
         case AST_POST_DEC:
         case AST_BINARY_OP:
@@ -1496,6 +3842,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
         }
 
         case AST_FOR: {
+            if (strcmp(node->text, "parallel") == 0) {
+                generate_parallel_for(f, node, indent);
+                break;
+            }
             emit_line_directive(f, node);
             emit_indent(f, indent);
             fprintf(f, "for (");
@@ -1507,7 +3857,9 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                     // Actually let's assume it's common.
                     ASTNode* decl = node->children[0];
                     ASTNode* type = decl->children[1];
-                    fprintf(f, "%s %s = ", type->text, decl->text);
+                    // In an async function the variable is a frame local already
+                    if (async_function) fprintf(f, "%s = ", decl->text);
+                    else fprintf(f, "%s %s = ", type->text, decl->text);
                     generate_expression(f, decl->children[0]);
                 } else {
                     generate_expression(f, node->children[0]);
@@ -1537,8 +3889,10 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
                 emit_indent(f, indent);
                 fprintf(f, "}\n");
             } else {
-                fprintf(f, "\n");
+                fprintf(f, "{\n");
                 generate_node(f, body, indent + 4);
+                emit_indent(f, indent);
+                fprintf(f, "}\n");
             }
             break;
         }
@@ -1559,6 +3913,101 @@ static void generate_node(FILE* f, ASTNode* node, int indent) {
 }
 
 
+// Modules that are part of the runtime rather than compiled with the program
+static int runtime_module(const char* name) {
+    return strcmp(name, "std") == 0 || strcmp(name, "string") == 0 || strcmp(name, "array") == 0 ||
+           strcmp(name, "map") == 0 || strcmp(name, "net") == 0;
+}
+
+// The prototype of a module function, with its attributes
+static void emit_function_prototype(FILE* f, ASTNode* child) {
+    emit_function_attributes(f, child);
+    if (child->child_count > 0 && child->children[0]->type != AST_BLOCK) {
+         ASTNode* ret = child->children[0];
+         
+         char func_name[8192];
+         int is_main = (strcmp(child->text, "main") == 0);
+         char* underscore = strchr(child->text, '_');
+         if (underscore && !is_main && isupper(child->text[0])) {
+             // Struct method: first char is uppercase
+             long prefix_len = underscore - child->text;
+             snprintf(func_name, sizeof(func_name), "come_%s__%.*s__%s", current_module, (int)prefix_len, child->text, underscore + 1);
+         } else if (strcmp(child->text, "init") == 0) {
+             snprintf(func_name, sizeof(func_name), "come_%s__init_local", current_module);
+         } else if (strcmp(child->text, "exit") == 0) {
+             snprintf(func_name, sizeof(func_name), "come_%s__exit_local", current_module);
+         } else {
+             // Regular function
+             snprintf(func_name, sizeof(func_name), "come_%s__%s", current_module, child->text);
+         }
+
+
+         if (ret->text[0] == '(') {
+              fprintf(f, "void %s(", func_name);
+         } else {
+              if (strcmp(ret->text, "string") == 0) fprintf(f, "come_string_t* %s(", func_name);
+              else if (vector_type(ret->text)) fprintf(f, "come_%s_t %s(", ret->text, func_name);
+              else fprintf(f, "%s %s(", ret->text, func_name);
+         }
+    } else {
+         // Fallback for void return without explicit type? or AST_FUNCTION without children?
+         // Should check if we have mangled name logic here too just in case
+         char func_name[8192];
+         snprintf(func_name, sizeof(func_name), "come_%s__%s", current_module, child->text);
+         fprintf(f, "void %s(", func_name);
+    }
+    // Args?
+    // Iterate children until AST_BLOCK
+    int start_args = 1; // 0 is return
+    if (child->child_count > 0 && child->children[0]->type == AST_BLOCK) start_args = 0;
+    
+    // If nport, inject self?
+    if (strcmp(child->text, "nport")==0) {
+        fprintf(f, "struct TCP_ADDR* self"); 
+    }
+    
+    int first = (strcmp(child->text, "nport")==0) ? 0 : 1;
+    
+    for (int j=start_args; j<child->child_count; j++) {
+        if (child->children[j]->type == AST_BLOCK) break;
+        if (!first) fprintf(f, ", ");
+        ASTNode* arg = child->children[j];
+        if (arg->type == AST_VAR_DECL) {
+            ASTNode* type = arg->children[1];
+            // Array check
+              if (strncmp(type->text, "chan<", 5) == 0) {
+                   fprintf(f, "come_chan_t*");
+              } else if (soa_struct(type->text)) {
+                   char c_type[256];
+                   come_c_type(type->text, c_type, sizeof(c_type));
+                   fprintf(f, "%s", c_type);
+              } else if (strstr(type->text, "[]")) {
+                   char raw[64];
+                   strncpy(raw, type->text, strlen(type->text)-2);
+                   raw[strlen(type->text)-2] = 0;
+                   
+                   if (strcmp(raw, "int")==0) fprintf(f, "come_int_array_t*");
+                   else if (strcmp(raw, "byte")==0) fprintf(f, "come_byte_array_t*");
+                   else if (strcmp(raw, "long")==0) fprintf(f, "come_long_array_t*");
+                   else if (strcmp(raw, "float")==0) fprintf(f, "come_float_array_t*");
+                   else if (strcmp(raw, "double")==0) fprintf(f, "come_double_array_t*");
+                   else if (strcmp(raw, "string")==0) fprintf(f, "come_string_list_t*");
+                   else fprintf(f, "come_array_t*");
+              } else if (type->text[0] == '(') {
+                   fprintf(f, "void"); // Multi-return hack
+              } else {
+                   if (strcmp(type->text, "string")==0) fprintf(f, "come_string_t*");
+                   else if (vector_type(type->text)) fprintf(f, "come_%s_t", type->text);
+                   else fprintf(f, "%s", type->text);
+              }
+         } else {
+            fprintf(f, "void*"); // Fallback
+        }
+        first = 0;
+    }
+    fprintf(f, ");\n");
+}
+
 int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_file, int gen_line_map) {
     FILE* f = fopen(out_file, "w");
     if (!f) return 1;
@@ -1569,6 +4018,13 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
     src_filename[sizeof(src_filename) - 1] = '\0';
     source_filename = src_filename;
     g_gen_line_map = gen_line_map;
+    g_memstats = getenv("COME_MEMSTATS") != NULL;
+    current_program = ast;
+    spawn_site_count = 0;
+    parallel_site_count = 0;
+    handler_site_count = 0;
+    async_resume_count = 0;
+    codegen_errors = 0;
     
     // Reset seen structs tracker
     for (int i=0; i<seen_count; i++) free(seen_structs[i]);
@@ -1600,11 +4056,15 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
     fprintf(f, "#include <string.h>\n");
     fprintf(f, "#include <stdbool.h>\n");
     fprintf(f, "#include <stdint.h>\n");
+    fprintf(f, "#include <stdatomic.h>\n");
     fprintf(f, "#include \"come_string.h\"\n");
     fprintf(f, "#include \"come_array.h\"\n");
     fprintf(f, "#include \"come_map.h\"\n");
     fprintf(f, "#include \"come_types.h\"\n");
     fprintf(f, "#include \"mem/talloc.h\"\n");
+    fprintf(f, "#include \"come_sched.h\"\n");
+    fprintf(f, "#include \"come_simd.h\"\n");
+    fprintf(f, "#include \"come_net.h\"\n");
     fprintf(f, "#include <errno.h>\n");
     fprintf(f, "#define come_errno_wrapper() (errno)\n");
     fprintf(f, "static __attribute__((unused)) const char* come_strerror() { return strerror(errno); }\n");
@@ -1626,39 +4086,43 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
         fprintf(f, "extern void come_ERR_clear(void);\n");
         // We need the type for ERR object too
         fprintf(f, "typedef struct come_std__ERR_t come_std__ERR_t;\n");
-        fprintf(f, "extern come_std__ERR_t come_std__ERR;\n");
+        fprintf(f, "extern __thread come_std__ERR_t come_std__ERR;\n");
     }
     // Macros for method dispatch
     fprintf(f, "#define COME_CTX come_%s__ctx\n\n", current_module);
     
-    // Module memory context
-    fprintf(f, "TALLOC_CTX* come_%s__ctx = NULL;\n", current_module);
+    // Module memory context, per thread: it is set up on the main thread, and
+    // other threads see NULL and allocate under their own root
+    fprintf(f, "__thread TALLOC_CTX* come_%s__ctx = NULL;\n", current_module);
     
     // TODO: Extern imports - disabled for now to avoid linker errors
     // for (int i=0; i<current_import_count; i++) {
     //     fprintf(f, "extern TALLOC_CTX* come_%s__ctx;\n", current_imports[i]);
     // }
 
-    // Only generate main if it's not a base module
-    if (strcmp(current_module, "std") != 0 && strcmp(current_module, "string") != 0 && 
-        strcmp(current_module, "array") != 0 && strcmp(current_module, "map") != 0) {
-
-        // Scan AST to find main function and check if it has parameters
-        int main_has_params = 0;
-        for (int i = 0; i < ast->child_count; i++) {
-            ASTNode* child = ast->children[i];
-            if (child && child->type == AST_FUNCTION && strcmp(child->text, "main") == 0) {
-                // Check if main has any arguments
-                // Arguments are in children[1] if present and NOT a block
-                if (child->child_count > 1 && child->children[1] && child->children[1]->type != AST_BLOCK) {
-                    ASTNode* args_node = child->children[1];
-                    if (args_node->child_count > 0) {
-                        main_has_params = 1;
-                    }
+    // Scan AST to find main function and check if it has parameters
+    int has_main = 0;
+    int main_has_params = 0;
+    for (int i = 0; i < ast->child_count; i++) {
+        ASTNode* child = ast->children[i];
+        if (child && child->type == AST_FUNCTION && strcmp(child->text, "main") == 0) {
+            has_main = 1;
+            // Check if main has any arguments
+            // Arguments are in children[1] if present and NOT a block
+            if (child->child_count > 1 && child->children[1] && child->children[1]->type != AST_BLOCK) {
+                ASTNode* args_node = child->children[1];
+                if (args_node->child_count > 0) {
+                    main_has_params = 1;
                 }
-                break;
             }
+            break;
         }
+    }
+
+    // Only generate main if it's not a base module, and not a module
+    // imported by another (one without a main of its own)
+    if (has_main && strcmp(current_module, "std") != 0 && strcmp(current_module, "string") != 0 && 
+        strcmp(current_module, "array") != 0 && strcmp(current_module, "map") != 0) {
 
         // Forward declare user main with correct signature
         if (main_has_params) {
@@ -1672,7 +4136,12 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
         fprintf(f, "void come_%s__exit(void);\n", current_module);
         
         fprintf(f, "\nint main(int argc, char* argv[]) {\n");
-        fprintf(f, "    COME_CTX = mem_talloc_new_ctx(NULL);\n");
+        if (g_memstats) {
+            fprintf(f, "    mem_talloc_stats_enable();\n");
+            fprintf(f, "    mem_talloc_site = \"%s:module\";\n", source_filename);
+        }
+        fprintf(f, "    mem_talloc_module_init();\n");
+        fprintf(f, "    COME_CTX = mem_talloc_pool_new(NULL, MEM_TALLOC_MODULE_POOL);\n");
         fprintf(f, "    if (!COME_CTX) { fprintf(stderr, \"OOM\\n\"); return 1; }\n");
         
         fprintf(f, "    come_%s__init();\n", current_module);
@@ -1797,6 +4266,14 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
         }
     }
 
+    // Interfaces of the imported modules of the program: prototypes of
+    // their exports, and the bodies of exported inline functions
+    for (int i = 0; i < current_import_count; i++) {
+        if (runtime_module(current_imports[i])) continue;
+        fprintf(f, "#if __has_include(\"come_%s.h\")\n#include \"come_%s.h\"\n#endif\n", current_imports[i],
+                current_imports[i]);
+    }
+
     // Pass 0: Forward decls for Structs
     if (g_verbose) printf("DEBUG: Starting Pass 0: Structs\n");
     for (int i = 0; i < ast->child_count; i++) {
@@ -1807,6 +4284,8 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
                  fprintf(f, "typedef struct %s %s;\n", child->text, child->text);
                  mark_struct_seen(child->text);
              }
+             emit_struct_dup_prototype(f, child);
+             emit_struct_soa_typedef(f, child);
         }
     }
 
@@ -1814,84 +4293,11 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
     if (g_verbose) printf("DEBUG: Starting Pass forward prototypes\n");
     for (int i=0; i<ast->child_count; i++) {
         ASTNode* child = ast->children[i];
+        if (child->type == AST_ASYNC_FUNCTION) emit_async_prototypes(f, child);
         if (child->type == AST_FUNCTION) {
              if (strcmp(child->text, "main") == 0) continue; // Skip main prototype
              if (g_verbose) printf("DEBUG: Mapping prototype for %s\n", child->text);
-             // But `add` error requires it.
-             // Simple loop:
-             if (child->child_count > 0 && child->children[0]->type != AST_BLOCK) {
-                  ASTNode* ret = child->children[0];
-                  
-                  char func_name[8192];
-                  int is_main = (strcmp(child->text, "main") == 0);
-                  char* underscore = strchr(child->text, '_');
-                  if (underscore && !is_main && isupper(child->text[0])) {
-                      // Struct method: first char is uppercase
-                      long prefix_len = underscore - child->text;
-                      snprintf(func_name, sizeof(func_name), "come_%s__%.*s__%s", current_module, (int)prefix_len, child->text, underscore + 1);
-                  } else if (strcmp(child->text, "init") == 0) {
-                      snprintf(func_name, sizeof(func_name), "come_%s__init_local", current_module);
-                  } else if (strcmp(child->text, "exit") == 0) {
-                      snprintf(func_name, sizeof(func_name), "come_%s__exit_local", current_module);
-                  } else {
-                      // Regular function
-                      snprintf(func_name, sizeof(func_name), "come_%s__%s", current_module, child->text);
-                  }
-
-
-                  if (ret->text[0] == '(') {
-                       fprintf(f, "void %s(", func_name);
-                  } else {
-                       if (strcmp(ret->text, "string") == 0) fprintf(f, "come_string_t* %s(", func_name);
-                       else fprintf(f, "%s %s(", ret->text, func_name);
-                  }
-             } else {
-                  // Fallback for void return without explicit type? or AST_FUNCTION without children?
-                  // Should check if we have mangled name logic here too just in case
-                  char func_name[8192];
-                  snprintf(func_name, sizeof(func_name), "come_%s__%s", current_module, child->text);
-                  fprintf(f, "void %s(", func_name);
-             }
-             // Args?
-             // Iterate children until AST_BLOCK
-             int start_args = 1; // 0 is return
-             if (child->child_count > 0 && child->children[0]->type == AST_BLOCK) start_args = 0;
-             
-             // If nport, inject self?
-             if (strcmp(child->text, "nport")==0) {
-                 fprintf(f, "struct TCP_ADDR* self"); 
-             }
-             
-             int first = (strcmp(child->text, "nport")==0) ? 0 : 1;
-             
-             for (int j=start_args; j<child->child_count; j++) {
-                 if (child->children[j]->type == AST_BLOCK) break;
-                 if (!first) fprintf(f, ", ");
-                 ASTNode* arg = child->children[j];
-                 if (arg->type == AST_VAR_DECL) {
-                     ASTNode* type = arg->children[1];
-                     // Array check
-                       if (strstr(type->text, "[]")) {
-                            char raw[64];
-                            strncpy(raw, type->text, strlen(type->text)-2);
-                            raw[strlen(type->text)-2] = 0;
-                            
-                            if (strcmp(raw, "int")==0) fprintf(f, "come_int_array_t*");
-                            else if (strcmp(raw, "byte")==0) fprintf(f, "come_byte_array_t*");
-                            else if (strcmp(raw, "string")==0) fprintf(f, "come_string_list_t*");
-                            else fprintf(f, "come_array_t*");
-                       } else if (type->text[0] == '(') {
-                            fprintf(f, "void"); // Multi-return hack
-                       } else {
-                            if (strcmp(type->text, "string")==0) fprintf(f, "come_string_t*");
-                            else fprintf(f, "%s", type->text);
-                       }
-                  } else {
-                     fprintf(f, "void*"); // Fallback
-                 }
-                 first = 0;
-             }
-             fprintf(f, ");\n");
+             emit_function_prototype(f, child);
         }
     }
 
@@ -1903,7 +4309,78 @@ int generate_c_from_ast(ASTNode* ast, const char* out_file, const char* source_f
     } else {
         generate_node(f, ast, 0);
     }
+    flush_deferred(f);
 
     fclose(f);
-    return 0;
+    return codegen_errors ? 1 : 0;
+}
+
+// The functions of the module that inline bodies in the interface call
+static void collect_calls(ASTNode* node, NameSet* calls) {
+    if (!node) return;
+    if (node->type == AST_CALL && find_function(node->text)) nameset_add(calls, node->text);
+    for (int i = 0; i < node->child_count; i++) collect_calls(node->children[i], calls);
+}
+
+// The interface of the module last passed to generate_c_from_ast, which
+// importers include as come_<module>.h: a prototype for each exported
+// function, and the whole body of each exported inline one, so that calls
+// from other modules inline as well as calls from this one. Functions the
+// inline bodies call come along, exported or not.
+int generate_interface(ASTNode* ast, const char* out_file) {
+    NameSet needed = { .count = 0 };
+    for (int i = 0; i < ast->child_count; i++) {
+        ASTNode* exports = ast->children[i];
+        if (exports->type != AST_EXPORT) continue;
+        for (int j = 0; j < exports->child_count; j++) {
+            if (find_function(exports->children[j]->text)) nameset_add(&needed, exports->children[j]->text);
+        }
+    }
+    for (int i = 0; i < needed.count; i++) {
+        ASTNode* fn = find_function(needed.names[i]);
+        if (function_has(fn, "inline")) collect_calls(fn->children[fn->child_count - 1], &needed);
+    }
+
+    FILE* f = fopen(out_file, "w");
+    if (!f) return 1;
+    fprintf(f, "/* Interface of module %s, generated from %s */\n", current_module, source_filename);
+    fprintf(f, "#ifndef COME_%s_INTERFACE\n#define COME_%s_INTERFACE\n", current_module, current_module);
+    for (int i = 0; i < ast->child_count; i++) {
+        if (ast->children[i]->type == AST_STRUCT_DECL) {
+            fprintf(f, "typedef struct %s %s;\n", ast->children[i]->text, ast->children[i]->text);
+        }
+    }
+    for (int i = 0; i < ast->child_count; i++) {
+        ASTNode* child = ast->children[i];
+        if (child->type != AST_FUNCTION || strcmp(child->text, "main") == 0 || !nameset_has(&needed, child->text)) continue;
+        emit_function_prototype(f, child);
+    }
+    // Globals the inline bodies use stay defined in the module's own unit
+    NameSet refs = { .count = 0 };
+    for (int i = 0; i < needed.count; i++) {
+        ASTNode* fn = find_function(needed.names[i]);
+        if (function_has(fn, "inline")) collect_refs(fn->children[fn->child_count - 1], &refs);
+    }
+    for (int i = 0; i < ast->child_count; i++) {
+        ASTNode* child = ast->children[i];
+        if (child->type != AST_VAR_DECL || !nameset_has(&refs, child->text)) continue;
+        const char* type = child->children[1]->text;
+        size_t len = strlen(type);
+        if (strcmp(type, "var") == 0 || (strchr(type, '[') && (len < 2 || strcmp(type + len - 2, "[]") != 0))) {
+            codegen_error(child, "global '%s' is used by an exported inline function: "
+                          "give it an explicit type that is not a fixed-size array", child->text);
+            continue;
+        }
+        char c_type[128];
+        come_c_type(type, c_type, sizeof(c_type));
+        fprintf(f, "extern %s %s;\n", c_type, child->text);
+    }
+    for (int i = 0; i < ast->child_count; i++) {
+        ASTNode* child = ast->children[i];
+        if (child->type != AST_FUNCTION || !function_has(child, "inline") || !nameset_has(&needed, child->text)) continue;
+        generate_node(f, child, 0);
+    }
+    fprintf(f, "#endif\n");
+    fclose(f);
+    return codegen_errors ? 1 : 0;
 }
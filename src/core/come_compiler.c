@@ -183,6 +183,11 @@ static int resolve_import(const char *import_name, const char *current_file, cha
 /* ---------- Compilation ---------- */
 
 // Compile a single file, recursing on imports
+// Memstats builds generate different C, so they are cached separately
+static const char *build_variant(void) {
+    return getenv("COME_MEMSTATS") ? ".memstats" : "";
+}
+
 static void compile_file(const char *source_path, const char *forced_o_path) {
     char abs_path[PATH_MAX];
     if (!realpath(source_path, abs_path)) {
@@ -206,7 +211,8 @@ static void compile_file(const char *source_path, const char *forced_o_path) {
             if (ast->children[i] && ast->children[i]->type == AST_IMPORT) {
                 char *import_name = ast->children[i]->text;
                 if (strcmp(import_name, "std") == 0 || strcmp(import_name, "string") == 0 ||
-                    strcmp(import_name, "array") == 0 || strcmp(import_name, "map") == 0) {
+                    strcmp(import_name, "array") == 0 || strcmp(import_name, "map") == 0 ||
+                    strcmp(import_name, "net") == 0) {
                     continue;
                 }
 
@@ -233,7 +239,7 @@ static void compile_file(const char *source_path, const char *forced_o_path) {
         } else {
             strcpy(rel_path, basename(abs_path));
         }
-        snprintf(c_file, sizeof(c_file), "%s/%s.c", g_ccache_dir, rel_path);
+        snprintf(c_file, sizeof(c_file), "%s/%s%s.c", g_ccache_dir, rel_path, build_variant());
     }
     
     char c_dir[PATH_MAX];
@@ -247,7 +253,7 @@ static void compile_file(const char *source_path, const char *forced_o_path) {
     char *bn = basename(base_name);
     char *dot = strrchr(bn, '.');
     if (dot) *dot = 0;
-    snprintf(o_file, sizeof(o_file), "%s/%s.o", g_build_dir, bn);
+    snprintf(o_file, sizeof(o_file), "%s/%s%s.o", g_build_dir, bn, build_variant());
     
     if (!forced_o_path) ensure_dir(g_build_dir);
 
@@ -268,6 +274,12 @@ static void compile_file(const char *source_path, const char *forced_o_path) {
         if (generate_c_from_ast(ast, c_file, abs_path, 1) != 0) {
             die("Codegen failed: %s", abs_path);
         }
+        // The module's interface, for the modules that import it
+        char h_file[PATH_MAX];
+        snprintf(h_file, sizeof(h_file), "%s/come_%s.h", g_ccache_dir, ast->text[0] ? ast->text : "main");
+        if (generate_interface(ast, h_file) != 0) {
+            die("Codegen failed: %s", h_file);
+        }
     }
     ast_free(ast);
 
@@ -302,18 +314,18 @@ static void compile_file(const char *source_path, const char *forced_o_path) {
 
         if (is_installed) {
              snprintf(cmd, sizeof(cmd), 
-                "gcc -c -Wall -Wno-cpp -Wno-implicit-function-declaration -D__STDC_WANT_LIB_EXT1__=1 "
-                "-I\"%s\" -I\"%s/talloc\" "
+                "gcc -c -Wall -Wno-cpp -Wno-implicit-function-declaration -Wno-psabi -D__STDC_WANT_LIB_EXT1__=1 "
+                "-I\"%s\" -I\"%s/talloc\" -I\"%s\" "
                 "\"%s\" -o \"%s\"",
-                include_dir, include_dir,
+                include_dir, include_dir, g_ccache_dir,
                 c_file, o_file);
         } else {
              snprintf(cmd, sizeof(cmd), 
-                "gcc -c -Wall -Wno-cpp -Wno-implicit-function-declaration -D__STDC_WANT_LIB_EXT1__=1 "
+                "gcc -c -Wall -Wno-cpp -Wno-implicit-function-declaration -Wno-psabi -D__STDC_WANT_LIB_EXT1__=1 "
                 "-I%s/src/include -I%s/src/core/include "
-                "-I%s/src/external/talloc/lib/talloc -I%s/src/external/talloc/lib/replace "
+                "-I%s/src/external/talloc/lib/talloc -I%s/src/external/talloc/lib/replace -I\"%s\" "
                 "\"%s\" -o \"%s\"",
-                project_base, project_base, project_base, project_base,
+                project_base, project_base, project_base, project_base, g_ccache_dir,
                 c_file, o_file);
         }
             
@@ -334,7 +346,7 @@ int main(int argc, char *argv[]) {
 
     setbuf(stdout, NULL);
     if (argc < 3) {
-        fprintf(stderr, "Usage: come build <file.co|.> [-o output]\n");
+        fprintf(stderr, "Usage: come build <file.co|.> [-o output] [--alloc=talloc|arena]\n");
         return 1;
     }
 
@@ -348,12 +360,18 @@ int main(int argc, char *argv[]) {
 
     const char *input = NULL;
     const char *output = NULL;
+    int use_arena = 0;
 
     for (int i = 2; i < argc; i++) {
         if (strcmp(argv[i], "-o") == 0) {
             if (i + 1 < argc) output = argv[++i];
         } else if (strcmp(argv[i], "-v") == 0) {
             g_verbose = 1;
+        } else if (strncmp(argv[i], "--alloc=", 8) == 0) {
+            // Allocator backend behind the mem_talloc API, chosen at link time
+            if (strcmp(argv[i] + 8, "arena") == 0) use_arena = 1;
+            else if (strcmp(argv[i] + 8, "talloc") == 0) use_arena = 0;
+            else die("Unknown allocator: %s (expected talloc or arena)", argv[i] + 8);
         } else {
             input = argv[i];
         }
@@ -465,12 +483,29 @@ int main(int argc, char *argv[]) {
 
     // Add std libs
     // In dev mode, we need specific .o files from the build dir of the compiler repo
+    // The arena backend defines every mem_talloc_* symbol, so linking it
+    // ahead of libcome.a keeps talloc's archive members out of the binary.
     if (use_lib) {
+        if (use_arena) {
+            char lib_dir[PATH_MAX], arena[PATH_MAX];
+            strcpy(lib_dir, libcome);
+            snprintf(arena, sizeof(arena), "%s/come_arena.o", dirname(lib_dir));
+            if (!file_exists(arena)) die("Arena allocator not installed: %s", arena);
+            pos += snprintf(link_cmd + pos, sizeof(link_cmd) - pos, " \"%s\"", arena);
+        }
         pos += snprintf(link_cmd + pos, sizeof(link_cmd) - pos, " \"%s\"", libcome);
     } else {
-        const char *std_objs[] = {"std.o", "string.o", "array.o", "map.o", "talloc.o", "talloc_lib.o"};
-        for (int i=0; i<6; i++) {
-            pos += snprintf(link_cmd + pos, sizeof(link_cmd) - pos, " \"%s/build/%s\"", project_base, std_objs[i]);
+        static const char *runtime_objs[] = {"std.o", "string.o", "array.o", "map.o", "sched.o", "chan.o", "tcp.o", "http.o", "async.o", "sort.o"};
+        static const char *talloc_objs[] = {"talloc.o", "talloc_lib.o"};
+        static const char *arena_objs[] = {"arena.o"};
+        for (size_t i = 0; i < sizeof(runtime_objs) / sizeof(runtime_objs[0]); i++) {
+            pos += snprintf(link_cmd + pos, sizeof(link_cmd) - pos, " \"%s/build/%s\"", project_base, runtime_objs[i]);
+        }
+        const char **alloc_objs = use_arena ? arena_objs : talloc_objs;
+        size_t alloc_count = use_arena ? sizeof(arena_objs) / sizeof(arena_objs[0])
+                                       : sizeof(talloc_objs) / sizeof(talloc_objs[0]);
+        for (size_t i = 0; i < alloc_count; i++) {
+            pos += snprintf(link_cmd + pos, sizeof(link_cmd) - pos, " \"%s/build/%s\"", project_base, alloc_objs[i]);
         }
     }
 
@@ -26,8 +26,9 @@ typedef enum {
     AST_NET_TCP_CONNECT,    // net.tcp.connect(addr)
     AST_NET_TCP_LISTEN,     // net.tcp.listen(addr)
     AST_NET_TCP_ACCEPT,     // net.tcp.accept(listener)
-    AST_NET_TCP_ON,         // conn.on(EVENT) { ... }
+    AST_NET_ON,             // conn.on(EVENT) { ... }, msg.on(EVENT) { ... }
     AST_NET_TCP_ADDR,       // net.tcp.Addr(...)
+    AST_NET_HTTP_NEW,       // net.http.new()
     AST_CONST_DECL,
     AST_CONST_GROUP,
     AST_ENUM_DECL,
@@ -47,6 +48,11 @@ typedef enum {
     AST_CONTINUE,
     AST_CAST,
     AST_TERNARY,
+    AST_SPAWN,          // spawn f(args): child 0 is the call
+    AST_ASYNC_FUNCTION, // async T f(args) { ... }: children as AST_FUNCTION
+    AST_AWAIT,          // await x: child 0 is the awaited expression
+    AST_CHAN_NEW,       // chan<T>(args): text is the type, children the arguments
+    AST_SELECT,         // select { case c.recv(v): ... }: children are AST_CASE/AST_DEFAULT
     AST_TYPE_END
 } ASTNodeType;
 
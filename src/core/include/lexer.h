@@ -25,6 +25,8 @@ typedef enum { TOKEN_EOF, TOKEN_IMPORT, TOKEN_MAIN, TOKEN_INT,
                 TOKEN_AND_ASSIGN, TOKEN_OR_ASSIGN, TOKEN_XOR_ASSIGN, 
                 TOKEN_LSHIFT_ASSIGN, TOKEN_RSHIFT_ASSIGN, TOKEN_MOD_ASSIGN,
                 TOKEN_INC, TOKEN_DEC, TOKEN_QUESTION,
+                TOKEN_SPAWN, TOKEN_PARALLEL, TOKEN_ASYNC, TOKEN_AWAIT,
+                TOKEN_CHAN, TOKEN_SELECT, TOKEN_ATOMIC, TOKEN_AT, TOKEN_VECTOR, TOKEN_INLINE,
                TOKEN_UNKNOWN } TokenType;
 
 typedef struct { TokenType type; char text[128]; int line; } Token;
@@ -77,6 +77,23 @@ int lex_file(const char* filename, TokenList* out) {
             else if(MATCH_KEYWORD("else", TOKEN_ELSE)) { tok.type=TOKEN_ELSE; strcpy(tok.text,"else"); p+=4; }
             else if(MATCH_KEYWORD("break", TOKEN_BREAK)) { tok.type=TOKEN_BREAK; strcpy(tok.text,"break"); p+=5; }
             else if(MATCH_KEYWORD("continue", TOKEN_CONTINUE)) { tok.type=TOKEN_CONTINUE; strcpy(tok.text,"continue"); p+=8; }
+            else if(MATCH_KEYWORD("spawn", TOKEN_SPAWN)) { tok.type=TOKEN_SPAWN; strcpy(tok.text,"spawn"); p+=5; }
+            else if(MATCH_KEYWORD("parallel", TOKEN_PARALLEL)) { tok.type=TOKEN_PARALLEL; strcpy(tok.text,"parallel"); p+=8; }
+            else if(MATCH_KEYWORD("async", TOKEN_ASYNC)) { tok.type=TOKEN_ASYNC; strcpy(tok.text,"async"); p+=5; }
+            else if(MATCH_KEYWORD("await", TOKEN_AWAIT)) { tok.type=TOKEN_AWAIT; strcpy(tok.text,"await"); p+=5; }
+            else if(MATCH_KEYWORD("select", TOKEN_SELECT)) { tok.type=TOKEN_SELECT; strcpy(tok.text,"select"); p+=6; }
+            else if(MATCH_KEYWORD("chan", TOKEN_CHAN)) { tok.type=TOKEN_CHAN; strcpy(tok.text,"chan"); p+=4; }
+            else if(MATCH_KEYWORD("atomic", TOKEN_ATOMIC)) { tok.type=TOKEN_ATOMIC; strcpy(tok.text,"atomic"); p+=6; }
+            else if(MATCH_KEYWORD("inline", TOKEN_INLINE)) { tok.type=TOKEN_INLINE; strcpy(tok.text,"inline"); p+=6; }
+            
+            // SIMD vector types, text as written
+            else if(MATCH_KEYWORD("f32x4", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"f32x4"); p+=5; }
+            else if(MATCH_KEYWORD("f32x8", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"f32x8"); p+=5; }
+            else if(MATCH_KEYWORD("f64x4", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"f64x4"); p+=5; }
+            else if(MATCH_KEYWORD("i32x4", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"i32x4"); p+=5; }
+            else if(MATCH_KEYWORD("i32x8", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"i32x8"); p+=5; }
+            else if(MATCH_KEYWORD("i64x4", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"i64x4"); p+=5; }
+            else if(MATCH_KEYWORD("u8x16", TOKEN_VECTOR)) { tok.type=TOKEN_VECTOR; strcpy(tok.text,"u8x16"); p+=5; }
             
             // Types
             else if(MATCH_KEYWORD("int", TOKEN_INT)) { tok.type=TOKEN_INT; strcpy(tok.text,"int"); p+=3; }
@@ -121,6 +138,7 @@ int lex_file(const char* filename, TokenList* out) {
             else if(*p==';'){ tok.type=TOKEN_SEMICOLON; strcpy(tok.text,";"); p++; }
             else if(*p==','){ tok.type=TOKEN_COMMA; strcpy(tok.text,","); p++; }
             else if(*p=='?'){ tok.type=TOKEN_QUESTION; strcpy(tok.text,"?"); p++; }
+            else if(*p=='@'){ tok.type=TOKEN_AT; strcpy(tok.text,"@"); p++; }
             else if(*p=='~'){ tok.type=TOKEN_TILDE; strcpy(tok.text,"~"); p++; }
             
             // Multi-char Operators
@@ -7,6 +7,11 @@
 // Forward declarations
 static void parse_top_level_decl(ASTNode* program);
 static int is_type_token(TokenType type);
+static int is_type_as_value();
+static void parse_chan_type(char* type_name);
+static void parse_atomic_type(char* type_name);
+static ASTNode* parse_annotations(ASTNode* function);
+static int parse_soa(void);
 
 static TokenList tokens;
 static int pos;
@@ -91,6 +96,34 @@ void ast_free(ASTNode* node) {
     free(node);
 }
 
+// net.tcp.connect/listen/accept/Addr(args), net.http.new() and
+// x.on(EVENT) { ... } get nodes of their own. The others keep their
+// arguments as children; ON has the receiver, the event and the block.
+static ASTNode* net_node(ASTNode* call) {
+    ASTNode* receiver = call->children[0];
+    ASTNodeType type = AST_TYPE_END;
+    int in_net = receiver->type == AST_MEMBER_ACCESS && receiver->children[0]->type == AST_IDENTIFIER &&
+                 strcmp(receiver->children[0]->text, "net") == 0;
+    if (in_net && (strcmp(receiver->text, "tcp") == 0 || strcmp(receiver->text, "http") == 0)) {
+        if (strcmp(receiver->text, "http") == 0) {
+            if (strcmp(call->text, "new") == 0) type = AST_NET_HTTP_NEW;
+        } else if (strcmp(call->text, "connect") == 0) type = AST_NET_TCP_CONNECT;
+        else if (strcmp(call->text, "listen") == 0) type = AST_NET_TCP_LISTEN;
+        else if (strcmp(call->text, "accept") == 0) type = AST_NET_TCP_ACCEPT;
+        else if (strcmp(call->text, "Addr") == 0) type = AST_NET_TCP_ADDR;
+        if (type != AST_TYPE_END) {
+            ast_free(receiver);
+            for (int i = 1; i < call->child_count; i++) call->children[i - 1] = call->children[i];
+            call->child_count--;
+        }
+    } else if (strcmp(call->text, "on") == 0 && call->child_count == 3 &&
+               call->children[2]->type == AST_BLOCK) {
+        type = AST_NET_ON;
+    }
+    if (type != AST_TYPE_END) call->type = type;
+    return call;
+}
+
 // Forward decls
 static ASTNode* parse_block();
 static ASTNode* parse_statement();
@@ -129,8 +162,48 @@ static ASTNode* parse_primary() {
         return unary;
     }
 
+    // spawn f(args): the call runs as a task, the expression is its join handle
+    if (t->type == TOKEN_SPAWN) {
+        ASTNode* spawn = ast_new(AST_SPAWN);
+        advance();
+        ASTNode* call = parse_primary();
+        if (!call || call->type != AST_CALL) {
+            printf("Error: spawn needs a function call (line %d)\n", t->line);
+        }
+        if (call) spawn->children[spawn->child_count++] = call;
+        return spawn;
+    }
+
+    // await x: suspends the enclosing async function until x completes
+    if (t->type == TOKEN_AWAIT) {
+        ASTNode* await = ast_new(AST_AWAIT);
+        advance();
+        ASTNode* operand = parse_primary();
+        if (!operand) {
+            printf("Error: await needs an expression (line %d)\n", t->line);
+        } else {
+            await->children[await->child_count++] = operand;
+        }
+        return await;
+    }
+
+    // chan<T>(capacity[, SPSC]): a new channel
+    if (t->type == TOKEN_CHAN) {
+        ASTNode* chan = ast_new(AST_CHAN_NEW);
+        strcpy(chan->text, "chan");
+        advance();
+        parse_chan_type(chan->text);
+        expect(TOKEN_LPAREN);
+        while (current()->type != TOKEN_RPAREN && current()->type != TOKEN_EOF) {
+            if (match(TOKEN_COMMA)) continue;
+            chan->children[chan->child_count++] = parse_expression();
+        }
+        expect(TOKEN_RPAREN);
+        return chan;
+    }
+
     // 1. Parse Atom
-    if (t->type == TOKEN_IDENTIFIER) {
+    if (t->type == TOKEN_IDENTIFIER || is_type_as_value()) {
          // Check alias substitution
          ASTNode* alias_node = find_alias(t->text);
          if (alias_node) {
@@ -195,7 +268,7 @@ static ASTNode* parse_primary() {
         }
         expect(TOKEN_RBRACE);
     } else if (match(TOKEN_LPAREN)) {
-        if (is_type_token(current()->type)) {
+        if (is_type_token(current()->type) && !is_type_as_value()) {
              // Cast: (int) expr
              char type_name[64];
              strcpy(type_name, current()->text);
@@ -244,7 +317,7 @@ static ASTNode* parse_primary() {
                     if (current()->type == TOKEN_LBRACE) {
                         call->children[call->child_count++] = parse_block();    
                     }
-                    node = call;
+                    node = net_node(call);
                 } else {
                     // Member Access: .ident
                     ASTNode* access = ast_new(AST_MEMBER_ACCESS);
@@ -378,6 +451,8 @@ static ASTNode* parse_var_decl() {
         strcat(type_name, current()->text);
         advance();
     }
+    if (strcmp(type_name, "chan") == 0) parse_chan_type(type_name);
+    if (strcmp(type_name, "atomic") == 0) parse_atomic_type(type_name);
     
     // Check for array type: int[] x
     while (match(TOKEN_LBRACKET)) {
@@ -396,6 +471,8 @@ static ASTNode* parse_var_decl() {
             expect(TOKEN_RBRACKET);
             is_array = 1;
         }
+        int soa = (is_array || strstr(type_name, "[]")) && strncmp(type_name, "struct ", 7) == 0 && parse_soa();
+        ASTNode* align = parse_annotations(NULL);
         
          ASTNode* decl = ast_new(AST_VAR_DECL);
          strcpy(decl->text, var_name); // Var name
@@ -416,6 +493,8 @@ static ASTNode* parse_var_decl() {
          ASTNode* type_node = ast_new(AST_IDENTIFIER);
          strcpy(type_node->text, type_name);
          if (is_array) strcat(type_node->text, "[]"); // Mark as array
+         if (soa) strcat(type_node->text, " soa");
+         if (align) type_node->children[type_node->child_count++] = align;
          decl->children[decl->child_count++] = type_node;
          
          if (current()->type == TOKEN_SEMICOLON) advance();
@@ -486,6 +565,27 @@ static ASTNode* parse_switch_statement() {
     return switch_node;
 }
 
+// select { case c.recv(v): ... case c.send(x): ... default: ... }: cases
+// as in switch, each on a channel operation instead of a value
+static ASTNode* parse_select_statement() {
+    advance(); // Consume SELECT
+    ASTNode* select_node = ast_new(AST_SELECT);
+
+    expect(TOKEN_LBRACE);
+    while(current()->type!=TOKEN_RBRACE && current()->type!=TOKEN_EOF) {
+            int start_pos = pos;
+            ASTNode* stmt = parse_statement();
+            if (stmt) select_node->children[select_node->child_count++] = stmt;
+
+            if (pos == start_pos) {
+                 printf("Error: Unexpected token in select: %s\n", current()->text);
+                 advance();
+            }
+    }
+    expect(TOKEN_RBRACE);
+    return select_node;
+}
+
 static ASTNode* parse_case_statement() {
     advance(); // CASE
     ASTNode* case_node = ast_new(AST_CASE);
@@ -549,9 +649,12 @@ static ASTNode* parse_do_while_statement() {
 }
 
 static ASTNode* parse_for_statement() {
+    // parallel for (...) [reduce(op: var, ...)] [static|dynamic[(chunk)]] body
+    int parallel = match(TOKEN_PARALLEL);
     advance(); // Consume FOR
     expect(TOKEN_LPAREN);
     ASTNode* node = ast_new(AST_FOR);
+    if (parallel) strcpy(node->text, "parallel");
     
     // Init (stmt or expr)
     if (current()->type != TOKEN_SEMICOLON) {
@@ -579,9 +682,43 @@ static ASTNode* parse_for_statement() {
             node->children[node->child_count++] = NULL;
     }
     expect(TOKEN_RPAREN);
-    
+
+    // Clauses go after the body: children[4...]
+    ASTNode* clauses[16];
+    int clause_count = 0;
+    while (parallel && current()->type == TOKEN_IDENTIFIER && clause_count < 16 &&
+           (strcmp(current()->text, "reduce") == 0 || strcmp(current()->text, "static") == 0 ||
+            strcmp(current()->text, "dynamic") == 0)) {
+        ASTNode* clause = ast_new(AST_IDENTIFIER);
+        strcpy(clause->text, current()->text);
+        advance();
+        if (strcmp(clause->text, "reduce") == 0) {
+            // reduce(+: a, b): child 0 is the operator, the rest are the variables
+            expect(TOKEN_LPAREN);
+            ASTNode* op = ast_new(AST_IDENTIFIER);
+            strcpy(op->text, current()->text);
+            advance();
+            clause->children[clause->child_count++] = op;
+            expect(TOKEN_COLON);
+            while (current()->type == TOKEN_IDENTIFIER) {
+                ASTNode* var = ast_new(AST_IDENTIFIER);
+                strcpy(var->text, current()->text);
+                advance();
+                clause->children[clause->child_count++] = var;
+                if (!match(TOKEN_COMMA)) break;
+            }
+            expect(TOKEN_RPAREN);
+        } else if (match(TOKEN_LPAREN)) {
+            // static(chunk), dynamic(chunk)
+            clause->children[clause->child_count++] = parse_expression();
+            expect(TOKEN_RPAREN);
+        }
+        clauses[clause_count++] = clause;
+    }
+
     ASTNode* body = parse_statement(); 
     node->children[node->child_count++] = body;
+    for (int i = 0; i < clause_count; i++) node->children[node->child_count++] = clauses[i];
     
     return node;
 }
@@ -806,7 +943,8 @@ static ASTNode* parse_statement() {
           return parse_struct_statement();
     }
 
-    if (is_type_token(t->type)) {
+    // atomic.fence(order) and f32x4(x) are calls, not declarations
+    if (is_type_token(t->type) && !is_type_as_value()) {
         ASTNode* decl = parse_var_decl();
         if (decl) return decl; 
     }
@@ -815,11 +953,13 @@ static ASTNode* parse_statement() {
         case TOKEN_IDENTIFIER: return parse_identifier_statement();
         case TOKEN_IF: return parse_if_statement();
         case TOKEN_SWITCH: return parse_switch_statement();
+        case TOKEN_SELECT: return parse_select_statement();
         case TOKEN_CASE: return parse_case_statement();
         case TOKEN_DEFAULT: return parse_default_statement();
         case TOKEN_WHILE: return parse_while_statement();
         case TOKEN_DO: return parse_do_while_statement();
         case TOKEN_FOR: return parse_for_statement();
+        case TOKEN_PARALLEL: return parse_for_statement();
         case TOKEN_RETURN: return parse_return_statement();
         case TOKEN_LBRACE: return parse_block();
         case TOKEN_METHOD: return parse_method_statement();
@@ -893,8 +1033,28 @@ static void parse_import(ASTNode* program) {
     }
 }
 
+// The name an export item declares: "add" for add and for int add(int a),
+// "FILE_open" for bool FILE.open(string path)
+static void export_name(char* name) {
+    name[0] = 0;
+    for (int i = pos; i < tokens.count; i++) {
+        TokenType type = tokens.tokens[i].type;
+        if (type == TOKEN_COMMA || type == TOKEN_RPAREN || type == TOKEN_EOF) break;
+        if (type == TOKEN_LPAREN) {
+            if (i >= pos + 3 && tokens.tokens[i - 2].type == TOKEN_DOT) {
+                sprintf(name, "%s_%s", tokens.tokens[i - 3].text, tokens.tokens[i - 1].text);
+            }
+            break;
+        }
+        if (type == TOKEN_IDENTIFIER) strcpy(name, tokens.tokens[i].text);
+    }
+}
+
+// export (...) keeps the names as AST_IDENTIFIER children of an AST_EXPORT
 static void parse_export(ASTNode* program) {
     advance();
+    ASTNode* exports = ast_new(AST_EXPORT);
+    program->children[program->child_count++] = exports;
     if (match(TOKEN_LPAREN)) {
         while (current()->type != TOKEN_RPAREN && current()->type != TOKEN_EOF) {
             int start_pos = pos;
@@ -902,6 +1062,13 @@ static void parse_export(ASTNode* program) {
                 advance();
                 continue;
             }
+            char name[256];
+            export_name(name);
+            if (name[0]) {
+                ASTNode* item = ast_new(AST_IDENTIFIER);
+                strcpy(item->text, name);
+                exports->children[exports->child_count++] = item;
+            }
             parse_top_level_decl(program);
             
             if (pos == start_pos) {
@@ -911,6 +1078,9 @@ static void parse_export(ASTNode* program) {
         }
         expect(TOKEN_RPAREN);
     } else {
+        ASTNode* item = ast_new(AST_IDENTIFIER);
+        strcpy(item->text, current()->text);
+        exports->children[exports->child_count++] = item;
         advance(); // export symbol
     }
 }
@@ -1066,7 +1236,124 @@ static int is_type_token(TokenType type) {
             type == TOKEN_UINT ||
             type == TOKEN_LONG || type == TOKEN_ULONG ||
             type == TOKEN_WCHAR || type == TOKEN_MAP || type == TOKEN_VAR || 
-            type == TOKEN_STRUCT || type == TOKEN_UNION);
+            type == TOKEN_STRUCT || type == TOKEN_UNION || type == TOKEN_CHAN || type == TOKEN_ATOMIC ||
+            type == TOKEN_VECTOR);
+}
+
+// A type keyword used as a value: atomic.fence(...), a vector constructor
+// f32x4(...) or a vector type's function f32x4.load(...)
+static int is_type_as_value() {
+    TokenType type = current()->type;
+    TokenType next = tokens.tokens[pos+1].type;
+    return (type == TOKEN_ATOMIC && next == TOKEN_DOT) ||
+           (type == TOKEN_VECTOR && (next == TOKEN_DOT || next == TOKEN_LPAREN));
+}
+
+// chan<T>: appends the element type in angle brackets to type_name ("chan")
+static void parse_chan_type(char* type_name) {
+    if (!match(TOKEN_LT)) {
+        printf("Error: chan needs an element type, as in chan<int> (line %d)\n", current()->line);
+        return;
+    }
+    strcat(type_name, "<");
+    if (current()->type == TOKEN_STRUCT) {
+        advance();
+        strcat(type_name, "struct ");
+    }
+    strcat(type_name, current()->text);
+    advance();
+    while (match(TOKEN_LBRACKET)) {
+        expect(TOKEN_RBRACKET);
+        strcat(type_name, "[]");
+    }
+    expect(TOKEN_GT);
+    strcat(type_name, ">");
+}
+
+// atomic T: appends the integer or bool type after "atomic" to type_name
+static void parse_atomic_type(char* type_name) {
+    TokenType t = current()->type;
+    if (t != TOKEN_INT && t != TOKEN_UINT && t != TOKEN_LONG && t != TOKEN_ULONG && t != TOKEN_BOOL) {
+        printf("Error: atomic applies to int, uint, long, ulong and bool, not '%s' (line %d)\n",
+               current()->text, current()->line);
+        return;
+    }
+    strcat(type_name, " ");
+    strcat(type_name, current()->text);
+    advance();
+}
+
+// "soa" after the name of an array of structs, on the same line: the
+// structure-of-arrays layout, one column per field
+static int parse_soa(void) {
+    Token* t = current();
+    if (t->type != TOKEN_IDENTIFIER || strcmp(t->text, "soa") != 0 || t->line != tokens.tokens[pos - 1].line) {
+        return 0;
+    }
+    advance();
+    return 1;
+}
+
+// @align(n) or @align (a cache line) after a variable or field name: the
+// alignment in bytes as an AST_NUMBER, or NULL without one. Before a
+// function, function is non-NULL and @hot, @cold and @noinline are added
+// to it as AST_IDENTIFIER children.
+static ASTNode* parse_annotations(ASTNode* function) {
+    ASTNode* align = NULL;
+    while (current()->type == TOKEN_AT) {
+        advance();
+        Token* name = current();
+        advance();
+        if (function && (strcmp(name->text, "hot") == 0 || strcmp(name->text, "cold") == 0 ||
+                         strcmp(name->text, "noinline") == 0)) {
+            ASTNode* attr = ast_new(AST_IDENTIFIER);
+            strcpy(attr->text, name->text);
+            function->children[function->child_count++] = attr;
+            continue;
+        }
+        if (strcmp(name->text, "align") != 0) {
+            printf("Error: unknown annotation @%s (line %d)\n", name->text, name->line);
+            continue;
+        }
+        align = ast_new(AST_NUMBER);
+        strcpy(align->text, "64");
+        if (match(TOKEN_LPAREN)) {
+            if (current()->type == TOKEN_NUMBER) strcpy(align->text, current()->text);
+            else printf("Error: @align needs a number of bytes (line %d)\n", name->line);
+            advance();
+            expect(TOKEN_RPAREN);
+        }
+    }
+    return align;
+}
+
+static int has_attribute(ASTNode* attrs, const char* name) {
+    for (int i = 0; i < attrs->child_count; i++) {
+        if (strcmp(attrs->children[i]->text, name) == 0) return 1;
+    }
+    return 0;
+}
+
+// inline, @hot, @cold and @noinline before a function, in any order
+static ASTNode* parse_function_attributes(void) {
+    ASTNode* attrs = ast_new(AST_IDENTIFIER);
+    int line = current()->line;
+    while (current()->type == TOKEN_AT || current()->type == TOKEN_INLINE) {
+        if (match(TOKEN_INLINE)) {
+            ASTNode* attr = ast_new(AST_IDENTIFIER);
+            strcpy(attr->text, "inline");
+            attrs->children[attrs->child_count++] = attr;
+        } else if (parse_annotations(attrs)) {
+            printf("Error: @align goes after a variable name, not before a function (line %d)\n", line);
+        }
+    }
+    if (has_attribute(attrs, "inline") && has_attribute(attrs, "noinline")) {
+        printf("Error: a function can't be both inline and @noinline (line %d)\n", line);
+    }
+    if (has_attribute(attrs, "hot") && has_attribute(attrs, "cold")) {
+        printf("Error: a function can't be both @hot and @cold (line %d)\n", line);
+    }
+    return attrs;
 }
 
 static void parse_single_alias(ASTNode* program) {
@@ -1159,6 +1446,13 @@ static void parse_alias(ASTNode* program) {
 }
 
 static void parse_top_level_decl(ASTNode* program) {
+    // inline, @hot, @cold, @noinline; they end up as children of the return type
+    ASTNode* attrs = parse_function_attributes();
+    // async T f(args) { ... }
+    int is_async = match(TOKEN_ASYNC);
+    if (is_async && has_attribute(attrs, "inline")) {
+        printf("Error: an async function can't be inline (line %d)\n", current()->line);
+    }
     Token* t = current();
     
     char type_name[256] = {0};
@@ -1202,6 +1496,7 @@ static void parse_top_level_decl(ASTNode* program) {
          } else {
              strcpy(type_name, t->text);
              advance();
+             if (strcmp(type_name, "atomic") == 0) parse_atomic_type(type_name);
              // Check array [] in type? "int[] x" or "int[16] x"
              if (match(TOKEN_LBRACKET)) {
                  while(current()->type!=TOKEN_RBRACKET && current()->type!=TOKEN_EOF) advance();
@@ -1259,12 +1554,16 @@ static void parse_top_level_decl(ASTNode* program) {
              if (current()->type == TOKEN_LPAREN) {
                  // Function definition: Type Name(...) { ... }
                  // OR Prototype: Type Name(...);
-                 ASTNode* func = ast_new(AST_FUNCTION);
+                 ASTNode* func = ast_new(is_async ? AST_ASYNC_FUNCTION : AST_FUNCTION);
                  strcpy(func->text, name); // Function name
                  
                  // Child 0: Return Type
                  ASTNode* ret_node = ast_new(AST_IDENTIFIER);
                  strcpy(ret_node->text, type_name);
+                 for (int i = 0; i < attrs->child_count; i++) {
+                     ret_node->children[ret_node->child_count++] = attrs->children[i];
+                 }
+                 attrs->child_count = 0;
                  func->children[func->child_count++] = ret_node;
                  
                  expect(TOKEN_LPAREN);
@@ -1326,6 +1625,15 @@ static void parse_top_level_decl(ASTNode* program) {
                       } else {
                           strcpy(arg_type, current()->text);
                           advance();
+                          if (strcmp(arg_type, "chan") == 0) parse_chan_type(arg_type);
+                          if (strcmp(arg_type, "atomic") == 0) parse_atomic_type(arg_type);
+                          // Qualified types: net.tcp.Conn
+                          while (current()->type == TOKEN_DOT && tokens.tokens[pos+1].type == TOKEN_IDENTIFIER) {
+                              advance();
+                              strcat(arg_type, ".");
+                              strcat(arg_type, current()->text);
+                              advance();
+                          }
                       }
                       // brackets?
                       if (match(TOKEN_LBRACKET)) { 
@@ -1355,6 +1663,9 @@ static void parse_top_level_decl(ASTNode* program) {
                           }
                           
                           if (is_arr) strcat(at->text, "[]"); // array param
+                          if (strstr(at->text, "[]") && strncmp(at->text, "struct ", 7) == 0 && parse_soa()) {
+                              strcat(at->text, " soa");
+                          }
                           arg->children[arg->child_count++] = NULL; // No init
                           arg->children[arg->child_count++] = at;
                           
@@ -1381,9 +1692,17 @@ static void parse_top_level_decl(ASTNode* program) {
                  if (implicit_type && current()->type != TOKEN_LPAREN) {
                       printf("Error: Implicit type only supported for functions (e.g. 'main()'). Got '%s' after '%s'\n", current()->text, name);
                  }
+                 if (is_async) {
+                      printf("Error: async only applies to functions, not '%s' (line %d)\n", name, t->line);
+                 }
+                 if (attrs->child_count) {
+                      printf("Error: %s only applies to functions, not '%s' (line %d)\n",
+                             attrs->children[0]->text, name, t->line);
+                 }
 
                  ASTNode* var = ast_new(AST_VAR_DECL);
                  strcpy(var->text, name);
+                 ASTNode* align = parse_annotations(NULL);
                  ASTNode* init = NULL;
                  if (match(TOKEN_ASSIGN)) {
                      init = parse_expression();
@@ -1394,6 +1713,7 @@ static void parse_top_level_decl(ASTNode* program) {
                  var->children[var->child_count++] = init;
                  ASTNode* type_node = ast_new(AST_IDENTIFIER);
                  strcpy(type_node->text, type_name);
+                 if (align) type_node->children[type_node->child_count++] = align;
                  // check array
                  if (match(TOKEN_LBRACKET)) {
                      if (current()->type != TOKEN_RBRACKET) {
@@ -1412,6 +1732,7 @@ static void parse_top_level_decl(ASTNode* program) {
      } else {
          advance(); // unknown top level
      }
+     ast_free(attrs);
 }
 
 int parse_file(const char* filename, ASTNode** out_ast) {
@@ -23,6 +23,24 @@ typedef struct come_byte_array_t {
     uint8_t items[]; 
 } come_byte_array_t;
 
+typedef struct come_long_array_t {
+    uint32_t size;  // Capacity (elements)
+    uint32_t count; // Used length
+    long items[];
+} come_long_array_t;
+
+typedef struct come_float_array_t {
+    uint32_t size;  // Capacity (elements)
+    uint32_t count; // Used length
+    float items[];
+} come_float_array_t;
+
+typedef struct come_double_array_t {
+    uint32_t size;  // Capacity (elements)
+    uint32_t count; // Used length
+    double items[];
+} come_double_array_t;
+
 // Note: come_string_t is defined in come_string.h.
 // Forward declaring it here if needed, or include come_string.h
 struct come_string_t;
@@ -40,12 +58,58 @@ void* come_array_realloc(void* arr, size_t elem_size, uint32_t new_size);
 // Helpers for specific types (to be called by codegen via _Generic)
 void* come_int_array_resize(come_int_array_t* a, uint32_t n);
 void* come_byte_array_resize(come_byte_array_t* a, uint32_t n);
+void* come_long_array_resize(come_long_array_t* a, uint32_t n);
+void* come_float_array_resize(come_float_array_t* a, uint32_t n);
+void* come_double_array_resize(come_double_array_t* a, uint32_t n);
 void* come_string_list_resize(come_string_list_t* a, uint32_t n);
 
 come_int_array_t* come_int_array_slice(come_int_array_t* a, uint32_t start, uint32_t end);
 come_byte_array_t* come_byte_array_slice(come_byte_array_t* a, uint32_t start, uint32_t end);
+come_long_array_t* come_long_array_slice(come_long_array_t* a, uint32_t start, uint32_t end);
+come_float_array_t* come_float_array_slice(come_float_array_t* a, uint32_t start, uint32_t end);
+come_double_array_t* come_double_array_slice(come_double_array_t* a, uint32_t start, uint32_t end);
 come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start, uint32_t end);
 
+// .dup(depth): a copy on ctx, sized to the elements in use. Arrays of
+// numbers are one allocation and one memcpy whatever the depth; string
+// lists (string.c) copy their strings unless depth is 1.
+come_int_array_t* come_int_array_dup(TALLOC_CTX* ctx, const come_int_array_t* a, int depth);
+come_byte_array_t* come_byte_array_dup(TALLOC_CTX* ctx, const come_byte_array_t* a, int depth);
+come_long_array_t* come_long_array_dup(TALLOC_CTX* ctx, const come_long_array_t* a, int depth);
+come_float_array_t* come_float_array_dup(TALLOC_CTX* ctx, const come_float_array_t* a, int depth);
+come_double_array_t* come_double_array_dup(TALLOC_CTX* ctx, const come_double_array_t* a, int depth);
+come_string_list_t* come_string_list_dup(TALLOC_CTX* ctx, const come_string_list_t* a, int depth);
+
+// Copy-on-write sharing. a.share() gives another owner the same buffer: a
+// talloc reference keeps it alive until its last owner is freed, and
+// COME_SHARED in its size marks it. Before a write, come_array_cow(a) leaves
+// a buffer that no other owner holds as it is, and otherwise points a at a
+// copy of its own, allocated under the shared buffer so that the copy lives
+// as long as the handles reaching it. Reads never check.
+#define COME_SHARED 0x80000000u
+void* come_array_share(TALLOC_CTX* owner, void* a, size_t elem_size);
+void* come_array_unshare(void* a, size_t elem_size);
+#define come_array_cow(a) \
+    ((a) && __builtin_expect(((a)->size & COME_SHARED) != 0, 0) \
+         ? (void)((a) = come_array_unshare((a), sizeof((a)->items[0]))) : (void)0)
+
+// Struct arrays in the soa layout (struct Rect rects[] soa): one allocation
+// holding the header, a pointer to each field's column, then the columns,
+// each a multiple of 64 bytes long. Codegen emits a typed header per struct,
+// with the columns' pointers named after the fields, and passes the field
+// widths; the functions move the columns and re-point the header whenever
+// the capacity changes. Resizing zeroes new elements.
+typedef struct {
+    uint32_t size;   // Capacity (elements)
+    uint32_t count;  // Used length
+    void* cols[];
+} come_soa_t;
+
+void* come_soa_alloc(TALLOC_CTX* ctx, uint32_t n, const size_t* widths, int fields);
+void* come_soa_resize(void* a, uint32_t n, const size_t* widths, int fields);
+void* come_soa_reserve(void* a, uint32_t n, const size_t* widths, int fields); // Capacity for n, count unchanged
+void* come_soa_slice(void* a, uint32_t start, uint32_t end, const size_t* widths, int fields);
+
 // Generic Accessor
 #define COME_ARR_GET(arr, idx) _Generic((arr), \
     come_string_list_t*: ((come_string_list_t*)(arr))->items[(idx)], \
@@ -61,6 +125,12 @@ come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start
     const come_int_array_t**: ((arr) ? (arr)->count : 0), \
     come_byte_array_t**: ((arr) ? (arr)->count : 0), \
     const come_byte_array_t**: ((arr) ? (arr)->count : 0), \
+    come_long_array_t**: ((arr) ? (arr)->count : 0), \
+    const come_long_array_t**: ((arr) ? (arr)->count : 0), \
+    come_float_array_t**: ((arr) ? (arr)->count : 0), \
+    const come_float_array_t**: ((arr) ? (arr)->count : 0), \
+    come_double_array_t**: ((arr) ? (arr)->count : 0), \
+    const come_double_array_t**: ((arr) ? (arr)->count : 0), \
     come_string_list_t**: ((arr) ? (arr)->count : 0), \
     const come_string_list_t**: ((arr) ? (arr)->count : 0), \
     struct come_string_t**: ((arr) ? (arr)->count : 0), \
@@ -71,6 +141,9 @@ come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start
 #define come_array_resize(a, n) ((a) = _Generic((a), \
     come_int_array_t*: come_int_array_resize, \
     come_byte_array_t*: come_byte_array_resize, \
+    come_long_array_t*: come_long_array_resize, \
+    come_float_array_t*: come_float_array_resize, \
+    come_double_array_t*: come_double_array_resize, \
     come_string_list_t*: come_string_list_resize \
 )((a), (n)))
 
@@ -78,7 +151,72 @@ come_string_list_t* come_string_list_slice(come_string_list_t* a, uint32_t start
 #define come_array_slice(a, start, end) _Generic((a), \
     come_int_array_t*: come_int_array_slice, \
     come_byte_array_t*: come_byte_array_slice, \
+    come_long_array_t*: come_long_array_slice, \
+    come_float_array_t*: come_float_array_slice, \
+    come_double_array_t*: come_double_array_slice, \
     come_string_list_t*: come_string_list_slice \
 )((a), (start), (end))
 
+// Array Dup Helper Macro
+#define come_array_dup(ctx, a, depth) _Generic((a), \
+    come_int_array_t*: come_int_array_dup, \
+    come_byte_array_t*: come_byte_array_dup, \
+    come_long_array_t*: come_long_array_dup, \
+    come_float_array_t*: come_float_array_dup, \
+    come_double_array_t*: come_double_array_dup, \
+    come_string_list_t*: come_string_list_dup \
+)((ctx), (a), (depth))
+
+// Sorting and searching (sort.c). Comparators return <0, 0 or >0 as for
+// qsort, and get ctx as passed. None of the sorts is stable.
+typedef int (*come_cmp_t)(const void* a, const void* b, void* ctx);
+
+// Pattern-defeating quicksort: O(n log n) worst case, linear on sorted,
+// reversed and all-equal input
+void come_sort(void* base, size_t n, size_t size, come_cmp_t cmp, void* ctx);
+// Merge sort over the scheduler's workers; come_sort for small inputs or a
+// single worker
+void come_sort_parallel(void* base, size_t n, size_t size, come_cmp_t cmp, void* ctx);
+// Puts element k where sorting would, nothing greater before it and nothing
+// smaller after
+void come_nth_element(void* base, size_t n, size_t size, size_t k, come_cmp_t cmp, void* ctx);
+// The k smallest elements, sorted, at the front; the rest in no order
+void come_partial_sort(void* base, size_t n, size_t size, size_t k, come_cmp_t cmp, void* ctx);
+// In a sorted array: the first element not less than key (lower) or
+// greater than it (upper), n if there is none; cmp gets an element and key
+size_t come_lower_bound(const void* base, size_t n, size_t size, const void* key, come_cmp_t cmp, void* ctx);
+size_t come_upper_bound(const void* base, size_t n, size_t size, const void* key, come_cmp_t cmp, void* ctx);
+
+// LSD radix sorts (counting sort for bytes) and a multikey quicksort for
+// strings, by their bytes
+void come_radix_sort_i32(int32_t* items, size_t n);
+void come_radix_sort_i64(int64_t* items, size_t n);
+void come_radix_sort_u8(uint8_t* items, size_t n);
+void come_radix_sort_f32(float* items, size_t n);
+void come_radix_sort_f64(double* items, size_t n);
+void come_string_sort(struct come_string_t** items, size_t n);
+
+// Array methods: a.sort(), a.sort(cmp) with a function comparing two
+// elements, a.parallel_sort() likewise, a.nth_element(k), a.partial_sort(k),
+// and on sorted arrays a.lower_bound(x), a.upper_bound(x) and a.search(x)
+// (the index of an element equal to x, or -1). Keys of string lists are C
+// strings.
+#define COME_ARRAY_ALGORITHMS(X, A, T, P, K) \
+    void come_##X##_sort(A* a); \
+    void come_##X##_sort_by(A* a, int (*cmp)(P, P)); \
+    void come_##X##_parallel_sort(A* a); \
+    void come_##X##_parallel_sort_by(A* a, int (*cmp)(P, P)); \
+    void come_##X##_nth_element(A* a, uint32_t k); \
+    void come_##X##_partial_sort(A* a, uint32_t k); \
+    int come_##X##_lower_bound(const A* a, K key); \
+    int come_##X##_upper_bound(const A* a, K key); \
+    int come_##X##_search(const A* a, K key);
+
+COME_ARRAY_ALGORITHMS(int_array, come_int_array_t, int, int, int)
+COME_ARRAY_ALGORITHMS(long_array, come_long_array_t, long, long, long)
+COME_ARRAY_ALGORITHMS(byte_array, come_byte_array_t, uint8_t, int8_t, uint8_t)
+COME_ARRAY_ALGORITHMS(float_array, come_float_array_t, float, float, float)
+COME_ARRAY_ALGORITHMS(double_array, come_double_array_t, double, double, double)
+COME_ARRAY_ALGORITHMS(string_list, come_string_list_t, struct come_string_t*, struct come_string_t*, const char*)
+
 #endif // COME_ARRAY_MODULE_H
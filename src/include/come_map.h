@@ -30,5 +30,6 @@ void* come_map_get(come_map_t* m, string key);
 void come_map_remove(come_map_t* m, string key);
 uint32_t come_map_len(const come_map_t* m);
 void come_map_free(come_map_t* m);
+come_map_t* come_map_dup(TALLOC_CTX* ctx, const come_map_t* m, int depth); // Values are shared at any depth
 
 #endif // COME_MAP_H
@@ -0,0 +1,312 @@
+#ifndef COME_NET_H
+#define COME_NET_H
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "come_array.h"
+#include "come_string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Event loop behind net.tcp.
+//
+// Each thread has its own loop: an edge-triggered epoll set holding the
+// thread's listeners and connections, run by come_net_run() until every
+// handle is closed or come_net_stop() is called. Sockets are non-blocking.
+//
+// COME_NET_BACKEND=io_uring in the environment runs each loop on io_uring
+// instead, where the kernel supports it (Linux 6.0 and later): multishot
+// accept and recv, reads into a ring of provided buffers, and submissions
+// batched into the wait. Otherwise, or if setting it up fails, the loop
+// uses epoll. Handlers see no difference.
+//
+// Handlers are attached per event with come_net_tcp_on() and run on the
+// loop's thread under a context that is a child of the handle, so what
+// they allocate can be kept for as long as the handle lives. Every handle
+// is a context of its own; closing it frees everything allocated under it,
+// handler environments included.
+//
+// READABLE handlers get the bytes read as a byte[] that is the loop's read
+// buffer itself, reused for every read: it is only valid until the handler
+// returns. Writes made in a handler are queued as copies and sent with a
+// single gathered write once it returns. Writes outside a handler go out
+// at once; whatever the socket does not take is copied into the
+// connection's context. While more than COME_NET_TCP_HIGH_WATER bytes are queued, the
+// connection stops reading; WRITABLE fires when the queue drains.
+typedef enum {
+    COME_NET_TCP_ACCEPT,    // Listener: a connection is waiting (accept() takes it)
+    COME_NET_TCP_CONNECT,   // Connection: connect() completed
+    COME_NET_TCP_READABLE,  // Connection: bytes arrived, in data
+    COME_NET_TCP_WRITABLE,  // Connection: the output queue drained after a short write or high water
+    COME_NET_TCP_ERROR,     // Connection: socket error (come_net_tcp_error()); HUP follows
+    COME_NET_TCP_HUP,       // Connection: closed by either side; the last event
+    COME_NET_TCP_EVENTS
+} come_net_tcp_event_t;
+
+#define COME_NET_TCP_READ_BUFFER (64 * 1024)
+#define COME_NET_TCP_HIGH_WATER (1024 * 1024)
+
+typedef struct {
+    struct sockaddr_storage sa;
+    socklen_t len;  // 0 if the address did not parse
+} come_net_tcp_addr_t;
+
+typedef struct come_net_tcp_listener come_net_tcp_listener_t;
+typedef struct come_net_tcp_conn come_net_tcp_conn_t;
+
+// data: the bytes read (READABLE), else NULL; env: the environment from
+// come_net_tcp_on(); ctx: the handle's handler context
+typedef void (*come_net_tcp_handler_t)(come_byte_array_t* data, void* env, void* ctx);
+
+// Numeric IPv4 or IPv6 address
+come_net_tcp_addr_t come_net_tcp_addr(const char* host, int port);
+come_net_tcp_addr_t come_net_tcp_addr_string(const come_string_t* host, int port);
+
+// net.tcp.Addr(host, port) for strings and literals
+#define come_net_tcp_Addr(host, port) _Generic((host), \
+    come_string_t*: come_net_tcp_addr_string, \
+    const come_string_t*: come_net_tcp_addr_string, \
+    default: come_net_tcp_addr \
+)((host), (port))
+
+// NULL on failure, with errno set
+come_net_tcp_listener_t* come_net_tcp_listen(come_net_tcp_addr_t addr);
+come_net_tcp_conn_t* come_net_tcp_connect(come_net_tcp_addr_t addr);
+// The waiting connection in an ACCEPT handler, or the next pending one; NULL if none
+come_net_tcp_conn_t* come_net_tcp_accept(come_net_tcp_listener_t* listener);
+
+// Sets the handler for an event (NULL removes it) and returns a zeroed
+// environment of env_size bytes under the handle for it, or NULL for 0
+void* come_net_tcp_on(void* handle, come_net_tcp_event_t event, come_net_tcp_handler_t fn, size_t env_size);
+
+// Queues bytes; -1 if the connection is closing
+int come_net_tcp_write_bytes(come_net_tcp_conn_t* conn, const void* bytes, size_t len);
+// Queues a block from mem_talloc_alloc(), which the connection takes over
+// and frees once sent (or on failure). Allocate it under the connection:
+// the arena allocator cannot move a single block between contexts.
+int come_net_tcp_write_owned(come_net_tcp_conn_t* conn, void* block, size_t len);
+// Bytes queued and not yet taken by the socket
+size_t come_net_tcp_queued(const come_net_tcp_conn_t* conn);
+// 1 once close() was called or the connection is gone
+int come_net_tcp_closing(const come_net_tcp_conn_t* conn);
+// The environment of an event's handler if fn is that handler, else NULL
+void* come_net_tcp_env(void* handle, come_net_tcp_event_t event, come_net_tcp_handler_t fn);
+// Closes once queued output is written (a listener at once); HUP follows
+void come_net_tcp_close(void* handle);
+// errno of the error that closed the connection, or 0
+int come_net_tcp_error(come_net_tcp_conn_t* conn);
+
+int come_net_run(void);
+void come_net_stop(void);
+// "io_uring" or "epoll": the backend of this thread's loop
+const char* come_net_backend(void);
+// System calls this thread's loop has made for I/O: waits, reads, writes
+// and accepts
+long come_net_syscalls(void);
+
+static inline int come_net_tcp_write_array(come_net_tcp_conn_t* conn, const come_byte_array_t* a) {
+    return come_net_tcp_write_bytes(conn, a ? a->items : NULL, a ? a->count : 0);
+}
+
+static inline int come_net_tcp_write_string(come_net_tcp_conn_t* conn, const come_string_t* s) {
+    return come_net_tcp_write_bytes(conn, s ? come_string_data(s) : NULL, s ? s->count : 0);
+}
+
+static inline int come_net_tcp_write_cstr(come_net_tcp_conn_t* conn, const char* s) {
+    return come_net_tcp_write_bytes(conn, s, s ? strlen(s) : 0);
+}
+
+// conn.write(x) for byte[], string and literals
+#define come_net_tcp_write(conn, x) _Generic((x), \
+    come_byte_array_t*: come_net_tcp_write_array, \
+    const come_byte_array_t*: come_net_tcp_write_array, \
+    come_string_t*: come_net_tcp_write_string, \
+    const come_string_t*: come_net_tcp_write_string, \
+    default: come_net_tcp_write_cstr \
+)((conn), (x))
+
+// HTTP/1.1 over a net.tcp connection (docs/draft/COME_http.md).
+//
+// A session has two messages, req and resp. A server session parses
+// requests into req and sends resp; a session that sends a request becomes
+// a client and parses responses into resp. attach() takes the connection's
+// READABLE and WRITABLE events.
+//
+// Incoming bytes go into the session's connection buffer, parsed by a
+// state machine that resumes where the last read stopped. The start line
+// and headers are not copied: method(), path(), version() and header()
+// return views into the buffer, NUL-terminated in place, valid until the
+// message's READY handler returns (on a server, until the response is
+// sent). Bodies, by Content-Length or chunked, stream to DATA_READY as
+// views of the same buffer; without a DATA_READY handler they collect in
+// body(). Requests pipelined on a keep-alive connection are taken one at a
+// time: the next is parsed once the response to the current one is sent.
+//
+// Outgoing messages are written as the head, built in a block of its own,
+// and the body, in one gathered write.
+typedef enum {
+    COME_NET_HTTP_LINE_READY,    // Incoming: start line parsed
+    COME_NET_HTTP_HEADER_READY,  // Incoming: headers parsed
+    COME_NET_HTTP_DATA_READY,    // Incoming: a piece of the body, in data
+    COME_NET_HTTP_READY,         // Incoming: the whole message
+    COME_NET_HTTP_HEADER_DONE,   // Outgoing: start line and headers queued
+    COME_NET_HTTP_DATA_DONE,     // Outgoing: write() queued and the connection can take more
+    COME_NET_HTTP_DONE,          // Outgoing: the whole message queued
+    COME_NET_HTTP_EVENTS
+} come_net_http_event_t;
+
+#define COME_NET_HTTP_MAX_HEAD (64 * 1024)          // Start line and headers
+#define COME_NET_HTTP_MAX_BODY (16 * 1024 * 1024)   // Collected by body()
+#define COME_NET_HTTP_MAX_PENDING (1024 * 1024)     // Pipelined bytes waiting for a response
+
+typedef struct come_net_http_session come_net_http_session_t;
+typedef struct come_net_http_message come_net_http_message_t;
+
+// data: the body piece (DATA_READY), else NULL
+typedef void (*come_net_http_handler_t)(come_string_t* data, void* env, void* ctx);
+
+come_net_http_session_t* come_net_http_new(void* ctx);
+// Moves the session under the connection; -1 if it is closed or taken
+int come_net_http_attach(come_net_http_session_t* session, come_net_tcp_conn_t* conn);
+// Parses bytes from another transport; -1 once the stream is malformed
+int come_net_http_feed(come_net_http_session_t* session, const void* bytes, size_t len);
+come_net_http_message_t* come_net_http_req(come_net_http_session_t* session);
+come_net_http_message_t* come_net_http_resp(come_net_http_session_t* session);
+
+void* come_net_http_on(come_net_http_message_t* msg, come_net_http_event_t event, come_net_http_handler_t fn, size_t env_size);
+
+// Incoming; NULL or 0 if absent
+come_string_t* come_net_http_method(come_net_http_message_t* msg);
+come_string_t* come_net_http_path(come_net_http_message_t* msg);
+come_string_t* come_net_http_version(come_net_http_message_t* msg);
+int come_net_http_status(come_net_http_message_t* msg);
+come_string_t* come_net_http_header_bytes(come_net_http_message_t* msg, const char* name, size_t len);
+come_string_t* come_net_http_body(come_net_http_message_t* msg);
+
+// Outgoing; the request line defaults to GET /, the status to 200
+int come_net_http_set_method_bytes(come_net_http_message_t* msg, const char* method, size_t len);
+int come_net_http_set_path_bytes(come_net_http_message_t* msg, const char* path, size_t len);
+int come_net_http_set_status(come_net_http_message_t* msg, int status);
+int come_net_http_set_header_bytes(come_net_http_message_t* msg, const char* name, size_t name_len,
+                                   const char* value, size_t value_len);
+// The whole message with a Content-Length body
+int come_net_http_send_bytes(come_net_http_message_t* msg, const void* body, size_t len);
+// The body in pieces (chunked), then end()
+int come_net_http_write_bytes(come_net_http_message_t* msg, const void* bytes, size_t len);
+int come_net_http_end(come_net_http_message_t* msg);
+
+// String arguments: come strings, byte[] or literals
+#define come_net_http__data(x) _Generic((x), \
+    come_string_t*: come_net_http__sdata, \
+    const come_string_t*: come_net_http__sdata, \
+    come_byte_array_t*: come_net_http__bdata, \
+    const come_byte_array_t*: come_net_http__bdata, \
+    default: come_net_http__cdata \
+)(x)
+#define come_net_http__len(x) _Generic((x), \
+    come_string_t*: come_net_http__slen, \
+    const come_string_t*: come_net_http__slen, \
+    come_byte_array_t*: come_net_http__blen, \
+    const come_byte_array_t*: come_net_http__blen, \
+    default: come_net_http__clen \
+)(x)
+
+static inline const char* come_net_http__sdata(const come_string_t* s) {
+    return s ? come_string_data(s) : NULL;
+}
+static inline size_t come_net_http__slen(const come_string_t* s) {
+    return s ? s->count : 0;
+}
+static inline const char* come_net_http__bdata(const come_byte_array_t* a) {
+    return a ? (const char*)a->items : NULL;
+}
+static inline size_t come_net_http__blen(const come_byte_array_t* a) {
+    return a ? a->count : 0;
+}
+static inline const char* come_net_http__cdata(const char* s) {
+    return s;
+}
+static inline size_t come_net_http__clen(const char* s) {
+    return s ? strlen(s) : 0;
+}
+
+#define come_net_http_header(msg, name) \
+    come_net_http_header_bytes((msg), come_net_http__data(name), come_net_http__len(name))
+#define come_net_http_set_method(msg, x) \
+    come_net_http_set_method_bytes((msg), come_net_http__data(x), come_net_http__len(x))
+#define come_net_http_set_path(msg, x) \
+    come_net_http_set_path_bytes((msg), come_net_http__data(x), come_net_http__len(x))
+#define come_net_http_set_header(msg, name, value) \
+    come_net_http_set_header_bytes((msg), come_net_http__data(name), come_net_http__len(name), \
+                                   come_net_http__data(value), come_net_http__len(value))
+#define come_net_http_send(msg, x) \
+    come_net_http_send_bytes((msg), come_net_http__data(x), come_net_http__len(x))
+#define come_net_http_write(msg, x) \
+    come_net_http_write_bytes((msg), come_net_http__data(x), come_net_http__len(x))
+
+// Async functions (async/await), run on the loop's thread.
+//
+// Codegen turns each async function into a frame, a struct that begins with
+// come_async_t and holds the parameters and every local, and a step function
+// that runs the body from where it last stopped: each await saves the
+// locals into the frame, records the label to resume at and returns
+// COME_ASYNC_PENDING unless the awaited thing is already done. Nothing is
+// kept on the C stack between steps.
+//
+// Each task has a context of its own holding its frame; the step runs with
+// it as the module context, so what the body allocates goes with the task.
+// An awaited task is created under its awaiter and freed when the awaiter
+// takes its result, or kept under the awaiter if the result is an object.
+// A task nobody awaits is detached: it runs until its first await at once
+// and is freed when it finishes. What a task allocates lives as long as it.
+//
+// Tasks waiting on I/O are resumed from the loop's handlers through a ready
+// queue, drained before the handler returns. Tasks still waiting when the
+// loop stops are not resumed.
+typedef struct come_async come_async_t;
+typedef int (*come_async_step_t)(come_async_t* task);
+
+enum { COME_ASYNC_PENDING, COME_ASYNC_DONE };
+
+struct come_async {
+    come_async_step_t step;
+    void* resume;            // Label the step continues at; NULL before the first step
+    void* ctx;               // The task's context: its frame and what it allocates
+    void* result;            // Object in ctx for the awaiter, or NULL
+    void* value;             // Result of the last I/O await
+    come_async_t* awaiting;  // Task this one awaits
+    come_async_t* waiter;    // Task awaiting this one
+    come_async_t* next;      // Ready queue, or a listener's waiting tasks
+    int done;
+    int detached;
+};
+
+// A zeroed frame of size bytes in a new context under ctx
+void* come_async_new(void* ctx, size_t size, come_async_step_t step);
+// Starts a task nobody will await
+void come_async_detach(come_async_t* task);
+// Awaits child: 1 if self has to suspend, 0 if child is already done. Once
+// it is, release() gives its result to self and frees the rest.
+int come_async_await(come_async_t* self, come_async_t* child);
+void come_async_release(come_async_t* self);
+
+// Awaitable I/O, for self's step: 1 if self has to suspend, 0 if self->value
+// already holds the result. Connections read from or made this way have
+// their READABLE, CONNECT and HUP events taken by the async reader, which
+// keeps what arrives with nobody reading until the next read().
+// read: the bytes that arrived, as a byte[] in self's context, or NULL at
+// end of stream; one task reads a connection at a time
+int come_async_read(come_async_t* self, come_net_tcp_conn_t* conn);
+// accept: the next connection, in order of waiting tasks
+int come_async_accept(come_async_t* self, come_net_tcp_listener_t* listener);
+// connect: conn (from come_net_tcp_connect()) once connected, or NULL
+int come_async_connect(come_async_t* self, come_net_tcp_conn_t* conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef COME_SCHED_H
+#define COME_SCHED_H
+
+#include "mem/talloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Work-stealing task scheduler behind spawn/join.
+//
+// One worker thread per core (COME_WORKERS overrides the count), each with a
+// Chase-Lev deque: a worker pushes and pops its own tasks at the bottom and
+// idle workers steal from the top of a random victim. Tasks spawned by
+// threads that are not workers go to a global injection queue. A worker
+// waiting in join runs other tasks meanwhile, so fork/join recursion never
+// blocks it; other threads just wait.
+//
+// Each task runs under a fresh context of its own; when it finishes the
+// context is handed off to the joiner, which takes its result object (if
+// any) into the joining context and frees the rest.
+typedef struct come_sched_task come_sched_task_t;
+
+struct come_sched_task {
+    void (*run)(come_sched_task_t* task);
+    void* ctx;                  // The task's context while it runs
+    void* result;               // Object in ctx to give to the joiner, or NULL
+    mem_talloc_handoff_t done;  // ctx, pushed when run returns
+    come_sched_task_t* next;    // Injection queue link
+};
+
+// Starts the workers (0: one per core); spawn does it on first use
+void come_sched_start(int workers);
+// Stops and joins the workers; tasks not yet started are dropped
+void come_sched_shutdown(void);
+int come_sched_workers(void);
+
+// Queues a task: run, zeroed fields, and storage that outlives its join
+void come_sched_spawn(come_sched_task_t* task);
+// Waits for a task, running others meanwhile; its result goes to ctx
+void come_sched_join(come_sched_task_t* task, void* ctx);
+
+// Data-parallel loops behind `parallel for`. The range [lo, hi) is split
+// among come_parallel_width() participants, each a task on the scheduler.
+// Static chunking gives participant p an even share (chunk 0) or every
+// width-th block of chunk iterations; dynamic chunking hands out blocks of
+// chunk iterations from a shared counter as participants ask for them. Each
+// participant has its own reduction slot in slots, slot_size bytes apart
+// (generated code pads them to a cache line), and body gets that slot and
+// the participant's context, which ends up under ctx once the loop is done
+// (or is freed, without one). Returns when every iteration has run.
+typedef void (*come_parallel_body_t)(void** env, long lo, long hi, void* slot, void* ctx);
+
+typedef struct {
+    long lo;
+    long hi;
+    long chunk;         // 0: even split (static), or a default size (dynamic)
+    int dynamic;
+    come_parallel_body_t body;
+    void** env;         // Captured variables, by address
+    void* slots;        // width slots, or NULL without reductions
+    size_t slot_size;
+    int width;          // From come_parallel_width()
+    void* ctx;          // Keeps what the body allocated, or NULL
+} come_parallel_for_t;
+
+int come_parallel_width(void);
+void come_parallel_for(const come_parallel_for_t* loop);
+
+// Channels behind chan<T>: FIFO queues of fixed-size elements between
+// threads. A bounded channel is a ring of capacity slots, rounded up to a
+// power of two (at least 2): Vyukov's MPMC ring with a sequence number per
+// slot, or for COME_CHAN_SPSC a Lamport ring where each side caches the
+// other's index.
+// An unbounded channel (capacity 0) is a list of fixed-size segments, with
+// the same two variants. The head and tail each have a cache line of their
+// own. Elements are stored unboxed; COME_CHAN_OBJECT elements are pointers to
+// flat objects, exported on send and imported into the receiver's context
+// (see mem_talloc_export()).
+//
+// send blocks while a bounded channel is full and recv while a channel is
+// empty, spinning briefly before sleeping; try_send and try_recv never
+// block. All return COME_CHAN_OK, COME_CHAN_WOULD_BLOCK, or COME_CHAN_CLOSED
+// once the channel is closed (for recv: closed and drained, out zeroed).
+// A closed channel takes no more values; sends racing with the close may
+// still land and be received. The channel lives as long as ctx and frees
+// whatever is left in it.
+typedef struct come_chan come_chan_t;
+
+enum {
+    COME_CHAN_SPSC = 0x1,    // One sending and one receiving thread at a time
+    COME_CHAN_OBJECT = 0x2,  // Elements are objects (pointers), moved between contexts
+};
+
+enum {
+    COME_CHAN_OK = 0,
+    COME_CHAN_WOULD_BLOCK = 1,
+    COME_CHAN_CLOSED = -1,
+};
+
+come_chan_t* come_chan_new(void* ctx, size_t elem_size, long capacity, int flags);
+int come_chan_send(come_chan_t* ch, const void* value);
+int come_chan_try_send(come_chan_t* ch, const void* value);
+int come_chan_recv(come_chan_t* ch, void* out, void* ctx);
+int come_chan_try_recv(come_chan_t* ch, void* out, void* ctx);
+void come_chan_close(come_chan_t* ch);
+int come_chan_closed(const come_chan_t* ch);
+
+// select: runs the first case that can proceed, trying them from a rotating
+// start so none starves, and returns its index. With block set it waits
+// until one can; otherwise it returns -1 if none could. A send case on a
+// closed channel runs without sending, a recv case once its channel is
+// closed and drained (value zeroed); either sets closed.
+typedef struct {
+    come_chan_t* chan;
+    void* value;    // send: the value to send; recv: where it goes
+    int send;
+    int closed;     // Out: the case ran on a closed channel
+} come_chan_case_t;
+
+int come_chan_select(come_chan_case_t* cases, int n, int block, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
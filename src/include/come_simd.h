@@ -0,0 +1,89 @@
+#ifndef COME_SIMD_H
+#define COME_SIMD_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Vector types behind f32x4, f32x8, f64x4, i32x4, i32x8, i64x4 and u8x16:
+// GCC vector extensions, so arithmetic, bitwise and comparison operators
+// work lane by lane and compile to SSE/AVX on x86-64 and NEON on ARM64 (or
+// to pairs of registers, or scalar code, where the target has nothing that
+// wide). A comparison gives a mask: the signed integer vector of the same
+// shape, every bit set in lanes where it holds.
+//
+// Without AVX, GCC passes 32-byte vectors in memory rather than registers
+// and warns that this differs from AVX builds; every object of a program is
+// built with the same flags, so the warning says nothing here.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+typedef float come_f32x4_t __attribute__((vector_size(16)));
+typedef float come_f32x8_t __attribute__((vector_size(32)));
+typedef double come_f64x4_t __attribute__((vector_size(32)));
+typedef int32_t come_i32x4_t __attribute__((vector_size(16)));
+typedef int32_t come_i32x8_t __attribute__((vector_size(32)));
+typedef int64_t come_i64x4_t __attribute__((vector_size(32)));
+typedef uint8_t come_u8x16_t __attribute__((vector_size(16)));
+
+// For each type: a vector with every lane x; unaligned loads and stores of
+// N elements; sum (in S, wide enough for a byte vector's total), min and max
+// of the lanes; whether any or all lanes are non-zero; and blend, taking
+// lanes of a where the mask m is set and of b elsewhere.
+#define COME_SIMD_DEFINE(V, T, N, S, M) \
+    static inline come_##V##_t come_##V##_splat(T x) { \
+        come_##V##_t v; \
+        for (int i = 0; i < N; i++) v[i] = x; \
+        return v; \
+    } \
+    static inline come_##V##_t come_##V##_load(const T* p) { \
+        come_##V##_t v; \
+        memcpy(&v, p, sizeof(v)); \
+        return v; \
+    } \
+    static inline void come_##V##_store(come_##V##_t v, T* p) { memcpy(p, &v, sizeof(v)); } \
+    static inline S come_##V##_sum(come_##V##_t v) { \
+        S s = 0; \
+        for (int i = 0; i < N; i++) s += v[i]; \
+        return s; \
+    } \
+    static inline T come_##V##_min(come_##V##_t v) { \
+        T m = v[0]; \
+        for (int i = 1; i < N; i++) m = v[i] < m ? v[i] : m; \
+        return m; \
+    } \
+    static inline T come_##V##_max(come_##V##_t v) { \
+        T m = v[0]; \
+        for (int i = 1; i < N; i++) m = v[i] > m ? v[i] : m; \
+        return m; \
+    } \
+    static inline int come_##V##_any(come_##V##_t v) { \
+        for (int i = 0; i < N; i++) if (v[i]) return 1; \
+        return 0; \
+    } \
+    static inline int come_##V##_all(come_##V##_t v) { \
+        for (int i = 0; i < N; i++) if (!v[i]) return 0; \
+        return 1; \
+    } \
+    static inline come_##V##_t come_##V##_blend(come_##M##_t m, come_##V##_t a, come_##V##_t b) { \
+        return (come_##V##_t)(((come_##M##_t)a & m) | ((come_##M##_t)b & ~m)); \
+    }
+
+COME_SIMD_DEFINE(f32x4, float, 4, float, i32x4)
+COME_SIMD_DEFINE(f32x8, float, 8, float, i32x8)
+COME_SIMD_DEFINE(f64x4, double, 4, double, i64x4)
+COME_SIMD_DEFINE(i32x4, int32_t, 4, long, i32x4)
+COME_SIMD_DEFINE(i32x8, int32_t, 8, long, i32x8)
+COME_SIMD_DEFINE(i64x4, int64_t, 4, long, i64x4)
+COME_SIMD_DEFINE(u8x16, uint8_t, 16, long, u8x16)
+
+// Lanes of a and b picked by index (0..N-1 from a, N..2N-1 from b); M is
+// the integer vector type of the same shape. Clang wants the indices as
+// constants, so generated code only ever passes literals.
+#ifdef __clang__
+#define COME_SIMD_SHUFFLE(a, b, M, ...) __builtin_shufflevector((a), (b), __VA_ARGS__)
+#else
+#define COME_SIMD_SHUFFLE(a, b, M, ...) __builtin_shuffle((a), (b), (M){ __VA_ARGS__ })
+#endif
+
+#endif
@@ -19,16 +19,59 @@ typedef struct come_string_t {
 
 typedef come_string_t* string;
 
+// String view: a non-owning window onto another string's bytes.
+// Views share the size/count header prefix with come_string_t, so a view can be
+// passed to every read-only come_string_* function. A size of 0 marks a view
+// (a real string's size always includes its header).
+// Views are allocated under the viewed string, so they never outlive its bytes.
+typedef struct come_string_view_t {
+    uint32_t size;                // Always COME_STRING_VIEW_TAG
+    uint32_t count;               // Window length in bytes
+    uint32_t offset;              // Window start in parent->data
+    uint32_t flags;               // COME_STRING_VIEW_* flags
+    const come_string_t* parent;  // Owning string (views never nest)
+    const char* cstr;             // NUL-terminated copy from come_string_cstr, or NULL
+} come_string_view_t;
+
+#define COME_STRING_VIEW_TAG      0u
+#define COME_STRING_VIEW_EMBEDDED 0x1u  // Stored inside a list's view block, not its own chunk
+#define COME_STRING_VIEW_HELD     0x2u  // Holds a reference to its parent (after a chown)
+
+static inline bool come_string_is_view(const come_string_t* a) {
+    return a && a->size == COME_STRING_VIEW_TAG;
+}
+
+// Start of the string's bytes (not NUL-terminated for views; use count for length)
+static inline const char* come_string_data(const come_string_t* a) {
+    if (come_string_is_view(a)) {
+        const come_string_view_t* v = (const come_string_view_t*)a;
+        return v->parent->data + v->offset;
+    }
+    return a->data;
+}
+
+// Memory context for strings derived from 'a' (the owning string for views)
+static inline TALLOC_CTX* come_string_ctx(const come_string_t* a) {
+    if (come_string_is_view(a)) return (TALLOC_CTX*)((const come_string_view_t*)a)->parent;
+    return (TALLOC_CTX*)a;
+}
+
 // Constructor/Destructor
 come_string_t* come_string_new(TALLOC_CTX* ctx, const char* str);
 come_string_t* come_string_new_len(TALLOC_CTX* ctx, const char* str, size_t len);
+come_string_t* come_string_dup(TALLOC_CTX* ctx, const come_string_t* a); // .dup(): an owned copy, views included
+// Copy-on-write (see come_array_share): the same bytes for another owner. The
+// in-place methods copy a string that is still shared before writing it; a
+// view is copied rather than shared.
+come_string_t* come_string_share(TALLOC_CTX* owner, come_string_t* a);
 void come_string_free(come_string_t* str);
 
 // Core Methods
 uint32_t come_string_size(const come_string_t* a);
 uint32_t come_string_len(const come_string_t* a);
+uint32_t come_string_count_runes(const come_string_t* a); // UTF-8 code points (same as len)
 int come_string_cmp(const come_string_t* a, const come_string_t* b, size_t n); // n=0 for full
-int come_string_casecmp(const come_string_t* a, const come_string_t* b, size_t n); // n=0 for full
+int come_string_casecmp(const come_string_t* a, const come_string_t* b, size_t n); // n=0 for full; Unicode simple folding
 
 // Search
 long come_string_chr(const come_string_t* a, int c);
@@ -44,10 +87,19 @@ bool come_string_isalpha(const come_string_t* a);
 bool come_string_isalnum(const come_string_t* a);
 bool come_string_isspace(const come_string_t* a);
 bool come_string_isascii(const come_string_t* a);
+bool come_string_utf8(const come_string_t* a); // Well-formed UTF-8
 
 // Transformation (allocates new string on parent context)
 come_string_t* come_string_upper(const come_string_t* a);
 come_string_t* come_string_lower(const come_string_t* a);
+
+// In-place case mapping: converts the string's own bytes without allocating.
+// Returns the string, which only moves in the rare case that a rune needs more
+// bytes than the buffer holds; views are copied since they do not own their bytes.
+come_string_t* come_string_upper_reuse(come_string_t* a);
+come_string_t* come_string_lower_reuse(come_string_t* a);
+#define come_string_upper_inplace(a) ((a) = come_string_upper_reuse(a))
+#define come_string_lower_inplace(a) ((a) = come_string_lower_reuse(a))
 come_string_t* come_string_repeat(const come_string_t* a, size_t n);
 come_string_t* come_string_replace(const come_string_t* a, const char* old_str, const char* new_str, size_t n); // n=0 for all
 
@@ -67,17 +119,51 @@ come_string_list_t* come_string_split(const come_string_t* a, const char* sep);
 come_string_list_t* come_string_split_n(const come_string_t* a, const char* sep, size_t n);
 come_string_t* come_string_join(const come_string_list_t* list, const come_string_t* sep);
 uint32_t come_string_list_len(const come_string_list_t* list);
+come_string_list_t* come_string_list_new(TALLOC_CTX* ctx, uint32_t capacity);
+come_string_list_t* come_string_list_append(come_string_list_t* list, const char* str, size_t len); // May move the list
 come_string_list_t* come_string_list_from_argv(TALLOC_CTX* ctx, int argc, char* argv[]);
 
 // Substring
 come_string_t* come_string_substr(const come_string_t* a, size_t start, size_t end);
 
+// Views (zero-copy variants; results are come_string_view_t handles)
+come_string_t* come_string_view(const come_string_t* a, size_t offset, size_t len); // byte range
+come_string_t* come_string_substr_view(const come_string_t* a, size_t start, size_t end);
+come_string_t* come_string_trim_view(const come_string_t* a, const char* cutset);
+come_string_t* come_string_ltrim_view(const come_string_t* a, const char* cutset);
+come_string_t* come_string_rtrim_view(const come_string_t* a, const char* cutset);
+come_string_list_t* come_string_split_view(const come_string_t* a, const char* sep, size_t n);
+const char* come_string_cstr(const come_string_t* a); // NUL-terminated bytes (copies only for inner views)
+
 // Regex
 bool come_string_regex(const come_string_t* a, const char* pattern);
 come_string_list_t* come_string_regex_split(const come_string_t* a, const char* pattern, size_t n);
 come_string_list_t* come_string_regex_groups(const come_string_t* a, const char* pattern);
 come_string_t* come_string_regex_replace(const come_string_t* a, const char* pattern, const char* repl, size_t count);
 
+// Compiled regex (REG_EXTENDED). The string regex methods above compile through
+// a small per-thread LRU cache; a regex object keeps its program for its lifetime.
+// Matching is linear-time (src/string/re.c) and keeps a lazily built DFA in the
+// object, so a regex should not be used from two threads at once.
+typedef struct come_regex_t come_regex_t;
+typedef come_regex_t* regex;
+
+come_regex_t* come_regex_compile(TALLOC_CTX* ctx, const char* pattern); // NULL on a bad pattern
+void come_regex_free(come_regex_t* re);
+bool come_regex_match(const come_regex_t* re, const come_string_t* a);
+come_string_list_t* come_regex_split(const come_regex_t* re, const come_string_t* a, size_t n);
+come_string_list_t* come_regex_groups(const come_regex_t* re, const come_string_t* a);
+come_string_t* come_regex_replace(const come_regex_t* re, const come_string_t* a, const char* repl, size_t count);
+
+// Regex set: many patterns matched in one pass over the input
+typedef struct come_regex_set_t come_regex_set_t;
+typedef come_regex_set_t* regex_set;
+
+come_regex_set_t* come_regex_compile_set(TALLOC_CTX* ctx, const come_string_list_t* patterns); // NULL if any pattern is bad
+void come_regex_set_free(come_regex_set_t* set);
+bool come_regex_set_match(const come_regex_set_t* set, const come_string_t* a); // Any pattern matches
+come_int_array_t* come_regex_set_matches(const come_regex_set_t* set, const come_string_t* a); // Indices, ascending
+
 // Memory Management
 // Memory Management
 void come_string_chown(come_string_t* a, TALLOC_CTX* new_ctx);
@@ -89,5 +175,16 @@ come_string_t* come_string_sprintf(TALLOC_CTX* ctx, const char* fmt, ...);
 // Conversions
 come_byte_array_t* come_string_to_byte_array(const come_string_t* a);
 
-long come_string_tol(const come_string_t* a);
+// Set ERR (errno): 0, EINVAL if the text is not a number, ERANGE if clamped.
+// Surrounding whitespace is allowed; base is 2-36, or 0 for a 0x/0b/0 prefix.
+long come_string_tol(const come_string_t* a, int base);
+double come_string_tod(const come_string_t* a);
+
+// Append a number in decimal (doubles in the shortest form that parses back
+// exactly) to a's own buffer. Returns the string, which moves when it has to
+// grow; views are copied first.
+come_string_t* come_string_cat_long(come_string_t* a, long v);
+come_string_t* come_string_cat_double(come_string_t* a, double v);
+#define come_string_append_long(a, v) ((a) = come_string_cat_long((a), (v)))
+#define come_string_append_double(a, v) ((a) = come_string_cat_double((a), (v)))
 #endif // COME_STRING_MODULE_H
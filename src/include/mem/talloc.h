@@ -16,6 +16,87 @@ void mem_talloc_free(void* ptr);
 void* mem_talloc_new_ctx(void* parent);
 void* mem_talloc_steal(void* new_ctx, void* ptr);
 
+// References: ctx becomes another owner of ptr, which lives until its parent
+// and every referencing context are freed. Freeing a referenced object only
+// drops its parent's link and leaves it to a reference holder.
+void* mem_talloc_reference(void* ctx, void* ptr);
+size_t mem_talloc_reference_count(void* ptr);
+void mem_talloc_set_destructor(void* ptr, int (*destructor)(void*));
+
+// Pools: one malloc up front, children are carved out of it by bumping a
+// pointer and have no malloc of their own. Memory is returned when the pool
+// and everything allocated in it are freed; allocations that do not fit fall
+// back to malloc.
+void* mem_talloc_pool_new(void* parent, size_t size);
+
+// Default pool size for generated module contexts
+#define MEM_TALLOC_MODULE_POOL (64 * 1024)
+
+// Pool scope: points *slot (a module context) at a fresh pool under it until
+// the scope is exited, which frees the pool and restores *slot. Generated code
+// pairs the two with __attribute__((cleanup)), so every exit path unwinds.
+typedef struct {
+    void** slot;
+    void* outer;
+} mem_talloc_scope_t;
+
+mem_talloc_scope_t mem_talloc_scope_enter(void** slot, size_t size);
+void mem_talloc_scope_exit(mem_talloc_scope_t* scope);
+
+// Threads: every thread has its own root context (the parent used for NULL),
+// created by mem_talloc_module_init() or on first use and freed when the
+// thread exits; mem_talloc_module_shutdown() frees the calling thread's root.
+// A context and everything under it belong to one thread at a time.
+//
+// Handoff moves a tree between threads. The producer builds it under a
+// context of its own, from mem_talloc_new_ctx() on a non-pool parent (pool
+// memory stays tied to the pool's thread), and pushes it together with msg,
+// the object in it the consumer wants; push detaches the tree and links it
+// into the box with a single CAS. The consumer takes trees back in push
+// order, each re-parented under the consumer's context, with *msg set.
+// Any number of threads may push; only one may take from a given box.
+// Neither side takes a lock; after a push the producer must not touch the tree.
+// push returns 0, or -1 if the tree cannot be handed off; take returns NULL
+// when the box is empty.
+typedef struct {
+    void* head;   // Pushed, newest first (shared, atomic)
+    void* taken;  // Detached from head, oldest first (consumer only)
+} mem_talloc_handoff_t;
+
+#define MEM_TALLOC_HANDOFF_INIT { NULL, NULL }
+
+int mem_talloc_handoff_push(mem_talloc_handoff_t* box, void* tree, void* msg);
+void* mem_talloc_handoff_take(mem_talloc_handoff_t* box, void* ctx, void** msg);
+
+// Export moves a single object out of the calling thread's hierarchy, for a
+// channel to carry: it returns obj itself, detached, or a detached copy when
+// obj cannot leave (pool memory, objects with other owners, and any object
+// under the arena allocator). Copies are shallow, so only flat objects
+// (strings, number arrays) may be exported. Import re-parents an exported
+// object under ctx on the receiving thread; mem_talloc_free() drops one that
+// nobody imported. Either way the exporting thread must not touch obj
+// afterwards.
+void* mem_talloc_export(void* obj);
+void* mem_talloc_import(void* ctx, void* obj);
+
+// Memory statistics, on when COME_MEMSTATS is set in the environment or the
+// program was built with it set. Each context counts its own bytes, objects
+// and peak (child contexts count separately), allocations are attributed to
+// mem_talloc_site ("file.co:line", set before each statement by memstats
+// builds), and a report goes to stderr at exit. mem_talloc_stats(NULL) gives
+// process totals; the report lists the calling thread's context tree.
+typedef struct {
+    size_t bytes;
+    size_t objects;
+    size_t peak;
+} mem_talloc_stats_t;
+
+extern __thread const char* mem_talloc_site;
+
+void mem_talloc_stats_enable(void);
+mem_talloc_stats_t mem_talloc_stats(void* ctx);
+char* mem_talloc_stats_report(void* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,15 +7,20 @@
 #define INITIAL_CAPACITY 16
 #define LOAD_FACTOR_THRESHOLD 0.75
 
-// DJB2 hash for strings
-static uint32_t hash_string(const char* str) {
+// DJB2 hash over a key's bytes: views included, which aren't NUL-terminated
+// and whose bytes aren't at data
+static uint32_t hash_string(const come_string_t* key) {
+    const unsigned char* p = (const unsigned char*)come_string_data(key);
     uint32_t hash = 5381;
-    int c;
-    while ((c = *str++))
-        hash = ((hash << 5) + hash) + c;
+    for (uint32_t i = 0; i < key->count; i++)
+        hash = ((hash << 5) + hash) + p[i];
     return hash;
 }
 
+static bool key_equal(const come_string_t* a, const come_string_t* b) {
+    return a->count == b->count && memcmp(come_string_data(a), come_string_data(b), a->count) == 0;
+}
+
 come_map_t* come_map_new(TALLOC_CTX* ctx) {
     size_t header_size = sizeof(uint32_t) * 2;
     size_t total_size = header_size + sizeof(come_map_entry_t) * INITIAL_CAPACITY;
@@ -68,11 +73,11 @@ void come_map_put(come_map_t** m_ptr, string key, void* value) {
         m = *m_ptr;
     }
     
-    uint32_t hash = hash_string(key->data);
+    uint32_t hash = hash_string(key);
     uint32_t idx = hash % m->size;
     
     while (m->entries[idx].occupied) {
-        if (strcmp(m->entries[idx].key->data, key->data) == 0) {
+        if (key_equal(m->entries[idx].key, key)) {
             m->entries[idx].value = value;
             return;
         }
@@ -89,12 +94,12 @@ void come_map_put(come_map_t** m_ptr, string key, void* value) {
 void* come_map_get(come_map_t* m, string key) {
     if (!m || !key) return NULL;
     
-    uint32_t hash = hash_string(key->data);
+    uint32_t hash = hash_string(key);
     uint32_t idx = hash % m->size;
     uint32_t start_idx = idx;
     
     while (m->entries[idx].occupied) {
-        if (strcmp(m->entries[idx].key->data, key->data) == 0) {
+        if (key_equal(m->entries[idx].key, key)) {
             return m->entries[idx].value;
         }
         idx = (idx + 1) % m->size;
@@ -107,12 +112,12 @@ void* come_map_get(come_map_t* m, string key) {
 void come_map_remove(come_map_t* m, string key) {
     if (!m || !key) return;
     
-    uint32_t hash = hash_string(key->data);
+    uint32_t hash = hash_string(key);
     uint32_t idx = hash % m->size;
     uint32_t start_idx = idx;
     
     while (m->entries[idx].occupied) {
-        if (strcmp(m->entries[idx].key->data, key->data) == 0) {
+        if (key_equal(m->entries[idx].key, key)) {
             m->entries[idx].occupied = false;
             m->entries[idx].key = NULL;
             m->entries[idx].value = NULL;
@@ -142,3 +147,30 @@ uint32_t come_map_len(const come_map_t* m) {
 void come_map_free(come_map_t* m) {
     // mem_talloc_free(m);
 }
+
+// come_string_dup, kept here: the compiler links map.o without the string module
+static string copy_key(TALLOC_CTX* ctx, const come_string_t* key) {
+    come_string_t* s = mem_talloc_alloc(ctx, sizeof(come_string_t) + key->count + 1);
+    if (!s) return NULL;
+    s->size = (uint32_t)(sizeof(come_string_t) + key->count + 1);
+    s->count = key->count;
+    memcpy(s->data, come_string_data(key), key->count);
+    s->data[key->count] = '\0';
+    return s;
+}
+
+// The table in one memcpy, same capacity so every entry keeps its slot. Keys
+// are copied under the new map unless depth is 1; values are untyped, so the
+// copy always shares them.
+come_map_t* come_map_dup(TALLOC_CTX* ctx, const come_map_t* m, int depth) {
+    if (!m) return NULL;
+    size_t bytes = sizeof(uint32_t) * 2 + sizeof(come_map_entry_t) * m->size;
+    come_map_t* copy = mem_talloc_alloc(ctx, bytes);
+    if (!copy) return NULL;
+    memcpy(copy, m, bytes);
+    if (depth == 1) return copy;
+    for (uint32_t i = 0; i < copy->size; i++) {
+        if (copy->entries[i].occupied) copy->entries[i].key = copy_key(copy, copy->entries[i].key);
+    }
+    return copy;
+}
@@ -0,0 +1,492 @@
+// Bump-arena backend for the mem_talloc API (come build --alloc=arena).
+//
+// Every context is an arena: a chain of blocks that allocations are carved
+// from by bumping a pointer, with a 16-byte header per allocation instead of
+// talloc's chunk header, magic and destructor bookkeeping. Objects allocated
+// under an object share its arena, so the object hierarchy is flattened into
+// the context hierarchy:
+//  - freeing a context frees its child contexts and all their memory;
+//  - freeing an object only runs its destructor, and returns its memory when
+//    it is the arena's most recent allocation (which is also the one
+//    realloc can grow in place); everything else is reclaimed with the context.
+//
+// Stealing a context re-parents it. An object cannot move to another arena
+// without changing its address, so stealing (or referencing) an object from
+// a context that may be freed first keeps that whole context alive until
+// exit, with a one-time diagnostic on stderr.
+
+#include "mem/talloc.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_FIRST_BLOCK 1024
+#define ARENA_MAX_BLOCK (1024 * 1024)
+
+#define CHUNK_CTX  0x1 // The chunk is a context handle
+#define CHUNK_DTOR 0x2 // A destructor is registered
+#define CHUNK_REF  0x4 // Referenced: another context owns it too
+#define CHUNK_FLAGS (ARENA_ALIGN - 1)
+
+typedef struct arena arena_t;
+
+// Header in front of every allocation. cap is the 16-byte rounded size, so
+// its low bits are free for flags.
+typedef struct chunk {
+    arena_t* arena;
+    size_t cap;
+} chunk_t;
+
+typedef struct block {
+    struct block* next;
+    size_t size;
+    _Alignas(ARENA_ALIGN) char data[];
+} block_t;
+
+typedef struct dtor {
+    struct dtor* next;
+    void* ptr;
+    int (*fn)(void*);
+} dtor_t;
+
+struct arena {
+    arena_t* parent;
+    arena_t* children;
+    arena_t* next;          // Siblings
+    arena_t* prev;
+    block_t* blocks;        // Current block first
+    char* cur;
+    char* end;
+    chunk_t* last;          // Most recent allocation in the current block
+    size_t next_block;
+    dtor_t* dtors;          // Newest first
+    bool kept;              // An object escaped: keep memory until exit
+    bool exported;          // Holds one exported object, not yet imported
+    _Alignas(ARENA_ALIGN) chunk_t self; // Header of the handle given out for the context
+};
+
+// Per-thread roots, as in the talloc backend
+static __thread arena_t* co_arena_root = NULL;
+static __thread bool co_arena_exiting = false;
+static pthread_key_t co_arena_root_key;
+static pthread_once_t co_arena_root_once = PTHREAD_ONCE_INIT;
+
+#define ALIGN_UP(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static inline chunk_t* chunk_of(const void* ptr) {
+    return (chunk_t*)ptr - 1;
+}
+
+static inline void* handle_of(arena_t* a) {
+    return &a->self + 1;
+}
+
+static inline size_t chunk_cap(const chunk_t* c) {
+    return c->cap & ~(size_t)CHUNK_FLAGS;
+}
+
+
+// Contexts
+
+static void link_child(arena_t* parent, arena_t* a) {
+    a->parent = parent;
+    a->prev = NULL;
+    a->next = parent ? parent->children : NULL;
+    if (a->next) a->next->prev = a;
+    if (parent) parent->children = a;
+}
+
+static void unlink_child(arena_t* a) {
+    if (a->prev) a->prev->next = a->next;
+    else if (a->parent) a->parent->children = a->next;
+    if (a->next) a->next->prev = a->prev;
+    a->parent = a->next = a->prev = NULL;
+}
+
+static arena_t* arena_new(arena_t* parent, size_t first_block) {
+    arena_t* a = calloc(1, sizeof(arena_t));
+    if (!a) return NULL;
+    a->self.arena = a;
+    a->self.cap = CHUNK_CTX;
+    a->next_block = first_block ? first_block : ARENA_FIRST_BLOCK;
+    link_child(parent, a);
+    return a;
+}
+
+static void arena_release(arena_t* a);
+
+static void root_destroy(void* root) {
+    co_arena_exiting = true;
+    arena_release(root);
+    co_arena_exiting = false;
+    co_arena_root = NULL;
+}
+
+static void root_key_init(void) {
+    pthread_key_create(&co_arena_root_key, root_destroy);
+    if (getenv("COME_MEMSTATS")) mem_talloc_stats_enable();
+}
+
+void mem_talloc_module_init(void) {
+    if (co_arena_root) return;
+    pthread_once(&co_arena_root_once, root_key_init);
+    co_arena_root = arena_new(NULL, 0);
+    if (!co_arena_root) {
+        fprintf(stderr, "arena: failed to create root context\n");
+        return;
+    }
+    pthread_setspecific(co_arena_root_key, co_arena_root);
+}
+
+// The arena a context handle or object belongs to (the root for NULL)
+static arena_t* arena_of(const void* ctx) {
+    if (ctx) return chunk_of(ctx)->arena;
+    if (__builtin_expect(!co_arena_root, 0)) mem_talloc_module_init();
+    return co_arena_root;
+}
+
+static void arena_release(arena_t* a) {
+    if (a->kept && !co_arena_exiting && a != co_arena_root) {
+        // Something in it outlives its context: hand it to the root
+        unlink_child(a);
+        link_child(arena_of(NULL), a);
+        return;
+    }
+    while (a->children) arena_release(a->children);
+    for (dtor_t* d = a->dtors; d; d = d->next) d->fn(d->ptr);
+    block_t* b = a->blocks;
+    while (b) {
+        block_t* next = b->next;
+        free(b);
+        b = next;
+    }
+    unlink_child(a);
+    free(a);
+}
+
+void mem_talloc_module_shutdown(void) {
+    if (co_arena_root) {
+        pthread_setspecific(co_arena_root_key, NULL);
+        root_destroy(co_arena_root);
+    }
+}
+
+void* mem_talloc_new_ctx(void* parent) {
+    arena_t* a = arena_new(arena_of(parent), 0);
+    if (!a) {
+        fprintf(stderr, "arena: failed to create new context\n");
+        return NULL;
+    }
+    return handle_of(a);
+}
+
+// A pool is an arena whose first block has the requested size
+void* mem_talloc_pool_new(void* parent, size_t size) {
+    arena_t* a = arena_new(arena_of(parent), size > ARENA_FIRST_BLOCK ? ALIGN_UP(size) : 0);
+    if (!a) {
+        fprintf(stderr, "arena: failed to create pool\n");
+        return NULL;
+    }
+    return handle_of(a);
+}
+
+
+// Allocation
+
+// Starts a new current block with room for need bytes
+static bool arena_grow(arena_t* a, size_t need) {
+    size_t size = a->next_block;
+    if (size < need) size = ALIGN_UP(need);
+    block_t* b = malloc(sizeof(block_t) + size);
+    if (!b) return false;
+    b->size = size;
+    b->next = a->blocks;
+    a->blocks = b;
+    a->cur = b->data;
+    a->end = b->data + size;
+    a->last = NULL;
+    if (a->next_block < ARENA_MAX_BLOCK) a->next_block *= 2;
+    return true;
+}
+
+static void* arena_alloc(arena_t* a, size_t size) {
+    size_t cap = ALIGN_UP(size ? size : 1);
+    size_t need = sizeof(chunk_t) + cap;
+    if (cap < size || need > (size_t)(a->end - a->cur)) {
+        if (cap < size || !arena_grow(a, need)) return NULL;
+    }
+    chunk_t* c = (chunk_t*)a->cur;
+    a->cur += need;
+    c->arena = a;
+    c->cap = cap;
+    a->last = c;
+    return c + 1;
+}
+
+void* mem_talloc_alloc(void* ctx, size_t size) {
+    return arena_alloc(arena_of(ctx), size);
+}
+
+void* mem_talloc_realloc(void* ctx, void* ptr, size_t size) {
+    if (!ptr) return mem_talloc_alloc(ctx, size);
+    chunk_t* c = chunk_of(ptr);
+    if (c->cap & CHUNK_CTX) {
+        fprintf(stderr, "arena: cannot realloc a context\n");
+        return NULL;
+    }
+    arena_t* a = c->arena;
+    size_t cap = ALIGN_UP(size ? size : 1);
+    size_t old = chunk_cap(c);
+    if (cap <= old) return ptr;
+
+    // The newest allocation grows in place while its block has room
+    if (c == a->last && cap - old <= (size_t)(a->end - a->cur)) {
+        a->cur += cap - old;
+        c->cap += cap - old;
+        return ptr;
+    }
+    void* grown = arena_alloc(a, size);
+    if (!grown) return NULL;
+    memcpy(grown, ptr, old);
+    chunk_t* g = chunk_of(grown);
+    g->cap |= c->cap & CHUNK_DTOR;
+    for (dtor_t* d = a->dtors; d; d = d->next) {
+        if (d->ptr == ptr) d->ptr = grown;
+    }
+    return grown;
+}
+
+static void run_dtor(arena_t* a, void* ptr) {
+    for (dtor_t** p = &a->dtors; *p; p = &(*p)->next) {
+        if ((*p)->ptr == ptr) {
+            dtor_t* d = *p;
+            *p = d->next;
+            d->fn(ptr);
+            return;
+        }
+    }
+}
+
+void mem_talloc_free(void* ptr) {
+    if (!ptr) return;
+    chunk_t* c = chunk_of(ptr);
+    if (c->cap & CHUNK_CTX) {
+        arena_release(c->arena);
+        return;
+    }
+    arena_t* a = c->arena;
+    if (a->exported) {
+        arena_release(a);
+        return;
+    }
+    if (c->cap & CHUNK_REF) return;  // Another owner still uses it
+    if (c->cap & CHUNK_DTOR) {
+        c->cap &= ~(size_t)CHUNK_DTOR;
+        run_dtor(a, ptr);
+    }
+    if (c == a->last) {
+        a->cur = (char*)c;
+        a->last = NULL;
+    }
+}
+
+void mem_talloc_set_destructor(void* ptr, int (*destructor)(void*)) {
+    if (!ptr) return;
+    chunk_t* c = chunk_of(ptr);
+    arena_t* a = c->arena;
+    if (c->cap & CHUNK_DTOR) {
+        for (dtor_t** p = &a->dtors; *p; p = &(*p)->next) {
+            if ((*p)->ptr == ptr) {
+                dtor_t* d = *p;
+                if (destructor) d->fn = destructor;
+                else *p = d->next;
+                break;
+            }
+        }
+        if (!destructor) c->cap &= ~(size_t)CHUNK_DTOR;
+        return;
+    }
+    if (!destructor) return;
+    dtor_t* d = arena_alloc(a, sizeof(dtor_t));
+    if (!d) return;
+    d->ptr = ptr;
+    d->fn = destructor;
+    d->next = a->dtors;
+    a->dtors = d;
+    c->cap |= CHUNK_DTOR;
+}
+
+
+// Ownership
+
+// True if a is b or one of b's ancestors, i.e. a is freed no earlier than b
+static bool outlives(const arena_t* a, const arena_t* b) {
+    for (; b; b = b->parent) {
+        if (a == b) return true;
+    }
+    return false;
+}
+
+// Keeps the arena holding an object alive as long as dst needs it
+static void keep_for(arena_t* src, arena_t* dst) {
+    static bool warned = false;
+    if (outlives(src, dst) || src->kept) return;
+    src->kept = true;
+    if (!warned) {
+        warned = true;
+        fprintf(stderr, "come: arena allocator cannot move an object to a longer-lived context; "
+                        "its context will be kept until exit (chown a whole context, or build with --alloc=talloc)\n");
+    }
+}
+
+void* mem_talloc_steal(void* new_ctx, void* ptr) {
+    if (!ptr) return NULL;
+    arena_t* dst = arena_of(new_ctx);
+    chunk_t* c = chunk_of(ptr);
+    if (c->cap & CHUNK_CTX) {
+        if (outlives(c->arena, dst)) {
+            fprintf(stderr, "arena: cannot move a context under itself\n");
+            return ptr;
+        }
+        unlink_child(c->arena);
+        link_child(dst, c->arena);
+        return ptr;
+    }
+    keep_for(c->arena, dst);
+    return ptr;
+}
+
+void* mem_talloc_reference(void* ctx, void* ptr) {
+    if (!ptr) return NULL;
+    chunk_t* c = chunk_of(ptr);
+    if (!(c->cap & CHUNK_CTX)) c->cap |= CHUNK_REF;
+    keep_for(c->arena, arena_of(ctx));
+    return ptr;
+}
+
+// References are not counted: an object once referenced counts as shared
+// for as long as it lives
+size_t mem_talloc_reference_count(void* ptr) {
+    return ptr && (chunk_of(ptr)->cap & CHUNK_REF) ? 1 : 0;
+}
+
+mem_talloc_scope_t mem_talloc_scope_enter(void** slot, size_t size) {
+    mem_talloc_scope_t scope = { slot, *slot };
+    void* pool = mem_talloc_pool_new(*slot, size);
+    if (pool) *slot = pool;
+    return scope;
+}
+
+void mem_talloc_scope_exit(mem_talloc_scope_t* scope) {
+    if (*scope->slot != scope->outer) {
+        mem_talloc_free(*scope->slot);
+        *scope->slot = scope->outer;
+    }
+}
+
+// Handoff: a Treiber stack of nodes allocated in the handed-off arenas. The
+// consumer detaches the whole stack with one exchange, so there is no ABA
+// problem, and keeps it reversed into push order in box->taken. Only
+// contexts can be handed off, since objects cannot leave their arena.
+typedef struct handoff_node {
+    struct handoff_node* next;
+    void* tree;
+    void* msg;
+} handoff_node_t;
+
+int mem_talloc_handoff_push(mem_talloc_handoff_t* box, void* tree, void* msg) {
+    if (!box || !tree) return -1;
+    chunk_t* c = chunk_of(tree);
+    if (!(c->cap & CHUNK_CTX)) {
+        fprintf(stderr, "arena: only a context can be handed off to another thread\n");
+        return -1;
+    }
+    handoff_node_t* node = arena_alloc(c->arena, sizeof(handoff_node_t));
+    if (!node) return -1;
+    node->tree = tree;
+    node->msg = msg;
+    unlink_child(c->arena); // Detach from the producer's hierarchy
+    node->next = __atomic_load_n((handoff_node_t**)&box->head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n((handoff_node_t**)&box->head, &node->next, node,
+                                        1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return 0;
+}
+
+void* mem_talloc_handoff_take(mem_talloc_handoff_t* box, void* ctx, void** msg) {
+    if (!box) return NULL;
+    handoff_node_t* node = box->taken;
+    if (!node) {
+        handoff_node_t* list = __atomic_exchange_n((handoff_node_t**)&box->head, NULL, __ATOMIC_ACQUIRE);
+        while (list) {
+            handoff_node_t* next = list->next;
+            list->next = node;
+            node = list;
+            list = next;
+        }
+        if (!node) return NULL;
+    }
+    box->taken = node->next;
+    void* tree = node->tree;
+    if (msg) *msg = node->msg;
+    mem_talloc_free(node);
+    link_child(arena_of(ctx), chunk_of(tree)->arena);
+    return tree;
+}
+
+// Export: an object cannot leave its arena, so it travels as a copy in an
+// arena of its own, sized to fit, which import links under the receiver
+void* mem_talloc_export(void* obj) {
+    if (!obj) return NULL;
+    size_t size = chunk_cap(chunk_of(obj));
+    arena_t* a = arena_new(NULL, ALIGN_UP(sizeof(chunk_t) + size));
+    if (!a) return NULL;
+    void* copy = arena_alloc(a, size);
+    if (!copy) {
+        arena_release(a);
+        return NULL;
+    }
+    memcpy(copy, obj, size);
+    a->exported = true;
+    return copy;
+}
+
+void* mem_talloc_import(void* ctx, void* obj) {
+    if (!obj) return NULL;
+    arena_t* a = chunk_of(obj)->arena;
+    if (a->exported) {
+        a->exported = false;
+        link_child(arena_of(ctx), a);
+    }
+    return obj;
+}
+
+
+// Memory statistics are a talloc backend feature: arenas do not track
+// objects, so COME_MEMSTATS only reports that it is unavailable.
+__thread const char* mem_talloc_site = NULL;
+
+void mem_talloc_stats_enable(void) {
+    static bool warned = false;
+    if (!warned) {
+        warned = true;
+        fprintf(stderr, "come: COME_MEMSTATS is not available with --alloc=arena\n");
+    }
+}
+
+mem_talloc_stats_t mem_talloc_stats(void* ctx) {
+    (void)ctx;
+    mem_talloc_stats_t r = { 0, 0, 0 };
+    return r;
+}
+
+char* mem_talloc_stats_report(void* ctx) {
+    static const char text[] = "come memstats: not available with --alloc=arena\n";
+    char* report = mem_talloc_alloc(ctx, sizeof(text));
+    if (report) memcpy(report, text, sizeof(text));
+    return report;
+}
@@ -1,51 +1,567 @@
 #include "mem/talloc.h"
 #include "talloc.h"   // from src/external/talloc/include
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-static void* co_mem_root = NULL;
+// Each thread allocates under its own root, so threads never share a talloc
+// hierarchy. The main thread's root is created eagerly by generated main();
+// other threads get theirs on first use of a NULL context, and it is freed
+// when the thread exits.
+static __thread void* co_mem_root = NULL;
+static pthread_key_t co_mem_root_key;
+static pthread_once_t co_mem_root_once = PTHREAD_ONCE_INIT;
+
+static void stats_attach(void* ctx, const char* kind);
+
+static void root_destroy(void* root) {
+    talloc_free(root);
+}
+
+static void root_key_init(void) {
+    pthread_key_create(&co_mem_root_key, root_destroy);
+    if (getenv("COME_MEMSTATS")) mem_talloc_stats_enable();
+    // talloc reads its fill setting on the first free: get that done before
+    // there are other threads
+    talloc_free(talloc_new(NULL));
+}
 
 void mem_talloc_module_init(void) {
+    if (co_mem_root) return;
+    pthread_once(&co_mem_root_once, root_key_init);
     co_mem_root = talloc_new(NULL);
     if (!co_mem_root) {
         fprintf(stderr, "talloc: failed to create root context\n");
+        return;
     }
+    stats_attach(co_mem_root, "root");
+    pthread_setspecific(co_mem_root_key, co_mem_root);
 }
 
 void mem_talloc_module_shutdown(void) {
-    if (co_mem_root)
+    if (co_mem_root) {
+        pthread_setspecific(co_mem_root_key, NULL);
         talloc_free(co_mem_root);
+    }
     co_mem_root = NULL;
 }
 
+// The calling thread's root, the context used for NULL
+static inline void* root_ctx(void) {
+    if (__builtin_expect(!co_mem_root, 0)) mem_talloc_module_init();
+    return co_mem_root;
+}
+
+
+// Memory statistics (COME_MEMSTATS)
+//
+// When enabled, every context gets a stats record: a talloc child whose
+// address is also the context's talloc name, so the context owning any
+// chunk is found by walking up to the first parent with such a name. A
+// record counts the context's own objects (not those of child contexts),
+// and when it is freed with its context its peak is folded into the
+// per-site table. Allocations are named after mem_talloc_site, which
+// memstats builds set to the Come source line of each statement.
+
+#define STATS_MAGIC "come ctx stats"
+#define SITE_SLOTS 4096
+#define REPORT_SITES 32
+
+typedef struct {
+    char magic[16];
+    size_t bytes;
+    size_t objects;
+    size_t peak;
+    const char* site;  // Where the context was created
+    const char* kind;  // root, ctx or pool
+} ctx_stats_t;
+
+typedef struct {
+    const char* site;
+    size_t allocs;     // Allocations made here, ever
+    size_t bytes;
+    size_t live_bytes; // Filled in while reporting
+    size_t live_objects;
+    size_t ctxs;       // Contexts created here and freed
+    size_t ctx_peak;   // Largest peak among them
+} site_stats_t;
+
+__thread const char* mem_talloc_site = NULL;
+
+static bool co_stats = false;
+static size_t co_stats_live = 0;     // Bytes in all contexts (atomic)
+static size_t co_stats_objects = 0;
+static size_t co_stats_peak = 0;
+static site_stats_t co_sites[SITE_SLOTS];
+static pthread_mutex_t co_sites_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline ctx_stats_t* stats_of(const void* ptr) {
+    const char* name = talloc_get_name(ptr);
+    return name && strncmp(name, STATS_MAGIC, sizeof(STATS_MAGIC)) == 0 ? (ctx_stats_t*)name : NULL;
+}
+
+// The stats of the context that owns ptr
+static ctx_stats_t* stats_owner(const void* ptr) {
+    for (const void* p = ptr; p; p = talloc_parent(p)) {
+        ctx_stats_t* s = stats_of(p);
+        if (s) return s;
+    }
+    return NULL;
+}
+
+static void stats_count(ctx_stats_t* s, long bytes, long objects) {
+    if (!s) return;
+    s->bytes += bytes;
+    s->objects += objects;
+    if (s->bytes > s->peak) s->peak = s->bytes;
+}
+
+static void stats_total(long bytes, long objects) {
+    size_t live = __atomic_add_fetch(&co_stats_live, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&co_stats_objects, objects, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&co_stats_peak, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&co_stats_peak, &peak, live, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// The table entry for a site, created on first use if create (lock held)
+static site_stats_t* site_get(const char* site, bool create) {
+    uint32_t h = 2166136261u;
+    for (const char* c = site; *c; c++) h = (h ^ (unsigned char)*c) * 16777619u;
+    for (uint32_t i = 0; i < SITE_SLOTS; i++) {
+        site_stats_t* e = &co_sites[(h + i) % SITE_SLOTS];
+        if (!e->site) {
+            if (!create) return NULL;
+            e->site = site;
+        }
+        if (e->site == site || strcmp(e->site, site) == 0) return e;
+    }
+    return NULL;
+}
+
+static int stats_retire(void* ptr) {
+    ctx_stats_t* s = ptr;
+    stats_total(-(long)s->bytes, -(long)s->objects);
+    pthread_mutex_lock(&co_sites_lock);
+    site_stats_t* e = site_get(s->site ? s->site : s->kind, true);
+    if (e) {
+        e->ctxs++;
+        if (s->peak > e->ctx_peak) e->ctx_peak = s->peak;
+    }
+    pthread_mutex_unlock(&co_sites_lock);
+    return 0;
+}
+
+static void stats_attach(void* ctx, const char* kind) {
+    if (!co_stats || !ctx) return;
+    ctx_stats_t* s = talloc_zero_size(ctx, sizeof(ctx_stats_t));
+    if (!s) return;
+    memcpy(s->magic, STATS_MAGIC, sizeof(STATS_MAGIC));
+    s->site = mem_talloc_site;
+    s->kind = kind;
+    talloc_set_name_const(ctx, (const char*)s);
+    _talloc_set_destructor(s, stats_retire);
+}
+
+static void stats_alloc(void* ptr, size_t size) {
+    stats_count(stats_owner(ptr), size, 1);
+    stats_total(size, 1);
+    const char* site = mem_talloc_site;
+    if (!site) return;
+    talloc_set_name_const(ptr, site);
+    pthread_mutex_lock(&co_sites_lock);
+    site_stats_t* e = site_get(site, true);
+    if (e) {
+        e->allocs++;
+        e->bytes += size;
+    }
+    pthread_mutex_unlock(&co_sites_lock);
+}
+
+// Bytes and objects in ptr's subtree that belong to ptr's own context,
+// i.e. not inside a child context
+typedef struct {
+    const void* top;
+    size_t bytes;
+    size_t objects;
+} subtree_t;
+
+static void subtree_chunk(const void* ptr, int depth, int max_depth, int is_ref, void* priv) {
+    (void)depth; (void)max_depth;
+    subtree_t* t = priv;
+    if (is_ref) return;
+    for (const void* p = ptr; p != t->top; p = talloc_parent(p)) {
+        if (stats_of(p)) return;
+    }
+    t->bytes += talloc_get_size(ptr);
+    t->objects++;
+}
+
+static subtree_t stats_subtree(const void* ptr) {
+    subtree_t t = { ptr, 0, 0 };
+    talloc_report_depth_cb(ptr, 0, -1, subtree_chunk, &t);
+    return t;
+}
+
+// Steal with the moved objects counted against their new context
+static void* stats_steal(void* new_ctx, void* ptr) {
+    if (!co_stats || !ptr || stats_of(ptr)) return talloc_steal(new_ctx, ptr);
+    ctx_stats_t* from = stats_owner(ptr);
+    subtree_t t = stats_subtree(ptr);
+    void* moved = talloc_steal(new_ctx, ptr);
+    ctx_stats_t* to = stats_owner(ptr);
+    if (moved && from != to) {
+        stats_count(from, -(long)t.bytes, -(long)t.objects);
+        stats_count(to, t.bytes, t.objects);
+    }
+    return moved;
+}
+
+static void stats_exit_report(void);
+
+static void stats_setup(void) {
+    co_stats = true;
+    atexit(stats_exit_report);
+}
+
+void mem_talloc_stats_enable(void) {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, stats_setup);
+}
+
+
+// Allocation
+
 void* mem_talloc_alloc(void* ctx, size_t size) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!ctx) ctx = co_mem_root;
-    return talloc_size(ctx, size);
+    if (!ctx) ctx = root_ctx();
+    void* ptr = talloc_size(ctx, size);
+    if (__builtin_expect(co_stats, 0) && ptr) stats_alloc(ptr, size);
+    return ptr;
 }
 
 void* mem_talloc_realloc(void* ctx, void* ptr, size_t size) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!ctx) ctx = co_mem_root;
-    return talloc_realloc_size(ctx, ptr, size);
+    if (!ctx) ctx = root_ctx();
+    if (__builtin_expect(!co_stats, 1) || !ptr) {
+        void* grown = talloc_realloc_size(ctx, ptr, size);
+        if (co_stats && grown) stats_alloc(grown, size);
+        return grown;
+    }
+    const char* name = talloc_get_name(ptr);
+    size_t old = talloc_get_size(ptr);
+    void* grown = talloc_realloc_size(ctx, ptr, size);
+    if (grown) {
+        talloc_set_name_const(grown, name);
+        stats_count(stats_owner(grown), (long)size - (long)old, 0);
+        stats_total((long)size - (long)old, 0);
+    }
+    return grown;
+}
+
+// A referenced object outlives its parent's free: the parent's link goes and
+// a reference holder becomes the parent
+static void unlink_shared(void* ptr) {
+    ctx_stats_t* from = co_stats ? stats_owner(ptr) : NULL;
+    subtree_t t = co_stats ? stats_subtree(ptr) : (subtree_t){ ptr, 0, 0 };
+    talloc_unlink(talloc_parent(ptr), ptr);
+    ctx_stats_t* to = co_stats ? stats_owner(ptr) : NULL;
+    if (from != to) {
+        stats_count(from, -(long)t.bytes, -(long)t.objects);
+        stats_count(to, t.bytes, t.objects);
+    }
 }
 
 void mem_talloc_free(void* ptr) {
-    if (ptr)
-        talloc_free(ptr);
+    if (!ptr) return;
+    if (__builtin_expect(talloc_reference_count(ptr) != 0, 0)) {
+        unlink_shared(ptr);
+        return;
+    }
+    if (__builtin_expect(co_stats, 0) && !stats_of(ptr)) {
+        ctx_stats_t* s = stats_owner(ptr);
+        subtree_t t = stats_subtree(ptr);
+        if (talloc_free(ptr) == 0) {
+            stats_count(s, -(long)t.bytes, -(long)t.objects);
+            stats_total(-(long)t.bytes, -(long)t.objects);
+        }
+        return;
+    }
+    talloc_free(ptr);
 }
 
 void* mem_talloc_new_ctx(void* parent) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!parent) parent = co_mem_root;  // default parent is global root
+    if (!parent) parent = root_ctx();  // default parent is the thread's root
     void* ctx = talloc_new(parent);
     if (!ctx) {
         fprintf(stderr, "talloc: failed to create new context\n");
     }
+    stats_attach(ctx, "ctx");
     return ctx;
 }
 
 void* mem_talloc_steal(void* new_ctx, void* ptr) {
-    if (!co_mem_root) mem_talloc_module_init();
-    if (!new_ctx) new_ctx = co_mem_root;
-    return talloc_steal(new_ctx, ptr);
+    if (!new_ctx) new_ctx = root_ctx();
+    return stats_steal(new_ctx, ptr);
+}
+
+void* mem_talloc_reference(void* ctx, void* ptr) {
+    if (!ctx) ctx = root_ctx();
+    return talloc_reference(ctx, ptr);
+}
+
+size_t mem_talloc_reference_count(void* ptr) {
+    return ptr ? talloc_reference_count(ptr) : 0;
+}
+
+void mem_talloc_set_destructor(void* ptr, int (*destructor)(void*)) {
+    if (ptr)
+        _talloc_set_destructor(ptr, destructor);
+}
+
+// Pools this thread has created and not yet freed, for mem_talloc_export():
+// a pool carves its members out of [pool, pool + size). Past POOL_SLOTS the
+// rest are only counted, and every object is treated as pool memory.
+#define POOL_SLOTS 32
+
+typedef struct {
+    const char* start;
+    const char* end;
+} pool_range_t;
+
+static __thread pool_range_t co_pools[POOL_SLOTS];
+static __thread int co_pool_count = 0;
+static __thread int co_pool_untracked = 0;
+
+static int pool_forget(void* pool) {
+    for (int i = 0; i < co_pool_count; i++) {
+        if (co_pools[i].start == pool) {
+            co_pools[i] = co_pools[--co_pool_count];
+            return 0;
+        }
+    }
+    if (co_pool_untracked > 0) co_pool_untracked--;
+    return 0;
+}
+
+// The tracked pool ptr was carved out of, or NULL
+static const void* pool_owner(const void* ptr) {
+    for (int i = 0; i < co_pool_count; i++) {
+        if ((const char*)ptr > co_pools[i].start && (const char*)ptr < co_pools[i].end) return co_pools[i].start;
+    }
+    return NULL;
+}
+
+static bool in_pool(const void* ptr) {
+    return co_pool_untracked || pool_owner(ptr);
+}
+
+void* mem_talloc_pool_new(void* parent, size_t size) {
+    if (!parent) parent = root_ctx();
+    void* pool = talloc_pool(parent, size);
+    if (!pool) {
+        fprintf(stderr, "talloc: failed to create pool\n");
+        return NULL;
+    }
+    if (co_pool_count < POOL_SLOTS) {
+        co_pools[co_pool_count++] = (pool_range_t){ pool, (const char*)pool + size };
+    } else {
+        co_pool_untracked++;
+    }
+    _talloc_set_destructor(pool, pool_forget);
+    stats_attach(pool, "pool");
+    return pool;
+}
+
+mem_talloc_scope_t mem_talloc_scope_enter(void** slot, size_t size) {
+    mem_talloc_scope_t scope = { slot, *slot };
+    void* pool = mem_talloc_pool_new(*slot, size);
+    if (pool) *slot = pool;
+    return scope;
+}
+
+void mem_talloc_scope_exit(mem_talloc_scope_t* scope) {
+    if (*scope->slot != scope->outer) {
+        talloc_free(*scope->slot);
+        *scope->slot = scope->outer;
+    }
+}
+
+// Handoff: a Treiber stack of nodes allocated inside the trees themselves.
+// The consumer detaches the whole stack with one exchange, so there is no
+// ABA problem, and keeps it reversed into push order in box->taken.
+typedef struct handoff_node {
+    struct handoff_node* next;
+    void* tree;
+    void* msg;
+} handoff_node_t;
+
+int mem_talloc_handoff_push(mem_talloc_handoff_t* box, void* tree, void* msg) {
+    if (!box || !tree) return -1;
+    // Past POOL_SLOTS pools are not tracked, so only tracked ones are caught
+    if (pool_owner(tree)) {
+        fprintf(stderr, "talloc: pool memory cannot be handed off to another thread\n");
+        return -1;
+    }
+    stats_steal(NULL, tree); // Detach from the producer's hierarchy
+    handoff_node_t* node = talloc_size(tree, sizeof(handoff_node_t));
+    if (!node) return -1;
+    node->tree = tree;
+    node->msg = msg;
+    node->next = __atomic_load_n((handoff_node_t**)&box->head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n((handoff_node_t**)&box->head, &node->next, node,
+                                        1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return 0;
+}
+
+void* mem_talloc_handoff_take(mem_talloc_handoff_t* box, void* ctx, void** msg) {
+    if (!box) return NULL;
+    handoff_node_t* node = box->taken;
+    if (!node) {
+        handoff_node_t* list = __atomic_exchange_n((handoff_node_t**)&box->head, NULL, __ATOMIC_ACQUIRE);
+        while (list) {
+            handoff_node_t* next = list->next;
+            list->next = node;
+            node = list;
+            list = next;
+        }
+        if (!node) return NULL;
+    }
+    box->taken = node->next;
+    void* tree = node->tree;
+    if (msg) *msg = node->msg;
+    talloc_free(node);
+    stats_steal(ctx ? ctx : root_ctx(), tree);
+    return tree;
+}
+
+// Export/import: pool memory stays tied to its pool's thread (freeing it
+// updates the pool's count), so it leaves as a copy; anything else is
+// detached as it is, children included.
+void* mem_talloc_export(void* obj) {
+    if (!obj) return NULL;
+    if (!in_pool(obj) && !talloc_reference_count(obj)) return stats_steal(NULL, obj);
+    size_t size = talloc_get_size(obj);
+    void* copy = talloc_size(NULL, size);
+    if (!copy) return NULL;
+    memcpy(copy, obj, size);
+    if (__builtin_expect(co_stats, 0)) stats_total(size, 1);
+    return copy;
+}
+
+void* mem_talloc_import(void* ctx, void* obj) {
+    if (!obj) return NULL;
+    return stats_steal(ctx ? ctx : root_ctx(), obj);
+}
+
+
+// Reporting
+
+mem_talloc_stats_t mem_talloc_stats(void* ctx) {
+    mem_talloc_stats_t r = { 0, 0, 0 };
+    if (!co_stats) return r;
+    if (!ctx) {
+        r.bytes = __atomic_load_n(&co_stats_live, __ATOMIC_RELAXED);
+        r.objects = __atomic_load_n(&co_stats_objects, __ATOMIC_RELAXED);
+        r.peak = __atomic_load_n(&co_stats_peak, __ATOMIC_RELAXED);
+        return r;
+    }
+    ctx_stats_t* s = stats_owner(ctx);
+    if (s) {
+        r.bytes = s->bytes;
+        r.objects = s->objects;
+        r.peak = s->peak;
+    }
+    return r;
+}
+
+// "dir/file.co:12" -> "file.co:12"
+static const char* site_short(const char* site) {
+    const char* colon = strrchr(site, ':');
+    const char* p = colon ? colon : site + strlen(site);
+    while (p > site && p[-1] != '/') p--;
+    return p;
+}
+
+static void report_chunk(const void* ptr, int depth, int max_depth, int is_ref, void* priv) {
+    (void)depth; (void)max_depth;
+    FILE* out = priv;
+    if (is_ref) return;
+    ctx_stats_t* s = stats_of(ptr);
+    if (s) {
+        int level = 0;
+        for (const void* p = talloc_parent(ptr); p; p = talloc_parent(p)) {
+            if (stats_of(p)) level++;
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "%*s%s%s%s", level * 2, "", s->kind,
+                 s->site ? " " : "", s->site ? site_short(s->site) : "");
+        fprintf(out, "  %-36s %10zu B %8zu %10zu B\n", label, s->bytes, s->objects, s->peak);
+        return;
+    }
+    site_stats_t* e = site_get(talloc_get_name(ptr), false);
+    if (e && e->allocs) {
+        e->live_bytes += talloc_get_size(ptr);
+        e->live_objects++;
+    }
+}
+
+static int site_cmp(const void* a, const void* b) {
+    const site_stats_t* x = *(site_stats_t* const*)a;
+    const site_stats_t* y = *(site_stats_t* const*)b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+// A copy of text allocated (and counted) like any other object
+static char* report_copy(void* ctx, const char* text, size_t len) {
+    char* copy = mem_talloc_alloc(ctx, len + 1);
+    if (!copy) return NULL;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+char* mem_talloc_stats_report(void* ctx) {
+    static const char off[] = "come memstats: off (set COME_MEMSTATS=1)\n";
+    if (!co_stats) return report_copy(ctx, off, sizeof(off) - 1);
+    char* text = NULL;
+    size_t len = 0;
+    FILE* out = open_memstream(&text, &len);
+    if (!out) return NULL;
+
+    mem_talloc_stats_t total = mem_talloc_stats(NULL);
+    fprintf(out, "come memstats: %zu B live in %zu objects, peak %zu B\n", total.bytes, total.objects, total.peak);
+    fprintf(out, "contexts (this thread)                  own bytes  objects         peak\n");
+
+    pthread_mutex_lock(&co_sites_lock);
+    for (int i = 0; i < SITE_SLOTS; i++) co_sites[i].live_bytes = co_sites[i].live_objects = 0;
+    if (co_mem_root) talloc_report_depth_cb(co_mem_root, 0, -1, report_chunk, out);
+
+    site_stats_t* top[SITE_SLOTS];
+    int n = 0;
+    for (int i = 0; i < SITE_SLOTS; i++) {
+        if (co_sites[i].site) top[n++] = &co_sites[i];
+    }
+    qsort(top, n, sizeof(top[0]), site_cmp);
+    if (n) fprintf(out, "sites                        live bytes  objects  total bytes   allocs  contexts  ctx peak\n");
+    for (int i = 0; i < n && i < REPORT_SITES; i++) {
+        site_stats_t* e = top[i];
+        fprintf(out, "  %-24s %10zu B %8zu %10zu B %8zu %9zu %8zu B\n", site_short(e->site),
+                e->live_bytes, e->live_objects, e->bytes, e->allocs, e->ctxs, e->ctx_peak);
+    }
+    pthread_mutex_unlock(&co_sites_lock);
+
+    fclose(out);
+    char* report = report_copy(ctx, text, len);
+    free(text);
+    return report;
+}
+
+static void stats_exit_report(void) {
+    char* report = mem_talloc_stats_report(NULL);
+    if (report) fputs(report, stderr);
+    mem_talloc_free(report);
 }
@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// async/await: the executor behind generated step functions, and awaitable
+// I/O on net.tcp. A task runs by calling its step; one that returns
+// COME_ASYNC_PENDING has parked itself with whatever will wake it (an
+// awaited task, a connection's reader, a listener). Wakeups go on a FIFO
+// ready queue, which is drained by whoever is outermost: a loop handler or
+// the code that detached a task. Steps further in only queue, so a task
+// never runs inside another one's step except for an awaited task's first.
+
+static __thread come_async_t* ready_head = NULL;
+static __thread come_async_t* ready_tail = NULL;
+static __thread int running = 0;               // Steps on the C stack
+static __thread void* detached_root = NULL;    // Detached tasks' contexts
+
+static void die_oom(void) {
+    fprintf(stderr, "come: out of memory starting an async task\n");
+    abort();
+}
+
+static void drain(void);
+
+static void wake(come_async_t* t) {
+    t->next = NULL;
+    if (ready_tail) ready_tail->next = t;
+    else ready_head = t;
+    ready_tail = t;
+    drain();
+}
+
+static void finish(come_async_t* t) {
+    t->done = 1;
+    if (t->waiter) {
+        come_async_t* waiter = t->waiter;
+        t->waiter = NULL;
+        wake(waiter);
+    } else if (t->detached) {
+        mem_talloc_free(t->ctx);
+    }
+}
+
+static int run(come_async_t* t) {
+    running++;
+    int state = t->step(t);
+    running--;
+    if (state == COME_ASYNC_DONE) finish(t);
+    return state;
+}
+
+static void drain(void) {
+    if (running) return;
+    while (ready_head) {
+        come_async_t* t = ready_head;
+        ready_head = t->next;
+        if (!ready_head) ready_tail = NULL;
+        t->next = NULL;
+        run(t);
+    }
+}
+
+void* come_async_new(void* ctx, size_t size, come_async_step_t step) {
+    void* task_ctx = mem_talloc_new_ctx(ctx);
+    come_async_t* t = task_ctx ? mem_talloc_alloc(task_ctx, size) : NULL;
+    if (!t) die_oom();
+    memset(t, 0, size);
+    t->step = step;
+    t->ctx = task_ctx;
+    return t;
+}
+
+void come_async_detach(come_async_t* task) {
+    if (!detached_root) {
+        detached_root = mem_talloc_new_ctx(NULL);
+        if (!detached_root) die_oom();
+    }
+    // Out of the creator's context, which may be a handler's that goes with its connection
+    mem_talloc_steal(detached_root, task->ctx);
+    task->detached = 1;
+    run(task);
+    drain();
+}
+
+int come_async_await(come_async_t* self, come_async_t* child) {
+    self->awaiting = child;
+    if (run(child) == COME_ASYNC_DONE) return 0;
+    child->waiter = self;
+    return 1;
+}
+
+void come_async_release(come_async_t* self) {
+    come_async_t* child = self->awaiting;
+    if (!child) return;
+    self->awaiting = NULL;
+    // An object result keeps its whole context: the arena allocator cannot
+    // move single objects
+    if (child->result) mem_talloc_steal(self->ctx, child->ctx);
+    else mem_talloc_free(child->ctx);
+}
+
+// Connections: a reader on READABLE, CONNECT and HUP, shared through the
+// READABLE environment; the others hold a pointer to it
+
+typedef struct {
+    come_net_tcp_conn_t* conn;
+    come_async_t* reader;     // Task in read()
+    come_async_t* connector;  // Task in connect()
+    char* buf;                // Arrived with nobody reading, under the connection
+    size_t len, cap;
+    int connected;
+    int hup;
+} stream_t;
+
+static come_byte_array_t* bytes_new(void* ctx, const void* bytes, size_t len) {
+    come_byte_array_t* a = mem_talloc_alloc(ctx, sizeof(come_byte_array_t) + len);
+    if (!a) return NULL;
+    a->size = a->count = (uint32_t)len;
+    memcpy(a->items, bytes, len);
+    return a;
+}
+
+static void on_readable(come_byte_array_t* data, void* env, void* ctx) {
+    (void)ctx;
+    stream_t* s = env;
+    if (s->reader) {
+        come_async_t* t = s->reader;
+        s->reader = NULL;
+        t->value = bytes_new(t->ctx, data->items, data->count);
+        wake(t);
+        return;
+    }
+    if (s->len + data->count > s->cap) {
+        size_t cap = s->cap ? s->cap : 4096;
+        while (cap < s->len + data->count) cap *= 2;
+        char* buf = mem_talloc_realloc(s->conn, s->buf, cap);
+        if (!buf) {
+            come_net_tcp_close(s->conn);
+            return;
+        }
+        s->buf = buf;
+        s->cap = cap;
+    }
+    memcpy(s->buf + s->len, data->items, data->count);
+    s->len += data->count;
+}
+
+static void on_connect(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    stream_t* s = *(stream_t**)env;
+    s->connected = 1;
+    if (s->connector) {
+        come_async_t* t = s->connector;
+        s->connector = NULL;
+        t->value = s->conn;
+        wake(t);
+    }
+}
+
+static void on_hup(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    stream_t* s = *(stream_t**)env;
+    s->hup = 1;
+    if (s->reader) {
+        come_async_t* t = s->reader;
+        s->reader = NULL;
+        t->value = NULL;
+        wake(t);
+    }
+    if (s->connector) {
+        come_async_t* t = s->connector;
+        s->connector = NULL;
+        t->value = NULL;
+        wake(t);
+    }
+}
+
+static stream_t* stream_of(come_net_tcp_conn_t* conn) {
+    stream_t* s = come_net_tcp_env(conn, COME_NET_TCP_READABLE, on_readable);
+    if (s) return s;
+    s = come_net_tcp_on(conn, COME_NET_TCP_READABLE, on_readable, sizeof(stream_t));
+    stream_t** connect = come_net_tcp_on(conn, COME_NET_TCP_CONNECT, on_connect, sizeof(stream_t*));
+    stream_t** hup = come_net_tcp_on(conn, COME_NET_TCP_HUP, on_hup, sizeof(stream_t*));
+    if (!s || !connect || !hup) die_oom();
+    s->conn = conn;
+    *connect = s;
+    *hup = s;
+    return s;
+}
+
+int come_async_read(come_async_t* self, come_net_tcp_conn_t* conn) {
+    self->value = NULL;
+    stream_t* s = conn ? stream_of(conn) : NULL;
+    if (!s) return 0;
+    if (s->len > 0) {
+        self->value = bytes_new(self->ctx, s->buf, s->len);
+        s->len = 0;
+        return 0;
+    }
+    if (s->hup || s->reader || come_net_tcp_closing(conn)) return 0;
+    s->reader = self;
+    return 1;
+}
+
+int come_async_connect(come_async_t* self, come_net_tcp_conn_t* conn) {
+    self->value = NULL;
+    stream_t* s = conn ? stream_of(conn) : NULL;
+    if (!s || s->hup) return 0;
+    if (s->connected) {
+        self->value = conn;
+        return 0;
+    }
+    s->connector = self;
+    return 1;
+}
+
+// Listeners: connections are accepted as they come and handed to waiting
+// tasks in order, or queued until a task asks
+
+typedef struct {
+    come_net_tcp_listener_t* listener;
+    come_async_t* head;       // Tasks in accept(), linked through next
+    come_async_t* tail;
+    come_net_tcp_conn_t** queue;
+    int count, cap;
+} acceptor_t;
+
+static void on_accept(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    acceptor_t* a = env;
+    come_net_tcp_conn_t* conn = come_net_tcp_accept(a->listener);
+    if (!conn) return;
+    // Reading starts now: bytes may come before the first read()
+    stream_of(conn);
+    if (a->head) {
+        come_async_t* t = a->head;
+        a->head = t->next;
+        if (!a->head) a->tail = NULL;
+        t->value = conn;
+        wake(t);
+        return;
+    }
+    if (a->count == a->cap) {
+        int cap = a->cap ? a->cap * 2 : 16;
+        come_net_tcp_conn_t** queue = mem_talloc_realloc(a->listener, a->queue, cap * sizeof(*queue));
+        if (!queue) {
+            come_net_tcp_close(conn);
+            return;
+        }
+        a->queue = queue;
+        a->cap = cap;
+    }
+    a->queue[a->count++] = conn;
+}
+
+int come_async_accept(come_async_t* self, come_net_tcp_listener_t* listener) {
+    self->value = NULL;
+    if (!listener) return 0;
+    acceptor_t* a = come_net_tcp_env(listener, COME_NET_TCP_ACCEPT, on_accept);
+    if (!a) {
+        a = come_net_tcp_on(listener, COME_NET_TCP_ACCEPT, on_accept, sizeof(acceptor_t));
+        if (!a) die_oom();
+        a->listener = listener;
+    }
+    if (a->count > 0) {
+        self->value = a->queue[0];
+        memmove(a->queue, a->queue + 1, --a->count * sizeof(*a->queue));
+        return 0;
+    }
+    self->next = NULL;
+    if (a->tail) a->tail->next = self;
+    else a->head = self;
+    a->tail = self;
+    return 1;
+}
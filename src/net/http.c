@@ -0,0 +1,889 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// net.http: HTTP/1.1 on a net.tcp connection. Reads are appended to the
+// session's connection buffer and run through a line-oriented state machine;
+// a line is only taken once its LF is in, so a message may arrive in any
+// number of pieces. The buffer is compacted and grown only when bytes are
+// appended, which happens in a new READABLE event, after the loop flushed
+// whatever handlers queued by reference to it.
+
+enum {
+    P_LINE,        // Start line; blank lines before it are skipped
+    P_HEADERS,
+    P_BODY,        // Content-Length bytes
+    P_CHUNK_SIZE,
+    P_CHUNK_DATA,
+    P_CHUNK_END,   // CRLF after a chunk's data
+    P_TRAILERS,
+    P_BODY_EOF,    // Response without a length: everything until close
+    P_WAIT,        // Request complete, its response not sent yet
+    P_FAILED
+};
+
+enum { OUT_IDLE, OUT_STREAMING };
+
+#define BUFFER_INITIAL 4096
+#define MAX_CHUNK_LINE 1024
+
+typedef struct {
+    come_string_view_t name;
+    come_string_view_t value;
+} header_t;
+
+struct come_net_http_message {
+    come_net_http_session_t* session;
+    come_net_http_handler_t on[COME_NET_HTTP_EVENTS];
+    void* env[COME_NET_HTTP_EVENTS];
+    // Incoming: views into the session's buffer (parent NULL when unset)
+    come_string_view_t method, path, version;
+    int status;
+    header_t* headers;
+    int header_count, header_cap;
+    come_string_t* body;                   // Collected without a DATA_READY handler
+    void* body_ctx;                        // Holds body, to hand over whole
+    come_string_view_t piece;              // DATA_READY's data
+    // Outgoing
+    come_string_t* out_method;
+    come_string_t* out_path;
+    int out_status;
+    come_string_t* out_headers;            // "Name: value\r\n" lines
+    int out_state;
+    int want_data_done;                    // write() waits for room to fire DATA_DONE
+    int in_data_done;
+};
+
+struct come_net_http_session {
+    come_net_http_message_t req, resp;
+    void* ctx;                             // The session's own context (attach moves it)
+    come_net_tcp_conn_t* conn;
+    int client;                            // Sent a request: parses responses
+    come_string_t* in;                     // Connection buffer, NUL-terminated
+    size_t pos;                            // Parse position in in
+    size_t head_start, head_end;           // The current message's start line and headers
+    int state;
+    size_t remaining;                      // Body or chunk bytes still to come
+    long content_length;                   // -1 if none
+    int chunked;
+    int keep_alive;
+    int answered;                          // The current request's response is sent
+    int parsing;
+    void* scratch;                         // Context for handlers, from the loop
+    unsigned char* heads;                  // Client: per request awaiting its response, whether it was HEAD
+    size_t heads_first, heads_count, heads_cap;
+};
+
+static come_net_http_message_t* incoming(come_net_http_session_t* s) {
+    return s->client ? &s->resp : &s->req;
+}
+
+// Handlers
+
+static void* handler_ctx(come_net_http_session_t* s) {
+    // Outside the loop's handlers, the session's own: what handlers
+    // allocate may be kept past them
+    return s->scratch ? s->scratch : s->ctx;
+}
+
+static void dispatch(come_net_http_message_t* m, int event, come_string_t* data) {
+    if (m->on[event]) m->on[event](data, m->env[event], handler_ctx(m->session));
+}
+
+// A body lives in a context of its own, which moves as a whole where an
+// object could not (the arena allocator)
+static void* body_ctx(come_net_http_message_t* m) {
+    if (!m->body_ctx) m->body_ctx = mem_talloc_new_ctx(m->session);
+    return m->body_ctx;
+}
+
+static int closed(come_net_http_session_t* s) {
+    return s->state == P_FAILED || (s->conn && come_net_tcp_closing(s->conn));
+}
+
+// Views
+
+static void view_set(come_net_http_session_t* s, come_string_view_t* v, const char* p, size_t len) {
+    v->size = COME_STRING_VIEW_TAG;
+    v->count = (uint32_t)len;
+    v->offset = (uint32_t)(p - s->in->data);
+    v->flags = COME_STRING_VIEW_EMBEDDED;
+    v->parent = s->in;
+    v->cstr = NULL;
+}
+
+static come_string_t* view_get(come_string_view_t* v) {
+    return v->parent ? (come_string_t*)v : NULL;
+}
+
+static void view_move(come_string_view_t* v, const come_string_t* in, size_t shift) {
+    if (!v->parent) return;
+    v->parent = in;
+    v->offset -= (uint32_t)shift;
+    v->cstr = NULL;
+}
+
+// The incoming message's views after its bytes moved down by shift
+static void views_move(come_net_http_session_t* s, size_t shift) {
+    come_net_http_message_t* m = incoming(s);
+    view_move(&m->method, s->in, shift);
+    view_move(&m->path, s->in, shift);
+    view_move(&m->version, s->in, shift);
+    view_move(&m->piece, s->in, shift);
+    for (int i = 0; i < m->header_count; i++) {
+        view_move(&m->headers[i].name, s->in, shift);
+        view_move(&m->headers[i].value, s->in, shift);
+    }
+}
+
+// Buffers
+
+// A string of its own under the session, with room for cap bytes
+static come_string_t* buffer_new(void* ctx, size_t cap) {
+    come_string_t* b = mem_talloc_alloc(ctx, sizeof(come_string_t) + cap + 1);
+    if (!b) return NULL;
+    b->size = (uint32_t)(sizeof(come_string_t) + cap + 1);
+    b->count = 0;
+    b->data[0] = '\0';
+    return b;
+}
+
+static int buffer_append(void* ctx, come_string_t** b, const char* bytes, size_t len) {
+    come_string_t* a = *b;
+    if (!ctx) return -1;
+    if (!a && !(a = *b = buffer_new(ctx, len > 256 ? len : 256))) return -1;
+    size_t need = sizeof(come_string_t) + a->count + len + 1;
+    if (need > a->size) {
+        size_t size = a->size * 2;
+        while (size < need) size *= 2;
+        if (size > UINT32_MAX) return -1;
+        a = mem_talloc_realloc(ctx, a, size);
+        if (!a) return -1;
+        a->size = (uint32_t)size;
+        *b = a;
+    }
+    memcpy(a->data + a->count, bytes, len);
+    a->count += (uint32_t)len;
+    a->data[a->count] = '\0';
+    return 0;
+}
+
+// Makes room for len more bytes in the connection buffer, keeping only the
+// current message's head and the bytes not parsed yet
+static int buffer_reserve(come_net_http_session_t* s, size_t len) {
+    come_string_t* in = s->in;
+    size_t head = s->head_end - s->head_start;
+    size_t tail = in->count - s->pos;
+    if (s->head_start > 0 || s->pos > s->head_end) {
+        memmove(in->data, in->data + s->head_start, head);
+        memmove(in->data + head, in->data + s->pos, tail);
+        views_move(s, s->head_start);
+        s->pos = s->head_end = head;
+        s->head_start = 0;
+        in->count = (uint32_t)(head + tail);
+    }
+    size_t need = sizeof(come_string_t) + in->count + len + 1;
+    if (need > in->size) {
+        size_t size = in->size * 2;
+        while (size < need) size *= 2;
+        if (size > UINT32_MAX) return -1;
+        in = mem_talloc_realloc(s, in, size);
+        if (!in) return -1;
+        in->size = (uint32_t)size;
+        s->in = in;
+        views_move(s, 0);
+    }
+    return 0;
+}
+
+// Errors
+
+static const char* reason(int status) {
+    switch (status) {
+        case 100: return "Continue";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 308: return "Permanent Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 411: return "Length Required";
+        case 413: return "Content Too Large";
+        case 414: return "URI Too Long";
+        case 415: return "Unsupported Media Type";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 505: return "HTTP Version Not Supported";
+        default: return "";
+    }
+}
+
+// A malformed stream: a server answers with status and closes, a client
+// just closes
+static void fail(come_net_http_session_t* s, int status) {
+    if (s->state == P_FAILED) return;
+    s->state = P_FAILED;
+    if (!s->conn) return;
+    if (!s->client) {
+        char* block = mem_talloc_alloc(s->conn, 128);
+        if (block) {
+            int n = snprintf(block, 128, "HTTP/1.1 %d %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+                             status, reason(status));
+            come_net_tcp_write_owned(s->conn, block, (size_t)n);
+        }
+    }
+    come_net_tcp_close(s->conn);
+}
+
+// Parsing
+
+static void next_message(come_net_http_session_t* s) {
+    come_net_http_message_t* m = incoming(s);
+    memset(&m->method, 0, sizeof(m->method));
+    memset(&m->path, 0, sizeof(m->path));
+    memset(&m->version, 0, sizeof(m->version));
+    memset(&m->piece, 0, sizeof(m->piece));
+    m->status = 0;
+    m->header_count = 0;
+    // A response may have queued the body by reference: it goes with the
+    // handler context, after the loop has flushed
+    if (m->body_ctx) {
+        mem_talloc_steal(handler_ctx(s), m->body_ctx);
+        m->body_ctx = NULL;
+        m->body = NULL;
+    }
+    s->state = P_LINE;
+    s->head_start = s->head_end = s->pos;
+    s->remaining = 0;
+    s->content_length = -1;
+    s->chunked = 0;
+    s->keep_alive = 1;
+    s->answered = 0;
+}
+
+static void message_done(come_net_http_session_t* s) {
+    come_net_http_message_t* m = incoming(s);
+    // Without a connection (feed()) there is nothing to answer with, so
+    // requests are just parsed one after another
+    if (s->client || !s->conn) {
+        dispatch(m, COME_NET_HTTP_READY, NULL);
+        if (!closed(s)) next_message(s);
+        return;
+    }
+    // The next pipelined request waits for the response to this one
+    s->state = P_WAIT;
+    dispatch(m, COME_NET_HTTP_READY, NULL);
+    if (s->state == P_WAIT && s->answered) next_message(s);
+}
+
+static int deliver(come_net_http_session_t* s, come_net_http_message_t* m, const char* p, size_t n) {
+    if (m->on[COME_NET_HTTP_DATA_READY]) {
+        view_set(s, &m->piece, p, n);
+        dispatch(m, COME_NET_HTTP_DATA_READY, (come_string_t*)&m->piece);
+        memset(&m->piece, 0, sizeof(m->piece));
+        return 0;
+    }
+    if ((m->body ? m->body->count : 0) + n > COME_NET_HTTP_MAX_BODY) {
+        fail(s, 413);
+        return -1;
+    }
+    if (buffer_append(body_ctx(m), &m->body, p, n) < 0) {
+        fail(s, 500);
+        return -1;
+    }
+    return 0;
+}
+
+// "METHOD target HTTP/1.x" or "HTTP/1.x status reason"
+static void start_line(come_net_http_session_t* s, come_net_http_message_t* m, char* line, size_t len) {
+    if (len == 0) {
+        s->head_start = s->head_end = s->pos;
+        return;
+    }
+    char* end = line + len;
+    char* sp1 = memchr(line, ' ', len);
+    if (!sp1 || sp1 == line) {
+        fail(s, 400);
+        return;
+    }
+    *sp1 = '\0';
+    if (s->client) {
+        char* code = sp1 + 1;
+        char* sp2 = memchr(code, ' ', (size_t)(end - code));
+        if (!sp2) sp2 = end;
+        if (sp2 - code != 3 || code[0] < '1' || code[0] > '5' || code[1] < '0' || code[1] > '9' ||
+            code[2] < '0' || code[2] > '9') {
+            fail(s, 400);
+            return;
+        }
+        m->status = (code[0] - '0') * 100 + (code[1] - '0') * 10 + (code[2] - '0');
+        view_set(s, &m->version, line, (size_t)(sp1 - line));
+    } else {
+        char* target = sp1 + 1;
+        char* sp2 = memchr(target, ' ', (size_t)(end - target));
+        if (!sp2 || sp2 == target) {
+            fail(s, 400);
+            return;
+        }
+        *sp2 = '\0';
+        view_set(s, &m->method, line, (size_t)(sp1 - line));
+        view_set(s, &m->path, target, (size_t)(sp2 - target));
+        view_set(s, &m->version, sp2 + 1, (size_t)(end - sp2 - 1));
+    }
+    const char* version = come_string_data((come_string_t*)&m->version);
+    if (m->version.count != 8 || memcmp(version, "HTTP/1.", 7) != 0 || (version[7] != '0' && version[7] != '1')) {
+        fail(s, 505);
+        return;
+    }
+    // HTTP/1.0 closes after each message unless asked otherwise
+    s->keep_alive = version[7] == '1';
+    s->head_end = s->pos;
+    s->state = P_HEADERS;
+    dispatch(m, COME_NET_HTTP_LINE_READY, NULL);
+}
+
+// Whether a comma-separated header value lists token
+static int has_token(const char* value, const char* token) {
+    size_t n = strlen(token);
+    for (const char* p = value; *p;) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        const char* start = p;
+        while (*p && *p != ',') p++;
+        const char* end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+        if ((size_t)(end - start) == n && strncasecmp(start, token, n) == 0) return 1;
+    }
+    return 0;
+}
+
+// Checks a Transfer-Encoding list: 0 if it is chunked alone, 400 if
+// chunked is not the final coding (the body length is unknown), 501 if
+// other codings come before it (none are decoded)
+static int transfer_codings(const char* value) {
+    int count = 0, last_chunked = 0;
+    for (const char* p = value; *p;) {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (!*p) break;
+        const char* start = p;
+        while (*p && *p != ',') p++;
+        const char* end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+        count++;
+        last_chunked = end - start == 7 && strncasecmp(start, "chunked", 7) == 0;
+    }
+    if (!last_chunked) return 400;
+    return count == 1 ? 0 : 501;
+}
+
+// Status 1xx, 204 and 304 responses have no body
+static int bodiless(int status) {
+    return status < 200 || status == 204 || status == 304;
+}
+
+// Client: requests go out in order and their responses come back in it, so
+// a queue of flags tells which response answers a HEAD
+static int expect_response(come_net_http_session_t* s, int head) {
+    if (s->heads_first + s->heads_count == s->heads_cap) {
+        if (s->heads_first > 0) {
+            memmove(s->heads, s->heads + s->heads_first, s->heads_count);
+            s->heads_first = 0;
+        } else {
+            size_t cap = s->heads_cap ? s->heads_cap * 2 : 16;
+            unsigned char* heads = mem_talloc_realloc(s, s->heads, cap);
+            if (!heads) return -1;
+            s->heads = heads;
+            s->heads_cap = cap;
+        }
+    }
+    s->heads[s->heads_first + s->heads_count++] = (unsigned char)head;
+    return 0;
+}
+
+static int answers_head(come_net_http_session_t* s) {
+    if (s->heads_count == 0) return 0;
+    s->heads_count--;
+    return s->heads[s->heads_first++];
+}
+
+// The body's framing, in the order of RFC 7230 3.3.3
+static void headers_done(come_net_http_session_t* s, come_net_http_message_t* m) {
+    s->head_end = s->pos;
+    // A final response uses up its request; an interim one does not
+    int head = s->client && m->status >= 200 && answers_head(s);
+    dispatch(m, COME_NET_HTTP_HEADER_READY, NULL);
+    if (closed(s)) return;
+    if (s->client && (head || bodiless(m->status))) {
+        // Whatever Content-Length or Transfer-Encoding say
+        message_done(s);
+    } else if (s->chunked) {
+        // Both framings at once is how requests get smuggled past proxies
+        if (s->content_length >= 0) {
+            fail(s, 400);
+            return;
+        }
+        s->state = P_CHUNK_SIZE;
+    } else if (s->content_length > 0) {
+        s->remaining = (size_t)s->content_length;
+        s->state = P_BODY;
+    } else if (s->client && s->content_length < 0) {
+        s->state = P_BODY_EOF;
+    } else {
+        message_done(s);
+    }
+}
+
+static void header_line(come_net_http_session_t* s, come_net_http_message_t* m, char* line, size_t len) {
+    if (len == 0) {
+        headers_done(s, m);
+        return;
+    }
+    char* colon = memchr(line, ':', len);
+    // No name, whitespace in the name, or an obsolete folded line
+    if (!colon || colon == line || line[0] == ' ' || line[0] == '\t' || colon[-1] == ' ' || colon[-1] == '\t') {
+        fail(s, 400);
+        return;
+    }
+    *colon = '\0';
+    char* value = colon + 1;
+    char* end = line + len;
+    while (value < end && (*value == ' ' || *value == '\t')) value++;
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) end--;
+    *end = '\0';
+
+    if (m->header_count == m->header_cap) {
+        int cap = m->header_cap ? m->header_cap * 2 : 16;
+        header_t* headers = mem_talloc_realloc(s, m->headers, cap * sizeof(header_t));
+        if (!headers) {
+            fail(s, 500);
+            return;
+        }
+        m->headers = headers;
+        m->header_cap = cap;
+    }
+    header_t* h = &m->headers[m->header_count++];
+    view_set(s, &h->name, line, (size_t)(colon - line));
+    view_set(s, &h->value, value, (size_t)(end - value));
+
+    if (strcasecmp(line, "Content-Length") == 0) {
+        long n = 0;
+        if (value == end) n = -1;
+        for (char* p = value; p < end && n >= 0; p++) {
+            if (*p < '0' || *p > '9' || n > COME_NET_HTTP_MAX_BODY * 64L) n = -1;
+            else n = n * 10 + (*p - '0');
+        }
+        if (n < 0 || (s->content_length >= 0 && s->content_length != n)) {
+            fail(s, 400);
+            return;
+        }
+        s->content_length = n;
+    } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+        // A second field continues the list, after a chunked that was final
+        int status = s->chunked ? 400 : transfer_codings(value);
+        if (status) {
+            fail(s, status);
+            return;
+        }
+        s->chunked = 1;
+    } else if (strcasecmp(line, "Connection") == 0) {
+        if (has_token(value, "close")) s->keep_alive = 0;
+        else if (has_token(value, "keep-alive")) s->keep_alive = 1;
+    }
+    s->head_end = s->pos;
+}
+
+static void chunk_size_line(come_net_http_session_t* s, char* line, size_t len) {
+    size_t size = 0;
+    size_t i = 0;
+    for (; i < len && line[i] != ';' && line[i] != ' ' && line[i] != '\t'; i++) {
+        char c = line[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                    c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0 || size > ((size_t)1 << 40)) {
+            fail(s, 400);
+            return;
+        }
+        size = size * 16 + (size_t)digit;
+    }
+    if (i == 0) {
+        fail(s, 400);
+        return;
+    }
+    if (size == 0) {
+        s->state = P_TRAILERS;
+    } else {
+        s->remaining = size;
+        s->state = P_CHUNK_DATA;
+    }
+}
+
+static void parse(come_net_http_session_t* s) {
+    s->parsing = 1;
+    while (s->state != P_WAIT && !closed(s)) {
+        come_net_http_message_t* m = incoming(s);
+        char* data = s->in->data;
+        size_t avail = s->in->count - s->pos;
+        if (s->state == P_BODY || s->state == P_CHUNK_DATA || s->state == P_BODY_EOF) {
+            if (avail == 0) break;
+            size_t n = avail;
+            if (s->state != P_BODY_EOF) {
+                if (n > s->remaining) n = s->remaining;
+                s->remaining -= n;
+            }
+            char* p = data + s->pos;
+            s->pos += n;
+            if (deliver(s, m, p, n) < 0) break;
+            if (s->state == P_BODY && s->remaining == 0) message_done(s);
+            else if (s->state == P_CHUNK_DATA && s->remaining == 0) s->state = P_CHUNK_END;
+            continue;
+        }
+
+        char* line = data + s->pos;
+        char* lf = memchr(line, '\n', avail);
+        if (!lf) {
+            int head = s->state == P_LINE || s->state == P_HEADERS;
+            if (head && s->in->count - s->head_start > COME_NET_HTTP_MAX_HEAD) fail(s, 431);
+            else if (!head && avail > MAX_CHUNK_LINE) fail(s, 400);
+            break;
+        }
+        size_t len = (size_t)(lf - line);
+        s->pos += len + 1;
+        if (len > 0 && line[len - 1] == '\r') len--;
+        line[len] = '\0';  // Lines end in place, so the views in them are C strings too
+        switch (s->state) {
+            case P_LINE:
+                start_line(s, m, line, len);
+                break;
+            case P_HEADERS:
+                header_line(s, m, line, len);
+                break;
+            case P_CHUNK_SIZE:
+                chunk_size_line(s, line, len);
+                break;
+            case P_CHUNK_END:
+                if (len != 0) fail(s, 400);
+                else s->state = P_CHUNK_SIZE;
+                break;
+            case P_TRAILERS:
+                if (len == 0) message_done(s);
+                break;
+        }
+    }
+    s->parsing = 0;
+}
+
+static int feed(come_net_http_session_t* s, const void* bytes, size_t len) {
+    if (s->state == P_FAILED) return -1;
+    // A client pipelining requests faster than they are answered
+    if (s->state == P_WAIT && s->in->count - s->pos + len > COME_NET_HTTP_MAX_PENDING) {
+        fail(s, 503);
+        return -1;
+    }
+    if (buffer_reserve(s, len) < 0) {
+        fail(s, 500);
+        return -1;
+    }
+    memcpy(s->in->data + s->in->count, bytes, len);
+    s->in->count += (uint32_t)len;
+    s->in->data[s->in->count] = '\0';
+    if (!s->parsing) parse(s);
+    return s->state == P_FAILED ? -1 : 0;
+}
+
+// Writing
+
+static come_net_http_message_t* outgoing(come_net_http_session_t* s) {
+    return s->client ? &s->req : &s->resp;
+}
+
+// DATA_DONE once the connection can take more; handlers that write again
+// are picked up by the loop here rather than by recursion
+static void data_done(come_net_http_session_t* s, come_net_http_message_t* m) {
+    if (m->in_data_done) return;
+    m->in_data_done = 1;
+    while (m->want_data_done && m->out_state == OUT_STREAMING && !closed(s) &&
+           come_net_tcp_queued(s->conn) <= COME_NET_TCP_HIGH_WATER) {
+        m->want_data_done = 0;
+        dispatch(m, COME_NET_HTTP_DATA_DONE, NULL);
+    }
+    m->in_data_done = 0;
+}
+
+// Start line, headers and framing, built in one block the connection takes
+// over; body < 0 for chunked
+static int send_head(come_net_http_session_t* s, come_net_http_message_t* m, long body) {
+    size_t headers = m->out_headers ? m->out_headers->count : 0;
+    size_t size = headers + 128;
+    const char* method = m->out_method && m->out_method->count ? m->out_method->data : "GET";
+    const char* path = m->out_path && m->out_path->count ? m->out_path->data : "/";
+    if (s->client) size += strlen(method) + strlen(path);
+    char* block = mem_talloc_alloc(s->conn, size);
+    if (!block) return -1;
+    int n;
+    if (s->client) {
+        if (expect_response(s, strcmp(method, "HEAD") == 0) < 0) {
+            mem_talloc_free(block);
+            return -1;
+        }
+        n = snprintf(block, size, "%s %s HTTP/1.1\r\n", method, path);
+    } else {
+        n = snprintf(block, size, "HTTP/1.1 %d %s\r\n", m->out_status, reason(m->out_status));
+    }
+    if (headers) memcpy(block + n, m->out_headers->data, headers);
+    n += (int)headers;
+    if (body < 0) {
+        n += snprintf(block + n, size - n, "Transfer-Encoding: chunked\r\n");
+    } else if (s->client ? body > 0 || (strcmp(method, "GET") != 0 && strcmp(method, "HEAD") != 0)
+                         : !bodiless(m->out_status)) {
+        n += snprintf(block + n, size - n, "Content-Length: %ld\r\n", body);
+    }
+    if (!s->client && !s->keep_alive) n += snprintf(block + n, size - n, "Connection: close\r\n");
+    n += snprintf(block + n, size - n, "\r\n");
+    return come_net_tcp_write_owned(s->conn, block, (size_t)n);
+}
+
+// Outgoing message written: DONE, then a server moves on to the next request
+static void finish(come_net_http_session_t* s, come_net_http_message_t* m) {
+    m->out_state = OUT_IDLE;
+    m->want_data_done = 0;
+    m->out_status = 200;
+    if (m->out_method) m->out_method->count = 0;
+    if (m->out_path) m->out_path->count = 0;
+    if (m->out_headers) m->out_headers->count = 0;
+    dispatch(m, COME_NET_HTTP_DONE, NULL);
+    if (m != &s->resp || closed(s)) return;
+    if (!s->keep_alive) {
+        come_net_tcp_close(s->conn);
+        return;
+    }
+    s->answered = 1;
+    // Answered outside READY (say, from another connection's handler): pick
+    // up the requests that came in meanwhile
+    if (s->state == P_WAIT && !s->parsing) {
+        next_message(s);
+        parse(s);
+    }
+}
+
+// The message may be sent: a request makes the session a client, a
+// response needs a server session
+static int can_send(come_net_http_message_t* m) {
+    come_net_http_session_t* s = m ? m->session : NULL;
+    if (!s || !s->conn || closed(s)) return 0;
+    if (m == &s->req) {
+        if (!s->client && (s->req.method.parent || s->in->count > 0)) return 0;
+        s->client = 1;
+        return 1;
+    }
+    return !s->client;
+}
+
+// API
+
+come_net_http_session_t* come_net_http_new(void* ctx) {
+    void* own = mem_talloc_new_ctx(ctx);
+    if (!own) return NULL;
+    come_net_http_session_t* s = mem_talloc_alloc(own, sizeof(come_net_http_session_t));
+    if (!s) {
+        mem_talloc_free(own);
+        return NULL;
+    }
+    memset(s, 0, sizeof(*s));
+    s->ctx = own;
+    s->req.session = s->resp.session = s;
+    s->req.out_status = s->resp.out_status = 200;
+    s->in = buffer_new(s, BUFFER_INITIAL);
+    if (!s->in) {
+        mem_talloc_free(own);
+        return NULL;
+    }
+    next_message(s);
+    return s;
+}
+
+static void on_readable(come_byte_array_t* data, void* env, void* ctx) {
+    come_net_http_session_t* s = *(come_net_http_session_t**)env;
+    void* outer = s->scratch;
+    s->scratch = ctx;
+    feed(s, data->items, data->count);
+    s->scratch = outer;
+}
+
+static void on_writable(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    come_net_http_session_t* s = *(come_net_http_session_t**)env;
+    void* outer = s->scratch;
+    s->scratch = ctx;
+    data_done(s, outgoing(s));
+    s->scratch = outer;
+}
+
+int come_net_http_attach(come_net_http_session_t* s, come_net_tcp_conn_t* conn) {
+    if (!s || s->conn || come_net_tcp_closing(conn)) return -1;
+    void** readable = come_net_tcp_on(conn, COME_NET_TCP_READABLE, on_readable, sizeof(void*));
+    void** writable = come_net_tcp_on(conn, COME_NET_TCP_WRITABLE, on_writable, sizeof(void*));
+    if (!readable || !writable) return -1;
+    *readable = *writable = s;
+    mem_talloc_steal(conn, s->ctx);
+    s->conn = conn;
+    return 0;
+}
+
+int come_net_http_feed(come_net_http_session_t* s, const void* bytes, size_t len) {
+    return s ? feed(s, bytes, len) : -1;
+}
+
+come_net_http_message_t* come_net_http_req(come_net_http_session_t* s) {
+    return s ? &s->req : NULL;
+}
+
+come_net_http_message_t* come_net_http_resp(come_net_http_session_t* s) {
+    return s ? &s->resp : NULL;
+}
+
+void* come_net_http_on(come_net_http_message_t* m, come_net_http_event_t event, come_net_http_handler_t fn, size_t env_size) {
+    if (!m || (unsigned)event >= COME_NET_HTTP_EVENTS) return NULL;
+    if (m->env[event]) mem_talloc_free(m->env[event]);
+    m->env[event] = NULL;
+    m->on[event] = fn;
+    if (env_size > 0) {
+        m->env[event] = mem_talloc_alloc(m->session, env_size);
+        if (m->env[event]) memset(m->env[event], 0, env_size);
+    }
+    return m->env[event];
+}
+
+come_string_t* come_net_http_method(come_net_http_message_t* m) {
+    return m ? view_get(&m->method) : NULL;
+}
+
+come_string_t* come_net_http_path(come_net_http_message_t* m) {
+    return m ? view_get(&m->path) : NULL;
+}
+
+come_string_t* come_net_http_version(come_net_http_message_t* m) {
+    return m ? view_get(&m->version) : NULL;
+}
+
+int come_net_http_status(come_net_http_message_t* m) {
+    return m ? m->status : 0;
+}
+
+come_string_t* come_net_http_header_bytes(come_net_http_message_t* m, const char* name, size_t len) {
+    if (!m || !name) return NULL;
+    for (int i = 0; i < m->header_count; i++) {
+        header_t* h = &m->headers[i];
+        if (h->name.count == len && strncasecmp(come_string_data((come_string_t*)&h->name), name, len) == 0) {
+            return (come_string_t*)&h->value;
+        }
+    }
+    return NULL;
+}
+
+come_string_t* come_net_http_body(come_net_http_message_t* m) {
+    if (!m) return NULL;
+    if (!m->body && body_ctx(m)) m->body = buffer_new(m->body_ctx, 0);
+    return m->body;
+}
+
+static int set_string(come_net_http_message_t* m, come_string_t** field, const char* bytes, size_t len) {
+    if (!m || !bytes || len == 0 || memchr(bytes, '\n', len) || memchr(bytes, ' ', len)) return -1;
+    if (*field) (*field)->count = 0;
+    return buffer_append(m->session, field, bytes, len);
+}
+
+int come_net_http_set_method_bytes(come_net_http_message_t* m, const char* method, size_t len) {
+    return set_string(m, &m->out_method, method, len);
+}
+
+int come_net_http_set_path_bytes(come_net_http_message_t* m, const char* path, size_t len) {
+    return set_string(m, &m->out_path, path, len);
+}
+
+int come_net_http_set_status(come_net_http_message_t* m, int status) {
+    if (!m || status < 100 || status > 999) return -1;
+    m->out_status = status;
+    return 0;
+}
+
+int come_net_http_set_header_bytes(come_net_http_message_t* m, const char* name, size_t name_len,
+                                   const char* value, size_t value_len) {
+    if (!m || !name || name_len == 0 || memchr(name, ':', name_len) || memchr(name, '\n', name_len) ||
+        (value_len && memchr(value, '\n', value_len))) {
+        return -1;
+    }
+    come_net_http_session_t* s = m->session;
+    if (buffer_append(s, &m->out_headers, name, name_len) < 0 ||
+        buffer_append(s, &m->out_headers, ": ", 2) < 0 ||
+        (value_len && buffer_append(s, &m->out_headers, value, value_len) < 0) ||
+        buffer_append(s, &m->out_headers, "\r\n", 2) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int come_net_http_send_bytes(come_net_http_message_t* m, const void* body, size_t len) {
+    if (!can_send(m) || m->out_state != OUT_IDLE) return -1;
+    come_net_http_session_t* s = m->session;
+    if (!s->client && bodiless(m->out_status)) len = 0;
+    // Head and body go out together, in one gathered write; the answer to
+    // HEAD has the length of the body it leaves out
+    if (send_head(s, m, (long)len) < 0) return -1;
+    int head = !s->client && s->req.method.count == 4 && memcmp(come_string_data((come_string_t*)&s->req.method), "HEAD", 4) == 0;
+    if (len && !head && come_net_tcp_write_bytes(s->conn, body, len) < 0) return -1;
+    dispatch(m, COME_NET_HTTP_HEADER_DONE, NULL);
+    finish(s, m);
+    return 0;
+}
+
+int come_net_http_write_bytes(come_net_http_message_t* m, const void* bytes, size_t len) {
+    if (!can_send(m)) return -1;
+    come_net_http_session_t* s = m->session;
+    if (m->out_state == OUT_IDLE) {
+        if (send_head(s, m, -1) < 0) return -1;
+        m->out_state = OUT_STREAMING;
+        dispatch(m, COME_NET_HTTP_HEADER_DONE, NULL);
+        if (closed(s)) return -1;
+    }
+    // An empty chunk would end the body
+    if (len > 0) {
+        char* size = mem_talloc_alloc(s->conn, 24);
+        if (!size) return -1;
+        int n = snprintf(size, 24, "%zx\r\n", len);
+        if (come_net_tcp_write_owned(s->conn, size, (size_t)n) < 0 ||
+            come_net_tcp_write_bytes(s->conn, bytes, len) < 0 ||
+            come_net_tcp_write_bytes(s->conn, "\r\n", 2) < 0) {
+            return -1;
+        }
+    }
+    m->want_data_done = 1;
+    data_done(s, m);
+    return 0;
+}
+
+int come_net_http_end(come_net_http_message_t* m) {
+    if (!m) return -1;
+    if (m->out_state == OUT_IDLE) return come_net_http_send_bytes(m, NULL, 0);
+    come_net_http_session_t* s = m->session;
+    if (closed(s) || come_net_tcp_write_bytes(s->conn, "0\r\n\r\n", 5) < 0) return -1;
+    finish(s, m);
+    return 0;
+}
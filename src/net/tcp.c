@@ -0,0 +1,939 @@
+#define _GNU_SOURCE // accept4
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// net.tcp on an edge-triggered epoll loop, one per thread. Each readiness
+// edge is drained (accept or read until EAGAIN, write until the queue is
+// empty or EAGAIN) since the kernel will not report it again.
+//
+// With COME_NET_BACKEND=io_uring a thread's loop runs on io_uring instead,
+// if the kernel has what it needs (see uring_new()). Listeners keep a
+// multishot accept armed and connections a multishot recv that takes its
+// buffers from a ring of byte[] storage, handed to READABLE as they are.
+// Submissions collect in the ring and go in with the next wait, one system
+// call for the batch. Writes stay synchronous: the queue may point into the
+// caller's memory until the write returns, so they are tried at once and a
+// one-shot poll stands in for EPOLLOUT.
+
+#define MAX_EVENTS 64
+#define MAX_IOV 64            // iovecs per gathered write
+#define URING_ENTRIES 256
+#define URING_BUFFERS 32      // Provided read buffers, COME_NET_TCP_READ_BUFFER bytes each
+#define URING_GROUP 0
+
+// Operations in flight carry their handle in user_data, tagged with the
+// kind in the low bits (handles are at least 8-byte aligned); 0 marks
+// cancellations, whose own completions are ignored
+enum { OP_ACCEPT = 1, OP_RECV, OP_POLL };
+#define OP_MASK 7
+
+enum { HANDLE_LISTENER, HANDLE_CONN };
+
+typedef struct handle {
+    int kind;
+    int fd;
+    int closed;                            // Out of the epoll set; freed after the batch
+    int inflight;                          // io_uring operations not completed yet
+    come_net_tcp_handler_t on[COME_NET_TCP_EVENTS];
+    void* env[COME_NET_TCP_EVENTS];
+    void* scratch;                         // Context handlers run under, made on first use
+    struct handle* next_dead;
+} handle_t;
+
+struct come_net_tcp_listener {
+    handle_t h;
+    int pending;                           // Accepted fd offered to the ACCEPT handler, or -1
+    int starved;                           // io_uring: accept ran out of descriptors, not armed
+    struct come_net_tcp_listener* next_starved;
+};
+
+typedef struct {
+    const char* base;
+    size_t len;
+    void* copy;                            // Block in the connection's context, or NULL
+} out_t;
+
+struct come_net_tcp_conn {
+    handle_t h;
+    int connecting;
+    int closing;                           // close() called: no more reads, close when drained
+    int peer_hup;                          // The peer shut down its side (RDHUP)
+    int blocked;                           // A write hit EAGAIN or the high-water mark; WRITABLE fires when drained
+    int in_writable, rewritable;           // In the WRITABLE handler; drained again meanwhile
+    int dirty;                             // On the loop's flush list
+    int recv_armed, recv_cancel;           // io_uring: multishot recv armed; being cancelled
+    int polling;                           // io_uring: waiting for POLLOUT
+    int err;
+    out_t* out;                            // Queue, out[head..tail)
+    int head, tail, cap;
+    size_t queued;
+    come_net_tcp_conn_t* next_dirty;
+};
+
+typedef struct {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask, sq_entries;
+    unsigned tail;                         // Ours, published on submit
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    void* ring;
+    size_t ring_size, sqes_size;
+    struct io_uring_buf_ring* br;          // Read buffers offered to the kernel
+    unsigned short br_tail;
+    come_byte_array_t* bufs[URING_BUFFERS];
+} uring_t;
+
+typedef struct {
+    int epfd;
+    uring_t* uring;                        // NULL on the epoll backend
+    void* root;                            // Handles live under it
+    come_byte_array_t* buf;                // The read buffer handed to READABLE
+    int live;                              // Open handles
+    int stopping;
+    int in_handler;
+    long syscalls;
+    come_net_tcp_conn_t* dirty;            // Written to during a handler
+    come_net_tcp_listener_t* starved;
+    handle_t* dead;
+} loop_t;
+
+static __thread loop_t* co_loop = NULL;
+
+// io_uring
+
+static int uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_register(int fd, unsigned op, void* arg, unsigned n) {
+    return (int)syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+// Multishot recv came with Linux 6.0, as did SEND_ZC, which a probe can see
+static int uring_probe(int fd) {
+    size_t size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, size);
+    int ok = probe && uring_register(fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+             probe->last_op >= IORING_OP_SEND_ZC && (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return ok;
+}
+
+static void uring_free(uring_t* u) {
+    if (u->br) munmap(u->br, URING_BUFFERS * sizeof(struct io_uring_buf));
+    if (u->sqes) munmap(u->sqes, u->sqes_size);
+    if (u->ring) munmap(u->ring, u->ring_size);
+    close(u->fd);
+    mem_talloc_free(u);
+}
+
+// Returns read buffer bid to the kernel
+static void uring_buf_put(uring_t* u, int bid) {
+    struct io_uring_buf* b = &u->br->bufs[u->br_tail & (URING_BUFFERS - 1)];
+    b->addr = (uintptr_t)u->bufs[bid]->items;
+    b->len = u->bufs[bid]->size;
+    b->bid = (unsigned short)bid;
+    __atomic_store_n(&u->br->tail, ++u->br_tail, __ATOMIC_RELEASE);
+}
+
+// The ring, its mappings and the read buffers; NULL if the kernel lacks any
+// of it, and the loop stays on epoll
+static uring_t* uring_new(void* root) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    int fd = uring_setup(URING_ENTRIES, &p);
+    if (fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));  // Before 6.1
+        fd = uring_setup(URING_ENTRIES, &p);
+    }
+    if (fd < 0) return NULL;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP) || !uring_probe(fd)) {
+        close(fd);
+        return NULL;
+    }
+    uring_t* u = mem_talloc_alloc(root, sizeof(uring_t));
+    if (!u) {
+        close(fd);
+        return NULL;
+    }
+    memset(u, 0, sizeof(*u));
+    u->fd = fd;
+    size_t sq = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->ring_size = sq > cq ? sq : cq;
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->ring = mmap(NULL, u->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    u->br = mmap(NULL, URING_BUFFERS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->ring == MAP_FAILED) u->ring = NULL;
+    if (u->sqes == MAP_FAILED) u->sqes = NULL;
+    if (u->br == MAP_FAILED) u->br = NULL;
+    struct io_uring_buf_reg reg = { .ring_addr = (uintptr_t)u->br, .ring_entries = URING_BUFFERS,
+                                    .bgid = URING_GROUP };
+    if (!u->ring || !u->sqes || !u->br || uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        uring_free(u);
+        return NULL;
+    }
+    char* ring = u->ring;
+    u->sq_head = (unsigned*)(ring + p.sq_off.head);
+    u->sq_tail = (unsigned*)(ring + p.sq_off.tail);
+    u->sq_mask = *(unsigned*)(ring + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    u->tail = *u->sq_tail;
+    unsigned* array = (unsigned*)(ring + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) array[i] = i;
+    u->cq_head = (unsigned*)(ring + p.cq_off.head);
+    u->cq_tail = (unsigned*)(ring + p.cq_off.tail);
+    u->cq_mask = *(unsigned*)(ring + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe*)(ring + p.cq_off.cqes);
+    for (int i = 0; i < URING_BUFFERS; i++) {
+        u->bufs[i] = mem_talloc_alloc(u, sizeof(come_byte_array_t) + COME_NET_TCP_READ_BUFFER);
+        if (!u->bufs[i]) {
+            uring_free(u);
+            return NULL;
+        }
+        u->bufs[i]->size = COME_NET_TCP_READ_BUFFER;
+        u->bufs[i]->count = 0;
+        uring_buf_put(u, i);
+    }
+    return u;
+}
+
+// Submits what is queued and, with wait, blocks for a completion
+static int uring_enter(loop_t* loop, unsigned wait) {
+    uring_t* u = loop->uring;
+    __atomic_store_n(u->sq_tail, u->tail, __ATOMIC_RELEASE);
+    unsigned submit = u->tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if (!submit && !wait) return 0;
+    loop->syscalls++;
+    return (int)syscall(__NR_io_uring_enter, u->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+static struct io_uring_sqe* uring_sqe(loop_t* loop) {
+    uring_t* u = loop->uring;
+    if (u->tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) == u->sq_entries) uring_enter(loop, 0);
+    struct io_uring_sqe* sqe = &u->sqes[u->tail & u->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    u->tail++;
+    return sqe;
+}
+
+static void uring_submit(handle_t* h, struct io_uring_sqe* sqe, int op) {
+    sqe->user_data = (uintptr_t)h | op;
+    h->inflight++;
+}
+
+static void uring_arm_accept(loop_t* loop, come_net_tcp_listener_t* l) {
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = l->h.fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    uring_submit(&l->h, sqe, OP_ACCEPT);
+}
+
+static void uring_arm_recv(loop_t* loop, come_net_tcp_conn_t* c) {
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->h.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_GROUP;
+    uring_submit(&c->h, sqe, OP_RECV);
+    c->recv_armed = 1;
+}
+
+static void uring_arm_poll(loop_t* loop, come_net_tcp_conn_t* c) {
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = c->h.fd;
+    sqe->poll32_events = POLLOUT;
+    uring_submit(&c->h, sqe, OP_POLL);
+    c->polling = 1;
+}
+
+// Cancels one operation, by its user_data, or with all set every operation
+// on the handle's descriptor
+static void uring_cancel(loop_t* loop, handle_t* h, int op, int all) {
+    struct io_uring_sqe* sqe = uring_sqe(loop);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    if (all) {
+        sqe->fd = h->fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    } else {
+        sqe->addr = (uintptr_t)h | op;
+    }
+}
+
+// A multishot recv stays armed while the connection may read: it is
+// cancelled over the high-water mark and armed again below it
+static void uring_want_read(loop_t* loop, come_net_tcp_conn_t* c) {
+    if (c->h.closed) return;
+    int want = !c->closing && !c->connecting && c->queued <= COME_NET_TCP_HIGH_WATER;
+    if (want && !c->recv_armed) {
+        uring_arm_recv(loop, c);
+    } else if (!want && c->recv_armed && !c->recv_cancel) {
+        uring_cancel(loop, &c->h, OP_RECV, 0);
+        c->recv_cancel = 1;
+    }
+}
+
+static loop_t* loop_get(void) {
+    if (co_loop) return co_loop;
+    loop_t* loop = calloc(1, sizeof(loop_t));
+    if (!loop) return NULL;
+    loop->root = mem_talloc_new_ctx(NULL);
+    const char* backend = getenv("COME_NET_BACKEND");
+    if (backend && strcmp(backend, "io_uring") == 0) loop->uring = uring_new(loop->root);
+    if (!loop->uring) {
+        loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (loop->epfd < 0) {
+            mem_talloc_free(loop->root);
+            free(loop);
+            return NULL;
+        }
+    }
+    loop->buf = mem_talloc_alloc(loop->root, sizeof(come_byte_array_t) + COME_NET_TCP_READ_BUFFER);
+    loop->buf->size = COME_NET_TCP_READ_BUFFER;
+    loop->buf->count = 0;
+    co_loop = loop;
+    return loop;
+}
+
+// Operations are armed by the caller on io_uring
+static void* handle_new(loop_t* loop, size_t size, int kind, int fd, uint32_t events) {
+    handle_t* h = mem_talloc_alloc(loop->root, size);
+    if (!h) return NULL;
+    memset(h, 0, size);
+    h->kind = kind;
+    h->fd = fd;
+    struct epoll_event ev = { .events = events | EPOLLET, .data.ptr = h };
+    if (!loop->uring && epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        int saved = errno;
+        mem_talloc_free(h);
+        errno = saved;
+        return NULL;
+    }
+    loop->live++;
+    return h;
+}
+
+// Handlers
+
+static void flush(come_net_tcp_conn_t* c);
+
+static void dispatch(handle_t* h, int event, come_byte_array_t* data) {
+    come_net_tcp_handler_t fn = h->on[event];
+    if (!fn) return;
+    loop_t* loop = co_loop;
+    // What a handler allocates may be kept past it, so it lives with the handle
+    if (!h->scratch) h->scratch = mem_talloc_new_ctx(h);
+    loop->in_handler++;
+    fn(data, h->env[event], h->scratch);
+    loop->in_handler--;
+    // Writes made by the handler go out together
+    while (loop->dirty) {
+        come_net_tcp_conn_t* c = loop->dirty;
+        loop->dirty = c->next_dirty;
+        c->dirty = 0;
+        flush(c);
+    }
+}
+
+// Takes the handle out of the loop; its memory goes after the current
+// batch. On io_uring, operations in flight are cancelled, and the
+// descriptor closed and memory freed once they have all completed.
+static void release(handle_t* h) {
+    if (h->closed) return;
+    loop_t* loop = co_loop;
+    h->closed = 1;
+    if (loop->uring) {
+        if (h->inflight) uring_cancel(loop, h, 0, 1);
+    } else {
+        epoll_ctl(loop->epfd, EPOLL_CTL_DEL, h->fd, NULL);
+        close(h->fd);
+    }
+    loop->live--;
+    if (h->kind == HANDLE_CONN) {
+        come_net_tcp_conn_t* c = (come_net_tcp_conn_t*)h;
+        if (c->err) dispatch(h, COME_NET_TCP_ERROR, NULL);
+        dispatch(h, COME_NET_TCP_HUP, NULL);
+    }
+    h->next_dead = loop->dead;
+    loop->dead = h;
+}
+
+static void fail(come_net_tcp_conn_t* c, int err) {
+    c->err = err;
+    c->head = c->tail = 0;
+    c->queued = 0;
+    release(&c->h);
+}
+
+// Output
+
+static int queue_push(come_net_tcp_conn_t* c, const char* base, size_t len, void* copy) {
+    if (c->tail == c->cap) {
+        if (c->head > 0) {
+            memmove(c->out, c->out + c->head, (c->tail - c->head) * sizeof(out_t));
+            c->tail -= c->head;
+            c->head = 0;
+        }
+        if (c->tail == c->cap) {
+            int cap = c->cap ? c->cap * 2 : 16;
+            out_t* out = mem_talloc_realloc(c, c->out, cap * sizeof(out_t));
+            if (!out) return -1;
+            c->out = out;
+            c->cap = cap;
+        }
+    }
+    c->out[c->tail++] = (out_t){ base, len, copy };
+    c->queued += len;
+    // Over the mark the writer should hold off: tell it when the queue drains
+    if (c->queued > COME_NET_TCP_HIGH_WATER) c->blocked = 1;
+    return 0;
+}
+
+// Entries still pointing at the caller's memory get copies of their own
+static int queue_own(come_net_tcp_conn_t* c) {
+    for (int i = c->head; i < c->tail; i++) {
+        if (c->out[i].copy) continue;
+        char* copy = mem_talloc_alloc(c, c->out[i].len);
+        if (!copy) return -1;
+        memcpy(copy, c->out[i].base, c->out[i].len);
+        c->out[i].base = copy;
+        c->out[i].copy = copy;
+    }
+    return 0;
+}
+
+// Writes as much of the queue as the socket takes, MAX_IOV entries per call
+static void flush(come_net_tcp_conn_t* c) {
+    if (c->h.closed || c->connecting) return;
+    while (c->head < c->tail) {
+        struct iovec iov[MAX_IOV];
+        int n = 0;
+        for (int i = c->head; i < c->tail && n < MAX_IOV; i++) {
+            iov[n].iov_base = (void*)c->out[i].base;
+            iov[n].iov_len = c->out[i].len;
+            n++;
+        }
+        // sendmsg is writev with MSG_NOSIGNAL: a peer reset is an error, not SIGPIPE
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = n };
+        co_loop->syscalls++;
+        ssize_t sent = sendmsg(c->h.fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                c->blocked = 1;
+                break;
+            }
+            fail(c, errno);
+            return;
+        }
+        c->queued -= sent;
+        while (sent > 0) {
+            out_t* o = &c->out[c->head];
+            if ((size_t)sent < o->len) {
+                o->base += sent;
+                o->len -= sent;
+                break;
+            }
+            sent -= o->len;
+            if (o->copy) mem_talloc_free(o->copy);
+            c->head++;
+        }
+    }
+    if (c->head < c->tail) {
+        if (queue_own(c) < 0) fail(c, ENOMEM);
+        else if (co_loop->uring && !c->polling) uring_arm_poll(co_loop, c);
+        return;
+    }
+    c->head = c->tail = 0;
+    if (c->closing) {
+        release(&c->h);
+    } else if (c->blocked) {
+        c->blocked = 0;
+        // A handler that writes past the mark again drains it again: loop
+        // here instead of recursing through flush
+        if (c->in_writable) {
+            c->rewritable = 1;
+            return;
+        }
+        c->in_writable = 1;
+        do {
+            c->rewritable = 0;
+            dispatch(&c->h, COME_NET_TCP_WRITABLE, NULL);
+        } while (c->rewritable && !c->h.closed);
+        c->in_writable = 0;
+    }
+}
+
+// Flushes after the handler when in one, else at once
+static int queue_flush(come_net_tcp_conn_t* c) {
+    loop_t* loop = co_loop;
+    if (loop->in_handler) {
+        if (!c->dirty) {
+            c->dirty = 1;
+            c->next_dirty = loop->dirty;
+            loop->dirty = c;
+        }
+    } else {
+        flush(c);
+        if (!c->h.closed && queue_own(c) < 0) fail(c, ENOMEM);
+    }
+    return 0;
+}
+
+int come_net_tcp_write_bytes(come_net_tcp_conn_t* c, const void* bytes, size_t len) {
+    if (!c || c->h.closed || c->closing) return -1;
+    if (len == 0) return 0;
+    // A handler's writes wait for it to return, and the caller may change
+    // the bytes meanwhile: they are queued as a copy
+    if (co_loop->in_handler) {
+        void* copy = mem_talloc_alloc(c, len);
+        if (!copy) return -1;
+        memcpy(copy, bytes, len);
+        if (queue_push(c, copy, len, copy) < 0) {
+            mem_talloc_free(copy);
+            return -1;
+        }
+        return queue_flush(c);
+    }
+    if (queue_push(c, bytes, len, NULL) < 0) return -1;
+    return queue_flush(c);
+}
+
+int come_net_tcp_write_owned(come_net_tcp_conn_t* c, void* block, size_t len) {
+    if (!c || c->h.closed || c->closing || len == 0 ||
+        !mem_talloc_steal(c, block) || queue_push(c, block, len, block) < 0) {
+        mem_talloc_free(block);
+        return c && !c->h.closed && !c->closing && len == 0 ? 0 : -1;
+    }
+    return queue_flush(c);
+}
+
+size_t come_net_tcp_queued(const come_net_tcp_conn_t* c) {
+    return c ? c->queued : 0;
+}
+
+int come_net_tcp_closing(const come_net_tcp_conn_t* c) {
+    return !c || c->h.closed || c->closing;
+}
+
+// Input
+
+static void conn_read(come_net_tcp_conn_t* c) {
+    loop_t* loop = co_loop;
+    come_byte_array_t* buf = loop->buf;
+    // Backpressure: a connection with a full queue is not read; its pending
+    // bytes stay in the kernel until the queue drains
+    while (!c->h.closed && !c->closing && c->queued <= COME_NET_TCP_HIGH_WATER) {
+        loop->syscalls++;
+        ssize_t n = read(c->h.fd, buf->items, buf->size);
+        if (n > 0) {
+            buf->count = (uint32_t)n;
+            dispatch(&c->h, COME_NET_TCP_READABLE, buf);
+            // A short read emptied the socket; new bytes bring a new edge.
+            // Once the peer has shut down no edge follows, so read on to
+            // the end of the stream
+            if ((size_t)n < buf->size && !c->peer_hup) break;
+        } else if (n == 0) {
+            come_net_tcp_close(c);
+            break;
+        } else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) fail(c, errno);
+            break;
+        }
+    }
+}
+
+// A non-blocking connect() finished: CONNECT, or ERROR and HUP
+static int connected(come_net_tcp_conn_t* c) {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    getsockopt(c->h.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+    if (err) {
+        fail(c, err);
+        return -1;
+    }
+    c->connecting = 0;
+    dispatch(&c->h, COME_NET_TCP_CONNECT, NULL);
+    flush(c);
+    return 0;
+}
+
+static void conn_event(come_net_tcp_conn_t* c, uint32_t events) {
+    if (c->connecting && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        if (connected(c) < 0) return;
+    }
+    if (events & EPOLLERR) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(c->h.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        fail(c, err ? err : EIO);
+        return;
+    }
+    if (events & (EPOLLRDHUP | EPOLLHUP)) c->peer_hup = 1;
+    if (events & EPOLLOUT) {
+        size_t before = c->queued;
+        flush(c);
+        // Reads stopped by backpressure resume once the queue drains below it
+        if (before > COME_NET_TCP_HIGH_WATER && c->queued <= COME_NET_TCP_HIGH_WATER) conn_read(c);
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) conn_read(c);
+}
+
+static come_net_tcp_conn_t* conn_new(loop_t* loop, int fd, int connecting) {
+    come_net_tcp_conn_t* c = handle_new(loop, sizeof(come_net_tcp_conn_t), HANDLE_CONN, fd,
+                                        EPOLLIN | EPOLLOUT | EPOLLRDHUP);
+    if (!c) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    c->connecting = connecting;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (loop->uring) {
+        if (connecting) uring_arm_poll(loop, c);
+        else uring_want_read(loop, c);
+    }
+    return c;
+}
+
+// Listeners
+
+// Offers an accepted descriptor to the ACCEPT handler
+static void offer(come_net_tcp_listener_t* l, int fd) {
+    if (!l->h.on[COME_NET_TCP_ACCEPT]) {
+        close(fd);
+        return;
+    }
+    l->pending = fd;
+    dispatch(&l->h, COME_NET_TCP_ACCEPT, NULL);
+    // Not taken by accept(): refused
+    if (l->pending >= 0) close(l->pending);
+    l->pending = -1;
+}
+
+static void listener_event(come_net_tcp_listener_t* l) {
+    while (!l->h.closed) {
+        co_loop->syscalls++;
+        int fd = accept4(l->h.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;  // EAGAIN, or out of descriptors: wait for the next edge
+        }
+        offer(l, fd);
+    }
+}
+
+// io_uring completions
+
+static void uring_accepted(loop_t* loop, come_net_tcp_listener_t* l, int res, int more) {
+    if (res >= 0) {
+        if (l->h.closed) close(res);
+        else offer(l, res);
+    }
+    if (more || l->h.closed || res == -ECANCELED) return;
+    // Out of descriptors: armed again once a handle closes, where epoll
+    // would wait for the next edge
+    if (res == -EMFILE || res == -ENFILE) {
+        if (!l->starved) {
+            l->starved = 1;
+            l->next_starved = loop->starved;
+            loop->starved = l;
+        }
+        return;
+    }
+    uring_arm_accept(loop, l);
+}
+
+static void uring_received(loop_t* loop, come_net_tcp_conn_t* c, const struct io_uring_cqe* cqe) {
+    if (!(cqe->flags & IORING_CQE_F_MORE)) c->recv_armed = c->recv_cancel = 0;
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        // Writes the handler made from data were flushed or copied by the
+        // time dispatch() returns, so the buffer goes straight back
+        int bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        come_byte_array_t* buf = loop->uring->bufs[bid];
+        if (cqe->res > 0 && !c->h.closed && !c->closing) {
+            buf->count = (uint32_t)cqe->res;
+            dispatch(&c->h, COME_NET_TCP_READABLE, buf);
+        }
+        uring_buf_put(loop->uring, bid);
+    }
+    if (c->h.closed) return;
+    if (cqe->res == 0) {
+        come_net_tcp_close(c);
+        return;
+    }
+    if (cqe->res < 0 && cqe->res != -ECANCELED && cqe->res != -ENOBUFS) {
+        fail(c, -cqe->res);
+        return;
+    }
+    uring_want_read(loop, c);
+}
+
+static void uring_polled(loop_t* loop, come_net_tcp_conn_t* c, int res) {
+    c->polling = 0;
+    if (c->h.closed || res == -ECANCELED) return;
+    if (res < 0) {
+        fail(c, -res);
+        return;
+    }
+    if (c->connecting) {
+        if (connected(c) < 0) return;
+    } else {
+        flush(c);
+    }
+    if (!c->h.closed) uring_want_read(loop, c);
+}
+
+static void uring_reap(loop_t* loop) {
+    uring_t* u = loop->uring;
+    unsigned head = *u->cq_head;
+    while (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe cqe = u->cqes[head & u->cq_mask];
+        __atomic_store_n(u->cq_head, ++head, __ATOMIC_RELEASE);
+        if (!cqe.user_data) continue;  // A cancellation
+        handle_t* h = (handle_t*)(uintptr_t)(cqe.user_data & ~(uint64_t)OP_MASK);
+        int more = cqe.flags & IORING_CQE_F_MORE;
+        if (!more) h->inflight--;
+        switch (cqe.user_data & OP_MASK) {
+            case OP_ACCEPT:
+                uring_accepted(loop, (come_net_tcp_listener_t*)h, cqe.res, more);
+                break;
+            case OP_RECV:
+                uring_received(loop, (come_net_tcp_conn_t*)h, &cqe);
+                break;
+            case OP_POLL:
+                uring_polled(loop, (come_net_tcp_conn_t*)h, cqe.res);
+                break;
+        }
+    }
+}
+
+// Frees released handles, except on io_uring those with operations still
+// in flight, which stay on the list until their last completion
+static void sweep(loop_t* loop) {
+    int freed = 0;
+    handle_t** p = &loop->dead;
+    while (*p) {
+        handle_t* h = *p;
+        if (h->inflight) {
+            p = &h->next_dead;
+            continue;
+        }
+        *p = h->next_dead;
+        if (loop->uring) close(h->fd);
+        mem_talloc_free(h);
+        freed = 1;
+    }
+    while (freed && loop->starved) {
+        come_net_tcp_listener_t* l = loop->starved;
+        loop->starved = l->next_starved;
+        l->starved = 0;
+        if (!l->h.closed) uring_arm_accept(loop, l);
+    }
+}
+
+// API
+
+come_net_tcp_addr_t come_net_tcp_addr(const char* host, int port) {
+    come_net_tcp_addr_t addr;
+    memset(&addr, 0, sizeof(addr));
+    struct sockaddr_in* in4 = (struct sockaddr_in*)&addr.sa;
+    struct sockaddr_in6* in6 = (struct sockaddr_in6*)&addr.sa;
+    if (!host) return addr;
+    if (inet_pton(AF_INET, host, &in4->sin_addr) == 1) {
+        in4->sin_family = AF_INET;
+        in4->sin_port = htons((uint16_t)port);
+        addr.len = sizeof(*in4);
+    } else if (inet_pton(AF_INET6, host, &in6->sin6_addr) == 1) {
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons((uint16_t)port);
+        addr.len = sizeof(*in6);
+    }
+    return addr;
+}
+
+come_net_tcp_addr_t come_net_tcp_addr_string(const come_string_t* host, int port) {
+    char text[INET6_ADDRSTRLEN + 1] = "";
+    if (host && host->count < sizeof(text)) {
+        memcpy(text, come_string_data(host), host->count);
+        text[host->count] = '\0';
+    }
+    return come_net_tcp_addr(text, port);
+}
+
+come_net_tcp_listener_t* come_net_tcp_listen(come_net_tcp_addr_t addr) {
+    loop_t* loop = loop_get();
+    if (!loop) return NULL;
+    if (addr.len == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = socket(addr.sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return NULL;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr*)&addr.sa, addr.len) < 0 || listen(fd, SOMAXCONN) < 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    come_net_tcp_listener_t* l = handle_new(loop, sizeof(come_net_tcp_listener_t), HANDLE_LISTENER, fd, EPOLLIN);
+    if (!l) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    l->pending = -1;
+    if (loop->uring) uring_arm_accept(loop, l);
+    return l;
+}
+
+come_net_tcp_conn_t* come_net_tcp_connect(come_net_tcp_addr_t addr) {
+    loop_t* loop = loop_get();
+    if (!loop) return NULL;
+    if (addr.len == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    int fd = socket(addr.sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return NULL;
+    if (connect(fd, (struct sockaddr*)&addr.sa, addr.len) < 0 && errno != EINPROGRESS) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return NULL;
+    }
+    // Even an immediate connect reports CONNECT from the loop
+    return conn_new(loop, fd, 1);
+}
+
+come_net_tcp_conn_t* come_net_tcp_accept(come_net_tcp_listener_t* l) {
+    if (!l || l->h.closed) return NULL;
+    int fd = l->pending;
+    l->pending = -1;
+    if (fd < 0) {
+        co_loop->syscalls++;
+        fd = accept4(l->h.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return NULL;
+    }
+    return conn_new(co_loop, fd, 0);
+}
+
+void* come_net_tcp_on(void* handle, come_net_tcp_event_t event, come_net_tcp_handler_t fn, size_t env_size) {
+    handle_t* h = handle;
+    if (!h || (unsigned)event >= COME_NET_TCP_EVENTS) return NULL;
+    if (h->env[event]) mem_talloc_free(h->env[event]);
+    h->env[event] = NULL;
+    h->on[event] = fn;
+    if (env_size > 0) {
+        h->env[event] = mem_talloc_alloc(h, env_size);
+        if (h->env[event]) memset(h->env[event], 0, env_size);
+    }
+    return h->env[event];
+}
+
+void* come_net_tcp_env(void* handle, come_net_tcp_event_t event, come_net_tcp_handler_t fn) {
+    handle_t* h = handle;
+    if (!h || (unsigned)event >= COME_NET_TCP_EVENTS || h->on[event] != fn) return NULL;
+    return h->env[event];
+}
+
+void come_net_tcp_close(void* handle) {
+    handle_t* h = handle;
+    if (!h || h->closed) return;
+    if (h->kind == HANDLE_LISTENER) {
+        release(h);
+        return;
+    }
+    come_net_tcp_conn_t* c = handle;
+    c->closing = 1;
+    if (c->head == c->tail && !c->dirty) release(h);
+}
+
+int come_net_tcp_error(come_net_tcp_conn_t* c) {
+    return c ? c->err : 0;
+}
+
+int come_net_run(void) {
+    loop_t* loop = loop_get();
+    if (!loop) return -1;
+    struct epoll_event events[MAX_EVENTS];
+    loop->stopping = 0;
+    for (;;) {
+        sweep(loop);
+        // Released handles still on the list wait for their cancellations
+        if (loop->stopping || (loop->live == 0 && !loop->dead)) break;
+        if (loop->uring) {
+            if (uring_enter(loop, 1) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN) return -1;
+            uring_reap(loop);
+            continue;
+        }
+        loop->syscalls++;
+        int n = epoll_wait(loop->epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        for (int i = 0; i < n; i++) {
+            handle_t* h = events[i].data.ptr;
+            if (h->closed) continue;  // Closed earlier in this batch
+            if (h->kind == HANDLE_LISTENER) listener_event((come_net_tcp_listener_t*)h);
+            else conn_event((come_net_tcp_conn_t*)h, events[i].events);
+        }
+    }
+    return 0;
+}
+
+void come_net_stop(void) {
+    if (co_loop) co_loop->stopping = 1;
+}
+
+const char* come_net_backend(void) {
+    loop_t* loop = loop_get();
+    if (!loop) return NULL;
+    return loop->uring ? "io_uring" : "epoll";
+}
+
+long come_net_syscalls(void) {
+    return co_loop ? co_loop->syscalls : 0;
+}
+
+// import net: the loop is created on first use, so there is nothing to set up
+void come_net__init(void) {
+}
+
+void come_net__exit(void) {
+}
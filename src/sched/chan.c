@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include "come_sched.h"
+
+// Channels: four queues behind one interface, and the sleeping side shared
+// by send, recv and select.
+//  - ring: Vyukov's bounded MPMC queue. Each slot has a sequence number:
+//    pos while free for the write at pos, pos + 1 once written, and
+//    pos + capacity once read, so both ends claim slots with one CAS.
+//  - spsc ring: Lamport's ring; each side caches the other's index and
+//    rereads it only when the cached value says full or empty.
+//  - segments: unbounded MPMC, after crossbeam's SegQueue. Positions step
+//    through SEG_LAP per segment, the extra one meaning "segment full, next
+//    one being installed"; slot states say written and read, and whether
+//    the last reader still has to free the segment.
+//  - spsc segments: the producer appends segments, the consumer frees them.
+// A sleeper links a wait node into each channel it waits on; whoever
+// changes a channel wakes the sleepers linked there.
+
+#define SPIN_ROUNDS 64         // Failed rounds before a waiter sleeps
+#define SLEEP_NS 10000000L     // Sleepers recheck at least this often
+#define SEG_LAP 32
+#define SEG_CAP (SEG_LAP - 1)  // Slots per segment
+#define SEG_SHIFT 1
+#define SEG_HAS_NEXT 1         // Head position: the tail is in a later segment
+#define SLOT_WRITE 1
+#define SLOT_READ 2
+#define SLOT_DESTROY 4
+
+enum { CHAN_RING, CHAN_SPSC_RING, CHAN_SEGS, CHAN_SPSC_SEGS };
+
+typedef struct seg {
+    struct seg* next;
+    size_t written;            // spsc segments: slots filled
+    char slots[];              // SEG_CAP slots
+} seg_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int signaled;
+} waiter_t;
+
+typedef struct wait_node {
+    waiter_t* waiter;
+    struct wait_node* prev;
+    struct wait_node* next;
+} wait_node_t;
+
+struct come_chan {
+    // Producer side
+    size_t tail __attribute__((aligned(64)));  // Next write position
+    seg_t* tail_seg;
+    size_t head_cache;                         // spsc ring: head as last read
+    // Consumer side
+    size_t head __attribute__((aligned(64)));  // Next read position
+    seg_t* head_seg;
+    size_t tail_cache;                         // spsc ring: tail as last read
+    // Read-mostly
+    int kind __attribute__((aligned(64)));
+    int flags;
+    int closed;
+    size_t elem_size;
+    size_t value_off;          // Slot layout: a sequence or state word, then the value
+    size_t stride;
+    size_t mask;               // Rings: capacity - 1
+    char* slots;
+    void* block;               // The allocation this struct sits in
+    // Sleepers
+    int sleepers __attribute__((aligned(64)));  // Wait nodes linked in (atomic)
+    pthread_mutex_t wait_lock;
+    wait_node_t* waiters;
+};
+
+static char chan_drop;  // take() context when emptying a freed channel
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void die_oom(void) {
+    fprintf(stderr, "come: out of memory in a channel\n");
+    abort();
+}
+
+static inline void put(come_chan_t* ch, char* slot, const void* value) {
+    if (ch->flags & COME_CHAN_OBJECT) *(void**)slot = mem_talloc_export(*(void* const*)value);
+    else memcpy(slot, value, ch->elem_size);
+}
+
+static inline void take(come_chan_t* ch, const char* slot, void* out, void* ctx) {
+    if (!(ch->flags & COME_CHAN_OBJECT)) memcpy(out, slot, ch->elem_size);
+    else if (ctx == &chan_drop) mem_talloc_free(*(void* const*)slot);
+    else *(void**)out = mem_talloc_import(ctx, *(void* const*)slot);
+}
+
+
+// Bounded MPMC ring
+
+static int ring_push(come_chan_t* ch, const void* value) {
+    size_t pos = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        char* slot = ch->slots + (pos & ch->mask) * ch->stride;
+        size_t seq = __atomic_load_n((size_t*)slot, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ch->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                put(ch, slot + ch->value_off, value);
+                __atomic_store_n((size_t*)slot, pos + 1, __ATOMIC_RELEASE);
+                return COME_CHAN_OK;
+            }
+        } else if (dif < 0) {
+            return COME_CHAN_WOULD_BLOCK;
+        } else {
+            pos = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int ring_pop(come_chan_t* ch, void* out, void* ctx) {
+    size_t pos = __atomic_load_n(&ch->head, __ATOMIC_RELAXED);
+    for (;;) {
+        char* slot = ch->slots + (pos & ch->mask) * ch->stride;
+        size_t seq = __atomic_load_n((size_t*)slot, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ch->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                take(ch, slot + ch->value_off, out, ctx);
+                __atomic_store_n((size_t*)slot, pos + ch->mask + 1, __ATOMIC_RELEASE);
+                return COME_CHAN_OK;
+            }
+        } else if (dif < 0) {
+            return COME_CHAN_WOULD_BLOCK;
+        } else {
+            pos = __atomic_load_n(&ch->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+// Bounded SPSC ring
+
+static int spsc_ring_push(come_chan_t* ch, const void* value) {
+    size_t t = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+    if (t - ch->head_cache > ch->mask) {
+        ch->head_cache = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE);
+        if (t - ch->head_cache > ch->mask) return COME_CHAN_WOULD_BLOCK;
+    }
+    put(ch, ch->slots + (t & ch->mask) * ch->stride, value);
+    __atomic_store_n(&ch->tail, t + 1, __ATOMIC_RELEASE);
+    return COME_CHAN_OK;
+}
+
+static int spsc_ring_pop(come_chan_t* ch, void* out, void* ctx) {
+    size_t h = __atomic_load_n(&ch->head, __ATOMIC_RELAXED);
+    if (h == ch->tail_cache) {
+        ch->tail_cache = __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+        if (h == ch->tail_cache) return COME_CHAN_WOULD_BLOCK;
+    }
+    take(ch, ch->slots + (h & ch->mask) * ch->stride, out, ctx);
+    __atomic_store_n(&ch->head, h + 1, __ATOMIC_RELEASE);
+    return COME_CHAN_OK;
+}
+
+
+// Unbounded MPMC segments
+
+static seg_t* seg_new(come_chan_t* ch) {
+    seg_t* seg = calloc(1, sizeof(seg_t) + SEG_CAP * ch->stride);
+    if (!seg) die_oom();
+    return seg;
+}
+
+static inline char* seg_slot(come_chan_t* ch, seg_t* seg, size_t i) {
+    return seg->slots + i * ch->stride;
+}
+
+// Frees seg once slots from start on are read; a slot still being read is
+// marked so its reader carries on from there
+static void seg_destroy(come_chan_t* ch, seg_t* seg, size_t start) {
+    for (size_t i = start; i < SEG_CAP - 1; i++) {
+        size_t* state = (size_t*)seg_slot(ch, seg, i);
+        if (!(__atomic_load_n(state, __ATOMIC_ACQUIRE) & SLOT_READ) &&
+            !(__atomic_fetch_or(state, SLOT_DESTROY, __ATOMIC_ACQ_REL) & SLOT_READ)) {
+            return;
+        }
+    }
+    free(seg);
+}
+
+static int segs_push(come_chan_t* ch, const void* value) {
+    size_t tail = __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+    seg_t* seg = __atomic_load_n(&ch->tail_seg, __ATOMIC_ACQUIRE);
+    seg_t* next = NULL;
+    for (;;) {
+        size_t offset = (tail >> SEG_SHIFT) % SEG_LAP;
+        if (offset == SEG_CAP) {
+            // Another sender is installing the next segment
+            cpu_relax();
+            tail = __atomic_load_n(&ch->tail, __ATOMIC_ACQUIRE);
+            seg = __atomic_load_n(&ch->tail_seg, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        // Taking the last slot means installing the next segment: have it ready
+        if (offset + 1 == SEG_CAP && !next) next = seg_new(ch);
+        size_t new_tail = tail + (1 << SEG_SHIFT);
+        if (__atomic_compare_exchange_n(&ch->tail, &tail, new_tail, 1, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+            if (offset + 1 == SEG_CAP) {
+                __atomic_store_n(&ch->tail_seg, next, __ATOMIC_RELEASE);
+                __atomic_store_n(&ch->tail, new_tail + (1 << SEG_SHIFT), __ATOMIC_RELEASE);
+                __atomic_store_n(&seg->next, next, __ATOMIC_RELEASE);
+                next = NULL;
+            }
+            char* slot = seg_slot(ch, seg, offset);
+            put(ch, slot + ch->value_off, value);
+            __atomic_fetch_or((size_t*)slot, SLOT_WRITE, __ATOMIC_RELEASE);
+            free(next);
+            return COME_CHAN_OK;
+        }
+        seg = __atomic_load_n(&ch->tail_seg, __ATOMIC_ACQUIRE);
+        cpu_relax();
+    }
+}
+
+static int segs_pop(come_chan_t* ch, void* out, void* ctx) {
+    size_t head = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE);
+    seg_t* seg = __atomic_load_n(&ch->head_seg, __ATOMIC_ACQUIRE);
+    for (;;) {
+        size_t offset = (head >> SEG_SHIFT) % SEG_LAP;
+        if (offset == SEG_CAP) {
+            cpu_relax();
+            head = __atomic_load_n(&ch->head, __ATOMIC_ACQUIRE);
+            seg = __atomic_load_n(&ch->head_seg, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        size_t new_head = head + (1 << SEG_SHIFT);
+        if (!(new_head & SEG_HAS_NEXT)) {
+            // Same segment as the tail, maybe: compare positions
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            size_t tail = __atomic_load_n(&ch->tail, __ATOMIC_RELAXED);
+            if (head >> SEG_SHIFT == tail >> SEG_SHIFT) return COME_CHAN_WOULD_BLOCK;
+            if ((head >> SEG_SHIFT) / SEG_LAP != (tail >> SEG_SHIFT) / SEG_LAP) new_head |= SEG_HAS_NEXT;
+        }
+        if (__atomic_compare_exchange_n(&ch->head, &head, new_head, 1, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)) {
+            if (offset + 1 == SEG_CAP) {
+                seg_t* next;
+                while (!(next = __atomic_load_n(&seg->next, __ATOMIC_ACQUIRE))) cpu_relax();
+                size_t next_head = (new_head & ~(size_t)SEG_HAS_NEXT) + (1 << SEG_SHIFT);
+                if (__atomic_load_n(&next->next, __ATOMIC_RELAXED)) next_head |= SEG_HAS_NEXT;
+                __atomic_store_n(&ch->head_seg, next, __ATOMIC_RELEASE);
+                __atomic_store_n(&ch->head, next_head, __ATOMIC_RELEASE);
+            }
+            char* slot = seg_slot(ch, seg, offset);
+            while (!(__atomic_load_n((size_t*)slot, __ATOMIC_ACQUIRE) & SLOT_WRITE)) cpu_relax();
+            take(ch, slot + ch->value_off, out, ctx);
+            if (offset + 1 == SEG_CAP) {
+                seg_destroy(ch, seg, 0);
+            } else if (__atomic_fetch_or((size_t*)slot, SLOT_READ, __ATOMIC_ACQ_REL) & SLOT_DESTROY) {
+                seg_destroy(ch, seg, offset + 1);
+            }
+            return COME_CHAN_OK;
+        }
+        seg = __atomic_load_n(&ch->head_seg, __ATOMIC_ACQUIRE);
+        cpu_relax();
+    }
+}
+
+
+// Unbounded SPSC segments: head counts slots read in head_seg
+
+static int spsc_segs_push(come_chan_t* ch, const void* value) {
+    seg_t* seg = ch->tail_seg;
+    size_t w = __atomic_load_n(&seg->written, __ATOMIC_RELAXED);
+    if (w == SEG_CAP) {
+        seg_t* next = seg_new(ch);
+        __atomic_store_n(&seg->next, next, __ATOMIC_RELEASE);
+        ch->tail_seg = seg = next;
+        w = 0;
+    }
+    put(ch, seg_slot(ch, seg, w), value);
+    __atomic_store_n(&seg->written, w + 1, __ATOMIC_RELEASE);
+    return COME_CHAN_OK;
+}
+
+static int spsc_segs_pop(come_chan_t* ch, void* out, void* ctx) {
+    seg_t* seg = ch->head_seg;
+    if (ch->head == SEG_CAP) {
+        seg_t* next = __atomic_load_n(&seg->next, __ATOMIC_ACQUIRE);
+        if (!next) return COME_CHAN_WOULD_BLOCK;
+        free(seg);
+        ch->head_seg = seg = next;
+        ch->head = 0;
+    }
+    if (ch->head == __atomic_load_n(&seg->written, __ATOMIC_ACQUIRE)) return COME_CHAN_WOULD_BLOCK;
+    take(ch, seg_slot(ch, seg, ch->head), out, ctx);
+    ch->head++;
+    return COME_CHAN_OK;
+}
+
+
+static inline int chan_push(come_chan_t* ch, const void* value) {
+    switch (ch->kind) {
+        case CHAN_RING: return ring_push(ch, value);
+        case CHAN_SPSC_RING: return spsc_ring_push(ch, value);
+        case CHAN_SEGS: return segs_push(ch, value);
+        default: return spsc_segs_push(ch, value);
+    }
+}
+
+static inline int chan_pop(come_chan_t* ch, void* out, void* ctx) {
+    switch (ch->kind) {
+        case CHAN_RING: return ring_pop(ch, out, ctx);
+        case CHAN_SPSC_RING: return spsc_ring_pop(ch, out, ctx);
+        case CHAN_SEGS: return segs_pop(ch, out, ctx);
+        default: return spsc_segs_pop(ch, out, ctx);
+    }
+}
+
+static int chan_destroy(void* block) {
+    come_chan_t* ch = (come_chan_t*)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+    char scratch[ch->elem_size];
+    while (chan_pop(ch, scratch, &chan_drop) == COME_CHAN_OK) {
+    }
+    if (ch->kind == CHAN_RING || ch->kind == CHAN_SPSC_RING) {
+        free(ch->slots);
+    } else {
+        seg_t* seg = ch->head_seg;
+        while (seg) {
+            seg_t* next = seg->next;
+            free(seg);
+            seg = next;
+        }
+    }
+    pthread_mutex_destroy(&ch->wait_lock);
+    return 0;
+}
+
+come_chan_t* come_chan_new(void* ctx, size_t elem_size, long capacity, int flags) {
+    if (flags & COME_CHAN_OBJECT) elem_size = sizeof(void*);
+    if (elem_size == 0) return NULL;
+    // Over-allocated so the struct starts on a cache line
+    void* block = mem_talloc_alloc(ctx, sizeof(come_chan_t) + 63);
+    if (!block) return NULL;
+    come_chan_t* ch = (come_chan_t*)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+    memset(ch, 0, sizeof(*ch));
+    ch->block = block;
+    ch->flags = flags;
+    ch->elem_size = elem_size;
+    int spsc = (flags & COME_CHAN_SPSC) != 0;
+    ch->value_off = spsc ? 0 : sizeof(size_t);
+    ch->stride = ch->value_off + ((elem_size + 7) & ~(size_t)7);
+    if (capacity > 0) {
+        size_t cap = 2;
+        while (cap < (size_t)capacity) cap <<= 1;
+        ch->kind = spsc ? CHAN_SPSC_RING : CHAN_RING;
+        ch->mask = cap - 1;
+        ch->slots = aligned_alloc(64, (cap * ch->stride + 63) & ~(size_t)63);
+        if (!ch->slots) die_oom();
+        if (!spsc) {
+            for (size_t i = 0; i < cap; i++) *(size_t*)(ch->slots + i * ch->stride) = i;
+        }
+    } else {
+        ch->kind = spsc ? CHAN_SPSC_SEGS : CHAN_SEGS;
+        ch->head_seg = ch->tail_seg = seg_new(ch);
+    }
+    pthread_mutex_init(&ch->wait_lock, NULL);
+    mem_talloc_set_destructor(block, chan_destroy);
+    return ch;
+}
+
+
+// Sleeping. A sleeper links its node and bumps sleepers before trying its
+// cases once more; a send, recv or close makes its change and then, after a
+// full fence, checks sleepers. One of the two sees the other.
+
+static void notify(come_chan_t* ch) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ch->sleepers, __ATOMIC_RELAXED) == 0) return;
+    pthread_mutex_lock(&ch->wait_lock);
+    for (wait_node_t* n = ch->waiters; n; n = n->next) {
+        pthread_mutex_lock(&n->waiter->lock);
+        n->waiter->signaled = 1;
+        pthread_cond_signal(&n->waiter->cond);
+        pthread_mutex_unlock(&n->waiter->lock);
+    }
+    pthread_mutex_unlock(&ch->wait_lock);
+}
+
+static void wait_link(come_chan_t* ch, wait_node_t* n) {
+    pthread_mutex_lock(&ch->wait_lock);
+    n->prev = NULL;
+    n->next = ch->waiters;
+    if (n->next) n->next->prev = n;
+    ch->waiters = n;
+    pthread_mutex_unlock(&ch->wait_lock);
+    __atomic_add_fetch(&ch->sleepers, 1, __ATOMIC_SEQ_CST);
+}
+
+static void wait_unlink(come_chan_t* ch, wait_node_t* n) {
+    pthread_mutex_lock(&ch->wait_lock);
+    if (n->prev) n->prev->next = n->next;
+    else ch->waiters = n->next;
+    if (n->next) n->next->prev = n->prev;
+    pthread_mutex_unlock(&ch->wait_lock);
+    __atomic_sub_fetch(&ch->sleepers, 1, __ATOMIC_SEQ_CST);
+}
+
+static void wait_sleep(waiter_t* w) {
+    pthread_mutex_lock(&w->lock);
+    if (!w->signaled) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += SLEEP_NS;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&w->cond, &w->lock, &until);
+    }
+    w->signaled = 0;
+    pthread_mutex_unlock(&w->lock);
+}
+
+
+// Operations
+
+static int case_try(come_chan_case_t* c, void* ctx) {
+    come_chan_t* ch = c->chan;
+    if (c->send) {
+        if (__atomic_load_n(&ch->closed, __ATOMIC_ACQUIRE)) return COME_CHAN_CLOSED;
+        if (chan_push(ch, c->value) != COME_CHAN_OK) return COME_CHAN_WOULD_BLOCK;
+        notify(ch);
+        return COME_CHAN_OK;
+    }
+    int r = chan_pop(ch, c->value, ctx);
+    if (r != COME_CHAN_OK) {
+        if (!__atomic_load_n(&ch->closed, __ATOMIC_ACQUIRE)) return COME_CHAN_WOULD_BLOCK;
+        // Closed: take what was sent before the close first
+        r = chan_pop(ch, c->value, ctx);
+        if (r != COME_CHAN_OK) {
+            memset(c->value, 0, ch->elem_size);
+            return COME_CHAN_CLOSED;
+        }
+    }
+    // Only a bounded channel has senders waiting for room
+    if (ch->kind == CHAN_RING || ch->kind == CHAN_SPSC_RING) notify(ch);
+    return COME_CHAN_OK;
+}
+
+static __thread unsigned co_select_turn = 0;
+
+int come_chan_select(come_chan_case_t* cases, int n, int block, void* ctx) {
+    if (n <= 0) return -1;
+    int start = (int)(co_select_turn++ % (unsigned)n);
+    int ran = -1;
+    int spins = 0;
+    int linked = 0;
+    waiter_t w;
+    wait_node_t nodes[n];
+    for (;;) {
+        for (int k = 0; k < n && ran < 0; k++) {
+            int i = (start + k) % n;
+            int r = case_try(&cases[i], ctx);
+            if (r != COME_CHAN_WOULD_BLOCK) {
+                cases[i].closed = r == COME_CHAN_CLOSED;
+                ran = i;
+            }
+        }
+        if (ran >= 0 || !block) break;
+        if (spins < SPIN_ROUNDS) {
+            spins++;
+            cpu_relax();
+        } else if (!linked) {
+            pthread_mutex_init(&w.lock, NULL);
+            pthread_cond_init(&w.cond, NULL);
+            w.signaled = 0;
+            for (int i = 0; i < n; i++) {
+                nodes[i].waiter = &w;
+                wait_link(cases[i].chan, &nodes[i]);
+            }
+            linked = 1;
+        } else {
+            wait_sleep(&w);
+        }
+    }
+    if (linked) {
+        for (int i = 0; i < n; i++) wait_unlink(cases[i].chan, &nodes[i]);
+        pthread_cond_destroy(&w.cond);
+        pthread_mutex_destroy(&w.lock);
+    }
+    return ran;
+}
+
+int come_chan_send(come_chan_t* ch, const void* value) {
+    come_chan_case_t c = { ch, (void*)value, 1, 0 };
+    int r = case_try(&c, NULL);
+    if (r != COME_CHAN_WOULD_BLOCK) return r;
+    come_chan_select(&c, 1, 1, NULL);
+    return c.closed ? COME_CHAN_CLOSED : COME_CHAN_OK;
+}
+
+int come_chan_try_send(come_chan_t* ch, const void* value) {
+    come_chan_case_t c = { ch, (void*)value, 1, 0 };
+    return case_try(&c, NULL);
+}
+
+int come_chan_recv(come_chan_t* ch, void* out, void* ctx) {
+    come_chan_case_t c = { ch, out, 0, 0 };
+    int r = case_try(&c, ctx);
+    if (r != COME_CHAN_WOULD_BLOCK) return r;
+    come_chan_select(&c, 1, 1, ctx);
+    return c.closed ? COME_CHAN_CLOSED : COME_CHAN_OK;
+}
+
+int come_chan_try_recv(come_chan_t* ch, void* out, void* ctx) {
+    come_chan_case_t c = { ch, out, 0, 0 };
+    return case_try(&c, ctx);
+}
+
+void come_chan_close(come_chan_t* ch) {
+    __atomic_store_n(&ch->closed, 1, __ATOMIC_RELEASE);
+    notify(ch);
+}
+
+int come_chan_closed(const come_chan_t* ch) {
+    return __atomic_load_n(&ch->closed, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "come_sched.h"
+
+// Work-stealing scheduler: per-worker Chase-Lev deques ("Correct and
+// Efficient Work-Stealing for Weak Memory Models", Le et al., PPoPP 2013)
+// plus a mutex-protected injection queue for tasks from other threads.
+
+#define SPIN_ROUNDS 64         // Empty find_work rounds before a worker sleeps
+#define SLEEP_NS 10000000L     // Sleepers re-check for work at least this often
+#define DEQUE_INITIAL 256
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static void die_oom(void) {
+    fprintf(stderr, "come: out of memory running a task\n");
+    abort();
+}
+
+// Deque
+
+typedef struct deque_buf {
+    long size;                 // Power of two
+    struct deque_buf* prev;    // Retired buffers, freed with the deque
+    come_sched_task_t* slots[];
+} deque_buf_t;
+
+typedef struct {
+    long top __attribute__((aligned(64)));     // Stealers take here (CAS)
+    long bottom __attribute__((aligned(64)));  // Owner pushes and pops here
+    deque_buf_t* buf;
+} deque_t;
+
+static deque_buf_t* buf_new(long size) {
+    deque_buf_t* b = malloc(sizeof(deque_buf_t) + size * sizeof(come_sched_task_t*));
+    if (!b) die_oom();
+    b->size = size;
+    b->prev = NULL;
+    return b;
+}
+
+static inline come_sched_task_t* buf_get(deque_buf_t* b, long i) {
+    return __atomic_load_n(&b->slots[i & (b->size - 1)], __ATOMIC_RELAXED);
+}
+
+static inline void buf_put(deque_buf_t* b, long i, come_sched_task_t* task) {
+    __atomic_store_n(&b->slots[i & (b->size - 1)], task, __ATOMIC_RELAXED);
+}
+
+static void deque_init(deque_t* q) {
+    q->top = 0;
+    q->bottom = 0;
+    q->buf = buf_new(DEQUE_INITIAL);
+}
+
+static void deque_destroy(deque_t* q) {
+    deque_buf_t* b = q->buf;
+    while (b) {
+        deque_buf_t* prev = b->prev;
+        free(b);
+        b = prev;
+    }
+    q->buf = NULL;
+}
+
+// Owner only. A full buffer is replaced by one twice its size; the old one
+// stays readable for stealers that loaded it before the switch.
+static void deque_push(deque_t* q, come_sched_task_t* task) {
+    long b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+    deque_buf_t* a = __atomic_load_n(&q->buf, __ATOMIC_RELAXED);
+    if (b - t > a->size - 1) {
+        deque_buf_t* grown = buf_new(a->size * 2);
+        for (long i = t; i < b; i++) buf_put(grown, i, buf_get(a, i));
+        grown->prev = a;
+        __atomic_store_n(&q->buf, grown, __ATOMIC_RELEASE);
+        a = grown;
+    }
+    buf_put(a, b, task);
+    __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+// Owner only: newest first
+static come_sched_task_t* deque_pop(deque_t* q) {
+    long b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED) - 1;
+    deque_buf_t* a = __atomic_load_n(&q->buf, __ATOMIC_RELAXED);
+    __atomic_store_n(&q->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&q->top, __ATOMIC_RELAXED);
+    come_sched_task_t* task = NULL;
+    if (t <= b) {
+        task = buf_get(a, b);
+        if (t == b) {
+            // Last one: race the stealers for it
+            if (!__atomic_compare_exchange_n(&q->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                task = NULL;
+            }
+            __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    } else {
+        __atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+// Any thread: oldest first. *lost is set when another thread won the race.
+static come_sched_task_t* deque_steal(deque_t* q, bool* lost) {
+    long t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return NULL;
+    deque_buf_t* a = __atomic_load_n(&q->buf, __ATOMIC_ACQUIRE);
+    come_sched_task_t* task = buf_get(a, t);
+    if (!__atomic_compare_exchange_n(&q->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        *lost = true;
+        return NULL;
+    }
+    return task;
+}
+
+static bool deque_empty(deque_t* q) {
+    return __atomic_load_n(&q->top, __ATOMIC_ACQUIRE) >= __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+}
+
+// Workers
+
+typedef struct {
+    deque_t deque;
+    pthread_t thread;
+} worker_t;
+
+static worker_t* co_workers = NULL;
+static int co_nworkers = 0;
+static int co_started = 0;
+static int co_stopping = 0;
+static pthread_mutex_t co_start_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread worker_t* co_self = NULL;
+static __thread unsigned co_rng = 0;
+
+// Injection queue: spawns from threads that are not workers
+static pthread_mutex_t co_inject_lock = PTHREAD_MUTEX_INITIALIZER;
+static come_sched_task_t* co_inject_head = NULL;
+static come_sched_task_t* co_inject_tail = NULL;
+static long co_inject_len = 0;
+
+// Idle workers sleep here
+static pthread_mutex_t co_idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t co_idle_cond = PTHREAD_COND_INITIALIZER;
+static int co_sleepers = 0;
+
+static void inject(come_sched_task_t* task) {
+    task->next = NULL;
+    pthread_mutex_lock(&co_inject_lock);
+    if (co_inject_tail) co_inject_tail->next = task;
+    else co_inject_head = task;
+    co_inject_tail = task;
+    __atomic_store_n(&co_inject_len, co_inject_len + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&co_inject_lock);
+}
+
+static come_sched_task_t* take_injected(void) {
+    if (__atomic_load_n(&co_inject_len, __ATOMIC_ACQUIRE) == 0) return NULL;
+    pthread_mutex_lock(&co_inject_lock);
+    come_sched_task_t* task = co_inject_head;
+    if (task) {
+        co_inject_head = task->next;
+        if (!co_inject_head) co_inject_tail = NULL;
+        __atomic_store_n(&co_inject_len, co_inject_len - 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&co_inject_lock);
+    return task;
+}
+
+static unsigned next_random(void) {
+    if (!co_rng) co_rng = (unsigned)(uintptr_t)&co_rng | 1;
+    co_rng ^= co_rng << 13;
+    co_rng ^= co_rng >> 17;
+    co_rng ^= co_rng << 5;
+    return co_rng;
+}
+
+// Own deque first, then the injection queue, then a sweep of victims
+// starting at a random one
+static come_sched_task_t* find_work(void) {
+    come_sched_task_t* task;
+    if (co_self && (task = deque_pop(&co_self->deque))) return task;
+    if ((task = take_injected())) return task;
+    int n = co_nworkers;
+    if (n == 0) return NULL;
+    bool lost;
+    do {
+        lost = false;
+        int start = next_random() % n;
+        for (int i = 0; i < n; i++) {
+            worker_t* victim = &co_workers[(start + i) % n];
+            if (victim == co_self) continue;
+            if ((task = deque_steal(&victim->deque, &lost))) return task;
+        }
+    } while (lost);
+    return NULL;
+}
+
+static bool has_work(void) {
+    if (__atomic_load_n(&co_inject_len, __ATOMIC_ACQUIRE) > 0) return true;
+    for (int i = 0; i < co_nworkers; i++) {
+        if (!deque_empty(&co_workers[i].deque)) return true;
+    }
+    return false;
+}
+
+static void wake_one(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&co_sleepers, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&co_idle_lock);
+        pthread_cond_signal(&co_idle_cond);
+        pthread_mutex_unlock(&co_idle_lock);
+    }
+}
+
+// The task's context comes from the running thread's root; the handoff
+// detaches it and moves it to the joiner
+static void run_task(come_sched_task_t* task) {
+    task->ctx = mem_talloc_new_ctx(NULL);
+    if (!task->ctx) die_oom();
+    task->run(task);
+    if (mem_talloc_handoff_push(&task->done, task->ctx, task->result) != 0) die_oom();
+}
+
+static void* worker_main(void* arg) {
+    co_self = arg;
+    mem_talloc_module_init();
+    int idle = 0;
+    while (!__atomic_load_n(&co_stopping, __ATOMIC_ACQUIRE)) {
+        come_sched_task_t* task = find_work();
+        if (task) {
+            run_task(task);
+            idle = 0;
+            continue;
+        }
+        if (++idle < SPIN_ROUNDS) {
+            cpu_relax();
+            continue;
+        }
+        // Sleepers is raised before the last look for work, and spawners
+        // check it after queueing, so a wakeup cannot be missed
+        pthread_mutex_lock(&co_idle_lock);
+        __atomic_add_fetch(&co_sleepers, 1, __ATOMIC_SEQ_CST);
+        if (!has_work() && !__atomic_load_n(&co_stopping, __ATOMIC_ACQUIRE)) {
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += SLEEP_NS;
+            if (until.tv_nsec >= 1000000000L) { until.tv_sec++; until.tv_nsec -= 1000000000L; }
+            pthread_cond_timedwait(&co_idle_cond, &co_idle_lock, &until);
+        }
+        __atomic_sub_fetch(&co_sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&co_idle_lock);
+        idle = 0;
+    }
+    return NULL;
+}
+
+void come_sched_start(int workers) {
+    pthread_mutex_lock(&co_start_lock);
+    if (co_started) {
+        pthread_mutex_unlock(&co_start_lock);
+        return;
+    }
+    if (workers <= 0) {
+        const char* env = getenv("COME_WORKERS");
+        workers = env ? atoi(env) : 0;
+        if (workers <= 0) workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (workers <= 0) workers = 1;
+    }
+    co_workers = calloc(workers, sizeof(worker_t));
+    if (!co_workers) die_oom();
+    for (int i = 0; i < workers; i++) deque_init(&co_workers[i].deque);
+    co_nworkers = workers;
+    __atomic_store_n(&co_stopping, 0, __ATOMIC_RELEASE);
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&co_workers[i].thread, NULL, worker_main, &co_workers[i]) != 0) {
+            fprintf(stderr, "come: cannot start scheduler worker %d\n", i);
+            abort();
+        }
+    }
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        atexit(come_sched_shutdown);
+    }
+    __atomic_store_n(&co_started, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&co_start_lock);
+}
+
+void come_sched_shutdown(void) {
+    pthread_mutex_lock(&co_start_lock);
+    if (!co_started || co_self) {
+        pthread_mutex_unlock(&co_start_lock);
+        return;
+    }
+    __atomic_store_n(&co_stopping, 1, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&co_idle_lock);
+    pthread_cond_broadcast(&co_idle_cond);
+    pthread_mutex_unlock(&co_idle_lock);
+    for (int i = 0; i < co_nworkers; i++) pthread_join(co_workers[i].thread, NULL);
+    for (int i = 0; i < co_nworkers; i++) deque_destroy(&co_workers[i].deque);
+    free(co_workers);
+    co_workers = NULL;
+    co_nworkers = 0;
+    co_inject_head = co_inject_tail = NULL;
+    co_inject_len = 0;
+    __atomic_store_n(&co_started, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&co_start_lock);
+}
+
+int come_sched_workers(void) {
+    return __atomic_load_n(&co_started, __ATOMIC_ACQUIRE) ? co_nworkers : 0;
+}
+
+void come_sched_spawn(come_sched_task_t* task) {
+    if (!__atomic_load_n(&co_started, __ATOMIC_ACQUIRE)) come_sched_start(0);
+    if (co_self) deque_push(&co_self->deque, task);
+    else inject(task);
+    wake_one();
+}
+
+// Waits for a task and takes its context, re-parented under ctx
+static void* wait_done(come_sched_task_t* task, void* ctx, void** result) {
+    void* tree;
+    int idle = 0;
+    while (!(tree = mem_talloc_handoff_take(&task->done, ctx, result))) {
+        // Workers run other tasks while they wait. Other threads only wait:
+        // helping there would nest whole stolen subtrees on their stack.
+        come_sched_task_t* other = co_self ? find_work() : NULL;
+        if (other) {
+            run_task(other);
+            idle = 0;
+        } else if (++idle < SPIN_ROUNDS) {
+            cpu_relax();
+        } else {
+            sched_yield();
+        }
+    }
+    return tree;
+}
+
+void come_sched_join(come_sched_task_t* task, void* ctx) {
+    void* result = NULL;
+    void* tree = wait_done(task, ctx, &result);
+    // The result moves to the joiner; the task's scratch goes with its context
+    if (result) mem_talloc_steal(ctx, result);
+    mem_talloc_free(tree);
+}
+
+// Parallel loops: one task per participant, all spawned and then joined by
+// the calling thread
+
+typedef struct {
+    const come_parallel_for_t* loop;
+    long next __attribute__((aligned(64)));  // Dynamic: first unclaimed iteration
+} loop_state_t;
+
+typedef struct {
+    come_sched_task_t task;
+    loop_state_t* state;
+    int index;
+} participant_t;
+
+static void participant_run(come_sched_task_t* task) {
+    participant_t* self = (participant_t*)task;
+    const come_parallel_for_t* loop = self->state->loop;
+    void* slot = loop->slots ? (char*)loop->slots + self->index * loop->slot_size : NULL;
+    long lo = loop->lo, hi = loop->hi, chunk = loop->chunk;
+    if (loop->dynamic) {
+        for (;;) {
+            long start = __atomic_fetch_add(&self->state->next, chunk, __ATOMIC_RELAXED);
+            if (start >= hi) break;
+            loop->body(loop->env, start, start + chunk < hi ? start + chunk : hi, slot, task->ctx);
+        }
+    } else if (chunk <= 0) {
+        long len = hi - lo, width = loop->width;
+        long start = lo + len * self->index / width;
+        long end = lo + len * (self->index + 1) / width;
+        if (start < end) loop->body(loop->env, start, end, slot, task->ctx);
+    } else {
+        long stride = chunk * loop->width;
+        for (long start = lo + chunk * self->index; start < hi; start += stride) {
+            loop->body(loop->env, start, start + chunk < hi ? start + chunk : hi, slot, task->ctx);
+        }
+    }
+}
+
+int come_parallel_width(void) {
+    if (!__atomic_load_n(&co_started, __ATOMIC_ACQUIRE)) come_sched_start(0);
+    return co_nworkers;
+}
+
+void come_parallel_for(const come_parallel_for_t* loop) {
+    if (loop->hi <= loop->lo || loop->width <= 0) return;
+    loop_state_t state = { loop, loop->lo };
+    come_parallel_for_t tuned;
+    if (loop->dynamic && loop->chunk <= 0) {
+        // About eight blocks per participant balances well without much contention
+        tuned = *loop;
+        tuned.chunk = (loop->hi - loop->lo) / (loop->width * 8L);
+        if (tuned.chunk < 1) tuned.chunk = 1;
+        state.loop = &tuned;
+    }
+    participant_t* parts = calloc(loop->width, sizeof(participant_t));
+    if (!parts) die_oom();
+    for (int i = 0; i < loop->width; i++) {
+        parts[i].task.run = participant_run;
+        parts[i].state = &state;
+        parts[i].index = i;
+        come_sched_spawn(&parts[i].task);
+    }
+    // What the body allocated may be stored in captured variables, so the
+    // participant contexts stay alive under the caller's
+    for (int i = loop->width - 1; i >= 0; i--) {
+        void* tree = wait_done(&parts[i].task, loop->ctx, NULL);
+        if (!loop->ctx) mem_talloc_free(tree);
+    }
+    free(parts);
+}
@@ -32,15 +32,27 @@ struct come_std__ERR_t {
 
 typedef struct come_std__ERR_t come_std__ERR_t;
 
-// Global ERR instance - exported as 'ERR' in std.co
-come_std__ERR_t come_std__ERR;
+// ERR instance - exported as 'ERR' in std.co. Per thread, like errno: it
+// starts zeroed and its str is pointed at its buffer on first use.
+__thread come_std__ERR_t come_std__ERR;
 
 
-// Pre-instantiated FILE objects: in, out, err
+// Pre-instantiated FILE objects: in, out, err. Shared by all threads; they
+// are set before main() and only read after that (stdio locks each stream).
 come_std__FILE_t std_in;
 come_std__FILE_t std_out;
 come_std__FILE_t std_err;
 
+__attribute__((constructor))
+static void come_std__files_init(void) {
+    std_in.fp = stdin;
+    std_in.fd = 0;
+    std_out.fp = stdout;
+    std_out.fd = 1;
+    std_err.fp = stderr;
+    std_err.fd = 2;
+}
+
 // Helper function to convert format string for COME types
 // Converts %t/%T to %s (for bool) and %c to %lc (for wchar)
 static char* come_convert_format(const char* fmt) {
@@ -87,22 +99,13 @@ static char* come_convert_format(const char* fmt) {
 // Helper to extract C string from come_string_t
 static const char* come_string_to_cstr(come_string_t* s) {
     if (!s) return "(null)";
-    // come_string_t has: uint32_t size, uint32_t count, char data[]
-    // Offset past the header to get to the char array
-    return (const char*)&s->data[0];
+    // Views are not NUL-terminated in place; come_string_cstr handles both kinds
+    return come_string_cstr(s);
 }
 
 // Module Initialization
 void come_std__init_local() {
-    // Initialize FILE objects
-    std_in.fp = stdin;
-    std_in.fd = 0;
-    std_out.fp = stdout;
-    std_out.fd = 1;
-    std_err.fp = stderr;
-    std_err.fd = 2;
-    
-    // Initialize ERR object
+    // Reset the calling thread's ERR object
     memset(&come_std__ERR, 0, sizeof(come_std__ERR));
     come_std__ERR.str = (come_string_t*)come_std__ERR.buffer;
     come_std__ERR.str->size = sizeof(come_std__ERR.buffer);
@@ -312,10 +315,10 @@ void come_std__ERR_t__clear(come_std__ERR_t* self) {
 
     self->no = 0;
     errno = 0;
-    if (self->str) {
-        self->str->count = 0;
-        self->str->data[0] = '\0';
-    }
+    self->str = (come_string_t*)self->buffer;
+    self->str->size = (uint32_t)(sizeof(self->buffer));
+    self->str->count = 0;
+    self->str->data[0] = '\0';
 }
 
 // Wrapper functions for global ERR object access
@@ -0,0 +1,287 @@
+#include "casemap.h"
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define COME_CASEMAP_X86 1
+#endif
+
+#include "casetab.h"
+
+// Invalid bytes decode to RUNE_BAD + byte: never mapped, never equal to a rune
+#define RUNE_BAD 0x110000u
+
+
+// Runes
+
+static inline uint32_t case_rune(uint32_t r, come_case_t to) {
+    if (r < 0x80) {
+        if (to == COME_CASE_UPPER) return (r >= 'a' && r <= 'z') ? r - 0x20 : r;
+        return (r >= 'A' && r <= 'Z') ? r + 0x20 : r;
+    }
+    if (r >= CASE_LIMIT) return r;
+    return r + case_deltas[case_blocks[case_index[r >> CASE_SHIFT]][r & CASE_MASK]][to];
+}
+
+uint32_t come_case_rune(uint32_t r, come_case_t to) {
+    return case_rune(r, to);
+}
+
+// Decodes the rune at s[i] (i < len) and returns its length in bytes.
+// Ill-formed sequences (Unicode Table 3-7) decode one byte at a time.
+static inline size_t decode(const unsigned char* s, size_t i, size_t len, uint32_t* r) {
+    unsigned c = s[i];
+    unsigned lo = 0x80, hi = 0xBF;
+    uint32_t cp;
+    size_t need;
+    if (c < 0x80) {
+        *r = c;
+        return 1;
+    }
+    if (c >= 0xC2 && c <= 0xDF) { need = 1; cp = c & 0x1F; }
+    else if (c >= 0xE0 && c <= 0xEF) {
+        need = 2;
+        cp = c & 0x0F;
+        if (c == 0xE0) lo = 0xA0;
+        else if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        need = 3;
+        cp = c & 0x07;
+        if (c == 0xF0) lo = 0x90;
+        else if (c == 0xF4) hi = 0x8F;
+    } else goto bad;
+
+    if (len - i <= need || s[i + 1] < lo || s[i + 1] > hi) goto bad;
+    cp = cp << 6 | (s[i + 1] & 0x3F);
+    for (size_t k = 2; k <= need; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) goto bad;
+        cp = cp << 6 | (s[i + k] & 0x3F);
+    }
+    *r = cp;
+    return need + 1;
+bad:
+    *r = RUNE_BAD + c;
+    return 1;
+}
+
+static inline size_t rune_len(uint32_t r) {
+    return r < 0x80 ? 1 : r < 0x800 ? 2 : r < 0x10000 ? 3 : 4;
+}
+
+static inline void encode(char* d, uint32_t r) {
+    if (r < 0x80) {
+        d[0] = (char)r;
+    } else if (r < 0x800) {
+        d[0] = (char)(0xC0 | r >> 6);
+        d[1] = (char)(0x80 | (r & 0x3F));
+    } else if (r < 0x10000) {
+        d[0] = (char)(0xE0 | r >> 12);
+        d[1] = (char)(0x80 | (r >> 6 & 0x3F));
+        d[2] = (char)(0x80 | (r & 0x3F));
+    } else {
+        d[0] = (char)(0xF0 | r >> 18);
+        d[1] = (char)(0x80 | (r >> 12 & 0x3F));
+        d[2] = (char)(0x80 | (r >> 6 & 0x3F));
+        d[3] = (char)(0x80 | (r & 0x3F));
+    }
+}
+
+// Simple case folding: runes that are equal ignoring case fold to the same rune
+static inline uint32_t fold(uint32_t r) {
+    if (r < 0x80) return (r >= 'A' && r <= 'Z') ? r + 0x20 : r;
+    if (r >= RUNE_BAD) return r;
+    return case_rune(case_rune(r, COME_CASE_UPPER), COME_CASE_LOWER);
+}
+
+
+// Mapping
+// Output never runs ahead of input unless a rune grows, so dst may be s.
+
+// Maps the rune at s[i], returns its input length and advances *w by its output length
+static inline __attribute__((always_inline)) size_t map_step(char* dst, size_t cap, const unsigned char* s, size_t i, size_t len,
+                              come_case_t to, size_t* w) {
+    uint32_t r;
+    if (s[i] < 0x80) {
+        if (*w < cap) dst[*w] = (char)case_rune(s[i], to);
+        (*w)++;
+        return 1;
+    }
+    // Two-byte runes (Latin, Greek, Cyrillic...) map to two bytes but for a handful
+    if (s[i] >= 0xC2 && s[i] < 0xE0 && i + 1 < len && (s[i + 1] & 0xC0) == 0x80) {
+        uint32_t m = case_rune((s[i] & 0x1Fu) << 6 | (s[i + 1] & 0x3Fu), to);
+        if (__builtin_expect(m >= 0x80 && m < 0x800, 1)) {
+            if (*w + 2 <= cap) {
+                dst[*w] = (char)(0xC0 | m >> 6);
+                dst[*w + 1] = (char)(0x80 | (m & 0x3F));
+            }
+            *w += 2;
+            return 2;
+        }
+    }
+    size_t n = decode(s, i, len, &r);
+    if (r >= RUNE_BAD) {
+        if (*w < cap) dst[*w] = (char)s[i];
+        (*w)++;
+        return 1;
+    }
+    uint32_t m = case_rune(r, to);
+    size_t out = n;
+    // Almost every rune keeps its length; branching on that keeps the output
+    // position from waiting on the table lookup
+    if (__builtin_expect(rune_len(m) != n, 0)) out = rune_len(m);
+    if (*w + out <= cap) encode(dst + *w, m);
+    *w += out;
+    return n;
+}
+
+static size_t map_scalar(char* dst, size_t cap, const unsigned char* s, size_t len, come_case_t to, size_t i, size_t w) {
+    while (i < len) i += map_step(dst, cap, s, i, len, to, &w);
+    return w;
+}
+
+
+#ifdef COME_CASEMAP_X86
+
+// Flips bit 5 of the bytes in [lo, lo + 25] ('a' for upper, 'A' for lower)
+static inline __m128i ascii_case_sse2(__m128i b, char lo) {
+    __m128i x = _mm_add_epi8(b, _mm_set1_epi8((char)(0x80 - lo)));
+    __m128i in = _mm_cmpgt_epi8(_mm_set1_epi8(-128 + 26), x);
+    return _mm_xor_si128(b, _mm_and_si128(in, _mm_set1_epi8(0x20)));
+}
+
+// Each step converts the ASCII run at i with one block store, then maps the
+// runes that ended it. The store also covers bytes past the run, which is
+// harmless unless it would land on unread input (in place, after a rune shrank).
+static size_t map_sse2(char* dst, size_t cap, const unsigned char* s, size_t len, come_case_t to, size_t i, size_t w) {
+    const char lo = to == COME_CASE_UPPER ? 'a' : 'A';
+    while (i + 16 <= len) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + i));
+        unsigned mask = _mm_movemask_epi8(b);
+        size_t run = mask ? (size_t)__builtin_ctz(mask) : 16;
+        if (run && w + 16 <= cap && (mask == 0 || dst + w == (const char*)s + i || dst + w + 16 <= (const char*)s + i ||
+                              (const char*)s + len <= dst || dst + cap <= (const char*)s)) {
+            _mm_storeu_si128((__m128i*)(dst + w), ascii_case_sse2(b, lo));
+            i += run;
+            w += run;
+        } else {
+            size_t end = i + run;
+            while (i < end) i += map_step(dst, cap, s, i, len, to, &w);
+        }
+        // Then the whole non-ASCII stretch, which often spans several runes
+        while (i < len && s[i] >= 0x80) i += map_step(dst, cap, s, i, len, to, &w);
+    }
+    return map_scalar(dst, cap, s, len, to, i, w);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i ascii_case_avx2(__m256i b, char lo) {
+    __m256i x = _mm256_add_epi8(b, _mm256_set1_epi8((char)(0x80 - lo)));
+    __m256i in = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), x);
+    return _mm256_xor_si256(b, _mm256_and_si256(in, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static size_t map_avx2(char* dst, size_t cap, const unsigned char* s, size_t len, come_case_t to) {
+    const char lo = to == COME_CASE_UPPER ? 'a' : 'A';
+    size_t i = 0, w = 0;
+    while (i + 32 <= len) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(b);
+        size_t run = mask ? (size_t)__builtin_ctz(mask) : 32;
+        if (run && w + 32 <= cap && (mask == 0 || dst + w == (const char*)s + i || dst + w + 32 <= (const char*)s + i ||
+                              (const char*)s + len <= dst || dst + cap <= (const char*)s)) {
+            _mm256_storeu_si256((__m256i*)(dst + w), ascii_case_avx2(b, lo));
+            i += run;
+            w += run;
+        } else {
+            size_t end = i + run;
+            while (i < end) i += map_step(dst, cap, s, i, len, to, &w);
+        }
+        // Then the whole non-ASCII stretch, which often spans several runes
+        while (i < len && s[i] >= 0x80) i += map_step(dst, cap, s, i, len, to, &w);
+    }
+    return map_sse2(dst, cap, s, len, to, i, w);
+}
+
+static bool have_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+
+size_t come_case_map(char* dst, size_t cap, const char* s, size_t len, come_case_t to) {
+    const unsigned char* u = (const unsigned char*)s;
+#ifdef COME_CASEMAP_X86
+    if (have_avx2()) return map_avx2(dst, cap, u, len, to);
+    return map_sse2(dst, cap, u, len, to, 0, 0);
+#else
+    return map_scalar(dst, cap, u, len, to, 0, 0);
+#endif
+}
+
+// Only a few two-byte runes grow (CASE_GROW_LEAD_*); those lead bytes are never
+// continuation bytes, so each one found starts a rune of the mapping walk
+static bool grows_at(const unsigned char* s, size_t i, size_t len, come_case_t to) {
+    uint32_t r;
+    size_t n = decode(s, i, len, &r);
+    return r < RUNE_BAD && rune_len(case_rune(r, to)) > n;
+}
+
+bool come_case_grows(const char* s, size_t len, come_case_t to) {
+    const unsigned char* u = (const unsigned char*)s;
+    size_t i = 0;
+#ifdef COME_CASEMAP_X86
+    const __m128i bias = _mm_set1_epi8((char)(0x80 - CASE_GROW_LEAD_MIN));
+    const __m128i span = _mm_set1_epi8((char)(-128 + (CASE_GROW_LEAD_MAX - CASE_GROW_LEAD_MIN) + 1));
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(u + i)), bias);
+        unsigned mask = _mm_movemask_epi8(_mm_cmpgt_epi8(span, x));
+        while (mask) {
+            if (grows_at(u, i + __builtin_ctz(mask), len, to)) return true;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        if (u[i] >= CASE_GROW_LEAD_MIN && u[i] <= CASE_GROW_LEAD_MAX && grows_at(u, i, len, to)) return true;
+    }
+    return false;
+}
+
+
+// Compare
+
+int come_case_fold_cmp(const char* a, size_t al, const char* b, size_t bl, size_t n) {
+    const unsigned char* p = (const unsigned char*)a;
+    const unsigned char* q = (const unsigned char*)b;
+    size_t i = 0, j = 0, chars = 0;
+
+    while (i < al && j < bl && (n == 0 || chars < n)) {
+#ifdef COME_CASEMAP_X86
+        // Skip ASCII blocks that are equal once lowercased
+        const __m128i ones = _mm_set1_epi8(-1);
+        while (i + 16 <= al && j + 16 <= bl && (n == 0 || chars + 16 <= n)) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+            __m128i y = _mm_loadu_si128((const __m128i*)(q + j));
+            __m128i ne = _mm_xor_si128(_mm_cmpeq_epi8(ascii_case_sse2(x, 'A'), ascii_case_sse2(y, 'A')), ones);
+            if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(x, y), ne))) break;
+            i += 16;
+            j += 16;
+            chars += 16;
+        }
+        if (i >= al || j >= bl || (n != 0 && chars >= n)) break;
+#endif
+        uint32_t r1, r2;
+        i += decode(p, i, al, &r1);
+        j += decode(q, j, bl, &r2);
+        if (r1 != r2) {
+            r1 = fold(r1);
+            r2 = fold(r2);
+            if (r1 != r2) return r1 < r2 ? -1 : 1;
+        }
+        chars++;
+    }
+
+    if (n != 0 && chars == n) return 0;
+    return (i < al) - (j < bl);
+}
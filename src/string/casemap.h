@@ -0,0 +1,36 @@
+#ifndef COME_STRING_CASEMAP_H
+#define COME_STRING_CASEMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Case mapping kernels for the string module (UTF-8, explicit lengths).
+//
+// Mappings are the simple 1:1 Unicode ones (like Go's unicode.ToUpper):
+// ß stays ß and ligatures are not expanded, but a mapped rune may need a
+// different number of bytes (ı -> I, ⱥ -> Ⱥ). ASCII runs are converted with
+// SIMD (AVX2 when available, else SSE2); other runes go through the
+// generated two-stage table in casetab.h. Invalid UTF-8 bytes are copied as is.
+
+typedef enum {
+    COME_CASE_UPPER = 0, // Column of the delta table in casetab.h
+    COME_CASE_LOWER = 1,
+} come_case_t;
+
+// Simple case mapping of one code point
+uint32_t come_case_rune(uint32_t r, come_case_t to);
+
+// Maps [0, len) into dst, writing at most cap bytes, and returns the full
+// output length. A result larger than cap means dst was too small and its
+// contents are unspecified. dst may be s itself when come_case_grows() is false.
+size_t come_case_map(char* dst, size_t cap, const char* s, size_t len, come_case_t to);
+
+// True if some rune in [0, len) maps to a longer UTF-8 encoding
+bool come_case_grows(const char* s, size_t len, come_case_t to);
+
+// Case-insensitive compare of the first n runes (n = 0 for all), folding
+// both sides rune by rune. Returns <0, 0 or >0 like strcmp.
+int come_case_fold_cmp(const char* a, size_t al, const char* b, size_t bl, size_t n);
+
+#endif
@@ -0,0 +1,548 @@
+// Generated by gen_casetab.py (Unicode 14.0.0); do not edit.
+// Simple case mappings: for a rune r below CASE_LIMIT,
+//   case_deltas[case_blocks[case_index[r >> CASE_SHIFT]][r & CASE_MASK]]
+// holds the deltas to its upper and lower case rune.
+
+#define CASE_SHIFT 7
+#define CASE_MASK 0x7F
+#define CASE_LIMIT 0x1E980
+
+// Only runes with these lead bytes map to a longer encoding
+#define CASE_GROW_LEAD_MIN 0xC8
+#define CASE_GROW_LEAD_MAX 0xCA
+
+static const int32_t case_deltas[179][2] = {
+    {0, 0}, {-38864, 0}, {-10795, 0}, {-10792, 0},
+    {-7264, 0}, {-7205, 0}, {-6254, 0}, {-6253, 0},
+    {-6244, 0}, {-6243, 0}, {-6242, 0}, {-6236, 0},
+    {-6181, 0}, {-928, 0}, {-300, 0}, {-232, 0},
+    {-219, 0}, {-218, 0}, {-217, 0}, {-214, 0},
+    {-213, 0}, {-211, 0}, {-210, 0}, {-209, 0},
+    {-207, 0}, {-206, 0}, {-205, 0}, {-203, 0},
+    {-202, 0}, {-116, 0}, {-96, 0}, {-86, 0},
+    {-80, 0}, {-79, 0}, {-71, 0}, {-69, 0},
+    {-64, 0}, {-63, 0}, {-62, 0}, {-59, 0},
+    {-57, 0}, {-54, 0}, {-48, 0}, {-47, 0},
+    {-40, 0}, {-39, 0}, {-38, 0}, {-37, 0},
+    {-34, 0}, {-32, 0}, {-31, 0}, {-28, 0},
+    {-26, 0}, {-16, 0}, {-15, 0}, {-8, 0},
+    {-2, 0}, {-1, 0}, {-1, 1}, {0, -42319},
+    {0, -42315}, {0, -42308}, {0, -42307}, {0, -42305},
+    {0, -42282}, {0, -42280}, {0, -42261}, {0, -42258},
+    {0, -35384}, {0, -35332}, {0, -10815}, {0, -10783},
+    {0, -10782}, {0, -10780}, {0, -10749}, {0, -10743},
+    {0, -10727}, {0, -8383}, {0, -8262}, {0, -7615},
+    {0, -7517}, {0, -3814}, {0, -3008}, {0, -199},
+    {0, -195}, {0, -163}, {0, -130}, {0, -128},
+    {0, -126}, {0, -121}, {0, -112}, {0, -100},
+    {0, -97}, {0, -86}, {0, -74}, {0, -60},
+    {0, -56}, {0, -48}, {0, -9}, {0, -8},
+    {0, -7}, {0, 1}, {0, 2}, {0, 8},
+    {0, 15}, {0, 16}, {0, 26}, {0, 28},
+    {0, 32}, {0, 34}, {0, 37}, {0, 38},
+    {0, 39}, {0, 40}, {0, 48}, {0, 63},
+    {0, 64}, {0, 69}, {0, 71}, {0, 79},
+    {0, 80}, {0, 116}, {0, 202}, {0, 203},
+    {0, 205}, {0, 206}, {0, 207}, {0, 209},
+    {0, 210}, {0, 211}, {0, 213}, {0, 214},
+    {0, 217}, {0, 218}, {0, 219}, {0, 928},
+    {0, 7264}, {0, 10792}, {0, 10795}, {0, 38864},
+    {7, 0}, {8, 0}, {9, 0}, {48, 0},
+    {56, 0}, {74, 0}, {84, 0}, {86, 0},
+    {97, 0}, {100, 0}, {112, 0}, {121, 0},
+    {126, 0}, {128, 0}, {130, 0}, {163, 0},
+    {195, 0}, {743, 0}, {3008, 0}, {3814, 0},
+    {10727, 0}, {10743, 0}, {10749, 0}, {10780, 0},
+    {10782, 0}, {10783, 0}, {10815, 0}, {35266, 0},
+    {35332, 0}, {35384, 0}, {42258, 0}, {42261, 0},
+    {42280, 0}, {42282, 0}, {42305, 0}, {42307, 0},
+    {42308, 0}, {42315, 0}, {42319, 0},
+};
+
+static const uint8_t case_index[979] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 12, 0, 0, 0, 0, 0, 13, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 14, 15, 16, 17, 18, 19, 20,
+    0, 0, 21, 22, 0, 0, 0, 0, 0, 23, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 24, 25, 26, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 27, 28, 29, 30,
+    0, 0, 0, 0, 0, 0, 31, 32, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 33, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 34, 35, 36, 37, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 38, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 39, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 40, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 41,
+};
+
+static const uint8_t case_blocks[42][128] = {
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 157, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        108, 108, 108, 108, 108, 108, 108, 0, 108, 108, 108, 108, 108, 108, 108, 0,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        49, 49, 49, 49, 49, 49, 49, 0, 49, 49, 49, 49, 49, 49, 49, 151,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        83, 15, 101, 57, 101, 57, 101, 57, 0, 101, 57, 101, 57, 101, 57, 101,
+        57, 101, 57, 101, 57, 101, 57, 101, 57, 0, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 89, 101, 57, 101, 57, 101, 57, 14,
+    },
+    {
+        156, 128, 101, 57, 101, 57, 125, 101, 57, 124, 124, 101, 57, 0, 119, 122,
+        123, 101, 57, 124, 126, 148, 129, 127, 101, 57, 155, 0, 129, 130, 154, 131,
+        101, 57, 101, 57, 101, 57, 133, 101, 57, 133, 0, 0, 101, 57, 133, 101,
+        57, 132, 132, 101, 57, 101, 57, 134, 101, 57, 0, 0, 101, 57, 0, 144,
+        0, 0, 0, 0, 102, 58, 56, 102, 58, 56, 102, 58, 56, 101, 57, 101,
+        57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 33, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        0, 102, 58, 56, 101, 57, 92, 96, 101, 57, 101, 57, 101, 57, 101, 57,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        86, 0, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 0, 0, 0, 0, 0, 0, 138, 101, 57, 85, 137, 166,
+        166, 101, 57, 84, 117, 118, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        165, 163, 164, 22, 25, 0, 26, 26, 0, 28, 0, 27, 178, 0, 0, 0,
+        26, 177, 0, 24, 0, 172, 176, 0, 23, 21, 176, 161, 174, 0, 0, 21,
+        0, 162, 20, 0, 0, 19, 0, 0, 0, 0, 0, 0, 0, 160, 0, 0,
+    },
+    {
+        17, 0, 175, 17, 0, 0, 0, 173, 17, 35, 18, 18, 34, 0, 0, 0,
+        0, 0, 16, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 171, 170, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 146, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        101, 57, 101, 57, 0, 0, 101, 57, 0, 0, 0, 154, 154, 154, 0, 121,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 111, 0, 110, 110, 110, 0, 116, 0, 115, 115,
+        0, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        108, 108, 0, 108, 108, 108, 108, 108, 108, 108, 108, 108, 46, 47, 47, 47,
+        0, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        49, 49, 50, 49, 49, 49, 49, 49, 49, 49, 49, 49, 36, 37, 37, 103,
+        38, 40, 0, 0, 0, 43, 41, 55, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        31, 32, 140, 29, 95, 30, 0, 101, 57, 100, 101, 57, 0, 86, 86, 86,
+    },
+    {
+        120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+    },
+    {
+        101, 57, 0, 0, 0, 0, 0, 0, 0, 0, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        104, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 54,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        0, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+        114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+        114, 114, 114, 114, 114, 114, 114, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+        42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+    },
+    {
+        42, 42, 42, 42, 42, 42, 42, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136,
+        136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136,
+        136, 136, 136, 136, 136, 136, 0, 136, 0, 0, 0, 0, 0, 136, 0, 0,
+        158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158,
+        158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158,
+        158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 158, 0, 0, 158, 158, 158,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139,
+        139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139,
+        139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139,
+        139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139,
+        139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139, 139,
+        103, 103, 103, 103, 103, 103, 0, 0, 55, 55, 55, 55, 55, 55, 0, 0,
+    },
+    {
+        6, 7, 8, 10, 10, 9, 11, 12, 167, 0, 0, 0, 0, 0, 0, 0,
+        82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82,
+        82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82,
+        82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 82, 0, 0, 82, 82, 82,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 168, 0, 0, 0, 159, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 169, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 0, 0, 0, 0, 0, 39, 0, 0, 79, 0,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+    },
+    {
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        141, 141, 141, 141, 141, 141, 0, 0, 99, 99, 99, 99, 99, 99, 0, 0,
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        141, 141, 141, 141, 141, 141, 0, 0, 99, 99, 99, 99, 99, 99, 0, 0,
+        0, 141, 0, 141, 0, 141, 0, 141, 0, 99, 0, 99, 0, 99, 0, 99,
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        145, 145, 147, 147, 147, 147, 149, 149, 153, 153, 150, 150, 152, 152, 0, 0,
+    },
+    {
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        141, 141, 141, 141, 141, 141, 141, 141, 99, 99, 99, 99, 99, 99, 99, 99,
+        141, 141, 0, 142, 0, 0, 0, 0, 99, 99, 94, 94, 98, 0, 5, 0,
+        0, 0, 0, 142, 0, 0, 0, 0, 93, 93, 93, 93, 98, 0, 0, 0,
+        141, 141, 0, 0, 0, 0, 0, 0, 99, 99, 91, 91, 0, 0, 0, 0,
+        141, 141, 0, 0, 0, 140, 0, 0, 99, 99, 90, 90, 100, 0, 0, 0,
+        0, 0, 0, 142, 0, 0, 0, 0, 87, 87, 88, 88, 98, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 80, 0, 0, 0, 77, 78, 0, 0, 0, 0,
+        0, 0, 107, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 51, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105, 105,
+        53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53,
+    },
+    {
+        0, 0, 0, 101, 57, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+        106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106, 106,
+        52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 52,
+        52, 52, 52, 52, 52, 52, 52, 52, 52, 52, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+        114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+        114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114, 114,
+        42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+        42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+        42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+        101, 57, 75, 81, 76, 2, 3, 101, 57, 101, 57, 101, 57, 73, 74, 71,
+        72, 0, 101, 57, 0, 101, 57, 0, 0, 0, 0, 0, 0, 0, 70, 70,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 0, 0, 0, 0, 0, 0, 0, 101, 57, 101, 57, 0,
+        0, 0, 101, 57, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+        4, 4, 4, 4, 4, 4, 0, 4, 0, 0, 0, 0, 0, 4, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        0, 0, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 101, 57, 101, 57, 69, 101, 57,
+    },
+    {
+        101, 57, 101, 57, 101, 57, 101, 57, 0, 0, 0, 101, 57, 65, 0, 0,
+        101, 57, 101, 57, 143, 0, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 61, 59, 60, 63, 61, 0,
+        67, 64, 66, 135, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57, 101, 57,
+        101, 57, 101, 57, 97, 62, 68, 101, 57, 101, 57, 0, 0, 0, 0, 0,
+        101, 57, 0, 0, 0, 0, 101, 57, 101, 57, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 101, 57, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 13, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    },
+    {
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 0, 0, 0, 0, 0,
+        0, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113,
+        113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113,
+        113, 113, 113, 113, 113, 113, 113, 113, 44, 44, 44, 44, 44, 44, 44, 44,
+        44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44,
+        44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113,
+        113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113, 113,
+        113, 113, 113, 113, 0, 0, 0, 0, 44, 44, 44, 44, 44, 44, 44, 44,
+        44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44,
+        44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 44, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 0, 112, 112, 112, 112,
+    },
+    {
+        112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 112, 0, 112, 112, 112, 112,
+        112, 112, 112, 0, 112, 112, 0, 45, 45, 45, 45, 45, 45, 45, 45, 45,
+        45, 45, 0, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45, 45,
+        45, 45, 0, 45, 45, 45, 45, 45, 45, 45, 0, 45, 45, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116,
+        116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116,
+        116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116, 116,
+        116, 116, 116, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36, 36,
+        36, 36, 36, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108, 108,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+        49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49, 49,
+    },
+    {
+        109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109,
+        109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109, 109,
+        109, 109, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+        48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+        48, 48, 48, 48, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    },
+};
@@ -0,0 +1,419 @@
+#include "classify.h"
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define COME_CLASSIFY_X86 1
+#endif
+
+
+// Scalar kernels
+
+#define CL_DIGIT 0x1
+#define CL_ALPHA 0x2
+#define CL_SPACE 0x4
+
+// C locale classes by byte
+static const uint8_t class_table[256] = {
+    ['0' ... '9'] = CL_DIGIT,
+    ['A' ... 'Z'] = CL_ALPHA,
+    ['a' ... 'z'] = CL_ALPHA,
+    ['\t' ... '\r'] = CL_SPACE,
+    [' '] = CL_SPACE,
+};
+
+static const uint8_t class_bits[] = {
+    [COME_CLASS_DIGIT] = CL_DIGIT,
+    [COME_CLASS_ALPHA] = CL_ALPHA,
+    [COME_CLASS_ALNUM] = CL_DIGIT | CL_ALPHA,
+    [COME_CLASS_SPACE] = CL_SPACE,
+};
+
+static bool all_scalar(const unsigned char* d, size_t len, uint8_t bits) {
+    for (size_t i = 0; i < len; i++) {
+        if (!(class_table[d[i]] & bits)) return false;
+    }
+    return true;
+}
+
+static bool ascii_scalar(const unsigned char* d, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (d[i] & 0x80) return false;
+    }
+    return true;
+}
+
+// Length of the well-formed sequence starting with a non-ASCII byte at s[i],
+// or 0 if it is ill-formed (Unicode Table 3-7)
+static size_t utf8_step(const unsigned char* s, size_t i, size_t len) {
+    unsigned c = s[i];
+    unsigned lo = 0x80, hi = 0xBF;
+    size_t need;
+    if (c >= 0xC2 && c <= 0xDF) need = 1;
+    else if (c >= 0xE0 && c <= 0xEF) {
+        need = 2;
+        if (c == 0xE0) lo = 0xA0;      // Overlong
+        else if (c == 0xED) hi = 0x9F; // Surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        need = 3;
+        if (c == 0xF0) lo = 0x90;      // Overlong
+        else if (c == 0xF4) hi = 0x8F; // Above U+10FFFF
+    } else return 0;
+
+    if (len - i <= need) return 0;
+    if (s[i + 1] < lo || s[i + 1] > hi) return 0;
+    for (size_t k = 2; k <= need; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) return 0;
+    }
+    return need + 1;
+}
+
+static bool utf8_scalar(const unsigned char* s, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        if (s[i] < 0x80) { i++; continue; }
+        size_t n = utf8_step(s, i, len);
+        if (!n) return false;
+        i += n;
+    }
+    return true;
+}
+
+static size_t runes_scalar(const unsigned char* d, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) count += (d[i] & 0xC0) != 0x80;
+    return count;
+}
+
+
+#ifdef COME_CLASSIFY_X86
+
+// SIMD kernels
+// SSE2 has no unsigned byte compare: ranges are tested by biasing into the
+// signed range, so b in [lo, hi] iff (int8_t)(b + 0x80 - lo) <= -128 + (hi - lo).
+
+static inline __m128i out_of_range_sse2(__m128i b, char lo, char hi) {
+    __m128i x = _mm_add_epi8(b, _mm_set1_epi8((char)(0x80 - lo)));
+    return _mm_cmpgt_epi8(x, _mm_set1_epi8((char)(-128 + (hi - lo))));
+}
+
+// 0xFF for every byte outside cls
+static inline __m128i bad_sse2(__m128i b, come_class_t cls) {
+    switch (cls) {
+    case COME_CLASS_DIGIT:
+        return out_of_range_sse2(b, '0', '9');
+    case COME_CLASS_ALPHA:
+        return out_of_range_sse2(_mm_or_si128(b, _mm_set1_epi8(0x20)), 'a', 'z');
+    case COME_CLASS_ALNUM:
+        return _mm_and_si128(out_of_range_sse2(b, '0', '9'),
+                             out_of_range_sse2(_mm_or_si128(b, _mm_set1_epi8(0x20)), 'a', 'z'));
+    default:
+        return _mm_andnot_si128(_mm_cmpeq_epi8(b, _mm_set1_epi8(' ')), out_of_range_sse2(b, '\t', '\r'));
+    }
+}
+
+static bool all_sse2(const char* d, size_t len, come_class_t cls) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m128i bad = _mm_or_si128(
+            _mm_or_si128(bad_sse2(_mm_loadu_si128((const __m128i*)(d + i)), cls),
+                         bad_sse2(_mm_loadu_si128((const __m128i*)(d + i + 16)), cls)),
+            _mm_or_si128(bad_sse2(_mm_loadu_si128((const __m128i*)(d + i + 32)), cls),
+                         bad_sse2(_mm_loadu_si128((const __m128i*)(d + i + 48)), cls)));
+        if (_mm_movemask_epi8(bad)) return false;
+    }
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(bad_sse2(_mm_loadu_si128((const __m128i*)(d + i)), cls))) return false;
+    }
+    return all_scalar((const unsigned char*)d + i, len - i, class_bits[cls]);
+}
+
+static bool ascii_sse2(const char* d, size_t len) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m128i b = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128((const __m128i*)(d + i)), _mm_loadu_si128((const __m128i*)(d + i + 16))),
+            _mm_or_si128(_mm_loadu_si128((const __m128i*)(d + i + 32)), _mm_loadu_si128((const __m128i*)(d + i + 48))));
+        if (_mm_movemask_epi8(b)) return false;
+    }
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(d + i)))) return false;
+    }
+    return ascii_scalar((const unsigned char*)d + i, len - i);
+}
+
+// ASCII blocks are skipped 16 bytes at a time; sequences are checked one by one
+static bool utf8_sse2(const char* d, size_t len) {
+    const unsigned char* s = (const unsigned char*)d;
+    size_t i = 0;
+    while (i + 16 <= len) {
+        unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s + i)));
+        if (!mask) { i += 16; continue; }
+        i += __builtin_ctz(mask);
+        size_t n = utf8_step(s, i, len);
+        if (!n) return false;
+        i += n;
+    }
+    return utf8_scalar(s + i, len - i);
+}
+
+// Continuation bytes are -128..-65 as int8_t
+static size_t runes_sse2(const char* d, size_t len) {
+    const __m128i cont_max = _mm_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(d + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(b, cont_max)));
+    }
+    return count + runes_scalar((const unsigned char*)d + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i out_of_range_avx2(__m256i b, char lo, char hi) {
+    __m256i x = _mm256_add_epi8(b, _mm256_set1_epi8((char)(0x80 - lo)));
+    return _mm256_cmpgt_epi8(x, _mm256_set1_epi8((char)(-128 + (hi - lo))));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i bad_avx2(__m256i b, come_class_t cls) {
+    switch (cls) {
+    case COME_CLASS_DIGIT:
+        return out_of_range_avx2(b, '0', '9');
+    case COME_CLASS_ALPHA:
+        return out_of_range_avx2(_mm256_or_si256(b, _mm256_set1_epi8(0x20)), 'a', 'z');
+    case COME_CLASS_ALNUM:
+        return _mm256_and_si256(out_of_range_avx2(b, '0', '9'),
+                                out_of_range_avx2(_mm256_or_si256(b, _mm256_set1_epi8(0x20)), 'a', 'z'));
+    default:
+        return _mm256_andnot_si256(_mm256_cmpeq_epi8(b, _mm256_set1_epi8(' ')), out_of_range_avx2(b, '\t', '\r'));
+    }
+}
+
+__attribute__((target("avx2")))
+static bool all_avx2(const char* d, size_t len, come_class_t cls) {
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i bad = _mm256_or_si256(bad_avx2(_mm256_loadu_si256((const __m256i*)(d + i)), cls),
+                                      bad_avx2(_mm256_loadu_si256((const __m256i*)(d + i + 32)), cls));
+        if (!_mm256_testz_si256(bad, bad)) return false;
+    }
+    return all_sse2(d + i, len - i, cls);
+}
+
+__attribute__((target("avx2")))
+static bool ascii_avx2(const char* d, size_t len) {
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128) {
+        __m256i b = _mm256_or_si256(
+            _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(d + i)), _mm256_loadu_si256((const __m256i*)(d + i + 32))),
+            _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(d + i + 64)), _mm256_loadu_si256((const __m256i*)(d + i + 96))));
+        if (_mm256_movemask_epi8(b)) return false;
+    }
+    return ascii_sse2(d + i, len - i);
+}
+
+// UTF-8 validation by nibble lookup (Keiser & Lemire, "Validating UTF-8 In
+// Less Than One Instruction Per Byte"). Each byte pair (prev, cur) is
+// classified by three 16-entry tables indexed by prev's high and low nibble
+// and cur's high nibble; a bit survives the AND of all three only for an
+// ill-formed pair. Third and fourth continuation bytes are checked separately
+// against the lead two or three bytes back.
+
+#define U8_TOO_SHORT   (1 << 0) // Lead followed by ASCII or another lead
+#define U8_TOO_LONG    (1 << 1) // ASCII followed by a continuation
+#define U8_OVERLONG_3  (1 << 2) // E0 80..9F
+#define U8_TOO_LARGE   (1 << 3) // F4 90..BF, F5..FF
+#define U8_SURROGATE   (1 << 4) // ED A0..BF
+#define U8_OVERLONG_2  (1 << 5) // C0..C1
+#define U8_TOO_LARGE_1000 (1 << 6) // F5..FF 80..8F
+#define U8_OVERLONG_4  (1 << 6) // F0 80..8F
+#define U8_TWO_CONTS   (1 << 7) // Two continuations (valid only after 3/4-byte leads)
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+static const uint8_t u8_prev_high[16] = {
+    // 0xxx: ASCII
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    // 10xx: continuation
+    U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+    // 1100, 1101: 2-byte leads
+    U8_TOO_SHORT | U8_OVERLONG_2,
+    U8_TOO_SHORT,
+    // 1110: 3-byte leads
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    // 1111: 4-byte leads and invalid bytes
+    U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+};
+
+static const uint8_t u8_prev_low[16] = {
+    U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4, // xxxx0000
+    U8_CARRY | U8_OVERLONG_2,                                 // xxxx0001
+    U8_CARRY,
+    U8_CARRY,
+    U8_CARRY | U8_TOO_LARGE,                                  // xxxx0100
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE, // xxxx1101
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+    U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+};
+
+static const uint8_t u8_cur_high[16] = {
+    // 0xxx: ASCII
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    // 1000
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+    // 1001
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+    // 101x
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+    U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+    // 11xx: leads
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+};
+
+// Validator state carried across 32-byte blocks
+typedef struct {
+    __m256i prev;       // Previous block
+    __m256i incomplete; // Nonzero if the previous block ends inside a sequence
+    __m256i error;
+} utf8_state_t;
+
+__attribute__((target("avx2")))
+static inline __m256i u8_lookup(const uint8_t* table, __m256i idx) {
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table)), idx);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i u8_high_nibble(__m256i b) {
+    return _mm256_and_si256(_mm256_srli_epi16(b, 4), _mm256_set1_epi8(0x0F));
+}
+
+__attribute__((target("avx2")))
+static inline void utf8_block_avx2(utf8_state_t* st, __m256i in) {
+    if (!_mm256_movemask_epi8(in)) {
+        // ASCII: only a sequence left open by the previous block can fail
+        st->error = _mm256_or_si256(st->error, st->incomplete);
+        st->prev = in;
+        return;
+    }
+    // Input shifted by 1..3 bytes, with the previous block's tail shifted in
+    __m256i carry = _mm256_permute2x128_si256(st->prev, in, 0x21);
+    __m256i prev1 = _mm256_alignr_epi8(in, carry, 15);
+    __m256i prev2 = _mm256_alignr_epi8(in, carry, 14);
+    __m256i prev3 = _mm256_alignr_epi8(in, carry, 13);
+
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(u8_lookup(u8_prev_high, u8_high_nibble(prev1)),
+                         u8_lookup(u8_prev_low, _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+        u8_lookup(u8_cur_high, u8_high_nibble(in)));
+
+    // Bytes two or three after a 3/4-byte lead must be continuations (TWO_CONTS)
+    __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must_cont = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    st->error = _mm256_or_si256(st->error, _mm256_xor_si256(must_cont, special));
+
+    // Lead bytes too close to the end of the block to be complete
+    const __m256i max_tail = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    st->incomplete = _mm256_subs_epu8(in, max_tail);
+    st->prev = in;
+}
+
+__attribute__((target("avx2")))
+static bool utf8_avx2(const char* d, size_t len) {
+    utf8_state_t st = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(d + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(d + i + 32));
+        if (!_mm256_movemask_epi8(_mm256_or_si256(a, b))) {
+            st.error = _mm256_or_si256(st.error, st.incomplete);
+            st.prev = b;
+            continue;
+        }
+        utf8_block_avx2(&st, a);
+        utf8_block_avx2(&st, b);
+    }
+    // Tail (possibly empty), zero padded: padding after a lead reads as TOO_SHORT
+    for (;;) {
+        uint8_t buf[32] = {0};
+        size_t n = len - i < 32 ? len - i : 32;
+        memcpy(buf, d + i, n);
+        utf8_block_avx2(&st, _mm256_loadu_si256((const __m256i*)buf));
+        i += n;
+        if (n < 32) break;
+    }
+    st.error = _mm256_or_si256(st.error, st.incomplete);
+    return _mm256_testz_si256(st.error, st.error);
+}
+
+__attribute__((target("avx2")))
+static size_t runes_avx2(const char* d, size_t len) {
+    const __m256i cont_max = _mm256_set1_epi8(-65);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m256i a = _mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*)(d + i)), cont_max);
+        __m256i b = _mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*)(d + i + 32)), cont_max);
+        uint64_t mask = (uint32_t)_mm256_movemask_epi8(a) | (uint64_t)(uint32_t)_mm256_movemask_epi8(b) << 32;
+        count += __builtin_popcountll(mask);
+    }
+    return count + runes_sse2(d + i, len - i);
+}
+
+static bool have_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+
+// Dispatch
+
+bool come_classify_ascii(const char* d, size_t len) {
+#ifdef COME_CLASSIFY_X86
+    if (have_avx2()) return ascii_avx2(d, len);
+    return ascii_sse2(d, len);
+#else
+    return ascii_scalar((const unsigned char*)d, len);
+#endif
+}
+
+bool come_classify_all(const char* d, size_t len, come_class_t cls) {
+#ifdef COME_CLASSIFY_X86
+    if (have_avx2()) return all_avx2(d, len, cls);
+    return all_sse2(d, len, cls);
+#else
+    return all_scalar((const unsigned char*)d, len, class_bits[cls]);
+#endif
+}
+
+bool come_classify_utf8(const char* d, size_t len) {
+#ifdef COME_CLASSIFY_X86
+    if (have_avx2()) return utf8_avx2(d, len);
+    return utf8_sse2(d, len);
+#else
+    return utf8_scalar((const unsigned char*)d, len);
+#endif
+}
+
+size_t come_classify_runes(const char* d, size_t len) {
+#ifdef COME_CLASSIFY_X86
+    if (have_avx2()) return runes_avx2(d, len);
+    return runes_sse2(d, len);
+#else
+    return runes_scalar((const unsigned char*)d, len);
+#endif
+}
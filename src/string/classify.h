@@ -0,0 +1,35 @@
+#ifndef COME_STRING_CLASSIFY_H
+#define COME_STRING_CLASSIFY_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Byte classification and UTF-8 kernels for the string module.
+// All functions work on explicit lengths and never stop at NUL bytes.
+//
+// Classes follow the C locale regardless of setlocale(), so results do not
+// depend on the environment. Kernels are SIMD (AVX2 when available, else
+// SSE2) with a scalar tail.
+
+typedef enum {
+    COME_CLASS_DIGIT, // 0-9
+    COME_CLASS_ALPHA, // A-Z a-z
+    COME_CLASS_ALNUM, // DIGIT | ALPHA
+    COME_CLASS_SPACE, // ' ' \t \n \v \f \r
+} come_class_t;
+
+// True if every byte is < 0x80
+bool come_classify_ascii(const char* d, size_t len);
+
+// True if every byte belongs to cls (true for an empty range)
+bool come_classify_all(const char* d, size_t len, come_class_t cls);
+
+// True if [0, len) is well-formed UTF-8 (no overlongs, surrogates or
+// code points above U+10FFFF, no truncated sequence at the end)
+bool come_classify_utf8(const char* d, size_t len);
+
+// Number of bytes that are not UTF-8 continuation bytes (10xxxxxx);
+// the code point count for valid UTF-8
+size_t come_classify_runes(const char* d, size_t len);
+
+#endif
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# Generates casetab.h: simple (1:1) Unicode case mappings as a two-stage table.
+#
+#   python3 src/string/gen_casetab.py > src/string/casetab.h
+#
+# Runes are split into blocks of 128. case_index maps a block to one of the
+# distinct blocks in case_blocks, whose entries index case_deltas, the
+# distinct (upper, lower) delta pairs. Lookup is three loads and no branches.
+#
+# Python only exposes full mappings (str.upper may return several code
+# points). The simple mapping is taken from it when the result is a single
+# code point; otherwise the titlecase form is used when it is single (Greek
+# iota subscript letters), and İ lowercases to i. Everything else with a
+# multi-character mapping (ß, ŉ, ligatures) has no simple mapping.
+
+import sys
+import unicodedata
+
+SHIFT = 7
+BLOCK = 1 << SHIFT
+
+
+def simple_upper(cp):
+    u = chr(cp).upper()
+    if len(u) == 1:
+        return ord(u)
+    t = chr(cp).title()
+    if len(t) == 1:
+        return ord(t)
+    return cp
+
+
+def simple_lower(cp):
+    lo = chr(cp).lower()
+    if len(lo) == 1:
+        return ord(lo)
+    if cp == 0x0130:
+        return 0x69
+    return cp
+
+
+def deltas():
+    out = {}
+    for cp in range(0x80, 0x110000):
+        if 0xD800 <= cp <= 0xDFFF:
+            continue
+        du = simple_upper(cp) - cp
+        dl = simple_lower(cp) - cp
+        if du or dl:
+            out[cp] = (du, dl)
+    return out
+
+
+def main():
+    d = deltas()
+    limit = (max(d) // BLOCK + 1) * BLOCK
+
+    pairs = [(0, 0)] + sorted(set(d.values()))
+    pair_id = {p: i for i, p in enumerate(pairs)}
+    assert len(pairs) <= 256
+
+    blocks = []
+    block_id = {}
+    index = []
+    for base in range(0, limit, BLOCK):
+        blk = tuple(pair_id[d.get(cp, (0, 0))] for cp in range(base, base + BLOCK))
+        if blk not in block_id:
+            block_id[blk] = len(blocks)
+            blocks.append(blk)
+        index.append(block_id[blk])
+    assert len(blocks) <= 256
+
+    # Lead bytes of the runes whose other case needs more UTF-8 bytes
+    enc_len = lambda cp: len(chr(cp).encode())
+    grow = [cp for cp, (du, dl) in d.items() if max(enc_len(cp + du), enc_len(cp + dl)) > enc_len(cp)]
+    grow_leads = [chr(cp).encode()[0] for cp in grow]
+
+    w = sys.stdout.write
+    w("// Generated by gen_casetab.py (Unicode %s); do not edit.\n" % unicodedata.unidata_version)
+    w("// Simple case mappings: for a rune r below CASE_LIMIT,\n")
+    w("//   case_deltas[case_blocks[case_index[r >> CASE_SHIFT]][r & CASE_MASK]]\n")
+    w("// holds the deltas to its upper and lower case rune.\n\n")
+    w("#define CASE_SHIFT %d\n" % SHIFT)
+    w("#define CASE_MASK 0x%X\n" % (BLOCK - 1))
+    w("#define CASE_LIMIT 0x%X\n\n" % limit)
+    w("// Only runes with these lead bytes map to a longer encoding\n")
+    w("#define CASE_GROW_LEAD_MIN 0x%X\n" % min(grow_leads))
+    w("#define CASE_GROW_LEAD_MAX 0x%X\n\n" % max(grow_leads))
+
+    w("static const int32_t case_deltas[%d][2] = {\n" % len(pairs))
+    for i in range(0, len(pairs), 4):
+        w("    " + " ".join("{%d, %d}," % p for p in pairs[i:i + 4]) + "\n")
+    w("};\n\n")
+
+    w("static const uint8_t case_index[%d] = {\n" % len(index))
+    for i in range(0, len(index), 16):
+        w("    " + " ".join("%d," % v for v in index[i:i + 16]) + "\n")
+    w("};\n\n")
+
+    w("static const uint8_t case_blocks[%d][%d] = {\n" % (len(blocks), BLOCK))
+    for blk in blocks:
+        w("    {\n")
+        for i in range(0, BLOCK, 16):
+            w("        " + " ".join("%d," % v for v in blk[i:i + 16]) + "\n")
+        w("    },\n")
+    w("};\n")
+
+
+main()
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+# Generates numtab.h: 128-bit power-of-ten tables for num.c.
+#
+#   python3 src/string/gen_numtab.py > src/string/numtab.h
+#
+# num_pow5[q] (q in [-342, 308]) is 5^q normalized so bit 127 is set, the
+# table of the Eisel-Lemire parser: truncated for q >= 0, rounded up for
+# small negative q and truncated from a wider quotient below -27, exactly as
+# in the paper's reference generator.
+#
+# num_pow10[k] (k in [-292, 324]) is floor(10^k * 2^-r) + 1 with r chosen so
+# bit 127 is set, the table of the Schubfach formatter.
+
+import sys
+
+POW5_MIN, POW5_MAX = -342, 308
+POW10_MIN, POW10_MAX = -292, 324
+
+
+def pow5(q):
+    if q >= 0:
+        v = 5 ** q
+        while v < (1 << 127):
+            v <<= 1
+        while v >= (1 << 128):
+            v >>= 1
+        return v
+    p = 5 ** -q
+    z = p.bit_length() if p & (p - 1) else p.bit_length() - 1
+    if q >= -27:
+        return (1 << (z + 127)) // p + 1
+    v = (1 << (2 * z + 128)) // p + 1
+    while v >= (1 << 128):
+        v >>= 1
+    return v
+
+
+def floor_log2_pow10(k):
+    return (k * 1741647) >> 19
+
+
+def pow10(k):
+    e = floor_log2_pow10(k) + 1 - 128
+    if k >= 0:
+        num, den = 10 ** k, 1
+    else:
+        num, den = 1, 10 ** -k
+    if e >= 0:
+        den <<= e
+    else:
+        num <<= -e
+    g = num // den + 1
+    assert (1 << 127) <= g < (1 << 128), k
+    return g
+
+
+def table(w, name, lo, hi, f):
+    w("static const uint64_t %s[%d][2] = {\n" % (name, hi - lo + 1))
+    for q in range(lo, hi + 1):
+        v = f(q)
+        w("    {0x%016X, 0x%016X}, // %d\n" % (v >> 64, v & ((1 << 64) - 1), q))
+    w("};\n\n")
+
+
+def main():
+    w = sys.stdout.write
+    w("// Generated by gen_numtab.py; do not edit.\n")
+    w("// Rows are {high, low} 64-bit halves of a 128-bit normalized power.\n\n")
+    w("#define NUM_POW5_MIN %d\n" % POW5_MIN)
+    w("#define NUM_POW5_MAX %d\n" % POW5_MAX)
+    w("#define NUM_POW10_MIN %d\n" % POW10_MIN)
+    w("#define NUM_POW10_MAX %d\n\n" % POW10_MAX)
+    table(w, "num_pow5", POW5_MIN, POW5_MAX, pow5)
+    table(w, "num_pow10", POW10_MIN, POW10_MAX, pow10)
+
+
+main()
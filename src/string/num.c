@@ -0,0 +1,526 @@
+#include "num.h"
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define COME_NUM_SWAR 1
+#endif
+
+#include "numtab.h"
+
+#define DBL_MANT_MASK ((UINT64_C(1) << 52) - 1)
+#define DBL_EXP_INF   0x7FF
+#define DBL_SIGN      (UINT64_C(1) << 63)
+
+
+// Digits
+
+static inline bool is_space(unsigned char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool is_digit(unsigned char c) {
+    return (unsigned)(c - '0') < 10;
+}
+
+// Value of c as a digit in bases up to 36, or 36 if it is not one
+static inline unsigned digit_value(unsigned char c) {
+    if (is_digit(c)) return c - '0';
+    c |= 0x20;
+    if ((unsigned)(c - 'a') < 26) return c - 'a' + 10;
+    return 36;
+}
+
+#ifdef COME_NUM_SWAR
+static inline uint64_t load8(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+// True if all eight bytes are ASCII digits
+static inline bool eight_digits(uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0) |
+            (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+// Value of eight digits (first digit in the lowest byte): pairs, then
+// quads, then the whole, with three multiplies
+static inline uint32_t eight_value(uint64_t v) {
+    const uint64_t mask = 0x000000FF000000FF;
+    const uint64_t mul1 = 100 + (UINT64_C(1000000) << 32);
+    const uint64_t mul2 = 1 + (UINT64_C(10000) << 32);
+    v -= 0x3030303030303030;
+    v = v * 10 + (v >> 8);
+    return (uint32_t)((((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32);
+}
+#endif
+
+static const char digit_pairs[200] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Writes v so that it ends just before p and returns its first byte
+static inline char* put_digits(char* p, uint64_t v) {
+    while (v >= 100) {
+        uint64_t r = v % 100;
+        v /= 100;
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * r, 2);
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * v, 2);
+    } else {
+        *--p = (char)('0' + v);
+    }
+    return p;
+}
+
+
+// Integers
+
+int come_num_parse_long(const char* str, size_t len, int base, long* out) {
+    const unsigned char* p = (const unsigned char*)str;
+    const unsigned char* end = p + len;
+    *out = 0;
+    if (base < 0 || base == 1 || base > 36) return EINVAL;
+
+    while (p < end && is_space(*p)) p++;
+    bool neg = false;
+    if (p < end && (*p == '+' || *p == '-')) neg = *p++ == '-';
+
+    // A prefix only counts when a digit follows: "0x" alone is 0 then junk
+    if (end - p >= 3 && p[0] == '0') {
+        unsigned x = p[1] | 0x20;
+        if (x == 'x' && (base == 0 || base == 16) && digit_value(p[2]) < 16) {
+            base = 16;
+            p += 2;
+        } else if (x == 'b' && (base == 0 || base == 2) && digit_value(p[2]) < 2) {
+            base = 2;
+            p += 2;
+        }
+    }
+    if (base == 0) base = (p < end && *p == '0') ? 8 : 10;
+
+    const unsigned char* digits = p;
+    uint64_t v = 0;
+    bool over = false;
+    if (base == 10) {
+        while (p < end && *p == '0') p++;
+        const unsigned char* sig = p;
+#ifdef COME_NUM_SWAR
+        // Up to 16 significant digits in blocks of eight cannot overflow
+        while (end - p >= 8 && p - sig < 16) {
+            uint64_t w = load8(p);
+            if (!eight_digits(w)) break;
+            v = v * 100000000 + eight_value(w);
+            p += 8;
+        }
+#endif
+        for (; p < end && is_digit(*p); p++) {
+            unsigned d = *p - '0';
+            if (p - sig < 19) v = v * 10 + d;
+            else if (__builtin_mul_overflow(v, 10, &v) || __builtin_add_overflow(v, d, &v)) over = true;
+        }
+    } else {
+        for (unsigned d; p < end && (d = digit_value(*p)) < (unsigned)base; p++) {
+            if (__builtin_mul_overflow(v, (unsigned)base, &v) || __builtin_add_overflow(v, d, &v)) over = true;
+        }
+    }
+    if (p == digits) return EINVAL;
+
+    int err = 0;
+    if (neg) {
+        if (over || v > (uint64_t)LONG_MAX + 1) {
+            *out = LONG_MIN;
+            err = ERANGE;
+        } else {
+            *out = v ? -(long)(v - 1) - 1 : 0;
+        }
+    } else if (over || v > LONG_MAX) {
+        *out = LONG_MAX;
+        err = ERANGE;
+    } else {
+        *out = (long)v;
+    }
+
+    while (p < end && is_space(*p)) p++;
+    if (p != end && !err) err = EINVAL;
+    return err;
+}
+
+size_t come_num_format_ulong(char* buf, unsigned long v) {
+    char tmp[COME_NUM_LONG_MAX];
+    char* p = put_digits(tmp + sizeof(tmp), v);
+    size_t n = (size_t)(tmp + sizeof(tmp) - p);
+    memcpy(buf, p, n);
+    return n;
+}
+
+size_t come_num_format_long(char* buf, long v) {
+    if (v >= 0) return come_num_format_ulong(buf, (unsigned long)v);
+    buf[0] = '-';
+    return 1 + come_num_format_ulong(buf + 1, 0 - (unsigned long)v);
+}
+
+
+// Parsing doubles
+
+// Powers of ten that are exact doubles, for the Clinger fast path
+static const double pow10_exact[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Eisel-Lemire: the IEEE bits (sign clear) of the double nearest to w * 10^q.
+// A 64x128-bit product with the normalized 5^q gives the 55 leading bits of
+// the result; returns false in the rare cases the truncated table entry
+// leaves the rounding undecided.
+static bool eisel_lemire(uint64_t w, int64_t q, uint64_t* bits) {
+    if (w == 0 || q < NUM_POW5_MIN) {
+        *bits = 0;
+        return true;
+    }
+    if (q > NUM_POW5_MAX) {
+        *bits = (uint64_t)DBL_EXP_INF << 52;
+        return true;
+    }
+
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    const uint64_t* t = num_pow5[q - NUM_POW5_MIN];
+    unsigned __int128 first = (unsigned __int128)w * t[0];
+    uint64_t hi = (uint64_t)(first >> 64), lo = (uint64_t)first;
+    if ((hi & 0x1FF) == 0x1FF) {
+        // The low half of 5^q may carry into the bits we keep
+        uint64_t second = (uint64_t)(((unsigned __int128)w * t[1]) >> 64);
+        lo += second;
+        if (second > lo) hi++;
+    }
+    // Outside this range 5^q is inexact in 128 bits and lo may hide a carry
+    if (lo == UINT64_MAX && (q < -27 || q > 55)) return false;
+
+    int upper = (int)(hi >> 63);
+    uint64_t m = hi >> (upper + 9);
+    int p2 = (int)(((152170 + 65536) * q) >> 16) + 63 + upper - lz + 1023;
+
+    if (p2 <= 0) {
+        // Subnormal, or zero when even the top bit shifts out
+        if (-p2 + 1 >= 64) {
+            *bits = 0;
+            return true;
+        }
+        m >>= -p2 + 1;
+        m += m & 1;
+        m >>= 1;
+        // Rounding up may have produced the smallest normal
+        *bits = m < (UINT64_C(1) << 52) ? m : (UINT64_C(1) << 52);
+        return true;
+    }
+
+    // Exactly halfway between two doubles: round to even, not up. Only
+    // products of small powers can be exact.
+    if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << (upper + 9)) == hi) {
+        m &= ~UINT64_C(1);
+    }
+    m += m & 1;
+    m >>= 1;
+    if (m >= (UINT64_C(2) << 52)) {
+        m = UINT64_C(1) << 52;
+        p2++;
+    }
+    if (p2 >= DBL_EXP_INF) {
+        *bits = (uint64_t)DBL_EXP_INF << 52;
+        return true;
+    }
+    *bits = (m & DBL_MANT_MASK) | ((uint64_t)p2 << 52);
+    return true;
+}
+
+// Consumes decimal digits, keeping the first 19 significant ones in *w and
+// adjusting the decimal exponent *q for kept fraction digits and dropped
+// integer digits. Leading zeros must already be skipped.
+static const unsigned char* take_digits(const unsigned char* p, const unsigned char* end,
+                                        uint64_t* w, int* nd, int64_t* q, bool* truncated, bool fraction) {
+#ifdef COME_NUM_SWAR
+    while (end - p >= 8 && *nd <= 11) {
+        uint64_t v = load8(p);
+        if (!eight_digits(v)) break;
+        *w = *w * 100000000 + eight_value(v);
+        *nd += 8;
+        if (fraction) *q -= 8;
+        p += 8;
+    }
+#endif
+    for (; p < end && is_digit(*p); p++) {
+        if (*nd < 19) {
+            *w = *w * 10 + (*p - '0');
+            (*nd)++;
+            if (fraction) (*q)--;
+        } else {
+            if (*p != '0') *truncated = true;
+            if (!fraction) (*q)++;
+        }
+    }
+    return p;
+}
+
+// Case-insensitive match of a lowercase word at p
+static bool match_word(const unsigned char* p, const unsigned char* end, const char* word, size_t n) {
+    if ((size_t)(end - p) < n) return false;
+    for (size_t i = 0; i < n; i++) {
+        if ((p[i] | 0x20) != (unsigned char)word[i]) return false;
+    }
+    return true;
+}
+
+// Trailing bytes after a parsed number: only whitespace is allowed
+static int parse_tail(const unsigned char* p, const unsigned char* end, int err) {
+    while (p < end && is_space(*p)) p++;
+    return (p != end && !err) ? EINVAL : err;
+}
+
+// strtod on a NUL-terminated copy, for hex floats and undecided inputs
+static int parse_slow(const unsigned char* s, const unsigned char* end, double* out) {
+    char stack[128];
+    size_t n = (size_t)(end - s);
+    char* buf = n < sizeof(stack) ? stack : malloc(n + 1);
+    if (!buf) return ENOMEM;
+    memcpy(buf, s, n);
+    buf[n] = '\0';
+
+    int saved = errno;
+    errno = 0;
+    char* stop;
+    *out = strtod(buf, &stop);
+    // strtod also flags subnormal results; only overflow and total underflow count
+    int err = (errno == ERANGE && (isinf(*out) || *out == 0)) ? ERANGE : 0;
+    errno = saved;
+    const unsigned char* p = s + (stop - buf);
+    if (buf != stack) free(buf);
+
+    if (p == s) return EINVAL;
+    return parse_tail(p, end, err);
+}
+
+int come_num_parse_double(const char* str, size_t len, double* out) {
+    const unsigned char* p = (const unsigned char*)str;
+    const unsigned char* end = p + len;
+    *out = 0;
+
+    while (p < end && is_space(*p)) p++;
+    const unsigned char* start = p;
+    bool neg = false;
+    if (p < end && (*p == '+' || *p == '-')) neg = *p++ == '-';
+
+    if (p < end && (*p | 0x20) == 'i' && match_word(p, end, "inf", 3)) {
+        p += match_word(p, end, "infinity", 8) ? 8 : 3;
+        *out = neg ? -HUGE_VAL : HUGE_VAL;
+        return parse_tail(p, end, 0);
+    }
+    if (p < end && (*p | 0x20) == 'n' && match_word(p, end, "nan", 3)) {
+        *out = neg ? -NAN : NAN;
+        return parse_tail(p + 3, end, 0);
+    }
+    if (end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x') return parse_slow(start, end, out);
+
+    uint64_t w = 0;
+    int64_t q = 0;
+    int nd = 0;
+    bool truncated = false;
+
+    const unsigned char* mark = p;
+    while (p < end && *p == '0') p++;
+    p = take_digits(p, end, &w, &nd, &q, &truncated, false);
+    bool any = p != mark;
+    if (p < end && *p == '.') {
+        mark = ++p;
+        if (nd == 0) {
+            for (; p < end && *p == '0'; p++) q--;
+        }
+        p = take_digits(p, end, &w, &nd, &q, &truncated, true);
+        any |= p != mark;
+    }
+    if (!any) return EINVAL;
+
+    // An exponent marker without digits is not part of the number
+    if (p < end && (*p | 0x20) == 'e') {
+        const unsigned char* e = p + 1;
+        bool eneg = false;
+        if (e < end && (*e == '+' || *e == '-')) eneg = *e++ == '-';
+        if (e < end && is_digit(*e)) {
+            int64_t x = 0;
+            for (; e < end && is_digit(*e); e++) {
+                if (x < 100000) x = x * 10 + (*e - '0');
+            }
+            q += eneg ? -x : x;
+            p = e;
+        }
+    }
+
+    uint64_t bits;
+#if FLT_EVAL_METHOD == 0
+    if (!truncated && q >= -22 && q <= 22 && w <= (UINT64_C(1) << 53)) {
+        // w and 10^|q| are exact doubles, so one correctly rounded operation suffices
+        double d = (double)w;
+        d = q < 0 ? d / pow10_exact[-q] : d * pow10_exact[q];
+        memcpy(&bits, &d, sizeof(bits));
+    } else
+#endif
+    {
+        // A truncated w is decided only if w and w + 1 round the same way
+        uint64_t up;
+        if (!eisel_lemire(w, q, &bits) ||
+            (truncated && (!eisel_lemire(w + 1, q, &up) || up != bits))) {
+            return parse_slow(start, end, out);
+        }
+    }
+
+    int err = 0;
+    if ((bits >> 52) == DBL_EXP_INF || (bits == 0 && w != 0)) err = ERANGE;
+    if (neg) bits |= DBL_SIGN;
+    memcpy(out, &bits, sizeof(bits));
+    return parse_tail(p, end, err);
+}
+
+
+// Formatting doubles (Schubfach, R. Giulietti: "The Schubfach way to render doubles")
+
+static inline int floor_log2_pow10(int e) {
+    return (e * 1741647) >> 19;
+}
+
+static inline int floor_log10_pow2(int e) {
+    return (e * 1262611) >> 22;
+}
+
+static inline int floor_log10_three_quarters_pow2(int e) {
+    return (e * 1262611 - 524031) >> 22;
+}
+
+// Upper 64 bits of g * cp / 2^64, with the lowest bit set if any bit below was
+static inline uint64_t round_to_odd(const uint64_t g[2], uint64_t cp) {
+    unsigned __int128 x = (unsigned __int128)g[1] * cp;
+    unsigned __int128 y = (unsigned __int128)g[0] * cp + (uint64_t)(x >> 64);
+    uint64_t y1 = (uint64_t)(y >> 64), y0 = (uint64_t)y;
+    return y1 | (y0 > 1);
+}
+
+// Shortest decimal s * 10^*exp10 that rounds back to the positive finite
+// double with these bits, nearest to it when several qualify
+static uint64_t shortest(uint64_t bits, int* exp10) {
+    uint64_t f = bits & DBL_MANT_MASK;
+    int e = (int)(bits >> 52);
+    uint64_t c = e ? f | (UINT64_C(1) << 52) : f;
+    int q = (e ? e : 1) - 1075;
+
+    // Integers below 2^53 are their own shortest form
+    if (q <= 0 && q >= -52 && ((c >> -q) << -q) == c) {
+        *exp10 = 0;
+        return c >> -q;
+    }
+
+    // The rounding interval [cbl, cbr] * 2^(q-2) around cb; it is lopsided
+    // when f == 0, since the double below has the next smaller exponent
+    bool even = (c & 1) == 0;
+    bool closer = f == 0 && e > 1;
+    uint64_t cbl = 4 * c - 2 + closer, cb = 4 * c, cbr = 4 * c + 2;
+    int k = closer ? floor_log10_three_quarters_pow2(q) : floor_log10_pow2(q);
+    int h = q + floor_log2_pow10(-k) + 1;
+    const uint64_t* g = num_pow10[-k - NUM_POW10_MIN];
+
+    uint64_t vbl = round_to_odd(g, cbl << h);
+    uint64_t vb = round_to_odd(g, cb << h);
+    uint64_t vbr = round_to_odd(g, cbr << h);
+    uint64_t lower = vbl + !even, upper = vbr - !even;
+
+    // One digit less when exactly one of its two candidates is in the interval
+    uint64_t s = vb / 4;
+    if (s >= 10) {
+        uint64_t sp = s / 10;
+        bool up_in = lower <= 40 * sp, wp_in = 40 * sp + 40 <= upper;
+        if (up_in != wp_in) {
+            *exp10 = k + 1;
+            return sp + wp_in;
+        }
+    }
+    bool u_in = lower <= 4 * s, w_in = 4 * s + 4 <= upper;
+    *exp10 = k;
+    if (u_in != w_in) return s + w_in;
+    // Both in: the nearer one, ties to even
+    uint64_t mid = 4 * s + 2;
+    return s + (vb > mid || (vb == mid && (s & 1)));
+}
+
+size_t come_num_format_double(char* buf, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    char* o = buf;
+
+    if ((bits >> 52 & DBL_EXP_INF) == DBL_EXP_INF) {
+        if (bits & DBL_MANT_MASK) {
+            memcpy(o, "nan", 3);
+            return 3;
+        }
+        if (bits & DBL_SIGN) *o++ = '-';
+        memcpy(o, "inf", 3);
+        return (size_t)(o + 3 - buf);
+    }
+    if (bits & DBL_SIGN) *o++ = '-';
+    bits &= ~DBL_SIGN;
+    if (bits == 0) {
+        *o++ = '0';
+        return (size_t)(o - buf);
+    }
+
+    int exp10;
+    uint64_t m = shortest(bits, &exp10);
+    while (m % 10 == 0) {
+        m /= 10;
+        exp10++;
+    }
+    char tmp[20];
+    char* d = put_digits(tmp + sizeof(tmp), m);
+    int k = (int)(tmp + sizeof(tmp) - d); // Digits
+    int n = k + exp10;                    // Digits before the decimal point
+
+    if (k <= n && n <= 21) {
+        memcpy(o, d, k);
+        memset(o + k, '0', n - k);
+        o += n;
+    } else if (0 < n && n <= 21) {
+        memcpy(o, d, n);
+        o[n] = '.';
+        memcpy(o + n + 1, d + n, k - n);
+        o += k + 1;
+    } else if (-6 < n && n <= 0) {
+        *o++ = '0';
+        *o++ = '.';
+        memset(o, '0', -n);
+        memcpy(o - n, d, k);
+        o += k - n;
+    } else {
+        *o++ = d[0];
+        if (k > 1) {
+            *o++ = '.';
+            memcpy(o, d + 1, k - 1);
+            o += k - 1;
+        }
+        int x = n - 1;
+        *o++ = 'e';
+        *o++ = x < 0 ? '-' : '+';
+        char* xe = put_digits(tmp + sizeof(tmp), (uint64_t)(x < 0 ? -x : x));
+        size_t xn = (size_t)(tmp + sizeof(tmp) - xe);
+        memcpy(o, xe, xn);
+        o += xn;
+    }
+    return (size_t)(o - buf);
+}
@@ -0,0 +1,38 @@
+#ifndef COME_STRING_NUM_H
+#define COME_STRING_NUM_H
+
+#include <stddef.h>
+
+// Numeric conversion kernels for the string module (explicit lengths, no
+// allocation, no locale).
+//
+// Parsers accept leading and trailing ASCII whitespace around the number and
+// return 0, EINVAL (no digits, bad base or other trailing bytes; the value
+// parsed so far is still stored) or ERANGE (out of range; the value is
+// clamped like strtol/strtod). Decimal digits are consumed eight at a time
+// with SWAR. Doubles are correctly rounded: exact small cases multiply
+// directly, the rest use the Eisel-Lemire algorithm and fall back to strtod
+// only when it cannot decide (hex floats, some inputs over 19 digits).
+//
+// Formatters write without a NUL and return the length. Doubles use the
+// Schubfach algorithm: the shortest digits that parse back to the same value.
+
+#define COME_NUM_LONG_MAX   20 // Bytes needed by come_num_format_long
+#define COME_NUM_DOUBLE_MAX 25 // Bytes needed by come_num_format_double
+
+// Base 2-36, or 0 to detect it from a 0x (16), 0b (2) or 0 (8) prefix.
+// Base 16 also accepts a 0x prefix and base 2 a 0b prefix.
+int come_num_parse_long(const char* s, size_t len, int base, long* out);
+
+// Decimal or hex floats with an optional exponent, inf, infinity and nan
+// (any case). Overflow gives ±HUGE_VAL and underflow to zero gives ±0, both ERANGE.
+int come_num_parse_double(const char* s, size_t len, double* out);
+
+size_t come_num_format_long(char* buf, long v);
+size_t come_num_format_ulong(char* buf, unsigned long v);
+
+// Fixed notation for decimal exponents from -6 to 20, otherwise d.ddde±x
+// (1e+21, 1.5e-7) like JavaScript; "inf", "-inf" and "nan" for the rest.
+size_t come_num_format_double(char* buf, double v);
+
+#endif
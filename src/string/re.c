@@ -0,0 +1,1194 @@
+#include "re.h"
+#include "search.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+// Patterns past these limits go to libc instead
+#define RE_MAX_INSTS 20000
+#define RE_MAX_REPEAT 1000
+#define RE_MAX_DEPTH 1000
+
+// The DFA cache is flushed and rebuilt from the current state when full
+#define RE_DFA_MAX_STATES 4096
+#define RE_DFA_TABLE_SIZE 8192 // Power of two, at least twice the state limit
+
+// Longest required literal kept for the substring prefilter
+#define RE_MAX_LITERAL 64
+
+
+// Program
+
+typedef struct {
+    uint64_t bits[4];
+} re_class_t;
+
+static inline bool class_has(const re_class_t* c, uint8_t b) {
+    return (c->bits[b >> 6] >> (b & 63)) & 1;
+}
+
+static inline void class_add(re_class_t* c, uint8_t b) {
+    c->bits[b >> 6] |= (uint64_t)1 << (b & 63);
+}
+
+enum {
+    I_CLASS, // Consume a byte in classes[x]
+    I_MATCH, // Pattern x matched
+    I_JMP,   // Go to x
+    I_SPLIT, // Go to x, then y (x preferred)
+    I_SAVE,  // Record the position in capture slot x
+    I_BOL,   // Assert start of input
+    I_EOL    // Assert end of input
+};
+
+typedef struct {
+    int op;
+    int x, y;
+} re_inst_t;
+
+typedef struct {
+    int* pcs;        // Sorted NFA states (I_CLASS, I_MATCH, I_EOL only)
+    int n;
+    uint32_t hash;
+    bool match;      // Contains an I_MATCH
+    uint32_t seen;   // Last set_match run that collected this state
+} re_dfa_state_t;
+
+typedef struct {
+    re_dfa_state_t* states;
+    size_t n_states, cap_states;
+    int* trans;         // n_states x n_bytes, -1 until computed
+    int table[RE_DFA_TABLE_SIZE]; // State index + 1, open addressing
+    int start[2];       // Start state without / with '^' satisfied, -1 until computed
+    uint32_t run;
+    bool anchored;      // No restart at every position
+    bool flushed;       // Set when the cache was cleared during a step
+} re_dfa_t;
+
+// One Pike VM thread list
+typedef struct {
+    int* pc;
+    long* caps;
+    size_t n;
+    uint32_t* mark;
+    uint32_t gen;
+} re_list_t;
+
+typedef struct {
+    int pc;
+    int slot;   // >= 0: restore caps[slot] = old
+    long old;
+} re_frame_t;
+
+struct come_re_prog_t {
+    re_inst_t* insts;
+    size_t n_insts, cap_insts;
+    re_class_t* classes;
+    size_t n_classes, cap_classes;
+    size_t groups;
+    size_t n_patterns;
+    size_t ncaps;          // 2 * (groups + 1)
+
+    // Every match contains lit (empty when the pattern has no such run);
+    // with lit_prefix every match starts with it
+    char lit[RE_MAX_LITERAL];
+    size_t lit_len;
+    bool lit_prefix;
+
+    // Bytes that no class tells apart share a column in the DFA table
+    uint8_t byte_map[256];
+    size_t n_bytes;
+
+    // Scratch shared by DFA construction and the Pike VM, and the DFA cache:
+    // matching writes both, so one match at a time holds the lock
+    pthread_mutex_t lock;
+    int* stack;
+    int* buf;
+    uint32_t* mark;
+    uint32_t gen;
+    re_dfa_t* dfa[2];      // Unanchored, anchored
+    re_list_t lists[2];
+    re_frame_t* frames;
+    long* tmp_caps;
+};
+
+
+// Parser
+// Recursive descent over the POSIX extended grammar into a small AST.
+// Anything outside the supported subset clears 'ok'.
+
+enum { N_EMPTY, N_CLASS, N_CAT, N_ALT, N_REPEAT, N_GROUP, N_BOL, N_EOL };
+
+typedef struct {
+    int kind;
+    int a, b;       // Children
+    int min, max;   // N_REPEAT; max -1 is unbounded
+    int cls;        // N_CLASS
+    int group;      // N_GROUP
+} re_node_t;
+
+typedef struct {
+    const char* p;
+    bool ok;
+    re_node_t* nodes;
+    size_t n_nodes, cap_nodes;
+    come_re_prog_t* prog; // Receives classes and group count
+} re_parser_t;
+
+static int new_node(re_parser_t* ps, int kind) {
+    if (!ps->ok) return -1;
+    if (ps->n_nodes == ps->cap_nodes) {
+        size_t cap = ps->cap_nodes ? ps->cap_nodes * 2 : 64;
+        re_node_t* nodes = realloc(ps->nodes, cap * sizeof(re_node_t));
+        if (!nodes) {
+            ps->ok = false;
+            return -1;
+        }
+        ps->nodes = nodes;
+        ps->cap_nodes = cap;
+    }
+    re_node_t* n = &ps->nodes[ps->n_nodes];
+    memset(n, 0, sizeof(*n));
+    n->kind = kind;
+    n->a = n->b = -1;
+    return (int)ps->n_nodes++;
+}
+
+static int new_class(re_parser_t* ps) {
+    come_re_prog_t* prog = ps->prog;
+    if (prog->n_classes == prog->cap_classes) {
+        size_t cap = prog->cap_classes ? prog->cap_classes * 2 : 16;
+        re_class_t* classes = realloc(prog->classes, cap * sizeof(re_class_t));
+        if (!classes) {
+            ps->ok = false;
+            return -1;
+        }
+        prog->classes = classes;
+        prog->cap_classes = cap;
+    }
+    memset(&prog->classes[prog->n_classes], 0, sizeof(re_class_t));
+    return (int)prog->n_classes++;
+}
+
+static int class_node(re_parser_t* ps, int cls) {
+    int n = new_node(ps, N_CLASS);
+    if (n >= 0) ps->nodes[n].cls = cls;
+    return n;
+}
+
+static int pair_node(re_parser_t* ps, int kind, int a, int b) {
+    int n = new_node(ps, kind);
+    if (n >= 0) {
+        ps->nodes[n].a = a;
+        ps->nodes[n].b = b;
+    }
+    return n;
+}
+
+// Named classes, evaluated in the C locale like the rest of the engine
+static bool add_named_class(re_class_t* c, const char* name, size_t len) {
+    static const struct {
+        const char* name;
+        int (*fn)(int);
+    } names[] = {
+        {"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum}, {"upper", isupper},
+        {"lower", islower}, {"space", isspace}, {"blank", isblank}, {"punct", ispunct},
+        {"print", isprint}, {"graph", isgraph}, {"cntrl", iscntrl}, {"xdigit", isxdigit},
+    };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strlen(names[i].name) == len && memcmp(names[i].name, name, len) == 0) {
+            for (int b = 0; b < 128; b++) {
+                if (names[i].fn(b)) class_add(c, (uint8_t)b);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void class_invert(re_class_t* c) {
+    for (int i = 0; i < 4; i++) c->bits[i] = ~c->bits[i];
+}
+
+// '[' already consumed
+static int parse_bracket(re_parser_t* ps) {
+    int cls = new_class(ps);
+    if (cls < 0) return -1;
+    re_class_t c = {{0}};
+    bool neg = false;
+    if (*ps->p == '^') {
+        neg = true;
+        ps->p++;
+    }
+    bool first = true;
+    for (;;) {
+        unsigned char ch = (unsigned char)*ps->p;
+        if (ch == '\0') goto fail;
+        if (ch == ']' && !first) {
+            ps->p++;
+            break;
+        }
+        first = false;
+        if (ch == '[' && ps->p[1] == ':') {
+            const char* name = ps->p + 2;
+            const char* end = strstr(name, ":]");
+            if (!end || !add_named_class(&c, name, end - name)) goto fail;
+            ps->p = end + 2;
+            continue;
+        }
+        if (ch == '[' && (ps->p[1] == '.' || ps->p[1] == '=')) goto fail; // Collating elements
+        ps->p++;
+        if (ps->p[0] == '-' && ps->p[1] != ']' && ps->p[1] != '\0') {
+            unsigned char hi = (unsigned char)ps->p[1];
+            if (hi == '[' || hi < ch) goto fail;
+            ps->p += 2;
+            for (unsigned b = ch; b <= hi; b++) class_add(&c, (uint8_t)b);
+        } else {
+            class_add(&c, ch);
+        }
+    }
+    if (neg) class_invert(&c);
+    ps->prog->classes[cls] = c;
+    return class_node(ps, cls);
+fail:
+    ps->ok = false;
+    return -1;
+}
+
+static int parse_alt(re_parser_t* ps, int depth);
+
+static int parse_atom(re_parser_t* ps, int depth) {
+    unsigned char ch = (unsigned char)*ps->p;
+    int cls;
+    switch (ch) {
+    case '(': {
+        ps->p++;
+        int group = (int)++ps->prog->groups;
+        int inner = parse_alt(ps, depth + 1);
+        if (!ps->ok || *ps->p != ')') {
+            ps->ok = false;
+            return -1;
+        }
+        ps->p++;
+        int n = pair_node(ps, N_GROUP, inner, -1);
+        if (n >= 0) ps->nodes[n].group = group;
+        return n;
+    }
+    case '.':
+        ps->p++;
+        if ((cls = new_class(ps)) < 0) return -1;
+        class_invert(&ps->prog->classes[cls]);
+        ps->prog->classes[cls].bits[0] &= ~(uint64_t)1; // Never NUL, like glibc
+        return class_node(ps, cls);
+    case '^':
+        ps->p++;
+        return new_node(ps, N_BOL);
+    case '$':
+        ps->p++;
+        return new_node(ps, N_EOL);
+    case '[':
+        ps->p++;
+        return parse_bracket(ps);
+    case '*': case '+': case '?': case '{':
+        ps->ok = false; // Nothing to repeat
+        return -1;
+    case '\\':
+        ch = (unsigned char)*++ps->p;
+        if (ch == '\0' || isdigit(ch) || strchr("bB<>`'", ch)) {
+            ps->ok = false; // Back-references and word boundaries are left to libc
+            return -1;
+        }
+        ps->p++;
+        if ((cls = new_class(ps)) < 0) return -1;
+        if (ch == 'w' || ch == 'W') {
+            add_named_class(&ps->prog->classes[cls], "alnum", 5);
+            class_add(&ps->prog->classes[cls], '_');
+        } else if (ch == 's' || ch == 'S') {
+            add_named_class(&ps->prog->classes[cls], "space", 5);
+        } else {
+            class_add(&ps->prog->classes[cls], ch);
+            return class_node(ps, cls);
+        }
+        if (ch == 'W' || ch == 'S') class_invert(&ps->prog->classes[cls]);
+        return class_node(ps, cls);
+    default:
+        ps->p++;
+        if ((cls = new_class(ps)) < 0) return -1;
+        class_add(&ps->prog->classes[cls], ch);
+        return class_node(ps, cls);
+    }
+}
+
+static bool parse_int(re_parser_t* ps, int* out) {
+    if (!isdigit((unsigned char)*ps->p)) return false;
+    long v = 0;
+    while (isdigit((unsigned char)*ps->p)) {
+        v = v * 10 + (*ps->p++ - '0');
+        if (v > RE_MAX_REPEAT) return false;
+    }
+    *out = (int)v;
+    return true;
+}
+
+static int parse_repeat(re_parser_t* ps, int depth) {
+    int atom = parse_atom(ps, depth);
+    while (ps->ok) {
+        int min, max;
+        char ch = *ps->p;
+        if (ch == '*') {
+            min = 0; max = -1;
+        } else if (ch == '+') {
+            min = 1; max = -1;
+        } else if (ch == '?') {
+            min = 0; max = 1;
+        } else if (ch == '{') {
+            ps->p++;
+            if (!parse_int(ps, &min)) min = 0; // "{,n}" as glibc accepts it
+            max = min;
+            if (*ps->p == ',') {
+                ps->p++;
+                if (!parse_int(ps, &max)) max = -1;
+            }
+            if (*ps->p != '}' || (max >= 0 && max < min)) {
+                ps->ok = false;
+                return -1;
+            }
+        } else {
+            break;
+        }
+        ps->p++;
+        int kind = ps->nodes[atom].kind;
+        if (kind == N_BOL || kind == N_EOL) {
+            ps->ok = false;
+            return -1;
+        }
+        atom = pair_node(ps, N_REPEAT, atom, -1);
+        if (atom >= 0) {
+            ps->nodes[atom].min = min;
+            ps->nodes[atom].max = max;
+        }
+    }
+    return atom;
+}
+
+static int parse_cat(re_parser_t* ps, int depth) {
+    int left = -1;
+    while (ps->ok && *ps->p && *ps->p != '|' && *ps->p != ')') {
+        int piece = parse_repeat(ps, depth);
+        left = left < 0 ? piece : pair_node(ps, N_CAT, left, piece);
+    }
+    return left < 0 ? new_node(ps, N_EMPTY) : left;
+}
+
+static int parse_alt(re_parser_t* ps, int depth) {
+    if (depth > RE_MAX_DEPTH) {
+        ps->ok = false;
+        return -1;
+    }
+    int left = parse_cat(ps, depth);
+    while (ps->ok && *ps->p == '|') {
+        ps->p++;
+        int right = parse_cat(ps, depth);
+        left = pair_node(ps, N_ALT, left, right);
+    }
+    return left;
+}
+
+
+// Compiler (Thompson construction)
+
+static int emit(re_parser_t* ps, int op, int x, int y) {
+    come_re_prog_t* prog = ps->prog;
+    if (!ps->ok) return -1;
+    if (prog->n_insts == prog->cap_insts) {
+        if (prog->n_insts >= RE_MAX_INSTS) {
+            ps->ok = false;
+            return -1;
+        }
+        size_t cap = prog->cap_insts ? prog->cap_insts * 2 : 64;
+        re_inst_t* insts = realloc(prog->insts, cap * sizeof(re_inst_t));
+        if (!insts) {
+            ps->ok = false;
+            return -1;
+        }
+        prog->insts = insts;
+        prog->cap_insts = cap;
+    }
+    prog->insts[prog->n_insts] = (re_inst_t){op, x, y};
+    return (int)prog->n_insts++;
+}
+
+static void emit_node(re_parser_t* ps, int idx, int depth) {
+    if (!ps->ok) return;
+    if (depth > RE_MAX_DEPTH * 2) {
+        ps->ok = false;
+        return;
+    }
+    come_re_prog_t* prog = ps->prog;
+    re_node_t n = ps->nodes[idx];
+    int s, j;
+    switch (n.kind) {
+    case N_EMPTY:
+        break;
+    case N_CLASS:
+        emit(ps, I_CLASS, n.cls, 0);
+        break;
+    case N_BOL:
+        emit(ps, I_BOL, 0, 0);
+        break;
+    case N_EOL:
+        emit(ps, I_EOL, 0, 0);
+        break;
+    case N_CAT:
+        emit_node(ps, n.a, depth + 1);
+        emit_node(ps, n.b, depth + 1);
+        break;
+    case N_ALT:
+        s = emit(ps, I_SPLIT, 0, 0);
+        emit_node(ps, n.a, depth + 1);
+        j = emit(ps, I_JMP, 0, 0);
+        if (!ps->ok) return;
+        prog->insts[s].x = s + 1;
+        prog->insts[s].y = (int)prog->n_insts;
+        emit_node(ps, n.b, depth + 1);
+        if (ps->ok) prog->insts[j].x = (int)prog->n_insts;
+        break;
+    case N_GROUP:
+        emit(ps, I_SAVE, 2 * n.group, 0);
+        emit_node(ps, n.a, depth + 1);
+        emit(ps, I_SAVE, 2 * n.group + 1, 0);
+        break;
+    case N_REPEAT: {
+        // x{m,} is m-1 copies and x+; x{m,n} is m copies and n-m optional ones
+        int copies = (n.max < 0 && n.min > 0) ? n.min - 1 : n.min;
+        for (int i = 0; i < copies; i++) emit_node(ps, n.a, depth + 1);
+        if (n.max < 0 && n.min == 0) {
+            // x* as (x+)? so a body matching empty still passes once, as in glibc
+            s = emit(ps, I_SPLIT, 0, 0);
+            emit_node(ps, n.a, depth + 1);
+            j = emit(ps, I_SPLIT, s + 1, 0);
+            if (!ps->ok) return;
+            prog->insts[s].x = s + 1;
+            prog->insts[s].y = prog->insts[j].y = (int)prog->n_insts;
+        } else if (n.max < 0) {
+            int loop = (int)prog->n_insts;
+            emit_node(ps, n.a, depth + 1);
+            s = emit(ps, I_SPLIT, loop, 0);
+            if (ps->ok) prog->insts[s].y = s + 1;
+        } else {
+            // Optional copies chain their exits through .y until the end is known
+            int chain = -1;
+            for (int i = n.min; i < n.max; i++) {
+                s = emit(ps, I_SPLIT, 0, chain);
+                if (!ps->ok) return;
+                prog->insts[s].x = s + 1;
+                chain = s;
+                emit_node(ps, n.a, depth + 1);
+            }
+            if (!ps->ok) return;
+            while (chain >= 0) {
+                int next = prog->insts[chain].y;
+                prog->insts[chain].y = (int)prog->n_insts;
+                chain = next;
+            }
+        }
+        break;
+    }
+    }
+}
+
+static int class_single(const re_class_t* c) {
+    int byte = -1;
+    for (int w = 0; w < 4; w++) {
+        uint64_t bits = c->bits[w];
+        if (!bits) continue;
+        if ((bits & (bits - 1)) || byte >= 0) return -1;
+        byte = w * 64 + __builtin_ctzll(bits);
+    }
+    return byte;
+}
+
+// Track the longest run of single-byte atoms in the top-level concatenation.
+// Every match contains that run, so inputs without it need no DFA pass.
+typedef struct {
+    char run[RE_MAX_LITERAL];
+    size_t len;
+    bool prefix; // The current run starts the pattern
+} re_literal_t;
+
+static void literal_scan(re_parser_t* ps, int idx, re_literal_t* lit) {
+    const re_node_t* n = &ps->nodes[idx];
+    if (n->kind == N_CAT) {
+        literal_scan(ps, n->a, lit);
+        literal_scan(ps, n->b, lit);
+        return;
+    }
+    int byte = n->kind == N_CLASS ? class_single(&ps->prog->classes[n->cls]) : -1;
+    if (byte < 0 || lit->len == RE_MAX_LITERAL) {
+        lit->len = 0;
+        lit->prefix = false;
+        if (byte < 0) return;
+    }
+    lit->run[lit->len++] = (char)byte;
+    if (lit->len > ps->prog->lit_len) {
+        memcpy(ps->prog->lit, lit->run, lit->len);
+        ps->prog->lit_len = lit->len;
+        ps->prog->lit_prefix = lit->prefix;
+    }
+}
+
+static bool compile_pattern(come_re_prog_t* prog, const char* pattern, bool literal) {
+    re_parser_t ps = {pattern, true, NULL, 0, 0, prog};
+    int root = parse_alt(&ps, 0);
+    if (ps.ok && *ps.p != '\0') ps.ok = false; // Unmatched ')'
+    if (ps.ok) emit_node(&ps, root, 0);
+    if (ps.ok && literal) {
+        re_literal_t lit = {{0}, 0, true};
+        literal_scan(&ps, root, &lit);
+    }
+    free(ps.nodes);
+    return ps.ok;
+}
+
+// Partition bytes into equivalence classes over every class in the program
+static void build_byte_map(come_re_prog_t* prog) {
+    memset(prog->byte_map, 0, sizeof(prog->byte_map));
+    size_t n = 1;
+    for (size_t c = 0; c < prog->n_classes && n < 256; c++) {
+        int remap[512];
+        memset(remap, -1, sizeof(remap));
+        size_t next = 0;
+        for (int b = 0; b < 256; b++) {
+            int key = prog->byte_map[b] * 2 + class_has(&prog->classes[c], (uint8_t)b);
+            if (remap[key] < 0) remap[key] = (int)next++;
+            prog->byte_map[b] = (uint8_t)remap[key];
+        }
+        n = next;
+    }
+    prog->n_bytes = n;
+}
+
+static bool prog_finish(come_re_prog_t* prog) {
+    size_t n = prog->n_insts;
+    prog->ncaps = 2 * (prog->groups + 1);
+    build_byte_map(prog);
+    prog->stack = malloc(sizeof(int) * (2 * n + 2));
+    prog->buf = malloc(sizeof(int) * (n + 1));
+    prog->mark = calloc(n, sizeof(uint32_t));
+    if (!prog->stack || !prog->buf || !prog->mark) return false;
+    return true;
+}
+
+static come_re_prog_t* prog_new(void) {
+    come_re_prog_t* prog = calloc(1, sizeof(come_re_prog_t));
+    if (prog) pthread_mutex_init(&prog->lock, NULL);
+    return prog;
+}
+
+come_re_prog_t* come_re_compile(const char* pattern) {
+    if (!pattern) return NULL;
+    come_re_prog_t* prog = prog_new();
+    if (!prog) return NULL;
+    prog->n_patterns = 1;
+    re_parser_t ps = {pattern, true, NULL, 0, 0, prog};
+    emit(&ps, I_SAVE, 0, 0);
+    if (ps.ok && compile_pattern(prog, pattern, true)) {
+        emit(&ps, I_SAVE, 1, 0);
+        emit(&ps, I_MATCH, 0, 0);
+    } else {
+        ps.ok = false;
+    }
+    if (!ps.ok || !prog_finish(prog)) {
+        come_re_free(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+come_re_prog_t* come_re_compile_set(const char* const* patterns, size_t n) {
+    if (!patterns || n == 0) return NULL;
+    come_re_prog_t* prog = prog_new();
+    if (!prog) return NULL;
+    prog->n_patterns = n;
+    re_parser_t ps = {NULL, true, NULL, 0, 0, prog};
+    // split(p0, split(p1, ... pn)), each pattern ending in its own I_MATCH
+    int pending = -1;
+    for (size_t i = 0; i < n && ps.ok; i++) {
+        if (pending >= 0) prog->insts[pending].y = (int)prog->n_insts;
+        if (i + 1 < n) {
+            pending = emit(&ps, I_SPLIT, 0, 0);
+            if (pending < 0) break;
+            prog->insts[pending].x = pending + 1;
+        }
+        if (!patterns[i] || !compile_pattern(prog, patterns[i], false)) {
+            ps.ok = false;
+            break;
+        }
+        emit(&ps, I_MATCH, (int)i, 0);
+    }
+    if (!ps.ok || !prog_finish(prog)) {
+        come_re_free(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+static void dfa_flush(re_dfa_t* dfa) {
+    for (size_t i = 0; i < dfa->n_states; i++) free(dfa->states[i].pcs);
+    dfa->n_states = 0;
+    memset(dfa->table, 0, sizeof(dfa->table));
+    dfa->start[0] = dfa->start[1] = -1;
+}
+
+void come_re_free(come_re_prog_t* prog) {
+    if (!prog) return;
+    for (int i = 0; i < 2; i++) {
+        re_dfa_t* dfa = prog->dfa[i];
+        if (dfa) {
+            dfa_flush(dfa);
+            free(dfa->states);
+            free(dfa->trans);
+            free(dfa);
+        }
+        free(prog->lists[i].pc);
+        free(prog->lists[i].caps);
+        free(prog->lists[i].mark);
+    }
+    free(prog->frames);
+    free(prog->tmp_caps);
+    free(prog->stack);
+    free(prog->buf);
+    free(prog->mark);
+    free(prog->insts);
+    free(prog->classes);
+    pthread_mutex_destroy(&prog->lock);
+    free(prog);
+}
+
+size_t come_re_groups(const come_re_prog_t* prog) {
+    return prog ? prog->groups : 0;
+}
+
+
+// Lazy DFA
+// A DFA state is the set of NFA states reachable at a position. States and
+// their transitions are built on first use and kept, so steady-state matching
+// is one table lookup per byte. The unanchored DFA folds the start state into
+// every step (search); the anchored one does not (longest match at a position).
+//
+// Table entries are row offsets (state * n_bytes) so the hot loop needs no
+// multiply. Match and dead states are stored as -2 - row, which sends them to
+// the slow path together with unknown transitions (-1).
+
+#define DFA_UNKNOWN -1
+
+// Append the epsilon closure of pc to prog->buf. '^' holds only when 'bol';
+// '$' is followed only when 'eol', otherwise it stays in the set.
+static void closure(come_re_prog_t* prog, int pc, bool bol, bool eol, size_t* n) {
+    int* stack = prog->stack;
+    size_t top = 0;
+    stack[top++] = pc;
+    while (top) {
+        pc = stack[--top];
+        if (prog->mark[pc] == prog->gen) continue;
+        prog->mark[pc] = prog->gen;
+        const re_inst_t* in = &prog->insts[pc];
+        switch (in->op) {
+        case I_JMP:
+            stack[top++] = in->x;
+            break;
+        case I_SPLIT:
+            stack[top++] = in->y;
+            stack[top++] = in->x;
+            break;
+        case I_SAVE:
+            stack[top++] = pc + 1;
+            break;
+        case I_BOL:
+            if (bol) stack[top++] = pc + 1;
+            break;
+        case I_EOL:
+            if (eol) {
+                stack[top++] = pc + 1;
+                break;
+            }
+            prog->buf[(*n)++] = pc;
+            break;
+        default:
+            prog->buf[(*n)++] = pc;
+            break;
+        }
+    }
+}
+
+static int cmp_int(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+static re_dfa_t* dfa_get(come_re_prog_t* prog, bool anchored) {
+    re_dfa_t* dfa = prog->dfa[anchored];
+    if (!dfa) {
+        dfa = calloc(1, sizeof(re_dfa_t));
+        if (!dfa) return NULL;
+        dfa->start[0] = dfa->start[1] = -1;
+        dfa->anchored = anchored;
+        prog->dfa[anchored] = dfa;
+    }
+    return dfa;
+}
+
+static inline bool dfa_special(const re_dfa_state_t* s) {
+    return s->match || s->n == 0;
+}
+
+static inline int dfa_entry(const come_re_prog_t* prog, const re_dfa_t* dfa, int si) {
+    int row = si * (int)prog->n_bytes;
+    return dfa_special(&dfa->states[si]) ? -2 - row : row;
+}
+
+static inline int entry_row(int entry) {
+    return entry >= 0 ? entry : -2 - entry;
+}
+
+// Find or add the state holding prog->buf[0..n). Returns -1 on allocation failure.
+static int dfa_intern(come_re_prog_t* prog, re_dfa_t* dfa, size_t n) {
+    int* pcs = prog->buf;
+    qsort(pcs, n, sizeof(int), cmp_int);
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint32_t)pcs[i];
+        h *= 16777619u;
+    }
+
+    size_t slot = h & (RE_DFA_TABLE_SIZE - 1);
+    while (dfa->table[slot]) {
+        re_dfa_state_t* s = &dfa->states[dfa->table[slot] - 1];
+        if (s->hash == h && (size_t)s->n == n && memcmp(s->pcs, pcs, n * sizeof(int)) == 0) {
+            return dfa->table[slot] - 1;
+        }
+        slot = (slot + 1) & (RE_DFA_TABLE_SIZE - 1);
+    }
+
+    if (dfa->n_states == RE_DFA_MAX_STATES) {
+        dfa_flush(dfa);
+        dfa->flushed = true;
+        slot = h & (RE_DFA_TABLE_SIZE - 1);
+    }
+    if (dfa->n_states == dfa->cap_states) {
+        size_t cap = dfa->cap_states ? dfa->cap_states * 2 : 16;
+        re_dfa_state_t* states = realloc(dfa->states, cap * sizeof(re_dfa_state_t));
+        if (!states) return -1;
+        dfa->states = states;
+        int* trans = realloc(dfa->trans, cap * prog->n_bytes * sizeof(int));
+        if (!trans) return -1;
+        dfa->trans = trans;
+        dfa->cap_states = cap;
+    }
+
+    re_dfa_state_t* s = &dfa->states[dfa->n_states];
+    s->pcs = malloc((n ? n : 1) * sizeof(int));
+    if (!s->pcs) return -1;
+    memcpy(s->pcs, pcs, n * sizeof(int));
+    s->n = (int)n;
+    s->hash = h;
+    s->seen = 0;
+    s->match = false;
+    for (size_t i = 0; i < n; i++) {
+        if (prog->insts[pcs[i]].op == I_MATCH) s->match = true;
+    }
+    memset(&dfa->trans[dfa->n_states * prog->n_bytes], 0xff, prog->n_bytes * sizeof(int)); // DFA_UNKNOWN
+    dfa->table[slot] = (int)dfa->n_states + 1;
+    return (int)dfa->n_states++;
+}
+
+// Entry for the start state, or DFA_UNKNOWN on allocation failure
+static int dfa_start(come_re_prog_t* prog, re_dfa_t* dfa, bool bol) {
+    if (dfa->start[bol] < 0) {
+        size_t n = 0;
+        prog->gen++;
+        closure(prog, 0, bol, false, &n);
+        int s = dfa_intern(prog, dfa, n);
+        if (s < 0) return DFA_UNKNOWN;
+        dfa->start[bol] = s;
+    }
+    return dfa_entry(prog, dfa, dfa->start[bol]);
+}
+
+// Slow path: build the transition of the state at 'row' on byte b.
+// Returns its entry, or DFA_UNKNOWN on allocation failure.
+static int dfa_step(come_re_prog_t* prog, re_dfa_t* dfa, int row, uint8_t b) {
+    int si = row / (int)prog->n_bytes;
+    size_t n = 0;
+    prog->gen++;
+    re_dfa_state_t* s = &dfa->states[si];
+    for (int i = 0; i < s->n; i++) {
+        const re_inst_t* in = &prog->insts[s->pcs[i]];
+        if (in->op == I_CLASS && class_has(&prog->classes[in->x], b)) {
+            closure(prog, s->pcs[i] + 1, false, false, &n);
+        }
+    }
+    if (!dfa->anchored) closure(prog, 0, false, false, &n);
+    dfa->flushed = false;
+    int t = dfa_intern(prog, dfa, n);
+    if (t < 0) return DFA_UNKNOWN;
+    int entry = dfa_entry(prog, dfa, t);
+    if (!dfa->flushed) dfa->trans[row + prog->byte_map[b]] = entry;
+    return entry;
+}
+
+// Resolve the '$' assertions still pending in a state at the end of input.
+// Leaves the reachable NFA states in prog->buf and returns their count.
+static size_t dfa_at_end(come_re_prog_t* prog, re_dfa_t* dfa, int entry, bool bol) {
+    size_t n = 0;
+    prog->gen++;
+    re_dfa_state_t* s = &dfa->states[entry_row(entry) / (int)prog->n_bytes];
+    for (int i = 0; i < s->n; i++) {
+        if (prog->insts[s->pcs[i]].op == I_EOL) closure(prog, s->pcs[i] + 1, bol, true, &n);
+    }
+    return n;
+}
+
+static bool buf_has_match(const come_re_prog_t* prog, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (prog->insts[prog->buf[i]].op == I_MATCH) return true;
+    }
+    return false;
+}
+
+static inline const re_dfa_state_t* entry_state(const come_re_prog_t* prog, const re_dfa_t* dfa, int entry) {
+    return &dfa->states[entry_row(entry) / (int)prog->n_bytes];
+}
+
+// Take the transition for byte b from entry e through the slow path
+static inline int dfa_next_slow(come_re_prog_t* prog, re_dfa_t* dfa, int e, uint8_t b) {
+    int row = entry_row(e);
+    int t = dfa->trans[row + prog->byte_map[b]];
+    return t == DFA_UNKNOWN ? dfa_step(prog, dfa, row, b) : t;
+}
+
+// Unanchored scan of d[from, len) for the earliest match end.
+// Returns the end offset, -1 if nothing matches, -2 on allocation failure.
+static long dfa_earliest(come_re_prog_t* prog, const char* d, size_t from, size_t len) {
+    re_dfa_t* dfa = dfa_get(prog, false);
+    if (!dfa) return -2;
+    int e = dfa_start(prog, dfa, from == 0);
+    if (e == DFA_UNKNOWN) return -2;
+
+    const uint8_t* p = (const uint8_t*)d;
+    const uint8_t* map = prog->byte_map;
+    size_t i = from;
+    for (;;) {
+        const int* trans = dfa->trans;
+        while (e >= 0 && i < len) {
+            int t = trans[e + map[p[i]]];
+            if (t == DFA_UNKNOWN) break;
+            e = t;
+            i++;
+        }
+        if (e < 0) {
+            const re_dfa_state_t* s = entry_state(prog, dfa, e);
+            if (s->match) return (long)i;
+            return -1; // Dead: an anchored pattern past its start
+        }
+        if (i == len) break;
+        e = dfa_next_slow(prog, dfa, e, p[i++]);
+        if (e == DFA_UNKNOWN) return -2;
+    }
+    return buf_has_match(prog, dfa_at_end(prog, dfa, e, len == 0)) ? (long)len : -1;
+}
+
+// Longest match starting exactly at 'from' (anchored DFA). Returns its end,
+// -1 if none, -2 on allocation failure. Adds the bytes examined to *scanned.
+static long dfa_longest(come_re_prog_t* prog, const char* d, size_t from, size_t len, size_t* scanned) {
+    re_dfa_t* dfa = dfa_get(prog, true);
+    if (!dfa) return -2;
+    int e = dfa_start(prog, dfa, from == 0);
+    if (e == DFA_UNKNOWN) return -2;
+
+    const uint8_t* p = (const uint8_t*)d;
+    const uint8_t* map = prog->byte_map;
+    long last = -1;
+    size_t i = from;
+    for (;;) {
+        const int* trans = dfa->trans;
+        while (e >= 0 && i < len) {
+            int t = trans[e + map[p[i]]];
+            if (t == DFA_UNKNOWN) break;
+            e = t;
+            i++;
+        }
+        if (e < 0) {
+            const re_dfa_state_t* s = entry_state(prog, dfa, e);
+            if (s->n == 0) break; // Dead: nothing longer can match
+            last = (long)i;
+        }
+        if (i == len) {
+            if (buf_has_match(prog, dfa_at_end(prog, dfa, e, len == 0))) last = (long)len;
+            break;
+        }
+        e = dfa_next_slow(prog, dfa, e, p[i++]);
+        if (e == DFA_UNKNOWN) return -2;
+    }
+    *scanned += i - from;
+    return last;
+}
+
+
+// Pike VM
+// Runs all NFA threads in lock step, each carrying its capture slots.
+// Thread order is priority order, which picks the groups among equally
+// long matches; the overall match is leftmost-longest.
+
+static bool vm_init(come_re_prog_t* prog) {
+    if (prog->frames) return true;
+    size_t n = prog->n_insts;
+    for (int i = 0; i < 2; i++) {
+        re_list_t* l = &prog->lists[i];
+        l->pc = malloc(sizeof(int) * n);
+        l->caps = malloc(sizeof(long) * n * prog->ncaps);
+        l->mark = calloc(n, sizeof(uint32_t));
+        if (!l->pc || !l->caps || !l->mark) return false;
+    }
+    prog->tmp_caps = malloc(sizeof(long) * prog->ncaps);
+    prog->frames = malloc(sizeof(re_frame_t) * (n + 1));
+    return prog->tmp_caps && prog->frames;
+}
+
+static void vm_add(come_re_prog_t* prog, re_list_t* l, int pc, long* caps, size_t pos, size_t len) {
+    re_frame_t* stack = prog->frames;
+    size_t ncaps = prog->ncaps;
+    size_t top = 0;
+    stack[top++] = (re_frame_t){pc, -1, 0};
+    while (top) {
+        re_frame_t f = stack[--top];
+        if (f.slot >= 0) {
+            caps[f.slot] = f.old;
+            continue;
+        }
+        pc = f.pc;
+        for (;;) {
+            if (l->mark[pc] == l->gen) break;
+            l->mark[pc] = l->gen;
+            const re_inst_t* in = &prog->insts[pc];
+            switch (in->op) {
+            case I_JMP:
+                pc = in->x;
+                continue;
+            case I_SPLIT:
+                stack[top++] = (re_frame_t){in->y, -1, 0};
+                pc = in->x;
+                continue;
+            case I_SAVE:
+                stack[top++] = (re_frame_t){0, in->x, caps[in->x]};
+                caps[in->x] = (long)pos;
+                pc++;
+                continue;
+            case I_BOL:
+                if (pos == 0) {
+                    pc++;
+                    continue;
+                }
+                break;
+            case I_EOL:
+                if (pos == len) {
+                    pc++;
+                    continue;
+                }
+                break;
+            default:
+                l->pc[l->n] = pc;
+                memcpy(&l->caps[l->n * ncaps], caps, ncaps * sizeof(long));
+                l->n++;
+                break;
+            }
+            break;
+        }
+    }
+}
+
+// Threads start at every position from 'from' until a match is found; with
+// 'anchored' only at 'from'. Positions past 'stop' are not examined.
+static bool vm_search(come_re_prog_t* prog, const char* d, size_t from, size_t stop, size_t len, bool anchored, long* best) {
+    size_t ncaps = prog->ncaps;
+    re_list_t* cl = &prog->lists[0];
+    re_list_t* nl = &prog->lists[1];
+    long* seed = prog->tmp_caps;
+    bool matched = false;
+
+    cl->n = 0;
+    cl->gen++;
+    for (size_t pos = from;; pos++) {
+        if (!matched && (!anchored || pos == from)) {
+            for (size_t i = 0; i < ncaps; i++) seed[i] = -1;
+            vm_add(prog, cl, 0, seed, pos, len);
+        }
+        if (cl->n == 0) {
+            if (matched || anchored || pos >= stop) break;
+            cl->gen++;
+            continue;
+        }
+
+        nl->n = 0;
+        nl->gen++;
+        for (size_t i = 0; i < cl->n; i++) {
+            long* tc = &cl->caps[i * ncaps];
+            if (matched && tc[0] > best[0]) continue; // Starts right of the match found
+            const re_inst_t* in = &prog->insts[cl->pc[i]];
+            if (in->op == I_MATCH) {
+                if (!matched || tc[0] < best[0] || tc[1] > best[1]) {
+                    memcpy(best, tc, ncaps * sizeof(long));
+                    matched = true;
+                }
+            } else if (pos < stop && class_has(&prog->classes[in->x], (uint8_t)d[pos])) {
+                vm_add(prog, nl, cl->pc[i] + 1, tc, pos + 1, len);
+            }
+        }
+        re_list_t* t = cl;
+        cl = nl;
+        nl = t;
+        if (pos >= stop) break;
+    }
+    return matched;
+}
+
+
+// Public entry points
+
+// Where a search of d[from, len) can start: past 'len' when the required
+// literal is missing, at its first occurrence when every match starts with it.
+static size_t literal_skip(const come_re_prog_t* prog, const char* d, size_t from, size_t len) {
+    if (!prog->lit_len) return from;
+    const char* hit = come_search_find(d + from, len - from, prog->lit, prog->lit_len);
+    if (!hit) return len + 1;
+    return prog->lit_prefix ? (size_t)(hit - d) : from;
+}
+
+static bool re_match(come_re_prog_t* prog, const char* d, size_t len) {
+    size_t from = literal_skip(prog, d, 0, len);
+    if (from > len) return false;
+    long end = dfa_earliest(prog, d, from, len);
+    if (end != -2) return end >= 0;
+    long* caps = malloc(sizeof(long) * prog->ncaps);
+    bool found = caps && vm_init(prog) && vm_search(prog, d, from, len, len, false, caps);
+    free(caps);
+    return found;
+}
+
+// Overall span of the leftmost-longest match. The unanchored DFA bounds the
+// leftmost start by the earliest match end; the anchored DFA then tries each
+// start in turn. If that costs more than a few passes over the span, the Pike
+// VM takes over so the worst case stays linear.
+static int re_find(come_re_prog_t* prog, const char* d, size_t from, size_t len, long* start, long* end) {
+    long first_end = dfa_earliest(prog, d, from, len);
+    if (first_end == -1) return 0;
+    if (first_end >= 0) {
+        size_t budget = 4 * ((size_t)first_end - from) + 1024;
+        size_t scanned = 0;
+        for (size_t s = from; s <= (size_t)first_end; s++) {
+            long e = dfa_longest(prog, d, s, len, &scanned);
+            if (e >= 0) {
+                *start = (long)s;
+                *end = e;
+                return 1;
+            }
+            if (e == -2 || scanned > budget) break;
+        }
+    }
+    return -1; // Pike VM needed
+}
+
+static bool re_search(come_re_prog_t* prog, const char* d, size_t from, size_t len, long* caps) {
+    from = literal_skip(prog, d, from, len);
+    if (from > len) return false;
+    long start, end;
+    int found = re_find(prog, d, from, len, &start, &end);
+    if (found == 0) return false;
+    if (!vm_init(prog)) return false;
+    if (found < 0) return vm_search(prog, d, from, len, len, false, caps);
+    if (prog->groups == 0) {
+        caps[0] = start;
+        caps[1] = end;
+        return true;
+    }
+    // Groups: one anchored Pike VM pass over the span already found
+    return vm_search(prog, d, (size_t)start, (size_t)end, len, true, caps);
+}
+
+static size_t set_collect(come_re_prog_t* prog, const int* pcs, size_t n, uint8_t* hits) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        const re_inst_t* in = &prog->insts[pcs[i]];
+        if (in->op == I_MATCH && !hits[in->x]) {
+            hits[in->x] = 1;
+            found++;
+        }
+    }
+    return found;
+}
+
+static size_t re_set_match(come_re_prog_t* prog, const char* d, size_t len, uint8_t* hits) {
+    memset(hits, 0, prog->n_patterns);
+    re_dfa_t* dfa = dfa_get(prog, false);
+    if (!dfa) return 0;
+    uint32_t run = ++dfa->run;
+    size_t count = 0;
+
+    int e = dfa_start(prog, dfa, true);
+    if (e == DFA_UNKNOWN) return 0;
+    const uint8_t* p = (const uint8_t*)d;
+    const uint8_t* map = prog->byte_map;
+    size_t i = 0;
+    for (;;) {
+        const int* trans = dfa->trans;
+        while (e >= 0 && i < len) {
+            int t = trans[e + map[p[i]]];
+            if (t == DFA_UNKNOWN) break;
+            e = t;
+            i++;
+        }
+        if (e < 0) {
+            re_dfa_state_t* s = &dfa->states[entry_row(e) / (int)prog->n_bytes];
+            if (s->n == 0) return count; // Dead
+            if (s->seen != run) {
+                s->seen = run;
+                count += set_collect(prog, s->pcs, s->n, hits);
+                if (count == prog->n_patterns) return count;
+            }
+        }
+        if (i == len) break;
+        e = dfa_next_slow(prog, dfa, e, p[i++]);
+        if (e == DFA_UNKNOWN) return count;
+    }
+
+    size_t n = dfa_at_end(prog, dfa, e, len == 0);
+    count += set_collect(prog, prog->buf, n, hits);
+    return count;
+}
+
+
+// Entry points: one match at a time per program
+
+bool come_re_match(come_re_prog_t* prog, const char* d, size_t len) {
+    if (!prog || !d) return false;
+    pthread_mutex_lock(&prog->lock);
+    bool found = re_match(prog, d, len);
+    pthread_mutex_unlock(&prog->lock);
+    return found;
+}
+
+bool come_re_search(come_re_prog_t* prog, const char* d, size_t from, size_t len, long* caps) {
+    if (!prog || !d || from > len) return false;
+    pthread_mutex_lock(&prog->lock);
+    bool found = re_search(prog, d, from, len, caps);
+    pthread_mutex_unlock(&prog->lock);
+    return found;
+}
+
+size_t come_re_set_match(come_re_prog_t* prog, const char* d, size_t len, uint8_t* hits) {
+    if (!prog || !d || !hits) return 0;
+    pthread_mutex_lock(&prog->lock);
+    size_t found = re_set_match(prog, d, len, hits);
+    pthread_mutex_unlock(&prog->lock);
+    return found;
+}
@@ -0,0 +1,43 @@
+#ifndef COME_STRING_RE_H
+#define COME_STRING_RE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Native regex engine for the string module (POSIX extended syntax, byte based).
+//
+// Patterns compile to a Thompson NFA. Yes/no questions run on a lazily built
+// DFA whose states are cached per program; positions and capture groups come
+// from a Pike VM. Both are linear in the input. Matches follow POSIX
+// leftmost-longest rules for the overall match; groups take the first
+// alternative that produces it, which differs from glibc only for groups
+// that can match empty inside repetitions.
+//
+// Constructs the engine does not implement (back-references, word boundaries,
+// collating elements) make come_re_compile return NULL so callers can fall
+// back to libc regcomp. Matching fills a program's DFA cache and scratch, so
+// threads sharing a program take turns: each match holds its lock.
+
+typedef struct come_re_prog_t come_re_prog_t;
+
+come_re_prog_t* come_re_compile(const char* pattern);
+// One program for many patterns; match ids are the pattern indices.
+come_re_prog_t* come_re_compile_set(const char* const* patterns, size_t n);
+void come_re_free(come_re_prog_t* prog);
+
+// Number of capture groups (like regex_t.re_nsub)
+size_t come_re_groups(const come_re_prog_t* prog);
+
+// True if [0, len) contains a match (lazy DFA)
+bool come_re_match(come_re_prog_t* prog, const char* d, size_t len);
+
+// Leftmost-longest match starting the search at 'from'. caps receives
+// 2 * (groups + 1) offsets into d (start, end per group, -1 if unset).
+bool come_re_search(come_re_prog_t* prog, const char* d, size_t from, size_t len, long* caps);
+
+// For a set program: sets hits[i] for every pattern i matching somewhere in
+// [0, len) and returns how many matched. One pass over the input.
+size_t come_re_set_match(come_re_prog_t* prog, const char* d, size_t len, uint8_t* hits);
+
+#endif
@@ -0,0 +1,450 @@
+#include "come_string.h"
+#include "mem/talloc.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <regex.h>
+#include "re.h"
+
+
+// A compiled pattern: the native engine (re.c) when it supports the pattern,
+// libc regcomp otherwise (back-references, word boundaries, ...)
+typedef struct {
+    come_re_prog_t* prog;
+    regex_t re;  // Valid when prog is NULL
+    size_t nsub;
+} regex_impl_t;
+
+struct come_regex_t {
+    regex_impl_t impl;
+    char pattern[]; // Source pattern, kept for diagnostics
+};
+
+struct come_regex_set_t {
+    come_re_prog_t* prog;  // All patterns in one program, or NULL
+    regex_impl_t* each;    // Per-pattern fallback when prog is NULL
+    size_t n;
+};
+
+static bool regex_impl_compile(regex_impl_t* r, const char* pattern) {
+    r->prog = come_re_compile(pattern);
+    if (r->prog) {
+        r->nsub = come_re_groups(r->prog);
+        return true;
+    }
+    if (regcomp(&r->re, pattern, REG_EXTENDED) != 0) return false;
+    r->nsub = r->re.re_nsub;
+    return true;
+}
+
+static void regex_impl_free(regex_impl_t* r) {
+    if (r->prog) {
+        come_re_free(r->prog);
+    } else {
+        regfree(&r->re);
+    }
+}
+
+
+// Matching core
+// All matching runs on (data, count) spans, so views and strings with embedded
+// NULs work. Offsets are relative to 'd'; '^' only matches at d itself, not at
+// every restart position (glibc REG_STARTEND on the fallback path).
+
+static int span_regexec(const regex_impl_t* re, const char* d, size_t from, size_t len, size_t nmatch, regmatch_t* pmatch) {
+    regmatch_t whole[1];
+    if (nmatch == 0) {
+        pmatch = whole;
+        nmatch = 1;
+    }
+    if (!re->prog) {
+        pmatch[0].rm_so = (regoff_t)from;
+        pmatch[0].rm_eo = (regoff_t)len;
+        return regexec(&re->re, d, nmatch, pmatch, REG_STARTEND);
+    }
+
+    size_t ncaps = 2 * (re->nsub + 1);
+    long local[32];
+    long* caps = ncaps <= 32 ? local : malloc(sizeof(long) * ncaps);
+    if (!caps) return REG_ESPACE;
+    int rc = REG_NOMATCH;
+    if (come_re_search(re->prog, d, from, len, caps)) {
+        for (size_t i = 0; i < nmatch; i++) {
+            bool set = i <= re->nsub;
+            pmatch[i].rm_so = set ? (regoff_t)caps[2 * i] : -1;
+            pmatch[i].rm_eo = set ? (regoff_t)caps[2 * i + 1] : -1;
+        }
+        rc = 0;
+    }
+    if (caps != local) free(caps);
+    return rc;
+}
+
+static bool regex_match_impl(const regex_impl_t* re, const come_string_t* a) {
+    if (re->prog) return come_re_match(re->prog, come_string_data(a), a->count);
+    return span_regexec(re, come_string_data(a), 0, a->count, 0, NULL) == 0;
+}
+
+// Single pass: each match ends the current part. Empty matches never split.
+static come_string_list_t* regex_split_impl(const regex_impl_t* re, const come_string_t* a, size_t n) {
+    come_string_list_t* list = come_string_list_new(come_string_ctx(a), 8);
+    if (!list) return NULL;
+
+    const char* d = come_string_data(a);
+    size_t len = a->count;
+    size_t start = 0; // Start of the current part
+    size_t from = 0;  // Where the next search begins
+    regmatch_t m[1];
+
+    while ((n == 0 || list->count + 1 < n) && from <= len && span_regexec(re, d, from, len, 1, m) == 0) {
+        if (m[0].rm_eo == m[0].rm_so) {
+            if ((size_t)m[0].rm_so >= len) break;
+            from = m[0].rm_so + 1;
+            continue;
+        }
+        list = come_string_list_append(list, d + start, m[0].rm_so - start);
+        start = from = m[0].rm_eo;
+    }
+    return come_string_list_append(list, d + start, len - start);
+}
+
+static come_string_list_t* regex_groups_impl(const regex_impl_t* re, const come_string_t* a) {
+    size_t nmatch = re->nsub + 1; // 0 is full match, 1..n are groups
+    regmatch_t local[16];
+    regmatch_t* pmatch = nmatch <= 16 ? local : malloc(sizeof(regmatch_t) * nmatch);
+    if (!pmatch) return NULL;
+
+    const char* d = come_string_data(a);
+    come_string_list_t* list;
+    if (span_regexec(re, d, 0, a->count, nmatch, pmatch) == 0) {
+        list = mem_talloc_alloc(come_string_ctx(a), sizeof(come_string_list_t) + sizeof(come_string_t*) * nmatch);
+        if (!list) {
+            if (pmatch != local) free(pmatch);
+            return NULL;
+        }
+        list->size = (uint32_t)nmatch;
+        list->count = (uint32_t)nmatch;
+        for (size_t i = 0; i < nmatch; i++) {
+            if (pmatch[i].rm_so != -1) {
+                size_t len = pmatch[i].rm_eo - pmatch[i].rm_so;
+                list->items[i] = come_string_new_len(list, d + pmatch[i].rm_so, len);
+            } else {
+                list->items[i] = NULL; // Optional group not matched
+            }
+        }
+    } else {
+        list = come_string_list_new(come_string_ctx(a), 1);
+    }
+
+    if (pmatch != local) free(pmatch);
+    return list;
+}
+
+// Growable output for replace; the string is allocated once and doubled as needed
+typedef struct {
+    come_string_t* s;
+    size_t cap; // Bytes available for data, excluding the NUL
+} regex_out_t;
+
+static bool out_append(regex_out_t* out, const char* p, size_t len) {
+    if (out->s->count + len > out->cap) {
+        size_t cap = out->cap * 2;
+        if (cap < out->s->count + len) cap = out->s->count + len;
+        come_string_t* grown = mem_talloc_realloc(NULL, out->s, sizeof(come_string_t) + cap + 1);
+        if (!grown) return false;
+        grown->size = (uint32_t)(sizeof(come_string_t) + cap + 1);
+        out->s = grown;
+        out->cap = cap;
+    }
+    memcpy(out->s->data + out->s->count, p, len);
+    out->s->count += (uint32_t)len;
+    return true;
+}
+
+// Single pass: copy the gap before each match, then the replacement.
+// On an empty match the next input byte is copied so the scan advances.
+static come_string_t* regex_replace_impl(const regex_impl_t* re, const come_string_t* a, const char* repl, size_t count) {
+    const char* d = come_string_data(a);
+    size_t len = a->count;
+    size_t repl_len = strlen(repl);
+
+    regex_out_t out;
+    out.cap = len + 16;
+    out.s = mem_talloc_alloc(come_string_ctx(a), sizeof(come_string_t) + out.cap + 1);
+    if (!out.s) return NULL;
+    out.s->size = (uint32_t)(sizeof(come_string_t) + out.cap + 1);
+    out.s->count = 0;
+
+    size_t p = 0;
+    size_t matches = 0;
+    regmatch_t m[1];
+    while (p < len && (count == 0 || matches < count) && span_regexec(re, d, p, len, 1, m) == 0) {
+        out_append(&out, d + p, m[0].rm_so - p);
+        out_append(&out, repl, repl_len);
+        p = m[0].rm_eo;
+        matches++;
+        if (m[0].rm_eo == m[0].rm_so && p < len) {
+            out_append(&out, d + p, 1);
+            p++;
+        }
+    }
+    out_append(&out, d + p, len - p);
+    out.s->data[out.s->count] = '\0';
+    return out.s;
+}
+
+
+// Per-thread pattern cache
+// A handful of recently used patterns per thread, evicted least recently used.
+// Threads own their cache, so lookups take no locks; it is freed at thread exit.
+
+#define REGEX_CACHE_SIZE 16
+
+typedef struct {
+    char* pattern;   // NULL when the slot is empty
+    uint32_t hash;
+    uint64_t stamp;  // Last use, for LRU eviction
+    regex_impl_t re;
+} regex_cache_entry_t;
+
+typedef struct {
+    uint64_t clock;
+    regex_cache_entry_t entries[REGEX_CACHE_SIZE];
+} regex_cache_t;
+
+static __thread regex_cache_t* tls_regex_cache = NULL;
+static pthread_key_t regex_cache_key;
+static pthread_once_t regex_cache_once = PTHREAD_ONCE_INIT;
+
+static void regex_cache_destroy(void* ptr) {
+    regex_cache_t* cache = ptr;
+    if (!cache) return;
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        if (cache->entries[i].pattern) {
+            regex_impl_free(&cache->entries[i].re);
+            free(cache->entries[i].pattern);
+        }
+    }
+    free(cache);
+}
+
+static void regex_cache_key_init(void) {
+    pthread_key_create(&regex_cache_key, regex_cache_destroy);
+}
+
+// FNV-1a
+static uint32_t pattern_hash(const char* s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static const regex_impl_t* regex_cache_get(const char* pattern) {
+    regex_cache_t* cache = tls_regex_cache;
+    if (!cache) {
+        pthread_once(&regex_cache_once, regex_cache_key_init);
+        cache = calloc(1, sizeof(regex_cache_t));
+        if (!cache) return NULL;
+        pthread_setspecific(regex_cache_key, cache);
+        tls_regex_cache = cache;
+    }
+
+    uint32_t hash = pattern_hash(pattern);
+    regex_cache_entry_t* victim = &cache->entries[0];
+    for (int i = 0; i < REGEX_CACHE_SIZE; i++) {
+        regex_cache_entry_t* e = &cache->entries[i];
+        if (e->pattern && e->hash == hash && strcmp(e->pattern, pattern) == 0) {
+            e->stamp = ++cache->clock;
+            return &e->re;
+        }
+        if (!e->pattern) {
+            if (victim->pattern) victim = e;
+        } else if (victim->pattern && e->stamp < victim->stamp) {
+            victim = e;
+        }
+    }
+
+    // Miss: compile into the empty or least recently used slot
+    regex_impl_t re;
+    if (!regex_impl_compile(&re, pattern)) return NULL;
+    char* copy = strdup(pattern);
+    if (!copy) {
+        regex_impl_free(&re);
+        return NULL;
+    }
+    if (victim->pattern) {
+        regex_impl_free(&victim->re);
+        free(victim->pattern);
+    }
+    victim->pattern = copy;
+    victim->hash = hash;
+    victim->stamp = ++cache->clock;
+    victim->re = re;
+    return &victim->re;
+}
+
+
+// String methods
+
+bool come_string_regex(const come_string_t* a, const char* pattern) {
+    if (!a || !pattern) return false;
+    const regex_impl_t* re = regex_cache_get(pattern);
+    return re ? regex_match_impl(re, a) : false;
+}
+
+come_string_list_t* come_string_regex_split(const come_string_t* a, const char* pattern, size_t n) {
+    if (!a || !pattern) return NULL;
+    const regex_impl_t* re = regex_cache_get(pattern);
+    return re ? regex_split_impl(re, a, n) : NULL;
+}
+
+come_string_list_t* come_string_regex_groups(const come_string_t* a, const char* pattern) {
+    if (!a || !pattern) return NULL;
+    const regex_impl_t* re = regex_cache_get(pattern);
+    return re ? regex_groups_impl(re, a) : NULL;
+}
+
+come_string_t* come_string_regex_replace(const come_string_t* a, const char* pattern, const char* repl, size_t count) {
+    if (!a || !pattern) return NULL;
+    const regex_impl_t* re = regex_cache_get(pattern);
+    return re ? regex_replace_impl(re, a, repl, count) : NULL;
+}
+
+
+// Compiled regex objects
+
+static int come_regex_destructor(void* ptr) {
+    come_regex_t* re = ptr;
+    regex_impl_free(&re->impl);
+    return 0;
+}
+
+come_regex_t* come_regex_compile(TALLOC_CTX* ctx, const char* pattern) {
+    if (!pattern) return NULL;
+    size_t len = strlen(pattern);
+    come_regex_t* re = mem_talloc_alloc(ctx, sizeof(come_regex_t) + len + 1);
+    if (!re) return NULL;
+    if (!regex_impl_compile(&re->impl, pattern)) {
+        mem_talloc_free(re);
+        return NULL;
+    }
+    memcpy(re->pattern, pattern, len + 1);
+    mem_talloc_set_destructor(re, come_regex_destructor);
+    return re;
+}
+
+void come_regex_free(come_regex_t* re) {
+    mem_talloc_free(re);
+}
+
+bool come_regex_match(const come_regex_t* re, const come_string_t* a) {
+    if (!re || !a) return false;
+    return regex_match_impl(&re->impl, a);
+}
+
+come_string_list_t* come_regex_split(const come_regex_t* re, const come_string_t* a, size_t n) {
+    if (!re || !a) return NULL;
+    return regex_split_impl(&re->impl, a, n);
+}
+
+come_string_list_t* come_regex_groups(const come_regex_t* re, const come_string_t* a) {
+    if (!re || !a) return NULL;
+    return regex_groups_impl(&re->impl, a);
+}
+
+come_string_t* come_regex_replace(const come_regex_t* re, const come_string_t* a, const char* repl, size_t count) {
+    if (!re || !a || !repl) return NULL;
+    return regex_replace_impl(&re->impl, a, repl, count);
+}
+
+
+// Regex sets
+
+static int come_regex_set_destructor(void* ptr) {
+    come_regex_set_t* set = ptr;
+    if (set->prog) come_re_free(set->prog);
+    for (size_t i = 0; set->each && i < set->n; i++) regex_impl_free(&set->each[i]);
+    return 0;
+}
+
+come_regex_set_t* come_regex_compile_set(TALLOC_CTX* ctx, const come_string_list_t* patterns) {
+    if (!patterns || patterns->count == 0) return NULL;
+    size_t n = patterns->count;
+    come_regex_set_t* set = mem_talloc_alloc(ctx, sizeof(come_regex_set_t));
+    if (!set) return NULL;
+    set->prog = NULL;
+    set->each = NULL;
+    set->n = n;
+
+    const char* local[16];
+    const char** cstrs = n <= 16 ? local : malloc(sizeof(char*) * n);
+    if (!cstrs) {
+        mem_talloc_free(set);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) cstrs[i] = come_string_cstr(patterns->items[i]);
+    set->prog = come_re_compile_set(cstrs, n);
+
+    bool ok = set->prog != NULL;
+    if (!ok) {
+        // Some pattern needs libc: keep one program per pattern
+        set->each = mem_talloc_alloc(set, sizeof(regex_impl_t) * n);
+        size_t i = 0;
+        while (set->each && i < n && regex_impl_compile(&set->each[i], cstrs[i])) i++;
+        set->n = i;
+        ok = set->each && i == n;
+    }
+    if (cstrs != local) free(cstrs);
+    if (!ok) {
+        come_regex_set_destructor(set);
+        mem_talloc_free(set);
+        return NULL;
+    }
+    mem_talloc_set_destructor(set, come_regex_set_destructor);
+    return set;
+}
+
+void come_regex_set_free(come_regex_set_t* set) {
+    mem_talloc_free(set);
+}
+
+bool come_regex_set_match(const come_regex_set_t* set, const come_string_t* a) {
+    if (!set || !a) return false;
+    if (set->prog) return come_re_match(set->prog, come_string_data(a), a->count);
+    for (size_t i = 0; i < set->n; i++) {
+        if (regex_match_impl(&set->each[i], a)) return true;
+    }
+    return false;
+}
+
+come_int_array_t* come_regex_set_matches(const come_regex_set_t* set, const come_string_t* a) {
+    if (!set || !a) return NULL;
+    // Hits are per call: a set may be matched from several threads at once
+    uint8_t local[256];
+    uint8_t* hits = set->n <= sizeof(local) ? local : malloc(set->n);
+    if (!hits) return NULL;
+    size_t found = 0;
+    if (set->prog) {
+        found = come_re_set_match(set->prog, come_string_data(a), a->count, hits);
+    } else {
+        for (size_t i = 0; i < set->n; i++) {
+            hits[i] = regex_match_impl(&set->each[i], a);
+            found += hits[i];
+        }
+    }
+
+    come_int_array_t* out = mem_talloc_alloc(come_string_ctx(a), sizeof(come_int_array_t) + sizeof(int) * found);
+    if (out) {
+        out->size = (uint32_t)found;
+        out->count = 0;
+        for (size_t i = 0; i < set->n && out->count < found; i++) {
+            if (hits[i]) out->items[out->count++] = (int)i;
+        }
+    }
+    if (hits != local) free(hits);
+    return out;
+}
@@ -0,0 +1,337 @@
+#define _GNU_SOURCE // memrchr
+#include "search.h"
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define COME_SEARCH_X86 1
+#endif
+
+
+// Scalar kernels
+
+// Candidates are found with memchr on the first byte, then verified
+static const char* find_scalar(const char* h, size_t hl, const char* n, size_t nl) {
+    if (hl < nl) return NULL;
+    const char* p = h;
+    const char* last = h + hl - nl; // Last possible match start
+    while (p <= last) {
+        p = memchr(p, n[0], last - p + 1);
+        if (!p) return NULL;
+        if (memcmp(p + 1, n + 1, nl - 1) == 0) return p;
+        p++;
+    }
+    return NULL;
+}
+
+static const char* rfind_scalar(const char* h, size_t hl, const char* n, size_t nl) {
+    if (hl < nl) return NULL;
+    size_t i = hl - nl + 1;
+    while (i > 0) {
+        const char* p = memrchr(h, n[0], i);
+        if (!p) return NULL;
+        if (memcmp(p + 1, n + 1, nl - 1) == 0) return p;
+        i = p - h;
+    }
+    return NULL;
+}
+
+
+// Two-Way (Crochemore-Perrin)
+// Linear time and constant space; takes over from the byte filter on long
+// needles when repetitive input makes verification dominate (O(n*m) otherwise).
+
+// Critical factorization: returns the split point and stores the period
+static size_t critical_factorization(const unsigned char* n, size_t nl, size_t* period) {
+    size_t ms, ms_rev, j, k, p;
+    unsigned char a, b;
+
+    // Maximal suffix for '<'
+    ms = SIZE_MAX;
+    j = 0;
+    k = p = 1;
+    while (j + k < nl) {
+        a = n[j + k];
+        b = n[ms + k];
+        if (a < b) {
+            j += k;
+            k = 1;
+            p = j - ms;
+        } else if (a == b) {
+            if (k != p) k++;
+            else { j += p; k = 1; }
+        } else {
+            ms = j++;
+            k = p = 1;
+        }
+    }
+    *period = p;
+
+    // Maximal suffix for '>'
+    ms_rev = SIZE_MAX;
+    j = 0;
+    k = p = 1;
+    while (j + k < nl) {
+        a = n[j + k];
+        b = n[ms_rev + k];
+        if (b < a) {
+            j += k;
+            k = 1;
+            p = j - ms_rev;
+        } else if (a == b) {
+            if (k != p) k++;
+            else { j += p; k = 1; }
+        } else {
+            ms_rev = j++;
+            k = p = 1;
+        }
+    }
+
+    if (ms_rev + 1 < ms + 1) return ms + 1;
+    *period = p;
+    return ms_rev + 1;
+}
+
+// Each step first checks the haystack byte under the needle's last position
+// against a bad-character table, so mismatches usually skip ahead by up to nl.
+static const char* find_two_way(const char* hay, size_t hl, const char* needle, size_t nl) {
+    const unsigned char* h = (const unsigned char*)hay;
+    const unsigned char* n = (const unsigned char*)needle;
+    size_t shift_table[256];
+    size_t period, shift;
+    size_t suffix = critical_factorization(n, nl, &period);
+    size_t i, j;
+
+    for (i = 0; i < 256; i++) shift_table[i] = nl;
+    for (i = 0; i < nl; i++) shift_table[n[i]] = nl - i - 1;
+
+    if (memcmp(n, n + period, suffix) == 0) {
+        // Periodic needle: remember how much of the period already matched
+        size_t memory = 0;
+        j = 0;
+        while (j + nl <= hl) {
+            shift = shift_table[h[j + nl - 1]];
+            if (shift > 0) {
+                // The last period has a byte out of place; no match before it
+                if (memory && shift < period) shift = nl - period;
+                memory = 0;
+                j += shift;
+                continue;
+            }
+            i = suffix > memory ? suffix : memory;
+            while (i < nl - 1 && n[i] == h[i + j]) i++;
+            if (i >= nl - 1) {
+                i = suffix - 1;
+                while (memory < i + 1 && n[i] == h[i + j]) i--;
+                if (i + 1 < memory + 1) return hay + j;
+                j += period;
+                memory = nl - period;
+            } else {
+                j += i - suffix + 1;
+                memory = 0;
+            }
+        }
+    } else {
+        // Distinct halves: any mismatch allows a maximal shift
+        period = (suffix > nl - suffix ? suffix : nl - suffix) + 1;
+        j = 0;
+        while (j + nl <= hl) {
+            shift = shift_table[h[j + nl - 1]];
+            if (shift > 0) {
+                j += shift;
+                continue;
+            }
+            i = suffix;
+            while (i < nl - 1 && n[i] == h[i + j]) i++;
+            if (i >= nl - 1) {
+                i = suffix - 1;
+                while (i != SIZE_MAX && n[i] == h[i + j]) i--;
+                if (i == SIZE_MAX) return hay + j;
+                j += period;
+            } else {
+                j += i - suffix + 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+// SIMD kernels
+// Compare a block of candidate starts against the needle's first byte and the
+// block shifted by (nl - 1) against its last byte; only positions where both
+// match are verified with memcmp. Needles are at least 2 bytes here.
+//
+// With a non-NULL 'stop', each verification is charged nl bytes; once the
+// charge outgrows the bytes scanned the kernel gives up, stores the block it
+// stopped at in *stop and returns NULL. *stop is hl when the scan completed.
+
+#define FILTER_SLACK (64u << 10)
+#define FILTER_OVER_BUDGET(spent, scanned) ((spent) > FILTER_SLACK + 2 * (scanned))
+
+#ifdef COME_SEARCH_X86
+static const char* find_sse2(const char* h, size_t hl, const char* n, size_t nl, size_t* stop) {
+    const __m128i first = _mm_set1_epi8(n[0]);
+    const __m128i last = _mm_set1_epi8(n[nl - 1]);
+    size_t spent = 0;
+    size_t i = 0;
+
+    if (stop) *stop = hl;
+    for (; i + nl - 1 + 16 <= hl; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i*)(h + i));
+        __m128i bl = _mm_loadu_si128((const __m128i*)(h + i + nl - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+        if (mask && stop) {
+            spent += (size_t)__builtin_popcount(mask) * nl;
+            if (FILTER_OVER_BUDGET(spent, i)) { *stop = i; return NULL; }
+        }
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(h + i + bit + 1, n + 1, nl - 2) == 0) return h + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(h + i, hl - i, n, nl);
+}
+
+__attribute__((target("avx2")))
+static const char* find_avx2(const char* h, size_t hl, const char* n, size_t nl, size_t* stop) {
+    const __m256i first = _mm256_set1_epi8(n[0]);
+    const __m256i last = _mm256_set1_epi8(n[nl - 1]);
+    size_t spent = 0;
+    size_t i = 0;
+
+    if (stop) *stop = hl;
+    for (; i + nl - 1 + 32 <= hl; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i*)(h + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i*)(h + i + nl - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, bf), _mm256_cmpeq_epi8(last, bl)));
+        if (mask && stop) {
+            spent += (size_t)__builtin_popcount(mask) * nl;
+            if (FILTER_OVER_BUDGET(spent, i)) { *stop = i; return NULL; }
+        }
+        while (mask) {
+            unsigned bit = __builtin_ctz(mask);
+            if (memcmp(h + i + bit + 1, n + 1, nl - 2) == 0) return h + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return find_sse2(h + i, hl - i, n, nl, NULL);
+}
+
+// Same filter walking backwards; candidates in a block are tried highest first
+static const char* rfind_sse2(const char* h, size_t hl, const char* n, size_t nl) {
+    const __m128i first = _mm_set1_epi8(n[0]);
+    const __m128i last = _mm_set1_epi8(n[nl - 1]);
+    size_t end = hl - nl + 1; // Candidate starts are [0, end)
+
+    while (end >= 16) {
+        size_t s = end - 16;
+        __m128i bf = _mm_loadu_si128((const __m128i*)(h + s));
+        __m128i bl = _mm_loadu_si128((const __m128i*)(h + s + nl - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf), _mm_cmpeq_epi8(last, bl)));
+        while (mask) {
+            unsigned bit = 31 - __builtin_clz(mask);
+            if (memcmp(h + s + bit + 1, n + 1, nl - 2) == 0) return h + s + bit;
+            mask &= ~(1u << bit);
+        }
+        end = s;
+    }
+    if (end == 0) return NULL;
+    return rfind_scalar(h, end + nl - 1, n, nl);
+}
+
+static size_t count_byte_sse2(const char* h, size_t hl, char c) {
+    const __m128i v = _mm_set1_epi8(c);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= hl; i += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(h + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(b, v)));
+    }
+    for (; i < hl; i++) count += (h[i] == c);
+    return count;
+}
+
+__attribute__((target("avx2")))
+static size_t count_byte_avx2(const char* h, size_t hl, char c) {
+    const __m256i v = _mm256_set1_epi8(c);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= hl; i += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(h + i));
+        count += __builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, v)));
+    }
+    return count + count_byte_sse2(h + i, hl - i, c);
+}
+
+static bool have_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+
+// Dispatch
+
+// Byte filter for needles of 2+ bytes; 'stop' as for the SIMD kernels
+static const char* find_filter(const char* h, size_t hl, const char* n, size_t nl, size_t* stop) {
+#ifdef COME_SEARCH_X86
+    if (have_avx2()) return find_avx2(h, hl, n, nl, stop);
+    return find_sse2(h, hl, n, nl, stop);
+#else
+    if (stop) {
+        // No SIMD filter to guard; long needles go straight to Two-Way
+        *stop = 0;
+        return NULL;
+    }
+    return find_scalar(h, hl, n, nl);
+#endif
+}
+
+const char* come_search_find(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    if (needle_len == 0) return hay;
+    if (needle_len > hay_len) return NULL;
+    if (needle_len == 1) return memchr(hay, needle[0], hay_len);
+    if (needle_len < COME_SEARCH_TWO_WAY_MIN) return find_filter(hay, hay_len, needle, needle_len, NULL);
+
+    size_t stop;
+    const char* p = find_filter(hay, hay_len, needle, needle_len, &stop);
+    if (p || stop == hay_len) return p;
+    return find_two_way(hay + stop, hay_len - stop, needle, needle_len);
+}
+
+const char* come_search_rfind(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    if (needle_len == 0) return hay + hay_len;
+    if (needle_len > hay_len) return NULL;
+    if (needle_len == 1) return memrchr(hay, needle[0], hay_len);
+#ifdef COME_SEARCH_X86
+    return rfind_sse2(hay, hay_len, needle, needle_len);
+#else
+    return rfind_scalar(hay, hay_len, needle, needle_len);
+#endif
+}
+
+size_t come_search_count(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    if (needle_len == 0 || needle_len > hay_len) return 0;
+    if (needle_len == 1) {
+#ifdef COME_SEARCH_X86
+        if (have_avx2()) return count_byte_avx2(hay, hay_len, needle[0]);
+        return count_byte_sse2(hay, hay_len, needle[0]);
+#else
+        size_t count = 0;
+        for (size_t i = 0; i < hay_len; i++) count += (hay[i] == needle[0]);
+        return count;
+#endif
+    }
+
+    size_t count = 0;
+    const char* p = hay;
+    const char* end = hay + hay_len;
+    while ((p = come_search_find(p, end - p, needle, needle_len)) != NULL) {
+        count++;
+        p += needle_len;
+    }
+    return count;
+}
@@ -0,0 +1,26 @@
+#ifndef COME_STRING_SEARCH_H
+#define COME_STRING_SEARCH_H
+
+#include <stddef.h>
+
+// Substring search kernels for the string module.
+// All functions work on explicit lengths and never stop at NUL bytes.
+//
+// Needle length selects the kernel:
+//   1 byte      -> memchr / memrchr
+//   2..63 bytes -> SIMD first/last byte filter (AVX2 when available, else SSE2)
+//   64+ bytes   -> the same filter, handing over to Two-Way (linear worst case)
+//                  when candidate verification starts to dominate
+
+#define COME_SEARCH_TWO_WAY_MIN 64
+
+// First occurrence of needle in haystack, or NULL. An empty needle matches at haystack.
+const char* come_search_find(const char* hay, size_t hay_len, const char* needle, size_t needle_len);
+
+// Last occurrence of needle in haystack, or NULL. An empty needle matches at hay + hay_len.
+const char* come_search_rfind(const char* hay, size_t hay_len, const char* needle, size_t needle_len);
+
+// Number of non-overlapping occurrences (0 for an empty needle)
+size_t come_search_count(const char* hay, size_t hay_len, const char* needle, size_t needle_len);
+
+#endif
@@ -1,10 +1,15 @@
+#define _GNU_SOURCE // memrchr
 #include "come_string.h"
+#include "search.h"
+#include "classify.h"
+#include "casemap.h"
+#include "num.h"
 #include "mem/talloc.h"
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <regex.h>
 
 
 // Module Initialization
@@ -33,6 +38,33 @@ come_string_t* come_string_new_len(TALLOC_CTX* ctx, const char* str, size_t len)
     return s;
 }
 
+// Header, bytes and terminator in one memcpy; a view becomes a string of its own
+come_string_t* come_string_dup(TALLOC_CTX* ctx, const come_string_t* a) {
+    if (!a) return NULL;
+    if (come_string_is_view(a)) return come_string_new_len(ctx, come_string_data(a), a->count);
+    size_t bytes = sizeof(come_string_t) + a->count + 1;
+    come_string_t* s = mem_talloc_alloc(ctx, bytes);
+    if (!s) return NULL;
+    memcpy(s, a, bytes);
+    s->size = (uint32_t)bytes;
+    return s;
+}
+
+come_string_t* come_string_share(TALLOC_CTX* owner, come_string_t* a) {
+    if (!a) return NULL;
+    if (come_string_is_view(a) || !mem_talloc_reference(owner, a)) return come_string_dup(owner, a);
+    a->size |= COME_SHARED;
+    return a;
+}
+
+// Whether another owner still shares a's bytes; once none does, the mark goes
+static bool string_held(come_string_t* a) {
+    if (!(a->size & COME_SHARED)) return false;
+    if (mem_talloc_reference_count(a)) return true;
+    a->size &= ~COME_SHARED;
+    return false;
+}
+
 void come_string_free(come_string_t* str) {
     mem_talloc_free(str);
 }
@@ -41,176 +73,198 @@ uint32_t come_string_size(const come_string_t* a) {
     return a ? a->count : 0;
 }
 
-// Basic UTF-8 char counting
+// Characters are UTF-8 code points (counted as non-continuation bytes)
 uint32_t come_string_len(const come_string_t* a) {
+    return come_string_count_runes(a);
+}
+
+uint32_t come_string_count_runes(const come_string_t* a) {
     if (!a) return 0;
-    uint32_t count = 0;
-    const char* p = a->data;
-    while (*p) {
-        if ((*p & 0xC0) != 0x80) count++;
-        p++;
-    }
-    return count;
+    return (uint32_t)come_classify_runes(come_string_data(a), a->count);
+}
+
+// Byte at 'i' of a span, 0 past the end (mirrors the NUL terminator of owned strings)
+static inline int span_at(const char* p, size_t len, size_t i) {
+    return i < len ? (unsigned char)p[i] : 0;
 }
 
 int come_string_cmp(const come_string_t* a, const come_string_t* b, size_t n) {
     if (!a || !b) return 0; // Safety
-    if (n == 0) return strcmp(a->data, b->data);
-    
-    // UTF-8 aware comparison for 'n' chars is complex, falling back to byte comparison for MVP if n is large
-    // Or we iterate n UTF-8 chars.
-    // For MVP, let's stick to simple strncmp logic but ideally we should count chars.
-    // Given the constraints, let's implement a simple char iterator.
-    
-    const char* p1 = a->data;
-    const char* p2 = b->data;
+    const char* p1 = come_string_data(a);
+    const char* p2 = come_string_data(b);
+    size_t l1 = a->count, l2 = b->count;
+
+    if (n == 0) {
+        int r = memcmp(p1, p2, l1 < l2 ? l1 : l2);
+        if (r != 0) return r;
+        return (l1 > l2) - (l1 < l2);
+    }
+
+    // Compare the first 'n' UTF-8 characters
+    size_t i1 = 0, i2 = 0;
     size_t chars = 0;
-    
-    while (*p1 && *p2 && chars < n) {
-        if (*p1 != *p2) return *p1 - *p2;
-        
+
+    while (i1 < l1 && i2 < l2 && chars < n) {
+        if (p1[i1] != p2[i2]) return p1[i1] - p2[i2];
+
         // Advance p1
-        do { p1++; } while ((*p1 & 0xC0) == 0x80);
+        do { i1++; } while (i1 < l1 && (p1[i1] & 0xC0) == 0x80);
         // Advance p2
-        do { p2++; } while ((*p2 & 0xC0) == 0x80);
-        
+        do { i2++; } while (i2 < l2 && (p2[i2] & 0xC0) == 0x80);
+
         chars++;
     }
-    
+
     if (chars == n) return 0;
-    return *p1 - *p2;
+    return span_at(p1, l1, i1) - span_at(p2, l2, i2);
 }
 
+// Rune-wise simple case folding; never allocates (see casemap.c)
 int come_string_casecmp(const come_string_t* a, const come_string_t* b, size_t n) {
-    // Similar to cmp but tolower
     if (!a || !b) return 0;
-    
-    const char* p1 = a->data;
-    const char* p2 = b->data;
-    size_t chars = 0;
-    
-    while (*p1 && *p2 && (n == 0 || chars < n)) {
-        if (tolower(*p1) != tolower(*p2)) return tolower(*p1) - tolower(*p2);
-        
-        // Advance p1
-        do { p1++; } while ((*p1 & 0xC0) == 0x80);
-        // Advance p2
-        do { p2++; } while ((*p2 & 0xC0) == 0x80);
-        
-        chars++;
-    }
-    
-    if (n != 0 && chars == n) return 0;
-    return tolower(*p1) - tolower(*p2);
+    return come_case_fold_cmp(come_string_data(a), a->count, come_string_data(b), b->count, n);
 }
 
 long come_string_chr(const come_string_t* a, int c) {
-    char* p = strchr(a->data, c);
-    return p ? (p - a->data) : -1;
+    const char* d = come_string_data(a);
+    const char* p = memchr(d, c, a->count);
+    return p ? (p - d) : -1;
 }
 
 long come_string_rchr(const come_string_t* a, int c) {
-    char* p = strrchr(a->data, c);
-    return p ? (p - a->data) : -1;
+    const char* d = come_string_data(a);
+    const char* p = memrchr(d, c, a->count);
+    return p ? (p - d) : -1;
 }
 
 long come_string_memchr(const come_string_t* a, int c, size_t n) {
-    void* p = memchr(a->data, c, n > a->count ? a->count : n);
-    return p ? ((char*)p - a->data) : -1;
+    const char* d = come_string_data(a);
+    const char* p = memchr(d, c, n > a->count ? a->count : n);
+    return p ? (p - d) : -1;
 }
 
 long come_string_find(const come_string_t* a, const char* sub) {
-    char* p = strstr(a->data, sub);
-    return p ? (p - a->data) : -1;
+    const char* d = come_string_data(a);
+    const char* p = come_search_find(d, a->count, sub, strlen(sub));
+    return p ? (p - d) : -1;
 }
 
 long come_string_rfind(const come_string_t* a, const char* sub) {
-    // strrstr is not standard C, implement manually
-    size_t sub_len = strlen(sub);
-    if (sub_len > a->count) return -1;
-    
-    for (long i = a->count - sub_len; i >= 0; i--) {
-        if (strncmp(a->data + i, sub, sub_len) == 0) return i;
-    }
-    return -1;
+    const char* d = come_string_data(a);
+    const char* p = come_search_rfind(d, a->count, sub, strlen(sub));
+    return p ? (p - d) : -1;
 }
 
 uint32_t come_string_count(const come_string_t* a, const char* sub) {
-    uint32_t count = 0;
-    const char* p = a->data;
-    size_t sub_len = strlen(sub);
-    if (sub_len == 0) return 0;
-    
-    while ((p = strstr(p, sub)) != NULL) {
-        count++;
-        p += sub_len;
-    }
-    return count;
+    return (uint32_t)come_search_count(come_string_data(a), a->count, sub, strlen(sub));
 }
 
-// Validation
+// Validation (C locale classes; see classify.c)
 bool come_string_isdigit(const come_string_t* a) {
-    for (size_t i = 0; i < a->count; i++) {
-        if (!isdigit(a->data[i])) return false;
-    }
-    return true;
+    return come_classify_all(come_string_data(a), a->count, COME_CLASS_DIGIT);
 }
 
 bool come_string_isalpha(const come_string_t* a) {
-    for (size_t i = 0; i < a->count; i++) {
-        if (!isalpha(a->data[i])) return false;
-    }
-    return true;
+    return come_classify_all(come_string_data(a), a->count, COME_CLASS_ALPHA);
 }
 
 bool come_string_isalnum(const come_string_t* a) {
-    for (size_t i = 0; i < a->count; i++) {
-        if (!isalnum(a->data[i])) return false;
-    }
-    return true;
+    return come_classify_all(come_string_data(a), a->count, COME_CLASS_ALNUM);
 }
 
 bool come_string_isspace(const come_string_t* a) {
-    for (size_t i = 0; i < a->count; i++) {
-        if (!isspace(a->data[i])) return false;
-    }
-    return true;
+    return come_classify_all(come_string_data(a), a->count, COME_CLASS_SPACE);
 }
 
 bool come_string_isascii(const come_string_t* a) {
     if (!a) return false;
-    // Check if high bit is set
-    const unsigned char* bytes = (const unsigned char*)a->data;
-    while (*bytes) {
-        if (*bytes & 0x80) return false;
-        bytes++;
-    }
-    return true;
+    return come_classify_ascii(come_string_data(a), a->count);
+}
+
+bool come_string_utf8(const come_string_t* a) {
+    if (!a) return false;
+    return come_classify_utf8(come_string_data(a), a->count);
 }
 
 // Transformation
-come_string_t* come_string_upper(const come_string_t* a) {
-    come_string_t* new_str = come_string_new_len((void*)a, a->data, a->count);
-    for (size_t i = 0; i < new_str->count; i++) {
-        new_str->data[i] = toupper(new_str->data[i]);
+// Case mapping into a new string; sized for the input, grown once if a rune needs more bytes
+static come_string_t* case_copy(const come_string_t* a, come_case_t to) {
+    const char* d = come_string_data(a);
+    size_t len = a->count;
+    size_t cap = len;
+    come_string_t* s = mem_talloc_alloc(come_string_ctx(a), sizeof(come_string_t) + cap + 1);
+    if (!s) return NULL;
+
+    size_t out = come_case_map(s->data, cap, d, len, to);
+    if (out > cap) {
+        cap = out;
+        come_string_t* grown = mem_talloc_realloc(NULL, s, sizeof(come_string_t) + cap + 1);
+        if (!grown) {
+            mem_talloc_free(s);
+            return NULL;
+        }
+        s = grown;
+        come_case_map(s->data, cap, d, len, to);
     }
-    return new_str;
+    s->size = (uint32_t)(sizeof(come_string_t) + cap + 1);
+    s->count = (uint32_t)out;
+    s->data[out] = '\0';
+    return s;
 }
 
-come_string_t* come_string_lower(const come_string_t* a) {
-    come_string_t* new_str = come_string_new_len((void*)a, a->data, a->count);
-    for (size_t i = 0; i < new_str->count; i++) {
-        new_str->data[i] = tolower(new_str->data[i]);
+// Case mapping over a's own bytes. Views do not own theirs and get a copy,
+// as do strings shared with another owner.
+static come_string_t* case_reuse(come_string_t* a, come_case_t to) {
+    if (!a) return NULL;
+    if (come_string_is_view(a) || string_held(a)) return case_copy(a, to);
+
+    if (!come_case_grows(a->data, a->count, to)) {
+        a->count = (uint32_t)come_case_map(a->data, a->count, a->data, a->count, to);
+        a->data[a->count] = '\0';
+        return a;
     }
-    return new_str;
+
+    // Some rune needs more bytes: map into a scratch copy and grow a to fit
+    come_string_t* tmp = case_copy(a, to);
+    if (!tmp) return a;
+    if (sizeof(come_string_t) + tmp->count + 1 > a->size) {
+        come_string_t* grown = mem_talloc_realloc(NULL, a, sizeof(come_string_t) + tmp->count + 1);
+        if (!grown) {
+            mem_talloc_free(tmp);
+            return a;
+        }
+        a = grown;
+        a->size = (uint32_t)(sizeof(come_string_t) + tmp->count + 1);
+    }
+    memcpy(a->data, tmp->data, tmp->count + 1);
+    a->count = tmp->count;
+    mem_talloc_free(tmp);
+    return a;
+}
+
+come_string_t* come_string_upper(const come_string_t* a) {
+    return case_copy(a, COME_CASE_UPPER);
+}
+
+come_string_t* come_string_lower(const come_string_t* a) {
+    return case_copy(a, COME_CASE_LOWER);
+}
+
+come_string_t* come_string_upper_reuse(come_string_t* a) {
+    return case_reuse(a, COME_CASE_UPPER);
+}
+
+come_string_t* come_string_lower_reuse(come_string_t* a) {
+    return case_reuse(a, COME_CASE_LOWER);
 }
 
 come_string_t* come_string_repeat(const come_string_t* a, size_t n) {
+    const char* d = come_string_data(a);
     size_t new_len = a->count * n;
-    come_string_t* new_str = come_string_new_len((void*)a, "", new_len); // Alloc space
+    come_string_t* new_str = come_string_new_len(come_string_ctx(a), "", new_len); // Alloc space
     // Manually fill
     for (size_t i = 0; i < n; i++) {
-        memcpy(new_str->data + (i * a->count), a->data, a->count);
+        memcpy(new_str->data + (i * a->count), d, a->count);
     }
     new_str->data[new_len] = '\0';
     return new_str;
@@ -218,28 +272,25 @@ come_string_t* come_string_repeat(const come_string_t* a, size_t n) {
 
 come_string_t* come_string_replace(const come_string_t* a, const char* old_str, const char* new_str, size_t n) {
     // Simple implementation: count matches, alloc new string, copy
+    const char* d = come_string_data(a);
+    const char* end = d + a->count;
     size_t old_len = strlen(old_str);
     size_t new_len_part = strlen(new_str);
-    
-    if (old_len == 0) return come_string_new((void*)a, a->data); // No-op if old is empty
-    
+
+    if (old_len == 0) return come_string_new_len(come_string_ctx(a), d, a->count); // No-op if old is empty
+
     // Count matches
-    size_t count = 0;
-    const char* p = a->data;
-    while ((p = strstr(p, old_str)) != NULL) {
-        count++;
-        p += old_len;
-        if (n > 0 && count >= n) break;
-    }
-    
+    size_t count = come_search_count(d, a->count, old_str, old_len);
+    if (n > 0 && count > n) count = n;
+
     size_t final_len = a->count + count * (new_len_part - old_len);
-    come_string_t* res = come_string_new_len((void*)a, "", final_len);
-    
-    p = a->data;
+    come_string_t* res = come_string_new_len(come_string_ctx(a), "", final_len);
+
+    const char* p = d;
     char* dest = res->data;
     size_t matches = 0;
-    while (*p) {
-        char* next_match = strstr(p, old_str);
+    while (p < end) {
+        const char* next_match = (n == 0 || matches < n) ? come_search_find(p, end - p, old_str, old_len) : NULL;
         if (next_match && (n == 0 || matches < n)) {
             size_t segment_len = next_match - p;
             memcpy(dest, p, segment_len);
@@ -249,18 +300,31 @@ come_string_t* come_string_replace(const come_string_t* a, const char* old_str,
             p = next_match + old_len;
             matches++;
         } else {
-            strcpy(dest, p);
+            memcpy(dest, p, end - p);
             break;
         }
     }
-    
+
     return res;
 }
 
 void come_string_chown(come_string_t* a, TALLOC_CTX* new_ctx) {
-    if (a) {
-        mem_talloc_steal(new_ctx, a);
+    if (!a) return;
+    if (come_string_is_view(a)) {
+        come_string_view_t* v = (come_string_view_t*)a;
+        if (v->flags & COME_STRING_VIEW_EMBEDDED) {
+            fprintf(stderr, "come: chown of a split_view item is not supported, chown the list instead\n");
+            return;
+        }
+        // The view lives under its parent; once moved it must hold the parent
+        // alive itself. One reference does that for every later move.
+        mem_talloc_steal(new_ctx, v);
+        if (!(v->flags & COME_STRING_VIEW_HELD) && mem_talloc_reference(v, (void*)v->parent)) {
+            v->flags |= COME_STRING_VIEW_HELD;
+        }
+        return;
     }
+    mem_talloc_steal(new_ctx, a);
 }
 
 // Stub for other methods to allow compilation
@@ -270,87 +334,67 @@ static bool is_cutset(char c, const char* cutset) {
     return strchr(cutset, c) != NULL;
 }
 
-come_string_t* come_string_trim(const come_string_t* a, const char* cutset) {
-    if (!a) return NULL;
+// Compute the [start, end) byte window left after trimming
+static void trim_bounds(const come_string_t* a, const char* cutset, bool left, bool right,
+                        size_t* out_start, size_t* out_end) {
+    const char* d = come_string_data(a);
     size_t start = 0;
     size_t end = a->count;
 
-    while (start < end && is_cutset(a->data[start], cutset)) start++;
-    while (end > start && is_cutset(a->data[end - 1], cutset)) end--;
+    if (left) while (start < end && is_cutset(d[start], cutset)) start++;
+    if (right) while (end > start && is_cutset(d[end - 1], cutset)) end--;
 
-    size_t new_len = end - start;
-    come_string_t* new_str = come_string_new_len((void*)a, a->data + start, new_len);
-    return new_str;
+    *out_start = start;
+    *out_end = end;
 }
 
-come_string_t* come_string_ltrim(const come_string_t* a, const char* cutset) {
+come_string_t* come_string_trim(const come_string_t* a, const char* cutset) {
     if (!a) return NULL;
-    size_t start = 0;
-    size_t end = a->count;
-
-    while (start < end && is_cutset(a->data[start], cutset)) start++;
+    size_t start, end;
+    trim_bounds(a, cutset, true, true, &start, &end);
+    return come_string_new_len(come_string_ctx(a), come_string_data(a) + start, end - start);
+}
 
-    size_t new_len = end - start;
-    come_string_t* new_str = come_string_new_len((void*)a, a->data + start, new_len);
-    return new_str;
+come_string_t* come_string_ltrim(const come_string_t* a, const char* cutset) {
+    if (!a) return NULL;
+    size_t start, end;
+    trim_bounds(a, cutset, true, false, &start, &end);
+    return come_string_new_len(come_string_ctx(a), come_string_data(a) + start, end - start);
 }
 
 come_string_t* come_string_rtrim(const come_string_t* a, const char* cutset) {
     if (!a) return NULL;
-    size_t start = 0;
-    size_t end = a->count;
+    size_t start, end;
+    trim_bounds(a, cutset, false, true, &start, &end);
+    return come_string_new_len(come_string_ctx(a), come_string_data(a) + start, end - start);
+}
 
-    while (end > start && is_cutset(a->data[end - 1], cutset)) end--;
+#define SPLIT_INITIAL_CAP 8
 
-    size_t new_len = end - start;
-    come_string_t* new_str = come_string_new_len((void*)a, a->data + start, new_len);
-    return new_str;
+// Next separator at or after p, or NULL once the part limit is reached.
+// n > 0 caps the result at n parts (n-1 splits); an empty sep never splits.
+static const char* split_next(const char* p, const char* end, const char* sep, size_t sep_len,
+                              size_t parts, size_t n) {
+    if (sep_len == 0 || (n > 0 && parts + 1 >= n)) return NULL;
+    return come_search_find(p, end - p, sep, sep_len);
 }
 
 come_string_list_t* come_string_split_n(const come_string_t* a, const char* sep, size_t n) {
     if (!a || !sep) return NULL;
-    
-    size_t sep_len = strlen(sep);
-    if (sep_len == 0) {
-        come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*));
-        list->size = 1;
-        list->count = 1;
-        list->items[0] = come_string_new((void*)a, a->data);
-        return list;
-    }
-    
-    // First pass: count parts to alloc array
-    size_t count = 1;
-    const char* p = a->data;
-    size_t matches = 0;
-    while ((p = strstr(p, sep)) != NULL) {
-        if (n > 0 && matches >= n - 1) break; // n parts means n-1 splits
-        count++;
-        matches++;
-        p += sep_len;
-    }
 
-    // Allocate list struct with items FAM on 'a' context
-    come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
-    list->size = count;
-    list->count = count;
+    // Single pass: the list grows as separators are found
+    come_string_list_t* list = come_string_list_new(come_string_ctx(a), SPLIT_INITIAL_CAP);
+    if (!list) return NULL;
 
-    // Second pass: fill
-    p = a->data;
-    matches = 0;
-    for (size_t i = 0; i < count; i++) {
-        const char* next = strstr(p, sep);
-        size_t len;
-        if (next && (n == 0 || matches < n - 1)) {
-            len = next - p;
-            list->items[i] = come_string_new_len(list, p, len);
-            p = next + sep_len;
-            matches++;
-        } else {
-            // Last part
-            len = strlen(p);
-            list->items[i] = come_string_new_len(list, p, len);
-        }
+    const char* d = come_string_data(a);
+    const char* end = d + a->count;
+    const char* p = d;
+    size_t sep_len = strlen(sep);
+    for (;;) {
+        const char* next = split_next(p, end, sep, sep_len, list->count, n);
+        list = come_string_list_append(list, p, (next ? next : end) - p);
+        if (!next) break;
+        p = next + sep_len;
     }
 
     return list;
@@ -361,15 +405,15 @@ come_string_list_t* come_string_split(const come_string_t* a, const char* sep) {
 }
 
 come_string_t* come_string_join(const come_string_list_t* list, const come_string_t* sep) {
-    if (!list || list->size == 0) return come_string_new_len(NULL, "", 0); // Context?
+    if (!list || list->count == 0) return come_string_new_len(NULL, "", 0); // Context?
     // If list is empty, return empty string. Context? Maybe list itself?
     // If sep is NULL, assume empty separator.
     
     size_t sep_len = sep ? sep->count : 0;
     size_t total_len = 0;
-    for (size_t i = 0; i < list->size; i++) {
+    for (size_t i = 0; i < list->count; i++) {
         if (list->items[i]) total_len += list->items[i]->count;
-        if (i < list->size - 1) total_len += sep_len;
+        if (i < list->count - 1) total_len += sep_len;
     }
 
     // Allocate on list context? Or sep context? Or new?
@@ -377,13 +421,13 @@ come_string_t* come_string_join(const come_string_list_t* list, const come_strin
     come_string_t* res = come_string_new_len((void*)list, "", total_len);
     
     char* p = res->data;
-    for (size_t i = 0; i < list->size; i++) {
+    for (size_t i = 0; i < list->count; i++) {
         if (list->items[i]) {
-            memcpy(p, list->items[i]->data, list->items[i]->count);
+            memcpy(p, come_string_data(list->items[i]), list->items[i]->count);
             p += list->items[i]->count;
         }
-        if (i < list->size - 1 && sep) {
-            memcpy(p, sep->data, sep_len);
+        if (i < list->count - 1 && sep) {
+            memcpy(p, come_string_data(sep), sep_len);
             p += sep_len;
         }
     }
@@ -391,191 +435,244 @@ come_string_t* come_string_join(const come_string_list_t* list, const come_strin
     return res;
 }
 
-come_string_t* come_string_substr(const come_string_t* a, size_t start, size_t end) {
-    if (!a) return NULL;
+// Map character indices [start, end) to a byte window of 'a'
+static void substr_bounds(const come_string_t* a, size_t start, size_t end,
+                          size_t* out_start, size_t* out_end) {
     // start/end are character indices, not bytes!
     // Need to iterate UTF-8
-    
-    const char* p = a->data;
+    const char* d = come_string_data(a);
+    size_t len = a->count;
+    size_t i = 0;
     size_t char_idx = 0;
-    const char* start_p = NULL;
-    const char* end_p = NULL;
+    size_t start_b = (size_t)-1;
+    size_t end_b = (size_t)-1;
+
+    while (i < len) {
+        if (char_idx == start) start_b = i;
+        if (char_idx == end) { end_b = i; break; }
 
-    while (*p) {
-        if (char_idx == start) start_p = p;
-        if (char_idx == end) { end_p = p; break; }
-        
         // Advance char
-        do { p++; } while ((*p & 0xC0) == 0x80);
+        do { i++; } while (i < len && (d[i] & 0xC0) == 0x80);
         char_idx++;
     }
-    
-    if (char_idx == start) start_p = p; // Start at end of string
-    if (!end_p) end_p = p; // End beyond string
 
-    if (!start_p) start_p = end_p; // Out of bounds
-    if (start_p > end_p) start_p = end_p;
+    if (char_idx == start) start_b = i; // Start at end of string
+    if (end_b == (size_t)-1) end_b = i; // End beyond string
 
-    size_t byte_len = end_p - start_p;
-    return come_string_new_len((void*)a, start_p, byte_len);
+    if (start_b == (size_t)-1) start_b = end_b; // Out of bounds
+    if (start_b > end_b) start_b = end_b;
+
+    *out_start = start_b;
+    *out_end = end_b;
 }
 
+come_string_t* come_string_substr(const come_string_t* a, size_t start, size_t end) {
+    if (!a) return NULL;
+    size_t start_b, end_b;
+    substr_bounds(a, start, end, &start_b, &end_b);
+    return come_string_new_len(come_string_ctx(a), come_string_data(a) + start_b, end_b - start_b);
+}
 
-// Regex
-bool come_string_regex(const come_string_t* a, const char* pattern) {
-    if (!a || !pattern) return false;
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB) != 0) return false;
-    
-    int ret = regexec(&regex, a->data, 0, NULL, 0);
-    regfree(&regex);
-    return ret == 0;
+
+// Views
+// A view is a talloc child of the string it looks into, so it is released with
+// it; views of views are flattened onto the owning string.
+come_string_t* come_string_view(const come_string_t* a, size_t offset, size_t len) {
+    if (!a) return NULL;
+    if (offset > a->count) offset = a->count;
+    if (len > a->count - offset) len = a->count - offset;
+
+    const come_string_t* parent = a;
+    if (come_string_is_view(a)) {
+        const come_string_view_t* av = (const come_string_view_t*)a;
+        parent = av->parent;
+        offset += av->offset;
+    }
+
+    come_string_view_t* v = mem_talloc_alloc((void*)parent, sizeof(come_string_view_t));
+    if (!v) return NULL;
+    v->size = COME_STRING_VIEW_TAG;
+    v->count = (uint32_t)len;
+    v->offset = (uint32_t)offset;
+    v->flags = 0;
+    v->parent = parent;
+    v->cstr = NULL;
+    return (come_string_t*)v;
 }
 
-come_string_list_t* come_string_regex_split(const come_string_t* a, const char* pattern, size_t n) {
-    if (!a || !pattern) return NULL;
-    
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED) != 0) return NULL;
+come_string_t* come_string_substr_view(const come_string_t* a, size_t start, size_t end) {
+    if (!a) return NULL;
+    size_t start_b, end_b;
+    substr_bounds(a, start, end, &start_b, &end_b);
+    return come_string_view(a, start_b, end_b - start_b);
+}
 
-    // First pass: count
-    size_t count = 1;
-    const char* p = a->data;
-    regmatch_t pmatch[1];
-    size_t matches = 0;
-    
-    while (regexec(&regex, p, 1, pmatch, 0) == 0) {
-        if (n > 0 && matches >= n - 1) break;
-        // Avoid infinite loop on empty match
-        if (pmatch[0].rm_eo == pmatch[0].rm_so) {
-             p++; // Advance one char if empty match
-             if (*p == '\0') break;
-             continue;
+come_string_t* come_string_trim_view(const come_string_t* a, const char* cutset) {
+    if (!a) return NULL;
+    size_t start, end;
+    trim_bounds(a, cutset, true, true, &start, &end);
+    return come_string_view(a, start, end - start);
+}
+
+come_string_t* come_string_ltrim_view(const come_string_t* a, const char* cutset) {
+    if (!a) return NULL;
+    size_t start, end;
+    trim_bounds(a, cutset, true, false, &start, &end);
+    return come_string_view(a, start, end - start);
+}
+
+come_string_t* come_string_rtrim_view(const come_string_t* a, const char* cutset) {
+    if (!a) return NULL;
+    size_t start, end;
+    trim_bounds(a, cutset, false, true, &start, &end);
+    return come_string_view(a, start, end - start);
+}
+
+// Split without copying: the list holds one block of embedded views, so a
+// split of N parts costs two allocations instead of N + 1.
+come_string_list_t* come_string_split_view(const come_string_t* a, const char* sep, size_t n) {
+    if (!a || !sep) return NULL;
+
+    const come_string_t* parent = a;
+    size_t base = 0;
+    if (come_string_is_view(a)) {
+        parent = ((const come_string_view_t*)a)->parent;
+        base = ((const come_string_view_t*)a)->offset;
+    }
+
+    // Single pass into a growable view block, then wrap it in an exact-size list
+    size_t cap = SPLIT_INITIAL_CAP;
+    size_t count = 0;
+    come_string_view_t* views = mem_talloc_alloc((void*)parent, sizeof(come_string_view_t) * cap);
+    if (!views) return NULL;
+
+    const char* d = come_string_data(a);
+    const char* end = d + a->count;
+    const char* p = d;
+    size_t sep_len = strlen(sep);
+    for (;;) {
+        const char* next = split_next(p, end, sep, sep_len, count, n);
+        if (count == cap) {
+            come_string_view_t* grown = mem_talloc_realloc((void*)parent, views, sizeof(come_string_view_t) * cap * 2);
+            if (!grown) { mem_talloc_free(views); return NULL; }
+            views = grown;
+            cap *= 2;
         }
+        views[count].size = COME_STRING_VIEW_TAG;
+        views[count].count = (uint32_t)((next ? next : end) - p);
+        views[count].offset = (uint32_t)(base + (p - d));
+        views[count].flags = COME_STRING_VIEW_EMBEDDED;
+        views[count].parent = parent;
+        views[count].cstr = NULL;
         count++;
-        matches++;
-        p += pmatch[0].rm_eo;
+        if (!next) break;
+        p = next + sep_len;
     }
-    
-    come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
+
+    come_string_list_t* list = mem_talloc_alloc((void*)parent, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
+    if (!list) { mem_talloc_free(views); return NULL; }
+    mem_talloc_steal(list, views);
     list->size = count;
     list->count = count;
-
-    // Second pass: fill
-    p = a->data;
-    matches = 0;
     for (size_t i = 0; i < count; i++) {
-        if (regexec(&regex, p, 1, pmatch, 0) == 0 && (n == 0 || matches < n - 1)) {
-            size_t len = pmatch[0].rm_so;
-            list->items[i] = come_string_new_len(list, p, len);
-            p += pmatch[0].rm_eo;
-            matches++;
-        } else {
-            size_t len = strlen(p);
-            list->items[i] = come_string_new_len(list, p, len);
-        }
+        list->items[i] = (come_string_t*)&views[i];
     }
 
-    regfree(&regex);
     return list;
 }
 
-come_string_list_t* come_string_regex_groups(const come_string_t* a, const char* pattern) {
-    if (!a || !pattern) return NULL;
-    
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED) != 0) return NULL;
+// .dup(depth) of a list. At depth 1 the copy shares the strings. Otherwise
+// it is laid out as split_view does it: the bytes of every string, counted
+// first, go into one string, and the items are views embedded after them in
+// the same block, so a copy of N strings costs two allocations: the block
+// and the list, which stays its own allocation so that it can grow.
+come_string_list_t* come_string_list_dup(TALLOC_CTX* ctx, const come_string_list_t* a, int depth) {
+    if (!a) return NULL;
+    size_t count = a->count;
+    come_string_list_t* list = mem_talloc_alloc(ctx, sizeof(come_string_list_t) + sizeof(come_string_t*) * count);
+    if (!list) return NULL;
+    list->size = (uint32_t)count;
+    list->count = (uint32_t)count;
+    if (depth == 1) {
+        memcpy(list->items, a->items, sizeof(come_string_t*) * count);
+        return list;
+    }
 
-    size_t nmatch = regex.re_nsub + 1; // 0 is full match, 1..n are groups
-    regmatch_t* pmatch_vals = malloc(sizeof(regmatch_t) * nmatch);
-    
-    if (regexec(&regex, a->data, nmatch, pmatch_vals, 0) == 0) {
-        come_string_list_t* list = mem_talloc_alloc((void*)a, sizeof(come_string_list_t) + sizeof(come_string_t*) * nmatch);
-        list->size = (uint32_t)nmatch;
-        list->count = (uint32_t)nmatch;
-        for (size_t i = 0; i < nmatch; i++) {
-            if (pmatch_vals[i].rm_so != -1) {
-                size_t len = pmatch_vals[i].rm_eo - pmatch_vals[i].rm_so;
-                list->items[i] = come_string_new_len(list, a->data + pmatch_vals[i].rm_so, len);
-            } else {
-                list->items[i] = NULL; // Optional group not matched
-            }
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; i++) bytes += a->items[i] ? a->items[i]->count : 0;
+    size_t views_at = (sizeof(come_string_t) + bytes + 1 + _Alignof(come_string_view_t) - 1) &
+                      ~(_Alignof(come_string_view_t) - 1);
+    come_string_t* block = mem_talloc_alloc(list, views_at + sizeof(come_string_view_t) * count);
+    if (!block) { mem_talloc_free(list); return NULL; }
+    block->size = (uint32_t)(sizeof(come_string_t) + bytes + 1);
+    block->count = (uint32_t)bytes;
+    block->data[bytes] = '\0';
+
+    come_string_view_t* views = (come_string_view_t*)((char*)block + views_at);
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        const come_string_t* s = a->items[i];
+        if (!s) {
+            list->items[i] = NULL;
+            continue;
         }
-        free(pmatch_vals);
-        regfree(&regex);
-        return list;
+        memcpy(block->data + offset, come_string_data(s), s->count);
+        views[i].size = COME_STRING_VIEW_TAG;
+        views[i].count = s->count;
+        views[i].offset = (uint32_t)offset;
+        views[i].flags = COME_STRING_VIEW_EMBEDDED;
+        views[i].parent = block;
+        views[i].cstr = NULL;
+        list->items[i] = (come_string_t*)&views[i];
+        offset += s->count;
     }
+    return list;
+}
+
+// NUL-terminated bytes of 'a'. Owned strings and views that run to the end of
+// their parent are returned in place; inner views are copied under the parent
+// once, and the copy is kept on the view for later calls.
+const char* come_string_cstr(const come_string_t* a) {
+    if (!a) return NULL;
+    if (!come_string_is_view(a)) return a->data;
 
-    free(pmatch_vals);
-    regfree(&regex);
-    come_string_list_t* empty = mem_talloc_alloc((void*)a, sizeof(come_string_list_t));
-    empty->size = 0;
-    empty->count = 0;
-    return empty;
+    come_string_view_t* v = (come_string_view_t*)a;
+    if (v->offset + v->count == v->parent->count) return v->parent->data + v->offset;
+    if (v->cstr) return v->cstr;
+
+    come_string_t* copy = come_string_new_len((void*)v->parent, come_string_data(a), a->count);
+    if (copy) v->cstr = copy->data;
+    return v->cstr;
 }
 
-come_string_t* come_string_regex_replace(const come_string_t* a, const char* pattern, const char* repl, size_t count) {
-    if (!a || !pattern) return NULL;
-    
-    regex_t regex;
-    if (regcomp(&regex, pattern, REG_EXTENDED) != 0) return NULL;
 
-    // We need to build the new string.
-    // Since we don't know the size, we might need a dynamic buffer or two passes.
-    // Two passes is easier.
-    
-    // Pass 1: calculate size
-    size_t new_len = 0;
-    const char* p = a->data;
-    size_t matches = 0;
-    regmatch_t pmatch[1];
-    size_t repl_len = strlen(repl);
-    
-    while (*p && (count == 0 || matches < count)) {
-        if (regexec(&regex, p, 1, pmatch, 0) == 0) {
-            new_len += pmatch[0].rm_so; // Prefix
-            new_len += repl_len;        // Replacement
-            p += pmatch[0].rm_eo;
-            matches++;
-            if (pmatch[0].rm_eo == pmatch[0].rm_so) { // Empty match
-                if (*p) { new_len++; p++; } // Advance one char
-            }
-        } else {
-            new_len += strlen(p);
-            break;
-        }
+come_string_list_t* come_string_list_new(TALLOC_CTX* ctx, uint32_t capacity) {
+    if (capacity == 0) capacity = 1;
+    come_string_list_t* list = mem_talloc_alloc(ctx, sizeof(come_string_list_t) + sizeof(come_string_t*) * capacity);
+    if (!list) return NULL;
+    list->size = capacity;
+    list->count = 0;
+    return list;
+}
+
+come_string_list_t* come_string_list_append(come_string_list_t* list, const char* str, size_t len) {
+    if ((list->size & COME_SHARED) && mem_talloc_reference_count(list)) {
+        // Another owner's list stays as it is (come_array_cow)
+        come_string_list_t* own = come_string_list_dup(list, list, 1);
+        if (!own) return list;
+        list = own;
     }
-    if (matches == count && *p) new_len += strlen(p); // Remaining
-    
-    come_string_t* res = come_string_new_len((void*)a, "", new_len);
-    
-    // Pass 2: copy
-    p = a->data;
-    char* dest = res->data;
-    matches = 0;
-    
-    while (*p && (count == 0 || matches < count)) {
-        if (regexec(&regex, p, 1, pmatch, 0) == 0) {
-            size_t prefix_len = pmatch[0].rm_so;
-            memcpy(dest, p, prefix_len);
-            dest += prefix_len;
-            memcpy(dest, repl, repl_len);
-            dest += repl_len;
-            p += pmatch[0].rm_eo;
-            matches++;
-            if (pmatch[0].rm_eo == pmatch[0].rm_so) {
-                if (*p) { *dest++ = *p++; }
-            }
-        } else {
-            strcpy(dest, p);
-            dest += strlen(p);
-            break;
-        }
+    list->size &= ~COME_SHARED;
+    if (list->count == list->size) {
+        // Items are talloc children of the list, so they follow it on realloc
+        uint32_t cap = list->size ? list->size * 2 : 4;  // Copies of empty lists have no room
+        come_string_list_t* grown = mem_talloc_realloc(NULL, list, sizeof(come_string_list_t) + sizeof(come_string_t*) * cap);
+        if (!grown) return list;
+        list = grown;
+        list->size = cap;
     }
-    if (matches == count && *p) strcpy(dest, p);
-    
-    regfree(&regex);
-    return res;
+    list->items[list->count++] = come_string_new_len(list, str, len);
+    return list;
 }
 
 uint32_t come_string_list_len(const come_string_list_t* list) {
@@ -611,11 +708,13 @@ come_string_t* come_string_sprintf(TALLOC_CTX* ctx, const char* fmt, ...) {
         return NULL;
     }
     
-    come_string_t* s = come_string_new_len(ctx, "", len);
+    come_string_t* s = mem_talloc_alloc(ctx, sizeof(come_string_t) + len + 1);
     if (!s) {
         va_end(args);
         return NULL;
     }
+    s->size = (uint32_t)(sizeof(come_string_t) + len + 1);
+    s->count = (uint32_t)len;
     
     vsnprintf(s->data, len + 1, fmt, args);
     va_end(args);
@@ -627,13 +726,13 @@ come_byte_array_t* come_string_to_byte_array(const come_string_t* a) {
     if (!a) return NULL;
     
     // Allocate byte array structure with items FAM
-    come_byte_array_t* ba = mem_talloc_alloc((void*)a, sizeof(come_byte_array_t) + a->count);
+    come_byte_array_t* ba = mem_talloc_alloc(come_string_ctx(a), sizeof(come_byte_array_t) + a->count);
     if (!ba) return NULL;
     
     ba->size = a->count;
     ba->count = a->count;
     
-    memcpy(ba->items, a->data, a->count);
+    memcpy(ba->items, come_string_data(a), a->count);
     
     return ba;
 }
@@ -642,29 +741,78 @@ come_byte_array_t* come_string_to_byte_array(const come_string_t* a) {
 come_string_t* come_string_at(const come_string_t* a, size_t index) {
     if (!a) return NULL;
     
-    const char* p = a->data;
+    const char* d = come_string_data(a);
+    size_t len = a->count;
+    size_t i = 0;
     size_t current_idx = 0;
     
-    while (*p) {
+    while (i < len) {
+        // Find the end of the current character
+        size_t start = i;
+        do { i++; } while (i < len && (d[i] & 0xC0) == 0x80);
+
         if (current_idx == index) {
-            // Found the character start
-            const char* start = p;
-            // Advance to find end
-            do { p++; } while ((*p & 0xC0) == 0x80);
-            
-            size_t len = p - start;
-            return come_string_new_len((void*)a, start, len);
+            return come_string_new_len(come_string_ctx(a), d + start, i - start);
         }
-        
-        // Advance
-        do { p++; } while ((*p & 0xC0) == 0x80);
         current_idx++;
     }
     
     return NULL; // Out of bounds
 }
 
-long come_string_tol(const come_string_t* a) {
-    if (!a) return 0;
-    return strtol(a->data, NULL, 10);
+// Numeric conversions report through errno, which ERR reads: 0 on success,
+// EINVAL for text that is not a number, ERANGE for a clamped result
+long come_string_tol(const come_string_t* a, int base) {
+    long v = 0;
+    errno = a ? come_num_parse_long(come_string_data(a), a->count, base, &v) : EINVAL;
+    return v;
+}
+
+double come_string_tod(const come_string_t* a) {
+    double v = 0;
+    errno = a ? come_num_parse_double(come_string_data(a), a->count, &v) : EINVAL;
+    return v;
+}
+
+// Room for extra more bytes after a's text, growing by half again so that
+// repeated appends are amortized. Views get an owned copy on their parent,
+// and shared strings one under themselves.
+static come_string_t* string_reserve(come_string_t* a, size_t extra) {
+    size_t need = sizeof(come_string_t) + a->count + extra + 1;
+    if (come_string_is_view(a) || string_held(a)) {
+        come_string_t* s = mem_talloc_alloc(come_string_ctx(a), need);
+        if (!s) return NULL;
+        s->size = (uint32_t)need;
+        s->count = a->count;
+        memcpy(s->data, come_string_data(a), a->count);
+        return s;
+    }
+    if (need <= a->size) return a;
+
+    size_t cap = a->size + a->size / 2;
+    if (cap < need) cap = need;
+    if (cap > UINT32_MAX) cap = UINT32_MAX;
+    if (need > cap) return NULL;
+    come_string_t* grown = mem_talloc_realloc(NULL, a, cap);
+    if (!grown) return NULL;
+    grown->size = (uint32_t)cap;
+    return grown;
+}
+
+come_string_t* come_string_cat_long(come_string_t* a, long v) {
+    if (!a) return NULL;
+    come_string_t* s = string_reserve(a, COME_NUM_LONG_MAX);
+    if (!s) return a;
+    s->count += (uint32_t)come_num_format_long(s->data + s->count, v);
+    s->data[s->count] = '\0';
+    return s;
+}
+
+come_string_t* come_string_cat_double(come_string_t* a, double v) {
+    if (!a) return NULL;
+    come_string_t* s = string_reserve(a, COME_NUM_DOUBLE_MAX);
+    if (!s) return a;
+    s->count += (uint32_t)come_num_format_double(s->data + s->count, v);
+    s->data[s->count] = '\0';
+    return s;
 }
@@ -9,6 +9,33 @@ gcc -Wall -g -Isrc/include -Isrc/core/include tests/test_parser.c src/core/parse
 gcc -Wall -g -Isrc/include -Isrc/core/include tests/test_codegen.c src/core/parser.c src/core/lexer.c src/core/codegen.c -o build/tests/test_codegen
 ./build/tests/test_codegen
 
-gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_string.c src/string/string.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_string -ldl
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_string.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_string -ldl
 ./build/tests/test_string
 
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include tests/test_arena.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/arena.c src/core/utils.c -o build/tests/test_arena
+./build/tests/test_arena
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_memstats.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_memstats -ldl
+./build/tests/test_memstats
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_sched.c src/sched/sched.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_sched -ldl
+./build/tests/test_sched
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_chan.c src/sched/chan.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_chan -ldl
+./build/tests/test_chan
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_net.c src/net/tcp.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_net -ldl
+./build/tests/test_net
+COME_NET_BACKEND=io_uring ./build/tests/test_net
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_http.c src/net/http.c src/net/tcp.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_http -ldl
+./build/tests/test_http
+COME_NET_BACKEND=io_uring ./build/tests/test_http
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_async.c src/net/async.c src/net/tcp.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_async -ldl
+./build/tests/test_async
+COME_NET_BACKEND=io_uring ./build/tests/test_async
+
+gcc -Wall -g -D__STDC_WANT_LIB_EXT1__=1 -Isrc/include -Isrc/core/include -Isrc/external/talloc/lib/talloc -Isrc/external/talloc/lib/replace tests/test_sort.c src/array/sort.c src/array/array.c src/sched/sched.c src/string/string.c src/string/search.c src/string/classify.c src/string/casemap.c src/string/num.c src/string/regex.c src/string/re.c src/mem/talloc.c src/core/utils.c src/external/talloc/lib/talloc/talloc.c -o build/tests/test_sort -ldl
+./build/tests/test_sort
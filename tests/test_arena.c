@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// The arena backend (src/mem/arena.c) behind the same mem_talloc API
+
+static int dtor_calls = 0;
+
+static int count_dtor(void* ptr) {
+    (void)ptr;
+    dtor_calls++;
+    return 0;
+}
+
+void test_bump() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    char* a = mem_talloc_alloc(ctx, 10);
+    char* b = mem_talloc_alloc(ctx, 10);
+    assert(((uintptr_t)a & 15) == 0 && ((uintptr_t)b & 15) == 0);
+    assert(b > a && b - a == 32); // 16-byte header + 16-byte rounded payload
+
+    // Only the newest allocation grows in place
+    assert(mem_talloc_realloc(ctx, b, 100) == b);
+    char* moved = mem_talloc_realloc(ctx, a, 100);
+    assert(moved != a);
+
+    // Freeing the newest allocation hands its bytes to the next one
+    char* c = mem_talloc_alloc(ctx, 8);
+    mem_talloc_free(c);
+    assert(mem_talloc_alloc(ctx, 8) == c);
+
+    // Allocations larger than a block get their own
+    char* big = mem_talloc_alloc(ctx, 1 << 20);
+    memset(big, 1, 1 << 20);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mArena bump tests passed\033[0m\n");
+}
+
+void test_hierarchy() {
+    TALLOC_CTX* root = mem_talloc_new_ctx(NULL);
+    TALLOC_CTX* child = mem_talloc_new_ctx(root);
+    TALLOC_CTX* pool = mem_talloc_pool_new(child, 8192);
+    void* obj = mem_talloc_alloc(pool, 16);
+    mem_talloc_set_destructor(obj, count_dtor);
+    void* gone = mem_talloc_alloc(pool, 16);
+    mem_talloc_set_destructor(gone, count_dtor);
+    mem_talloc_set_destructor(gone, NULL);
+
+    // Freeing a context frees its child contexts and runs their destructors
+    dtor_calls = 0;
+    mem_talloc_free(child);
+    assert(dtor_calls == 1);
+
+    // Stealing a context re-parents it
+    TALLOC_CTX* a = mem_talloc_new_ctx(root);
+    TALLOC_CTX* b = mem_talloc_new_ctx(root);
+    void* kept = mem_talloc_alloc(a, 16);
+    mem_talloc_set_destructor(kept, count_dtor);
+    assert(mem_talloc_steal(b, a) == a);
+    assert(mem_talloc_steal(a, b) == b); // Refused: b is a's parent now
+    dtor_calls = 0;
+    mem_talloc_free(b);
+    assert(dtor_calls == 1);
+
+    // Freeing an object runs its destructor once
+    void* o = mem_talloc_alloc(root, 16);
+    mem_talloc_set_destructor(o, count_dtor);
+    dtor_calls = 0;
+    mem_talloc_free(o);
+    mem_talloc_free(root);
+    assert(dtor_calls == 1);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mArena hierarchy tests passed\033[0m\n");
+}
+
+void test_strings() {
+    TALLOC_CTX* root = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new(root, "Parent");
+    come_string_t* up = come_string_upper(s);
+    assert(come_string_cmp(up, come_string_new(root, "PARENT"), 0) == 0);
+
+    // Appends reallocate the newest string in place
+    come_string_t* line = come_string_new(root, "");
+    for (int i = 0; i < 1000; i++) come_string_append_long(line, i);
+    assert(come_string_len(line) == 2890);
+
+    come_string_list_t* parts = come_string_split(come_string_new(root, "a,b,c"), ",");
+    assert(parts->count == 3 && come_string_cmp(parts->items[2], come_string_new(root, "c"), 0) == 0);
+
+    // A string stolen into a longer-lived context keeps its own context alive
+    TALLOC_CTX* request = mem_talloc_new_ctx(root);
+    come_string_t* name = come_string_new(request, "kept");
+    come_string_chown(name, root);
+    mem_talloc_free(request);
+    assert(come_string_len(name) == 4 && memcmp(name->data, "kept", 4) == 0);
+
+    // A shared string is not reclaimed when freed, and stays shared: the
+    // first write copies it even after the other owner is gone
+    TALLOC_CTX* owner = mem_talloc_new_ctx(root);
+    come_string_t* shared = come_string_share(owner, come_string_new(root, "both"));
+    mem_talloc_free(shared);
+    come_string_t* fresh = come_string_new(root, "next");
+    mem_talloc_free(owner);
+    assert(memcmp(shared->data, "both", 4) == 0 && memcmp(fresh->data, "next", 4) == 0);
+    assert(come_string_upper_reuse(shared) != shared);
+
+    // Pool scopes work the same as with talloc
+    TALLOC_CTX* module_ctx = root;
+    {
+        mem_talloc_scope_t scope __attribute__((cleanup(mem_talloc_scope_exit))) = mem_talloc_scope_enter(&module_ctx, 4096);
+        assert(module_ctx != root && come_string_new(module_ctx, "scoped") != NULL);
+    }
+    assert(module_ctx == root);
+
+    mem_talloc_free(root);
+    mem_talloc_module_shutdown();
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mArena string tests passed\033[0m\n");
+}
+
+static mem_talloc_handoff_t handoff_box = MEM_TALLOC_HANDOFF_INIT;
+
+static void* handoff_producer(void* arg) {
+    (void)arg;
+    for (int i = 0; i < 1000; i++) {
+        TALLOC_CTX* tree = mem_talloc_new_ctx(NULL);
+        assert(mem_talloc_handoff_push(&handoff_box, tree, come_string_sprintf(tree, "%d", i)) == 0);
+    }
+    return NULL;
+}
+
+void test_handoff() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    // Objects cannot leave their arena: only contexts are handed off
+    assert(mem_talloc_handoff_push(&handoff_box, mem_talloc_alloc(ctx, 8), NULL) == -1);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, handoff_producer, NULL);
+    for (int i = 0; i < 1000;) {
+        come_string_t* s;
+        TALLOC_CTX* tree = mem_talloc_handoff_take(&handoff_box, ctx, (void**)&s);
+        if (!tree) continue;
+        assert(atoi(come_string_cstr(s)) == i++);
+        if (i % 2) mem_talloc_free(tree); // The rest go with ctx
+    }
+    pthread_join(thread, NULL);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mArena handoff tests passed\033[0m\n");
+}
+
+int main() {
+    test_bump();
+    test_hierarchy();
+    test_handoff();
+    test_strings();
+    return 0;
+}
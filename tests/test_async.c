@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// async/await runtime (src/net/async.c), with step functions written the
+// way codegen writes them: locals in the frame, a label per await
+
+#define PORT 39612
+
+static int freed;
+
+static int count_free(void* p) {
+    (void)p;
+    freed++;
+    return 0;
+}
+
+// A task that finishes in its first step with an object result
+typedef struct {
+    come_async_t task;
+    char* result;
+} greet_t;
+
+static int greet_step(come_async_t* task) {
+    greet_t* f = (greet_t*)task;
+    f->result = mem_talloc_alloc(task->ctx, 6);
+    strcpy(f->result, "hello");
+    task->result = f->result;
+    return COME_ASYNC_DONE;
+}
+
+typedef struct {
+    come_async_t task;
+    char* got;
+} outer_t;
+
+static int outer_step(come_async_t* task) {
+    outer_t* f = (outer_t*)task;
+    if (task->resume) goto *task->resume;
+    task->resume = &&resume1;
+    if (come_async_await(task, come_async_new(task->ctx, sizeof(greet_t), greet_step))) {
+        return COME_ASYNC_PENDING;
+    }
+resume1:
+    f->got = ((greet_t*)task->awaiting)->result;
+    come_async_release(task);
+    return COME_ASYNC_DONE;
+}
+
+void test_await() {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    outer_t* f = come_async_new(ctx, sizeof(outer_t), outer_step);
+    // Not detached: the caller keeps the finished frame
+    assert(outer_step(&f->task) == COME_ASYNC_DONE);
+    assert(f->got && strcmp(f->got, "hello") == 0);
+    assert(f->task.awaiting == NULL);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mAsync await tests passed\033[0m\n");
+}
+
+// Loopback: a detached server task echoes one connection, a detached
+// client task sends pings and reads the echoes back, possibly merged
+
+typedef struct {
+    come_async_t task;
+    come_net_tcp_listener_t* listener;
+    come_net_tcp_conn_t* conn;
+    long echoed;
+} server_t;
+
+static long server_echoed = -1;
+
+static int server_step(come_async_t* task) {
+    server_t* f = (server_t*)task;
+    if (task->resume) goto *task->resume;
+    task->resume = &&accepted;
+    if (come_async_accept(task, f->listener)) return COME_ASYNC_PENDING;
+accepted:
+    f->conn = task->value;
+    assert(f->conn != NULL);
+    come_net_tcp_close(f->listener);
+    for (;;) {
+        task->resume = &&read;
+        if (come_async_read(task, f->conn)) return COME_ASYNC_PENDING;
+    read:
+        if (!task->value) break;
+        come_byte_array_t* data = task->value;
+        f->echoed += data->count;
+        come_net_tcp_write_array(f->conn, data);
+    }
+    server_echoed = f->echoed;
+    return COME_ASYNC_DONE;
+}
+
+typedef struct {
+    come_async_t task;
+    come_net_tcp_conn_t* conn;
+    int sent;
+    long received;
+} client_t;
+
+static long client_received = -1;
+
+static int client_step(come_async_t* task) {
+    client_t* f = (client_t*)task;
+    if (task->resume) goto *task->resume;
+    task->resume = &&connected;
+    if (come_async_connect(task, come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT)))) {
+        return COME_ASYNC_PENDING;
+    }
+connected:
+    f->conn = task->value;
+    assert(f->conn != NULL);
+    for (f->sent = 0; f->sent < 100; f->sent++) {
+        come_net_tcp_write_cstr(f->conn, "ping");
+        while (f->received < (f->sent + 1) * 4) {
+            task->resume = &&read;
+            if (come_async_read(task, f->conn)) return COME_ASYNC_PENDING;
+        read:
+            assert(task->value != NULL);
+            come_byte_array_t* data = task->value;
+            for (uint32_t i = 0; i < data->count; i++) assert(strchr("ping", data->items[i]));
+            f->received += data->count;
+        }
+    }
+    come_net_tcp_close(f->conn);
+    client_received = f->received;
+    return COME_ASYNC_DONE;
+}
+
+void test_loopback() {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    freed = 0;
+    server_t* server = come_async_new(ctx, sizeof(server_t), server_step);
+    server->listener = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+    assert(server->listener != NULL);
+    mem_talloc_set_destructor(server, count_free);
+    come_async_detach(&server->task);
+
+    client_t* client = come_async_new(ctx, sizeof(client_t), client_step);
+    mem_talloc_set_destructor(client, count_free);
+    come_async_detach(&client->task);
+
+    // Both are parked; each resumes from the loop's handlers
+    assert(freed == 0);
+    assert(come_net_run() == 0);
+    assert(client_received == 400 && server_echoed == 400);
+    // Detached tasks are freed when they finish
+    assert(freed == 2);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mAsync loopback tests passed\033[0m\n");
+}
+
+// connect() to a closed port gives NULL
+
+typedef struct {
+    come_async_t task;
+} refused_t;
+
+static int refused_result = 0;
+
+static int refused_step(come_async_t* task) {
+    if (task->resume) goto *task->resume;
+    task->resume = &&connected;
+    if (come_async_connect(task, come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", 1)))) {
+        return COME_ASYNC_PENDING;
+    }
+connected:
+    refused_result = task->value == NULL ? 1 : -1;
+    return COME_ASYNC_DONE;
+}
+
+void test_refused() {
+    refused_t* f = come_async_new(NULL, sizeof(refused_t), refused_step);
+    come_async_detach(&f->task);
+    assert(come_net_run() == 0);
+    assert(refused_result == 1);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mAsync refused connect tests passed\033[0m\n");
+}
+
+int main() {
+    mem_talloc_module_init();
+    test_await();
+    test_loopback();
+    test_refused();
+    mem_talloc_module_shutdown();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "come_string.h"
+#include "come_sched.h"
+#include "mem/talloc.h"
+
+// Channels (src/sched/chan.c): each of the four queues, closing, object
+// moves between thread contexts, select, and producers and consumers on
+// threads of their own
+
+static const char* kind_names[] = { "ring", "spsc ring", "segments", "spsc segments" };
+static const long kind_caps[] = { 8, 8, 0, 0 };
+static const int kind_flags[] = { 0, COME_CHAN_SPSC, 0, COME_CHAN_SPSC };
+
+void test_fifo() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (int k = 0; k < 4; k++) {
+        come_chan_t* ch = come_chan_new(ctx, sizeof(long), kind_caps[k], kind_flags[k]);
+        long v;
+        assert(come_chan_try_recv(ch, &v, ctx) == COME_CHAN_WOULD_BLOCK);
+        // Several segments' worth, or one ring's
+        long n = kind_caps[k] ? kind_caps[k] : 1000;
+        for (long i = 0; i < n; i++) assert(come_chan_try_send(ch, &i) == COME_CHAN_OK);
+        if (kind_caps[k]) assert(come_chan_try_send(ch, &n) == COME_CHAN_WOULD_BLOCK);
+        for (long i = 0; i < n; i++) {
+            assert(come_chan_recv(ch, &v, ctx) == COME_CHAN_OK);
+            assert(v == i);
+        }
+        assert(come_chan_try_recv(ch, &v, ctx) == COME_CHAN_WOULD_BLOCK);
+
+        // Wrap around a few times
+        for (long i = 0; i < 100; i++) {
+            assert(come_chan_send(ch, &i) == COME_CHAN_OK);
+            assert(come_chan_recv(ch, &v, ctx) == COME_CHAN_OK && v == i);
+        }
+
+        // Closed: what was sent still comes out, then CLOSED with a zero value
+        long last = 42;
+        assert(come_chan_send(ch, &last) == COME_CHAN_OK);
+        come_chan_close(ch);
+        assert(come_chan_closed(ch));
+        assert(come_chan_send(ch, &last) == COME_CHAN_CLOSED);
+        assert(come_chan_recv(ch, &v, ctx) == COME_CHAN_OK && v == 42);
+        assert(come_chan_recv(ch, &v, ctx) == COME_CHAN_CLOSED && v == 0);
+        assert(come_chan_try_recv(ch, &v, ctx) == COME_CHAN_CLOSED);
+    }
+    // Values left in a channel go with it
+    come_chan_t* ch = come_chan_new(ctx, sizeof(int), 0, 0);
+    for (int i = 0; i < 100; i++) come_chan_send(ch, &i);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mChannel FIFO tests passed\033[0m\n");
+}
+
+// Objects: a string from a context of the thread's own moves as it is; one
+// in a pool is copied, and the copy is what arrives
+void test_objects() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    TALLOC_CTX* pool = mem_talloc_pool_new(NULL, 4096);
+    TALLOC_CTX* dest = mem_talloc_new_ctx(NULL);
+    come_chan_t* ch = come_chan_new(ctx, 0, 4, COME_CHAN_OBJECT);
+
+    come_string_t* moved = come_string_new(ctx, "moved");
+    come_string_t* pooled = come_string_new(pool, "pooled");
+    assert(come_chan_send(ch, &moved) == COME_CHAN_OK);
+    assert(come_chan_send(ch, &pooled) == COME_CHAN_OK);
+
+    come_string_t* got;
+    assert(come_chan_recv(ch, &got, dest) == COME_CHAN_OK);
+    assert(got == moved && strcmp(come_string_cstr(got), "moved") == 0);
+    assert(come_chan_recv(ch, &got, dest) == COME_CHAN_OK);
+    assert(got != pooled && strcmp(come_string_cstr(got), "pooled") == 0);
+    assert(strcmp(come_string_cstr(pooled), "pooled") == 0);
+
+    // Received objects belong to dest: freeing the channel's context
+    // leaves them, freeing dest frees them
+    mem_talloc_free(ctx);
+    assert(strcmp(come_string_cstr(got), "pooled") == 0);
+    mem_talloc_free(dest);
+
+    // Objects nobody received are freed with the channel
+    ctx = mem_talloc_new_ctx(NULL);
+    ch = come_chan_new(ctx, 0, 0, COME_CHAN_OBJECT);
+    for (int i = 0; i < 50; i++) {
+        come_string_t* s = come_string_sprintf(ctx, "left %d", i);
+        come_chan_send(ch, &s);
+    }
+    mem_talloc_free(ctx);
+    mem_talloc_free(pool);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mChannel object tests passed\033[0m\n");
+}
+
+void test_select() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_chan_t* a = come_chan_new(ctx, sizeof(int), 2, 0);
+    come_chan_t* b = come_chan_new(ctx, sizeof(int), 0, 0);
+    int va = 0, vb = 0;
+    come_chan_case_t cases[] = { { a, &va, 0, 0 }, { b, &vb, 0, 0 } };
+    assert(come_chan_select(cases, 2, 0, ctx) == -1);
+
+    int x = 7;
+    come_chan_send(b, &x);
+    assert(come_chan_select(cases, 2, 1, ctx) == 1 && vb == 7 && !cases[1].closed);
+
+    // Both ready: the rotating start takes turns
+    int seen[2] = { 0, 0 };
+    for (int i = 0; i < 10; i++) {
+        come_chan_send(a, &i);
+        come_chan_send(b, &i);
+        int r = come_chan_select(cases, 2, 1, ctx);
+        assert(r == 0 || r == 1);
+        seen[r]++;
+        // Drain the other
+        int other;
+        come_chan_recv(r ? a : b, &other, ctx);
+    }
+    assert(seen[0] > 0 && seen[1] > 0);
+
+    // A send case on a full ring waits; a recv case on a closed channel runs
+    int y = 1;
+    come_chan_send(a, &y);
+    come_chan_send(a, &y);
+    come_chan_case_t send_a = { a, &y, 1, 0 };
+    assert(come_chan_select(&send_a, 1, 0, ctx) == -1);
+    come_chan_close(b);
+    vb = 5;
+    assert(come_chan_select(cases + 1, 1, 1, ctx) == 0 && cases[1].closed && vb == 0);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mChannel select tests passed\033[0m\n");
+}
+
+// Producers send 1..PER_PRODUCER each; consumers add up what they get until
+// the channel closes
+
+#define PER_PRODUCER 100000
+
+typedef struct {
+    come_chan_t* ch;
+    long sum;
+    long count;
+} worker_t;
+
+static void* producer(void* arg) {
+    worker_t* w = arg;
+    for (long i = 1; i <= PER_PRODUCER; i++) assert(come_chan_send(w->ch, &i) == COME_CHAN_OK);
+    return NULL;
+}
+
+static void* consumer(void* arg) {
+    worker_t* w = arg;
+    long v;
+    while (come_chan_recv(w->ch, &v, NULL) == COME_CHAN_OK) {
+        w->sum += v;
+        w->count++;
+    }
+    return NULL;
+}
+
+static void run_threads(come_chan_t* ch, int producers, int consumers) {
+    pthread_t threads[16];
+    worker_t workers[16];
+    for (int i = 0; i < producers + consumers; i++) {
+        workers[i] = (worker_t){ ch, 0, 0 };
+        pthread_create(&threads[i], NULL, i < producers ? producer : consumer, &workers[i]);
+    }
+    for (int i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+    come_chan_close(ch);
+    long sum = 0, count = 0;
+    for (int i = producers; i < producers + consumers; i++) {
+        pthread_join(threads[i], NULL);
+        sum += workers[i].sum;
+        count += workers[i].count;
+    }
+    assert(count == (long)producers * PER_PRODUCER);
+    assert(sum == (long)producers * PER_PRODUCER * (PER_PRODUCER + 1) / 2);
+}
+
+void test_threads() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (int k = 0; k < 4; k++) {
+        int spsc = kind_flags[k] & COME_CHAN_SPSC;
+        come_chan_t* ch = come_chan_new(ctx, sizeof(long), kind_caps[k] ? 64 : 0, kind_flags[k]);
+        run_threads(ch, spsc ? 1 : 4, spsc ? 1 : 4);
+        printf("  %s: ok\n", kind_names[k]);
+    }
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mChannel thread tests passed\033[0m\n");
+}
+
+int main() {
+    mem_talloc_module_init();
+    test_fifo();
+    test_objects();
+    test_select();
+    test_threads();
+    mem_talloc_module_shutdown();
+    return 0;
+}
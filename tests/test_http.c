@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// net.http (src/net/http.c): the parser on its own through feed(), in
+// every split of the input, then a client and a server session talking
+// over loopback
+
+#define PORT 39412
+
+// Every event as text, so runs over different splits can be compared
+static char trace[4096];
+
+static void trace_add(const char* fmt, const come_string_t* a, const come_string_t* b) {
+    size_t n = strlen(trace);
+    snprintf(trace + n, sizeof(trace) - n, fmt, a ? come_string_cstr(a) : "-", b ? come_string_cstr(b) : "-");
+}
+
+static void on_line(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    come_net_http_message_t* m = *(come_net_http_message_t**)env;
+    trace_add("L %s %s|", come_net_http_method(m), come_net_http_path(m));
+}
+
+static void on_header(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    come_net_http_message_t* m = *(come_net_http_message_t**)env;
+    trace_add("H %s %s|", come_net_http_header(m, "host"), come_net_http_header(m, "X-Empty"));
+}
+
+static void on_ready(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    come_net_http_message_t* m = *(come_net_http_message_t**)env;
+    // Views from the start line are still good, and still C strings
+    trace_add("R %s [%s]|", come_net_http_path(m), come_net_http_body(m));
+    assert(strlen(come_string_cstr(come_net_http_path(m))) == come_net_http_path(m)->count);
+}
+
+static come_net_http_session_t* parser(void* ctx) {
+    come_net_http_session_t* s = come_net_http_new(ctx);
+    come_net_http_message_t* req = come_net_http_req(s);
+    *(void**)come_net_http_on(req, COME_NET_HTTP_LINE_READY, on_line, sizeof(void*)) = req;
+    *(void**)come_net_http_on(req, COME_NET_HTTP_HEADER_READY, on_header, sizeof(void*)) = req;
+    *(void**)come_net_http_on(req, COME_NET_HTTP_READY, on_ready, sizeof(void*)) = req;
+    return s;
+}
+
+static const char pipelined[] =
+    "GET /a?x=1 HTTP/1.1\r\nHost: example.com\r\nX-Empty:\r\n\r\n"
+    "\r\n"  // Stray blank line between messages
+    "POST /b HTTP/1.1\r\nhost:  spaced  \r\nContent-Length: 5\r\n\r\nhello"
+    "PUT /c HTTP/1.1\nHOST: bare-lf\nTransfer-Encoding: chunked\n\n"
+    "3;ext=1\r\nabc\r\n10\r\n0123456789abcdef\r\n0\r\nTrailer: x\r\n\r\n";
+
+static const char expected[] =
+    "L GET /a?x=1|H example.com |R /a?x=1 []|"
+    "L POST /b|H spaced -|R /b [hello]|"
+    "L PUT /c|H bare-lf -|R /c [abc0123456789abcdef]|";
+
+void test_parser_splits() {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    size_t len = strlen(pipelined);
+    for (size_t step = 1; step <= len; step++) {
+        trace[0] = '\0';
+        come_net_http_session_t* s = parser(ctx);
+        for (size_t off = 0; off < len; off += step) {
+            size_t n = len - off < step ? len - off : step;
+            assert(come_net_http_feed(s, pipelined + off, n) == 0);
+        }
+        if (strcmp(trace, expected) != 0) {
+            printf("split %zu:\n  got      %s\n  expected %s\n", step, trace, expected);
+            assert(0);
+        }
+    }
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mHTTP parser split tests passed\033[0m\n");
+}
+
+static void pieces(come_string_t* data, void* env, void* ctx) {
+    (void)env;
+    (void)ctx;
+    trace_add("D %s%s|", data, NULL);
+}
+
+void test_parser_streaming() {
+    // With a DATA_READY handler the body streams instead of collecting
+    void* ctx = mem_talloc_new_ctx(NULL);
+    trace[0] = '\0';
+    come_net_http_session_t* s = come_net_http_new(ctx);
+    come_net_http_message_t* req = come_net_http_req(s);
+    come_net_http_on(req, COME_NET_HTTP_DATA_READY, pieces, 0);
+    *(void**)come_net_http_on(req, COME_NET_HTTP_READY, on_ready, sizeof(void*)) = req;
+    const char* head = "POST /s HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n4\r\nabcd\r\n";
+    assert(come_net_http_feed(s, head, strlen(head)) == 0);
+    assert(come_net_http_feed(s, "6\r\nef", 5) == 0);
+    assert(come_net_http_feed(s, "ghij\r\n0\r\n\r\n", 11) == 0);
+    assert(strcmp(trace, "D abcd-|D ef-|D ghij-|R /s []|") == 0);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mHTTP parser streaming tests passed\033[0m\n");
+}
+
+void test_parser_errors() {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    const char* bad[] = {
+        "GET\r\n\r\n",
+        "GET / HTTP/2.0\r\n\r\n",
+        "GET / HTTP/1.1\r\nNo colon\r\n\r\n",
+        "GET / HTTP/1.1\r\nName : value\r\n\r\n",
+        "GET / HTTP/1.1\r\nA: b\r\n folded\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 4\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: gzip\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        come_net_http_session_t* s = come_net_http_new(ctx);
+        if (come_net_http_feed(s, bad[i], strlen(bad[i])) != -1) {
+            printf("accepted: %s\n", bad[i]);
+            assert(0);
+        }
+        assert(come_net_http_feed(s, "GET / HTTP/1.1\r\n\r\n", 18) == -1);  // Stays failed
+    }
+    // A head that never ends
+    come_net_http_session_t* s = come_net_http_new(ctx);
+    char line[1024];
+    memset(line, 'a', sizeof(line));
+    assert(come_net_http_feed(s, "GET / HTTP/1.1\r\n", 16) == 0);
+    int result = 0;
+    for (int i = 0; i < 100 && result == 0; i++) result = come_net_http_feed(s, line, sizeof(line));
+    assert(result == -1);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mHTTP parser error tests passed\033[0m\n");
+}
+
+// Loopback: the client pipelines three requests; the server answers the
+// first with send(), streams the second and closes after the third
+
+static come_net_tcp_listener_t* listener;
+static come_net_http_session_t* server;
+static come_net_http_session_t* client;
+static int served, responses, data_done, server_done, client_done;
+
+static void serve(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)env;
+    (void)ctx;
+    come_net_http_message_t* req = come_net_http_req(server);
+    come_net_http_message_t* resp = come_net_http_resp(server);
+    come_string_t* path = come_net_http_path(req);
+    served++;
+    if (strcmp(come_string_cstr(path), "/stream") == 0) {
+        come_net_http_set_header(resp, "Content-Type", "text/plain");
+        come_net_http_write(resp, "one,");
+        come_net_http_write(resp, path);  // A view, by reference
+        come_net_http_end(resp);
+    } else if (strcmp(come_string_cstr(path), "/missing") == 0) {
+        come_net_http_set_status(resp, 404);
+        come_net_http_send(resp, "");
+    } else {
+        come_net_http_send(resp, come_net_http_body(req));
+    }
+}
+
+static void counted(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    (**(int**)env)++;
+}
+
+static void count(come_net_http_message_t* m, come_net_http_event_t event, int* counter) {
+    *(int**)come_net_http_on(m, event, counted, sizeof(int*)) = counter;
+}
+
+static void accepted(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)env;
+    server = come_net_http_new(ctx);
+    come_net_tcp_conn_t* conn = come_net_tcp_accept(listener);
+    come_net_tcp_close(listener);
+    come_net_http_on(come_net_http_req(server), COME_NET_HTTP_READY, serve, 0);
+    count(come_net_http_resp(server), COME_NET_HTTP_DATA_DONE, &data_done);
+    count(come_net_http_resp(server), COME_NET_HTTP_DONE, &server_done);
+    assert(come_net_http_attach(server, conn) == 0);
+    assert(come_net_http_attach(server, conn) == -1);
+}
+
+static void answered(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)env;
+    (void)ctx;
+    come_net_http_message_t* resp = come_net_http_resp(client);
+    const char* body = come_string_cstr(come_net_http_body(resp));
+    responses++;
+    switch (responses) {
+        case 1:
+            assert(come_net_http_status(resp) == 200 && strcmp(body, "posted") == 0);
+            break;
+        case 2:
+            assert(come_net_http_status(resp) == 200 && strcmp(body, "one,/stream") == 0);
+            assert(strcmp(come_string_cstr(come_net_http_header(resp, "content-type")), "text/plain") == 0);
+            break;
+        case 3:
+            assert(come_net_http_status(resp) == 404 && body[0] == '\0');
+            assert(strcmp(come_string_cstr(come_net_http_header(resp, "Connection")), "close") == 0);
+            break;
+    }
+}
+
+void test_loopback() {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    listener = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+    assert(listener != NULL);
+    come_net_tcp_on(listener, COME_NET_TCP_ACCEPT, accepted, 0);
+
+    come_net_tcp_conn_t* conn = come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT));
+    client = come_net_http_new(ctx);
+    assert(come_net_http_attach(client, conn) == 0);
+    come_net_http_message_t* req = come_net_http_req(client);
+    come_net_http_on(come_net_http_resp(client), COME_NET_HTTP_READY, answered, 0);
+    count(req, COME_NET_HTTP_DONE, &client_done);
+
+    come_net_http_set_method(req, "POST");
+    come_net_http_set_path(req, "/echo");
+    come_net_http_set_header(req, "Host", "localhost");
+    assert(come_net_http_send(req, "posted") == 0);
+    // Back to GET after a send; the header went with the first request
+    come_net_http_set_path(req, "/stream");
+    assert(come_net_http_send(req, "") == 0);
+    come_net_http_set_path(req, "/missing");
+    come_net_http_set_header(req, "Connection", "close");
+    assert(come_net_http_send(req, "") == 0);
+    // The server closes after the third response, and the client on end of stream
+    assert(come_net_run() == 0);
+    assert(served == 3 && responses == 3 && client_done == 3 && server_done == 3 && data_done == 2);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mHTTP loopback tests passed\033[0m\n");
+}
+
+// Transfer codings a server cannot take: chunked that is not the final
+// coding gets 400, other codings before it 501
+
+static int coding_status;
+
+static void coding_accepted(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    come_net_tcp_listener_t* l = *(come_net_tcp_listener_t**)env;
+    come_net_http_session_t* s = come_net_http_new(ctx);
+    assert(come_net_http_attach(s, come_net_tcp_accept(l)) == 0);
+    come_net_tcp_close(l);
+}
+
+static void coding_answer(come_byte_array_t* data, void* env, void* ctx) {
+    (void)env;
+    (void)ctx;
+    // "HTTP/1.1 NNN ..."
+    if (!coding_status && data->count > 12) coding_status = atoi((const char*)data->items + 9);
+}
+
+void test_transfer_codings() {
+    struct { const char* coding; int status; } cases[] = {
+        { "chunked, gzip", 400 },
+        { "gzip, chunked", 501 },
+    };
+    char request[256];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        come_net_tcp_listener_t* l = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+        assert(l != NULL);
+        *(come_net_tcp_listener_t**)come_net_tcp_on(l, COME_NET_TCP_ACCEPT, coding_accepted, sizeof(void*)) = l;
+        come_net_tcp_conn_t* conn = come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT));
+        come_net_tcp_on(conn, COME_NET_TCP_READABLE, coding_answer, 0);
+        int n = snprintf(request, sizeof(request), "POST / HTTP/1.1\r\nTransfer-Encoding: %s\r\n\r\n",
+                         cases[i].coding);
+        assert(come_net_tcp_write_bytes(conn, request, (size_t)n) == 0);
+        coding_status = 0;
+        assert(come_net_run() == 0);
+        assert(coding_status == cases[i].status);
+    }
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mHTTP transfer coding tests passed\033[0m\n");
+}
+
+// Responses a client must not read a body for whatever their framing says:
+// to HEAD, and 1xx/204/304; each pipelined behind the next so that taking
+// bytes for a body would eat the following response
+
+static char framing_in[1024];
+static size_t framing_len;
+static int framing_count;
+
+static void framing_request(come_byte_array_t* data, void* env, void* ctx) {
+    (void)ctx;
+    come_net_tcp_conn_t* conn = *(come_net_tcp_conn_t**)env;
+    assert(framing_len + data->count < sizeof(framing_in));
+    memcpy(framing_in + framing_len, data->items, data->count);
+    framing_len += data->count;
+    framing_in[framing_len] = '\0';
+    int heads = 0;
+    for (const char* p = framing_in; (p = strstr(p, "\r\n\r\n")); p += 4) heads++;
+    if (heads < 4 || come_net_tcp_closing(conn)) return;
+    assert(come_net_tcp_write_cstr(conn,
+                                   "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n"
+                                   "HTTP/1.1 100 Continue\r\nContent-Length: 5\r\n\r\n"
+                                   "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok"
+                                   "HTTP/1.1 304 Not Modified\r\nContent-Length: 5\r\n\r\n"
+                                   "HTTP/1.1 204 No Content\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                   "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok") == 0);
+    come_net_tcp_close(conn);
+}
+
+static void framing_accepted(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    come_net_tcp_listener_t* l = *(come_net_tcp_listener_t**)env;
+    come_net_tcp_conn_t* conn = come_net_tcp_accept(l);
+    come_net_tcp_close(l);
+    *(come_net_tcp_conn_t**)come_net_tcp_on(conn, COME_NET_TCP_READABLE, framing_request, sizeof(void*)) = conn;
+}
+
+static void framing_response(come_string_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    come_net_http_message_t* resp = *(come_net_http_message_t**)env;
+    const come_string_t* body = come_net_http_body(resp);
+    static const int statuses[] = { 200, 100, 200, 304, 204, 200 };
+    static const char* bodies[] = { "", "", "ok", "", "", "ok" };
+    assert(framing_count < 6);
+    assert(come_net_http_status(resp) == statuses[framing_count]);
+    assert(strcmp(body ? come_string_cstr(body) : "", bodies[framing_count]) == 0);
+    framing_count++;
+}
+
+void test_response_framing() {
+    void* ctx = mem_talloc_new_ctx(NULL);
+    come_net_tcp_listener_t* l = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+    assert(l != NULL);
+    *(come_net_tcp_listener_t**)come_net_tcp_on(l, COME_NET_TCP_ACCEPT, framing_accepted, sizeof(void*)) = l;
+
+    come_net_http_session_t* s = come_net_http_new(ctx);
+    assert(come_net_http_attach(s, come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT))) == 0);
+    come_net_http_message_t* req = come_net_http_req(s);
+    *(come_net_http_message_t**)come_net_http_on(come_net_http_resp(s), COME_NET_HTTP_READY, framing_response,
+                                                 sizeof(void*)) = come_net_http_resp(s);
+    come_net_http_set_method(req, "HEAD");
+    come_net_http_set_path(req, "/head");
+    assert(come_net_http_send(req, "") == 0);
+    come_net_http_set_path(req, "/after-head");
+    assert(come_net_http_send(req, "") == 0);
+    come_net_http_set_path(req, "/cached");
+    assert(come_net_http_send(req, "") == 0);
+    come_net_http_set_path(req, "/after-cached");
+    assert(come_net_http_send(req, "") == 0);
+    framing_count = 0;
+    assert(come_net_run() == 0);
+    assert(framing_count == 6);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mHTTP response framing tests passed\033[0m\n");
+}
+
+int main() {
+    mem_talloc_module_init();
+    test_parser_splits();
+    test_parser_streaming();
+    test_parser_errors();
+    test_loopback();
+    test_transfer_codings();
+    test_response_framing();
+    mem_talloc_module_shutdown();
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_string.h"
+#include "mem/talloc.h"
+
+// COME_MEMSTATS accounting in the talloc backend
+
+void test_counts() {
+    mem_talloc_stats_enable();
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    mem_talloc_site = "app.co:3";
+    come_string_t* s = come_string_new(ctx, "hello");  // 8-byte header + 6
+    come_string_t* up = come_string_upper(s);          // A child of s
+    mem_talloc_stats_t st = mem_talloc_stats(ctx);
+    assert(st.bytes == 28 && st.objects == 2 && st.peak == 28);
+
+    // Child contexts count on their own; chown moves the bytes
+    mem_talloc_site = "app.co:7";
+    TALLOC_CTX* req = mem_talloc_pool_new(ctx, 1024);
+    come_string_t* name = come_string_new(req, "request");
+    assert(mem_talloc_stats(req).bytes == 16 && mem_talloc_stats(ctx).bytes == 28);
+    come_string_chown(up, req);
+    assert(mem_talloc_stats(req).bytes == 30 && mem_talloc_stats(ctx).bytes == 14);
+    assert(mem_talloc_stats(name).objects == 2); // The stats of the context owning name
+
+    // Freeing an object subtracts it and its children; peak stays
+    come_string_free(s);
+    st = mem_talloc_stats(ctx);
+    assert(st.bytes == 0 && st.objects == 0 && st.peak == 28);
+
+    // Growing in place counts the difference
+    come_string_t* line = come_string_new(ctx, "");
+    for (int i = 0; i < 100; i++) come_string_append_long(line, i);
+    assert(mem_talloc_stats(ctx).bytes == line->size);
+
+    mem_talloc_free(req);
+    mem_talloc_stats_t total = mem_talloc_stats(NULL);
+    assert(total.bytes == line->size && total.objects == 1);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mMemstats count tests passed\033[0m\n");
+
+    // The report lists live contexts and the sites of their objects
+    mem_talloc_site = NULL;
+    char* report = mem_talloc_stats_report(ctx);
+    assert(strstr(report, "\n    ctx ") && strstr(report, "app.co:3"));
+    assert(strstr(report, "app.co:7") && !strstr(report, "pool app.co:7"));
+    mem_talloc_free(report);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mMemstats report tests passed\033[0m\n");
+}
+
+int main() {
+    test_counts();
+    mem_talloc_module_shutdown();
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_net.h"
+#include "mem/talloc.h"
+
+// The net.tcp event loop (src/net/tcp.c), driven the way generated
+// conn.on(EVENT) { ... } handlers drive it: a handler per event, with an
+// environment holding what the block captured
+
+#define PORT 39411
+#define TOTAL (8 << 20)  // Several times the high-water mark
+#define CHUNK (64 << 10)
+// Bytes the client keeps in flight: with more, both ends could sit above
+// the high-water mark and stop reading
+#define WINDOW (2 * COME_NET_TCP_HIGH_WATER)
+
+static unsigned char pattern(size_t i) {
+    return (unsigned char)(i * 7 + (i >> 12));
+}
+
+typedef struct {
+    come_net_tcp_listener_t* listener;
+    come_net_tcp_conn_t* conn;
+    long read_events;
+    long writable;
+    long hups;
+} server_env_t;
+
+typedef struct {
+    come_net_tcp_conn_t* conn;
+    size_t sent;
+    size_t received;
+    long bad;
+    int connected;
+    int hup;
+} client_env_t;
+
+static server_env_t* server;
+static client_env_t* client;
+
+static void server_read(come_byte_array_t* data, void* env, void* ctx) {
+    server_env_t* self = *(server_env_t**)env;
+    assert(ctx != NULL && data->count > 0 && data->count <= data->size);
+    // Handler allocations live with the connection
+    mem_talloc_alloc(ctx, 100);
+    come_net_tcp_write(self->conn, data);
+    self->read_events++;
+}
+
+static void server_writable(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    (*(server_env_t**)env)->writable++;
+}
+
+static void server_hup(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    server_env_t* self = *(server_env_t**)env;
+    self->hups++;
+    come_net_tcp_close(self->listener);
+}
+
+static void server_accept(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    server_env_t* self = *(server_env_t**)env;
+    self->conn = come_net_tcp_accept(self->listener);
+    assert(self->conn != NULL);
+    assert(come_net_tcp_accept(self->listener) == NULL);  // Only one is waiting
+    *(server_env_t**)come_net_tcp_on(self->conn, COME_NET_TCP_READABLE, server_read, sizeof(void*)) = self;
+    *(server_env_t**)come_net_tcp_on(self->conn, COME_NET_TCP_WRITABLE, server_writable, sizeof(void*)) = self;
+    *(server_env_t**)come_net_tcp_on(self->conn, COME_NET_TCP_HUP, server_hup, sizeof(void*)) = self;
+}
+
+static void client_connect(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    (*(client_env_t**)env)->connected = 1;
+}
+
+// Tops the client's writes up to the window, each chunk built in 'buf'
+static void client_fill(client_env_t* self, unsigned char* buf) {
+    while (self->sent < TOTAL && self->sent + CHUNK - self->received <= WINDOW) {
+        for (size_t i = 0; i < CHUNK; i++) buf[i] = pattern(self->sent + i);
+        assert(come_net_tcp_write_bytes(self->conn, buf, CHUNK) == 0);
+        self->sent += CHUNK;
+    }
+}
+
+static void client_read(come_byte_array_t* data, void* env, void* ctx) {
+    (void)ctx;
+    // In a handler too, each write takes its bytes as they are: one buffer,
+    // rewritten after every write, serves every chunk
+    static unsigned char chunk[CHUNK];
+    client_env_t* self = *(client_env_t**)env;
+    for (uint32_t i = 0; i < data->count; i++) {
+        if (data->items[i] != pattern(self->received + i)) self->bad++;
+    }
+    self->received += data->count;
+    if (self->received == TOTAL) come_net_tcp_close(self->conn);
+    client_fill(self, chunk);
+}
+
+static void client_hup(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    (*(client_env_t**)env)->hup = 1;
+}
+
+void test_echo_backpressure() {
+    server = calloc(1, sizeof(server_env_t));
+    client = calloc(1, sizeof(client_env_t));
+    server->listener = come_net_tcp_listen(come_net_tcp_Addr("127.0.0.1", PORT));
+    assert(server->listener != NULL);
+    *(server_env_t**)come_net_tcp_on(server->listener, COME_NET_TCP_ACCEPT, server_accept, sizeof(void*)) = server;
+
+    client->conn = come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT));
+    assert(client->conn != NULL);
+    *(client_env_t**)come_net_tcp_on(client->conn, COME_NET_TCP_CONNECT, client_connect, sizeof(void*)) = client;
+    *(client_env_t**)come_net_tcp_on(client->conn, COME_NET_TCP_READABLE, client_read, sizeof(void*)) = client;
+    *(client_env_t**)come_net_tcp_on(client->conn, COME_NET_TCP_HUP, client_hup, sizeof(void*)) = client;
+
+    // The first window is written before the connection is up, from outside
+    // any handler: the queue owns copies, so one buffer serves every chunk
+    unsigned char* chunk = malloc(CHUNK);
+    client_fill(client, chunk);
+    memset(chunk, 0, CHUNK);
+    free(chunk);
+
+    assert(come_net_run() == 0);
+    assert(client->connected && client->hup);
+    assert(client->received == TOTAL && client->bad == 0);
+    assert(server->hups == 1 && server->read_events > 0);
+    // How often the echo hit a full socket depends on scheduling
+    printf("  %ld reads, %ld drains\n", server->read_events, server->writable);
+    free(server);
+    free(client);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mNet echo/backpressure tests passed\033[0m\n");
+}
+
+#define BURST (32 << 20)  // More than a loopback socket buffers
+
+static long burst_writable;
+static size_t burst_received;
+static long burst_bad;
+
+static void burst_drained(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    burst_writable++;
+    come_net_tcp_close(*(come_net_tcp_conn_t**)env);
+}
+
+static void burst_accept(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    come_net_tcp_listener_t* listener = *(come_net_tcp_listener_t**)env;
+    come_net_tcp_conn_t* conn = come_net_tcp_accept(listener);
+    come_net_tcp_close(listener);
+    *(come_net_tcp_conn_t**)come_net_tcp_on(conn, COME_NET_TCP_WRITABLE, burst_drained, sizeof(void*)) = conn;
+    // Queued as a copy, so the bytes can go before the handler returns
+    unsigned char* bytes = mem_talloc_alloc(ctx, BURST);
+    for (size_t i = 0; i < BURST; i++) bytes[i] = pattern(i);
+    assert(come_net_tcp_write_bytes(conn, bytes, BURST) == 0);
+    mem_talloc_free(bytes);
+}
+
+static void burst_read(come_byte_array_t* data, void* env, void* ctx) {
+    (void)env;
+    (void)ctx;
+    for (uint32_t i = 0; i < data->count; i++) {
+        if (data->items[i] != pattern(burst_received + i)) burst_bad++;
+    }
+    burst_received += data->count;
+}
+
+void test_writable() {
+    come_net_tcp_listener_t* listener = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+    assert(listener != NULL);
+    *(come_net_tcp_listener_t**)come_net_tcp_on(listener, COME_NET_TCP_ACCEPT, burst_accept, sizeof(void*)) = listener;
+    come_net_tcp_conn_t* conn = come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", PORT));
+    // Counted outside the environment, which goes with the connection
+    come_net_tcp_on(conn, COME_NET_TCP_READABLE, burst_read, 0);
+    // The server closes once drained; the client sees end of stream and closes too
+    assert(come_net_run() == 0);
+    assert(burst_writable == 1 && burst_received == BURST && burst_bad == 0);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mNet writable tests passed\033[0m\n");
+}
+
+static int refused_events[COME_NET_TCP_EVENTS];
+
+static void count_event(come_byte_array_t* data, void* env, void* ctx) {
+    (void)data;
+    (void)ctx;
+    refused_events[*(int*)env]++;
+}
+
+void test_refused() {
+    come_net_tcp_conn_t* conn = come_net_tcp_connect(come_net_tcp_addr("127.0.0.1", 1));
+    assert(conn != NULL);
+    int events[] = { COME_NET_TCP_CONNECT, COME_NET_TCP_ERROR, COME_NET_TCP_HUP };
+    for (int i = 0; i < 3; i++) *(int*)come_net_tcp_on(conn, events[i], count_event, sizeof(int)) = events[i];
+    assert(come_net_run() == 0);
+    assert(refused_events[COME_NET_TCP_CONNECT] == 0);
+    assert(refused_events[COME_NET_TCP_ERROR] == 1 && refused_events[COME_NET_TCP_HUP] == 1);
+
+    // Bad addresses and ports in use fail up front
+    assert(come_net_tcp_connect(come_net_tcp_addr("not an address", 80)) == NULL);
+    come_net_tcp_listener_t* a = come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT));
+    assert(a != NULL);
+    assert(come_net_tcp_listen(come_net_tcp_addr("127.0.0.1", PORT)) == NULL);
+    come_net_tcp_close(a);
+    assert(come_net_run() == 0);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mNet error tests passed\033[0m\n");
+}
+
+// COME_NET_BACKEND picks the loop's backend; unsupported or unknown ones
+// fall back to epoll
+void test_backend() {
+    const char* want = getenv("COME_NET_BACKEND");
+    const char* backend = come_net_backend();
+    assert(strcmp(backend, "epoll") == 0 || (want && strcmp(backend, want) == 0));
+    printf("  backend %s, %ld system calls\n", backend, come_net_syscalls());
+}
+
+int main() {
+    mem_talloc_module_init();
+    test_echo_backpressure();
+    test_writable();
+    test_refused();
+    test_backend();
+    mem_talloc_module_shutdown();
+    return 0;
+}
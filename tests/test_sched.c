@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_string.h"
+#include "come_sched.h"
+#include "mem/talloc.h"
+
+// The work-stealing scheduler (src/sched/sched.c), driven the way generated
+// spawn/join code drives it
+
+typedef struct {
+    come_sched_task_t task;
+    int n;
+    long result;
+} fib_task_t;
+
+static void fib_run(come_sched_task_t* task);
+
+static long fib(int n) {
+    if (n < 12) return n < 2 ? n : fib(n - 1) + fib(n - 2);
+    fib_task_t* left = calloc(1, sizeof(fib_task_t));
+    left->task.run = fib_run;
+    left->n = n - 1;
+    come_sched_spawn(&left->task);
+    long right = fib(n - 2);
+    come_sched_join(&left->task, NULL);
+    long result = left->result + right;
+    free(left);
+    return result;
+}
+
+static void fib_run(come_sched_task_t* task) {
+    fib_task_t* self = (fib_task_t*)task;
+    self->result = fib(self->n);
+}
+
+void test_fork_join() {
+    come_sched_start(4);
+    assert(come_sched_workers() == 4);
+    come_sched_start(8); // Already running: no change
+    assert(come_sched_workers() == 4);
+    assert(fib(27) == 196418);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mScheduler fork/join tests passed\033[0m\n");
+}
+
+typedef struct {
+    come_sched_task_t task;
+    int id;
+    come_string_t* result;
+} label_task_t;
+
+static void label_run(come_sched_task_t* task) {
+    label_task_t* self = (label_task_t*)task;
+    come_string_t* scratch = come_string_new(task->ctx, "scratch");
+    self->result = come_string_sprintf(task->ctx, "task-%d-%u", self->id, come_string_len(scratch));
+    task->result = self->result;
+}
+
+void test_results() {
+    // Many tasks from a thread that is not a worker go through the injection queue
+    enum { N = 2000 };
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    label_task_t* tasks = calloc(N, sizeof(label_task_t));
+    for (int i = 0; i < N; i++) {
+        tasks[i].task.run = label_run;
+        tasks[i].id = i;
+        come_sched_spawn(&tasks[i].task);
+    }
+    for (int i = N - 1; i >= 0; i--) {
+        come_sched_join(&tasks[i].task, ctx);
+        char want[32];
+        snprintf(want, sizeof(want), "task-%d-7", i);
+        assert(strcmp(come_string_cstr(tasks[i].result), want) == 0);
+    }
+    // The results were handed to ctx, the scratch was freed with each task
+    TALLOC_CTX* other = mem_talloc_new_ctx(NULL);
+    come_string_chown(tasks[0].result, other);
+    mem_talloc_free(ctx);
+    assert(strcmp(come_string_cstr(tasks[0].result), "task-0-7") == 0);
+    mem_talloc_free(other);
+    free(tasks);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mScheduler result tests passed\033[0m\n");
+}
+
+// Lowered the way parallel for is: env holds the captured addresses, slot
+// is the participant's padded reduction slot
+typedef struct {
+    long sum;
+    long calls;
+} __attribute__((aligned(64))) sum_slot_t;
+
+static void sum_body(void** env, long lo, long hi, void* slot, void* ctx) {
+    const int* items = *(const int**)env[0];
+    sum_slot_t* mine = slot;
+    assert(ctx != NULL);
+    for (long i = lo; i < hi; i++) mine->sum += items[i];
+    mine->calls++;
+}
+
+static void mark_body(void** env, long lo, long hi, void* slot, void* ctx) {
+    (void)slot;
+    (void)ctx;
+    int* marks = *(int**)env[0];
+    for (long i = lo; i < hi; i++) marks[i]++;
+}
+
+void test_parallel_for() {
+    enum { N = 100003 };
+    int* items = malloc(N * sizeof(int));
+    for (int i = 0; i < N; i++) items[i] = i % 7;
+    long want = 0;
+    for (int i = 0; i < N; i++) want += items[i];
+    int width = come_parallel_width();
+    assert(width == come_sched_workers());
+
+    long chunks[] = { 0, 1000, 0, 37 };
+    int dynamic[] = { 0, 0, 1, 1 };
+    for (int c = 0; c < 4; c++) {
+        sum_slot_t* slots = aligned_alloc(64, width * sizeof(sum_slot_t));
+        memset(slots, 0, width * sizeof(sum_slot_t));
+        void* env[] = { &items, NULL };
+        come_parallel_for(&(come_parallel_for_t){ .lo = 0, .hi = N, .chunk = chunks[c],
+            .dynamic = dynamic[c], .body = sum_body, .env = env, .slots = slots,
+            .slot_size = sizeof(sum_slot_t), .width = width });
+        long total = 0, calls = 0;
+        for (int p = 0; p < width; p++) {
+            total += slots[p].sum;
+            calls += slots[p].calls;
+        }
+        assert(total == want);
+        if (c == 1) assert(calls == (N + 999) / 1000);
+        if (c == 3) assert(calls == (N + 36) / 37);
+        free(slots);
+    }
+
+    // Every iteration runs exactly once, also for an offset range; empty ranges run none
+    int* marks = calloc(N, sizeof(int));
+    void* env[] = { &marks, NULL };
+    come_parallel_for(&(come_parallel_for_t){ .lo = 5, .hi = N, .chunk = 3, .body = mark_body,
+        .env = env, .width = width });
+    come_parallel_for(&(come_parallel_for_t){ .lo = 10, .hi = 10, .body = mark_body,
+        .env = env, .width = width });
+    for (int i = 0; i < N; i++) assert(marks[i] == (i >= 5));
+    free(marks);
+    free(items);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mScheduler parallel for tests passed\033[0m\n");
+}
+
+void test_restart() {
+    come_sched_shutdown();
+    assert(come_sched_workers() == 0);
+    // Spawning starts the workers again
+    fib_task_t task = { .task.run = fib_run, .n = 20 };
+    come_sched_spawn(&task.task);
+    come_sched_join(&task.task, NULL);
+    assert(task.result == 6765 && come_sched_workers() > 0);
+    come_sched_shutdown();
+    mem_talloc_module_shutdown();
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mScheduler restart tests passed\033[0m\n");
+}
+
+int main() {
+    mem_talloc_module_init();
+    test_fork_join();
+    test_results();
+    test_parallel_for();
+    test_restart();
+    return 0;
+}
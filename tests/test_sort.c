@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "come_array.h"
+#include "come_string.h"
+#include "come_sched.h"
+#include "mem/talloc.h"
+
+// Sorting and searching (src/array/sort.c): pdqsort on the inputs that
+// trouble quicksorts, the radix sorts, selection, binary search, the
+// parallel merge sort and the multikey string sort, each checked against
+// qsort
+
+static unsigned long rng_state = 12345;
+
+static unsigned long rng(void) {
+    rng_state = rng_state * 6364136223846793005UL + 1442695040888963407UL;
+    return rng_state >> 33;
+}
+
+static int cmp_int(const void* a, const void* b, void* ctx) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static int qsort_int(const void* a, const void* b) {
+    return cmp_int(a, b, NULL);
+}
+
+enum { RANDOM, SORTED, REVERSED, EQUAL, FEW, ORGAN_PIPE, SAWTOOTH, PATTERNS };
+static const char* pattern_names[] = { "random", "sorted", "reversed", "equal", "few unique",
+                                       "organ pipe", "sawtooth" };
+
+static void fill(int* a, size_t n, int pattern) {
+    for (size_t i = 0; i < n; i++) {
+        switch (pattern) {
+            case RANDOM: a[i] = (int)rng() - (1 << 30); break;
+            case SORTED: a[i] = (int)i; break;
+            case REVERSED: a[i] = (int)(n - i); break;
+            case EQUAL: a[i] = 7; break;
+            case FEW: a[i] = (int)(rng() % 4); break;
+            case ORGAN_PIPE: a[i] = (int)(i < n / 2 ? i : n - i); break;
+            case SAWTOOTH: a[i] = (int)(i % 100); break;
+        }
+    }
+}
+
+// The comparator reads the key, the first member
+typedef struct { int key; char pad[40]; } wide_t;
+
+void test_pdqsort() {
+    static const size_t sizes[] = { 0, 1, 2, 3, 23, 24, 25, 129, 1000, 100000 };
+    for (int p = 0; p < PATTERNS; p++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            size_t n = sizes[s];
+            int* a = malloc((n + 1) * sizeof(int));
+            int* b = malloc((n + 1) * sizeof(int));
+            fill(a, n, p);
+            memcpy(b, a, n * sizeof(int));
+            come_sort(a, n, sizeof(int), cmp_int, NULL);
+            qsort(b, n, sizeof(int), qsort_int);
+            assert(memcmp(a, b, n * sizeof(int)) == 0);
+            free(a);
+            free(b);
+        }
+        printf("  %s: ok\n", pattern_names[p]);
+    }
+
+    // Elements wider than a word move whole
+    size_t n = 5000;
+    wide_t* w = malloc(n * sizeof(wide_t));
+    for (size_t i = 0; i < n; i++) {
+        w[i].key = (int)(rng() % 1000);
+        memset(w[i].pad, (char)w[i].key, sizeof(w[i].pad));
+    }
+    come_sort(w, n, sizeof(wide_t), cmp_int, NULL);
+    for (size_t i = 1; i < n; i++) {
+        assert(w[i - 1].key <= w[i].key);
+        assert(w[i].pad[39] == (char)w[i].key);
+    }
+    free(w);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mpdqsort tests passed\033[0m\n");
+}
+
+static int qsort_long(const void* a, const void* b) {
+    long x = *(const long*)a, y = *(const long*)b;
+    return (x > y) - (x < y);
+}
+
+static int qsort_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void test_radix() {
+    for (size_t n = 0; n < 70000; n = n * 3 + 1) {
+        int* a = malloc((n + 1) * sizeof(int));
+        int* b = malloc((n + 1) * sizeof(int));
+        fill(a, n, RANDOM);
+        memcpy(b, a, n * sizeof(int));
+        come_radix_sort_i32(a, n);
+        qsort(b, n, sizeof(int), qsort_int);
+        assert(memcmp(a, b, n * sizeof(int)) == 0);
+
+        long* la = malloc((n + 1) * sizeof(long));
+        long* lb = malloc((n + 1) * sizeof(long));
+        for (size_t i = 0; i < n; i++) la[i] = lb[i] = (long)(rng() << 31 ^ rng()) - (1L << 61);
+        come_radix_sort_i64(la, n);
+        qsort(lb, n, sizeof(long), qsort_long);
+        assert(memcmp(la, lb, n * sizeof(long)) == 0);
+
+        double* da = malloc((n + 1) * sizeof(double));
+        double* db = malloc((n + 1) * sizeof(double));
+        float* fa = malloc((n + 1) * sizeof(float));
+        for (size_t i = 0; i < n; i++) {
+            da[i] = db[i] = ((double)rng() - (1L << 30)) / 1000.0;
+            fa[i] = (float)da[i];
+        }
+        if (n > 2) da[0] = db[0] = -0.0;
+        come_radix_sort_f64(da, n);
+        qsort(db, n, sizeof(double), qsort_double);
+        for (size_t i = 0; i < n; i++) assert(da[i] == db[i]);
+        come_radix_sort_f32(fa, n);
+        for (size_t i = 1; i < n; i++) assert(fa[i - 1] <= fa[i]);
+
+        uint8_t* bytes = malloc(n + 1);
+        for (size_t i = 0; i < n; i++) bytes[i] = (uint8_t)rng();
+        come_radix_sort_u8(bytes, n);
+        for (size_t i = 1; i < n; i++) assert(bytes[i - 1] <= bytes[i]);
+
+        free(a); free(b); free(la); free(lb); free(da); free(db); free(fa); free(bytes);
+    }
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mRadix sort tests passed\033[0m\n");
+}
+
+void test_select_and_search() {
+    size_t n = 10001;
+    int* a = malloc(n * sizeof(int));
+    int* sorted = malloc(n * sizeof(int));
+    for (int p = 0; p < PATTERNS; p++) {
+        for (size_t k = 0; k < n; k += 997) {
+            fill(a, n, p);
+            come_nth_element(a, n, sizeof(int), k, cmp_int, NULL);
+            for (size_t i = 0; i < k; i++) assert(a[i] <= a[k]);
+            for (size_t i = k + 1; i < n; i++) assert(a[i] >= a[k]);
+
+            fill(a, n, p);
+            come_partial_sort(a, n, sizeof(int), k, cmp_int, NULL);
+            for (size_t i = 1; i < k; i++) assert(a[i - 1] <= a[i]);
+            for (size_t i = k; i < n && k > 0; i++) assert(a[i] >= a[k - 1]);
+        }
+    }
+
+    // Bounds in a sorted array with runs of equal keys
+    for (size_t i = 0; i < n; i++) sorted[i] = (int)(i / 3) * 2;
+    for (int key = -1; key < (int)(n / 3) * 2 + 1; key++) {
+        size_t lo = come_lower_bound(sorted, n, sizeof(int), &key, cmp_int, NULL);
+        size_t hi = come_upper_bound(sorted, n, sizeof(int), &key, cmp_int, NULL);
+        size_t expect = key < 0 ? 0 : (size_t)((key + 1) / 2) * 3;
+        if (expect > n) expect = n;
+        assert(lo == expect);
+        assert(hi - lo == (key >= 0 && key % 2 == 0 && lo < n ? (lo + 3 <= n ? 3 : n - lo) : 0));
+    }
+    free(a);
+    free(sorted);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mSelection and search tests passed\033[0m\n");
+}
+
+void test_parallel() {
+    // Parts and merges of uneven length: n not a multiple of the part count
+    static const size_t sizes[] = { 100, 40000, 250003, 1000000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        for (int p = 0; p < PATTERNS; p++) {
+            int* a = malloc(n * sizeof(int));
+            int* b = malloc(n * sizeof(int));
+            fill(a, n, p);
+            memcpy(b, a, n * sizeof(int));
+            come_sort_parallel(a, n, sizeof(int), cmp_int, NULL);
+            qsort(b, n, sizeof(int), qsort_int);
+            assert(memcmp(a, b, n * sizeof(int)) == 0);
+            free(a);
+            free(b);
+        }
+        printf("  %zu elements: ok\n", n);
+    }
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mParallel sort tests passed\033[0m\n");
+}
+
+static int qsort_string(const void* a, const void* b) {
+    const come_string_t* x = *(come_string_t* const*)a;
+    const come_string_t* y = *(come_string_t* const*)b;
+    size_t n = x->count < y->count ? x->count : y->count;
+    int r = memcmp(x->data, y->data, n);
+    return r ? r : (x->count > y->count) - (x->count < y->count);
+}
+
+static int by_length(come_string_t* a, come_string_t* b) {
+    return (int)a->count - (int)b->count;
+}
+
+void test_strings() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    size_t n = 20000;
+    come_string_list_t* list = come_array_alloc(ctx, sizeof(come_string_t*), n);
+    come_string_t** copy = malloc(n * sizeof(come_string_t*));
+    for (size_t i = 0; i < n; i++) {
+        // Shared prefixes, prefixes of each other, bytes above 0x7f, empty strings
+        char buf[32];
+        int len = (int)(rng() % 12);
+        for (int j = 0; j < len; j++) buf[j] = j < 4 ? "abab"[rng() % 2 + j % 2] : (char)(rng() % 6 + 0x7d);
+        list->items[i] = come_string_new_len(ctx, buf, len);
+        copy[i] = list->items[i];
+    }
+    come_string_list_sort(list);
+    qsort(copy, n, sizeof(come_string_t*), qsort_string);
+    for (size_t i = 0; i < n; i++) assert(qsort_string(&list->items[i], &copy[i]) == 0);
+
+    int at = come_string_list_search(list, come_string_cstr(copy[n / 2]));
+    assert(at >= 0 && qsort_string(&list->items[at], &copy[n / 2]) == 0);
+    assert(come_string_list_search(list, "zzz") == -1);
+    assert(come_string_list_lower_bound(list, "") == 0);
+
+    come_string_list_sort_by(list, by_length);
+    for (size_t i = 1; i < n; i++) assert(list->items[i - 1]->count <= list->items[i]->count);
+    free(copy);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mString sort tests passed\033[0m\n");
+}
+
+static int descending(int a, int b) {
+    return b - a;
+}
+
+// The typed functions behind the array methods
+void test_array_methods() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_int_array_t* a = come_array_alloc(ctx, sizeof(int), 1000);
+    for (int i = 0; i < 1000; i++) a->items[i] = (i * 7919) % 1000;
+    come_int_array_sort(a);
+    for (int i = 0; i < 1000; i++) assert(a->items[i] == i);
+    assert(come_int_array_search(a, 500) == 500);
+    assert(come_int_array_search(a, 1000) == -1);
+    assert(come_int_array_lower_bound(a, -5) == 0 && come_int_array_upper_bound(a, 999) == 1000);
+
+    come_int_array_sort_by(a, descending);
+    assert(a->items[0] == 999 && a->items[999] == 0);
+    come_int_array_partial_sort(a, 10);
+    for (int i = 0; i < 10; i++) assert(a->items[i] == i);
+    come_int_array_nth_element(a, 700);
+    assert(a->items[700] == 700);
+    come_int_array_parallel_sort_by(a, descending);
+    assert(a->items[0] == 999 && a->items[999] == 0);
+
+    come_double_array_t* d = come_array_alloc(ctx, sizeof(double), 4);
+    d->items[0] = 2.5; d->items[1] = -1.0; d->items[2] = 1e300; d->items[3] = -0.5;
+    come_double_array_sort(d);
+    assert(d->items[0] == -1.0 && d->items[1] == -0.5 && d->items[3] == 1e300);
+    assert(come_double_array_search(d, 2.5) == 2);
+
+    // Nothing to sort
+    come_int_array_sort(NULL);
+    come_int_array_t* empty = come_array_alloc(ctx, sizeof(int), 0);
+    come_int_array_parallel_sort(empty);
+    assert(come_int_array_search(empty, 1) == -1);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mArray method tests passed\033[0m\n");
+}
+
+int main() {
+    mem_talloc_module_init();
+    // Enough workers for the parallel sort to split, whatever the machine
+    come_sched_start(4);
+    test_pdqsort();
+    test_radix();
+    test_select_and_search();
+    test_parallel();
+    test_strings();
+    test_array_methods();
+    come_sched_shutdown();
+    mem_talloc_module_shutdown();
+    return 0;
+}
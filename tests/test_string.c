@@ -1,8 +1,13 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include "come_string.h"
 #include "mem/talloc.h"
+#include <pthread.h>
 
 void test_basic() {
     TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
@@ -28,6 +33,31 @@ void test_search() {
     assert(come_string_rchr(s, 'o') == 7);
     assert(come_string_find(s, "World") == 6);
     assert(come_string_count(s, "l") == 3);
+    assert(come_string_rfind(s, "o") == 7);
+    assert(come_string_rfind(s, "Hello") == 0);
+    assert(come_string_find(s, "xyz") == -1);
+
+    // Embedded NULs are part of the string
+    come_string_t* bin = come_string_new_len(ctx, "ab\0cd\0cd", 8);
+    assert(come_string_find(bin, "cd") == 3);
+    assert(come_string_rfind(bin, "cd") == 6);
+    assert(come_string_count(bin, "cd") == 2);
+
+    // Long haystack exercises the SIMD blocks, long needle the Two-Way path
+    char buf[4096];
+    memset(buf, 'a', sizeof(buf));
+    memcpy(buf + 3000, "needle", 6);
+    memset(buf + 4000, 'b', 80);
+    come_string_t* big = come_string_new_len(ctx, buf, sizeof(buf));
+    assert(come_string_find(big, "needle") == 3000);
+    assert(come_string_rfind(big, "aaneedle") == 2998);
+    assert(come_string_count(big, "a") == 4096 - 6 - 80);
+    char long_needle[72];
+    memset(long_needle, 'a', 8);
+    memset(long_needle + 8, 'b', 63);
+    long_needle[71] = '\0';
+    assert(come_string_find(big, long_needle) == 3992);
+    assert(come_string_count(big, "aab") == 1);
     
     mem_talloc_free(ctx);
     printf("\033[1;38;2;255;255;255;48;2;0;150;0mSearch tests passed\033[0m\n");
@@ -80,10 +110,77 @@ void test_memory() {
     // If it was freed, this might crash or show garbage (use after free)
     assert(come_string_len(stolen) == 6);
     
+    // Pools: strings carved from one block, released with it
+    TALLOC_CTX* pool = mem_talloc_pool_new(root, 4096);
+    come_string_t* a = come_string_new(pool, "pooled");
+    come_string_t* b = come_string_upper(a);
+    assert(a && b && (char*)b > (char*)pool && (char*)b < (char*)pool + 4096);
+    come_string_t* big = come_string_repeat(b, 2000); // Larger than the pool: plain malloc
+    assert(big && come_string_size(big) == 12000);
+    mem_talloc_free(pool);
+
+    // A pool scope swaps the context for its lifetime, then restores it
+    TALLOC_CTX* module_ctx = root;
+    {
+        mem_talloc_scope_t scope __attribute__((cleanup(mem_talloc_scope_exit))) = mem_talloc_scope_enter(&module_ctx, 1024);
+        assert(module_ctx != root && scope.outer == root);
+        assert(come_string_new(module_ctx, "scoped") != NULL);
+    }
+    assert(module_ctx == root);
+
     mem_talloc_free(root);
     printf("\033[1;38;2;255;255;255;48;2;0;150;0mMemory tests passed\033[0m\n");
 }
 
+// Threads: producers build strings under their own roots and hand them to
+// the main thread, which takes them without a lock
+#define HANDOFF_THREADS 4
+#define HANDOFF_TREES 500
+
+static mem_talloc_handoff_t handoff_box = MEM_TALLOC_HANDOFF_INIT;
+
+static void* handoff_producer(void* arg) {
+    long id = (long)arg;
+    for (int i = 0; i < HANDOFF_TREES; i++) {
+        TALLOC_CTX* tree = mem_talloc_new_ctx(NULL);
+        come_string_t* s = come_string_sprintf(tree, "%ld %d", id, i);
+        assert(mem_talloc_handoff_push(&handoff_box, tree, come_string_upper(s)) == 0);
+    }
+    // This thread's root (and anything left in it) is freed when it exits
+    assert(mem_talloc_alloc(NULL, 64) != NULL);
+    return NULL;
+}
+
+void test_threads() {
+    pthread_t threads[HANDOFF_THREADS];
+    for (long t = 0; t < HANDOFF_THREADS; t++) {
+        pthread_create(&threads[t], NULL, handoff_producer, (void*)t);
+    }
+
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    // Pool memory stays with its pool's thread
+    TALLOC_CTX* pool = mem_talloc_pool_new(ctx, 4096);
+    assert(mem_talloc_handoff_push(&handoff_box, mem_talloc_new_ctx(pool), NULL) == -1);
+    mem_talloc_free(pool);
+    int next[HANDOFF_THREADS] = {0};
+    int got = 0;
+    while (got < HANDOFF_THREADS * HANDOFF_TREES) {
+        come_string_t* s;
+        TALLOC_CTX* tree = mem_talloc_handoff_take(&handoff_box, ctx, (void**)&s);
+        if (!tree) continue;
+        // Each producer's trees arrive in the order it pushed them
+        int id, i;
+        assert(sscanf(come_string_cstr(s), "%d %d", &id, &i) == 2);
+        assert(i == next[id]++);
+        mem_talloc_free(tree);
+        got++;
+    }
+    for (int t = 0; t < HANDOFF_THREADS; t++) pthread_join(threads[t], NULL);
+    assert(mem_talloc_handoff_take(&handoff_box, ctx, NULL) == NULL);
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mThread tests passed\033[0m\n");
+}
+
 void test_trim() {
     TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
     come_string_t* s = come_string_new(ctx, "  Hello  ");
@@ -122,6 +219,15 @@ void test_split_join() {
     come_string_t* expected_join = come_string_new(ctx, "a-b-c");
     assert(come_string_cmp(joined, expected_join, 0) == 0);
     
+    // More parts than the initial list capacity
+    come_string_t* many = come_string_new(ctx, "0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19");
+    come_string_list_t* many_parts = come_string_split(many, ",");
+    assert(many_parts->count == 20);
+    assert(come_string_cmp(many_parts->items[19], come_string_new(ctx, "19"), 0) == 0);
+    come_string_list_t* many_views = come_string_split_view(many, ",", 0);
+    assert(many_views->count == 20);
+    assert(come_string_cmp(come_string_join(many_views, come_string_new(ctx, ",")), many, 0) == 0);
+
     come_string_list_t* list_n = come_string_split_n(s, ",", 2);
     assert(list_n->count == 2);
     come_string_t* expected_rest = come_string_new(ctx, "b,c");
@@ -161,17 +267,414 @@ void test_regex() {
     come_string_t* expected_repl = come_string_new(ctx, "foo#bar#");
     assert(come_string_cmp(replaced, expected_repl, 0) == 0);
 
+    // Repeated patterns hit the per-thread cache; more patterns than slots evict
+    char pattern[32];
+    for (int i = 0; i < 40; i++) {
+        snprintf(pattern, sizeof(pattern), "^foo[0-9]{%d}", i % 20 + 1);
+        assert(come_string_regex(text, pattern) == (i % 20 + 1 <= 3));
+    }
+    assert(come_string_regex(text, "(unbalanced") == false);
+
+    // Compiled regex objects
+    come_regex_t* re = come_regex_compile(ctx, "([a-z]+)([0-9]+)");
+    assert(re != NULL);
+    assert(come_regex_compile(ctx, "[") == NULL);
+    assert(come_regex_match(re, text));
+    come_string_list_t* re_groups = come_regex_groups(re, text);
+    assert(re_groups->count == 3);
+    assert(come_string_cmp(re_groups->items[2], come_string_new(ctx, "123"), 0) == 0);
+    come_string_list_t* re_parts = come_regex_split(re, come_string_new(ctx, "-ab1+cd22*"), 0);
+    assert(re_parts->count == 3);
+    assert(come_string_cmp(re_parts->items[1], come_string_new(ctx, "+"), 0) == 0);
+    come_string_t* re_repl = come_regex_replace(re, text, "<>", 1);
+    assert(come_string_cmp(re_repl, come_string_new(ctx, "<>bar456"), 0) == 0);
+
+    // Growing output and empty matches in a single pass
+    come_string_t* digits = come_string_new(ctx, "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20");
+    come_string_t* grown = come_string_regex_replace(digits, "[0-9]+", "<number>", 0);
+    assert(come_string_find(grown, "<number> <number>") == 0);
+    assert(come_string_count(grown, "<number>") == 20);
+    come_string_t* empty_repl = come_string_regex_replace(come_string_new(ctx, "abc"), "x*", "-", 0);
+    assert(come_string_cmp(empty_repl, come_string_new(ctx, "-a-b-c"), 0) == 0);
+    assert(come_string_regex_split(digits, " ", 0)->count == 20);
+    come_regex_free(re);
+
     mem_talloc_free(ctx);
     printf("\033[1;38;2;255;255;255;48;2;0;150;0mRegex tests passed\033[0m\n");
 }
 
+// One compiled regex and one set, matched from several threads at once
+typedef struct {
+    come_regex_t* re;
+    come_regex_set_t* set;
+    long id;
+} regex_shared_t;
+
+static void* regex_worker(void* arg) {
+    regex_shared_t* shared = arg;
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    for (int i = 0; i < 2000; i++) {
+        come_string_t* s = come_string_sprintf(ctx, "item%ld-%d ERROR", shared->id, i);
+        come_string_list_t* g = come_regex_groups(shared->re, s);
+        assert(g && g->count == 3 && (long)come_string_tol(g->items[2], 10) == i);
+        come_int_array_t* hits = come_regex_set_matches(shared->set, s);
+        assert(hits->count == (i % 10 == 7 ? 2u : 1u) && hits->items[0] == 0);
+        mem_talloc_free(g);
+        mem_talloc_free(hits);
+        mem_talloc_free(s);
+    }
+    mem_talloc_free(ctx);
+    return NULL;
+}
+
+void test_regex_engine() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    // POSIX leftmost-longest, not first alternative
+    come_string_list_t* g = come_string_regex_groups(come_string_new(ctx, "xabcd"), "(a|ab)(c|bcd)");
+    assert(g->count == 3);
+    assert(come_string_cmp(g->items[0], come_string_new(ctx, "abcd"), 0) == 0);
+    come_string_list_t* opt = come_string_regex_groups(come_string_new(ctx, "b"), "(a)?b");
+    assert(opt->count == 2 && opt->items[1] == NULL);
+
+    // Anchors apply to the view, not its parent
+    come_string_t* line = come_string_new(ctx, "[ERROR] disk full");
+    come_string_t* msg = come_string_view(line, 8, 9);
+    assert(come_string_regex(msg, "^disk"));
+    assert(come_string_regex(msg, "full$"));
+    assert(!come_string_regex(line, "^disk"));
+
+    // Classes, intervals and escapes
+    assert(come_string_regex(come_string_new(ctx, "ip=10.0.0.1"), "^ip=([0-9]{1,3}\\.){3}[0-9]{1,3}$"));
+    assert(!come_string_regex(come_string_new(ctx, "ip=10.0.0"), "^ip=([0-9]{1,3}\\.){3}[0-9]{1,3}$"));
+    assert(come_string_regex(come_string_new(ctx, "a_b c"), "^\\w+\\s[[:alpha:]]$"));
+
+    // Back-references are not in the native engine and go to libc
+    assert(come_string_regex(come_string_new(ctx, "abab"), "^(ab)\\1$"));
+    assert(!come_string_regex(come_string_new(ctx, "abba"), "^(ab)\\1$"));
+
+    // Linear time where backtracking explodes
+    char* runs = malloc(100001);
+    memset(runs, 'a', 100000);
+    runs[100000] = '\0';
+    come_string_t* as = come_string_new(ctx, runs);
+    free(runs);
+    assert(!come_string_regex(as, "^(a|aa)*[bc]$"));
+    assert(come_string_regex(as, "^(a|aa)*$"));
+
+    // Regex sets
+    come_string_list_t* pats = come_string_split(come_string_new(ctx, "ERROR|timeout|^GET|[0-9]{3}ms"), "|");
+    come_regex_set_t* set = come_regex_compile_set(ctx, pats);
+    assert(set != NULL);
+    come_string_t* log = come_string_new(ctx, "GET /api ERROR after 250ms");
+    assert(come_regex_set_match(set, log));
+    come_int_array_t* hits = come_regex_set_matches(set, log);
+    assert(hits->count == 3);
+    assert(hits->items[0] == 0 && hits->items[1] == 2 && hits->items[2] == 3);
+    assert(come_regex_set_matches(set, come_string_new(ctx, "ok"))->count == 0);
+    assert(!come_regex_set_match(set, come_string_new(ctx, "POST /api")));
+
+    // A pattern that needs libc keeps the set working, one pattern at a time
+    come_string_list_t* mixed = come_string_split(come_string_new(ctx, "(x)\\1 ok"), " ");
+    come_regex_set_t* fallback = come_regex_compile_set(ctx, mixed);
+    come_int_array_t* fb_hits = come_regex_set_matches(fallback, come_string_new(ctx, "xx ok"));
+    assert(fb_hits->count == 2);
+    come_string_list_t* bad = come_string_split(come_string_new(ctx, "ok ("), " ");
+    assert(come_regex_compile_set(ctx, bad) == NULL);
+    come_regex_set_free(set);
+
+    // Compiled programs fill their DFA cache while matching; threads sharing
+    // one take turns, and each call has its own set hits
+    come_string_list_t* shared_pats = come_string_split(come_string_new(ctx, "ERROR|7 "), "|");
+    come_regex_t* shared_re = come_regex_compile(ctx, "([a-z]+)[0-9]+-([0-9]+)");
+    come_regex_set_t* shared_set = come_regex_compile_set(ctx, shared_pats);
+    regex_shared_t shared[4];
+    pthread_t workers[4];
+    for (long t = 0; t < 4; t++) shared[t] = (regex_shared_t){ shared_re, shared_set, t };
+    for (long t = 0; t < 4; t++) pthread_create(&workers[t], NULL, regex_worker, &shared[t]);
+    for (long t = 0; t < 4; t++) pthread_join(workers[t], NULL);
+
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mRegex engine tests passed\033[0m\n");
+}
+
+void test_views() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* s = come_string_new(ctx, "  key=value;x=1  ");
+
+    come_string_t* t = come_string_trim_view(s, NULL);
+    assert(come_string_is_view(t));
+    assert(come_string_size(t) == 13);
+    assert(come_string_cmp(t, come_string_new(ctx, "key=value;x=1"), 0) == 0);
+    assert(come_string_find(t, "x=") == 10);
+    assert(come_string_chr(t, ' ') == -1);
+
+    come_string_list_t* pairs = come_string_split_view(t, ";", 0);
+    assert(pairs->count == 2);
+    assert(come_string_is_view(pairs->items[0]));
+    come_string_list_t* kv = come_string_split(pairs->items[0], "=");
+    assert(kv->count == 2);
+    assert(come_string_cmp(kv->items[1], come_string_new(ctx, "value"), 0) == 0);
+
+    // Inner views are materialized on demand, views at the tail are not
+    assert(strcmp(come_string_cstr(pairs->items[0]), "key=value") == 0);
+    // ... once: later calls return the same copy
+    assert(come_string_cstr(pairs->items[0]) == come_string_cstr(pairs->items[0]));
+    come_string_t* tail = come_string_view(s, 10, 7);
+    assert(come_string_cstr(tail) == s->data + 10);
+
+    come_string_t* sub = come_string_substr_view(t, 4, 9);
+    assert(come_string_cmp(sub, come_string_new(ctx, "value"), 0) == 0);
+    assert(come_string_tol(come_string_substr_view(t, 12, 13), 10) == 1);
+
+    // A chowned view keeps its parent alive
+    TALLOC_CTX* other = mem_talloc_new_ctx(NULL);
+    come_string_t* owner = come_string_new(ctx, "kept alive");
+    come_string_t* v = come_string_view(owner, 5, 5);
+    come_string_chown(v, other);
+    come_string_chown(v, other);
+    assert(mem_talloc_reference_count(owner) == 1);
+    mem_talloc_free(ctx);
+    assert(strcmp(come_string_cstr(v), "alive") == 0);
+
+    mem_talloc_free(other);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mView tests passed\033[0m\n");
+}
+
+void test_dup() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    TALLOC_CTX* other = mem_talloc_new_ctx(NULL);
+
+    // Owned copies of strings and of views, independent of the original
+    come_string_t* s = come_string_new(ctx, "hello, world");
+    come_string_t* copy = come_string_dup(other, s);
+    assert(copy != s && come_string_cmp(copy, s, 0) == 0 && copy->data[copy->count] == '\0');
+    come_string_t* view_copy = come_string_dup(other, come_string_view(s, 7, 5));
+    assert(!come_string_is_view(view_copy) && strcmp(view_copy->data, "world") == 0);
+
+    // Depth 1 shares the strings, any other depth copies them into one block
+    come_string_list_t* list = come_string_split(s, ", ");
+    come_string_list_t* shallow = come_string_list_dup(other, list, 1);
+    assert(shallow != list && shallow->count == 2 && shallow->items[0] == list->items[0]);
+    come_string_list_t* deep = come_string_list_dup(other, list, 0);
+    assert(deep->count == 2 && deep->items[1] != list->items[1]);
+    mem_talloc_free(ctx);
+    assert(strcmp(come_string_cstr(deep->items[0]), "hello") == 0);
+    assert(strcmp(come_string_cstr(deep->items[1]), "world") == 0);
+    assert(strcmp(copy->data, "hello, world") == 0);
+
+    // The copy is an ordinary list: it grows, and its strings are copied on write
+    deep = come_string_list_append(deep, "!", 1);
+    come_string_t* upper = come_string_upper_reuse(deep->items[0]);
+    assert(deep->count == 3 && strcmp(upper->data, "HELLO") == 0);
+    assert(come_string_cmp(deep->items[1], come_string_new(other, "world"), 0) == 0);
+
+    mem_talloc_free(other);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mDup tests passed\033[0m\n");
+}
+
+void test_share() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+    TALLOC_CTX* other = mem_talloc_new_ctx(NULL);
+
+    // Both owners read the same bytes; the first write copies
+    come_string_t* s = come_string_new(ctx, "shared");
+    come_string_t* t = come_string_share(other, s);
+    assert(t == s && (s->size & COME_SHARED) && come_string_len(t) == 6);
+    t = come_string_upper_reuse(t);
+    assert(t != s && strcmp(t->data, "SHARED") == 0 && strcmp(s->data, "shared") == 0);
+    come_string_append_long(s, 1);
+    assert(strcmp(s->data, "shared1") == 0 && strcmp(t->data, "SHARED") == 0);
+
+    // Freeing one owner leaves the other the only one, writing in place
+    come_string_t* u = come_string_share(other, come_string_new(ctx, "abc"));
+    mem_talloc_free(ctx);
+    assert(strcmp(u->data, "abc") == 0);
+    assert(come_string_upper_reuse(u) == u && !(u->size & COME_SHARED) && strcmp(u->data, "ABC") == 0);
+
+    // Freeing a shared string frees only its parent's link
+    ctx = mem_talloc_new_ctx(NULL);
+    come_string_t* v = come_string_share(other, come_string_new(ctx, "kept"));
+    mem_talloc_free(v);
+    mem_talloc_free(ctx);
+    assert(strcmp(v->data, "kept") == 0);
+
+    // Views are copied rather than shared
+    come_string_t* w = come_string_share(other, come_string_view(u, 1, 2));
+    assert(!come_string_is_view(w) && strcmp(w->data, "BC") == 0);
+
+    // A shared list gets a list of its own on append
+    come_string_list_t* list = come_string_split(come_string_new(other, "a,b"), ",");
+    list->size |= COME_SHARED;
+    mem_talloc_reference(other, list);
+    come_string_list_t* grown = come_string_list_append(list, "c", 1);
+    assert(grown != list && list->count == 2 && grown->count == 3 && grown->items[0] == list->items[0]);
+
+    mem_talloc_free(other);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mShare tests passed\033[0m\n");
+}
+
+void test_validation() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    assert(come_string_isdigit(come_string_new(ctx, "0123456789")));
+    assert(!come_string_isdigit(come_string_new(ctx, "12a")));
+    assert(come_string_isalpha(come_string_new(ctx, "AZaz")));
+    assert(!come_string_isalpha(come_string_new(ctx, "a@[`{")));
+    assert(come_string_isalnum(come_string_new(ctx, "a1Z9")));
+    assert(come_string_isspace(come_string_new(ctx, " \t\n\v\f\r")));
+    assert(!come_string_isspace(come_string_new_len(ctx, " \0", 2)));
+    assert(come_string_isdigit(come_string_new(ctx, ""))); // Vacuously true
+
+    // Long inputs run the SIMD blocks; the odd byte sits in each position class
+    char buf[200];
+    for (size_t bad = 0; bad < sizeof(buf); bad += 7) {
+        memset(buf, '7', sizeof(buf));
+        buf[bad] = (char)0xB7; // Not a digit in the C locale
+        come_string_t* s = come_string_new_len(ctx, buf, sizeof(buf));
+        assert(!come_string_isdigit(s));
+        assert(!come_string_isascii(s));
+        assert(come_string_count_runes(s) == sizeof(buf) - 1);
+    }
+
+    // UTF-8
+    assert(come_string_utf8(come_string_new(ctx, "plain ascii")));
+    assert(come_string_utf8(come_string_new(ctx, "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80")));
+    assert(come_string_count_runes(come_string_new(ctx, "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80")) == 8);
+    assert(come_string_len(come_string_new(ctx, "\xe2\x82\xac")) == 1);
+    assert(!come_string_utf8(come_string_new(ctx, "\xc0\xaf")));         // Overlong
+    assert(!come_string_utf8(come_string_new(ctx, "\xed\xa0\x80")));     // Surrogate
+    assert(!come_string_utf8(come_string_new(ctx, "\xf4\x90\x80\x80"))); // Above U+10FFFF
+    assert(!come_string_utf8(come_string_new(ctx, "\xe2\x82")));         // Truncated
+    assert(!come_string_utf8(come_string_new(ctx, "\x80")));             // Stray continuation
+
+    // A sequence straddling every block boundary, and one cut off at the end
+    for (size_t at = 0; at + 4 <= sizeof(buf); at++) {
+        memset(buf, 'x', sizeof(buf));
+        memcpy(buf + at, "\xf0\x9f\x98\x80", 4);
+        assert(come_string_utf8(come_string_new_len(ctx, buf, sizeof(buf))));
+        assert(!come_string_utf8(come_string_new_len(ctx, buf, at + 3)));
+    }
+
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mValidation tests passed\033[0m\n");
+}
+
+void test_case() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    // Non-ASCII runes map through the Unicode tables
+    come_string_t* s = come_string_new(ctx, "Stra\xc3\x9f" "e \xc3\xa9t\xc3\xa9 \xce\xa3\xcf\x89\xce\xba\xcf\x81\xce\xac\xcf\x84\xce\xb7\xcf\x82");
+    assert(strcmp(come_string_upper(s)->data, "STRA\xc3\x9f" "E \xc3\x89T\xc3\x89 \xce\xa3\xce\xa9\xce\x9a\xce\xa1\xce\x86\xce\xa4\xce\x97\xce\xa3") == 0);
+    assert(strcmp(come_string_lower(s)->data, "stra\xc3\x9f" "e \xc3\xa9t\xc3\xa9 \xcf\x83\xcf\x89\xce\xba\xcf\x81\xce\xac\xcf\x84\xce\xb7\xcf\x82") == 0);
+
+    // Runes whose other case needs a different number of bytes
+    come_string_t* dotless = come_string_upper(come_string_new(ctx, "\xc4\xb1")); // ı -> I
+    assert(dotless->count == 1 && dotless->data[0] == 'I');
+    come_string_t* grows = come_string_lower(come_string_new(ctx, "\xc8\xba!")); // Ⱥ -> ⱥ
+    assert(strcmp(grows->data, "\xe2\xb1\xa5!") == 0);
+
+    // In place: same pointer unless a rune grows past the buffer
+    come_string_t* owned = come_string_new(ctx, "hello, \xc3\xa9t\xc3\xa9 and a long ASCII tail to cover the SIMD blocks");
+    come_string_t* before = owned;
+    come_string_upper_inplace(owned);
+    assert(owned == before);
+    assert(strcmp(owned->data, "HELLO, \xc3\x89T\xc3\x89 AND A LONG ASCII TAIL TO COVER THE SIMD BLOCKS") == 0);
+    come_string_t* big = come_string_new(ctx, "\xc8\xba\xc8\xba");
+    come_string_lower_inplace(big);
+    assert(strcmp(big->data, "\xe2\xb1\xa5\xe2\xb1\xa5") == 0 && big->count == 6);
+
+    // A view gets a copy; its parent is untouched
+    come_string_t* parent = come_string_new(ctx, "abc def");
+    come_string_t* v = come_string_view(parent, 4, 3);
+    come_string_upper_inplace(v);
+    assert(strcmp(v->data, "DEF") == 0);
+    assert(strcmp(parent->data, "abc def") == 0);
+
+    // Case-folded compare
+    assert(come_string_casecmp(come_string_new(ctx, "HELLO world"), come_string_new(ctx, "hello WORLD"), 0) == 0);
+    assert(come_string_casecmp(come_string_new(ctx, "\xce\xa3\xce\x99\xce\xa3"), come_string_new(ctx, "\xcf\x83\xce\xb9\xcf\x82"), 0) == 0);
+    assert(come_string_casecmp(come_string_new(ctx, "\xc3\x89t\xc3\xa9"), come_string_new(ctx, "\xc3\xa9T\xc3\x89"), 0) == 0);
+    assert(come_string_casecmp(come_string_new(ctx, "abc"), come_string_new(ctx, "ABD"), 0) < 0);
+    assert(come_string_casecmp(come_string_new(ctx, "abc"), come_string_new(ctx, "AB"), 0) > 0);
+    assert(come_string_casecmp(come_string_new(ctx, "\xc3\xa9" "a"), come_string_new(ctx, "\xc3\x89" "b"), 1) == 0);
+
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mCase tests passed\033[0m\n");
+}
+
+void test_numeric() {
+    TALLOC_CTX* ctx = mem_talloc_new_ctx(NULL);
+
+    // Integers: bases, prefixes, errors through errno
+    assert(come_string_tol(come_string_new(ctx, " -12345678901234567 "), 10) == -12345678901234567L && errno == 0);
+    assert(come_string_tol(come_string_new(ctx, "ff"), 16) == 255 && errno == 0);
+    assert(come_string_tol(come_string_new(ctx, "0x1F"), 0) == 31);
+    assert(come_string_tol(come_string_new(ctx, "0b101"), 0) == 5);
+    assert(come_string_tol(come_string_new(ctx, "017"), 0) == 15);
+    assert(come_string_tol(come_string_new(ctx, "-9223372036854775808"), 10) == LONG_MIN && errno == 0);
+    assert(come_string_tol(come_string_new(ctx, "9223372036854775808"), 10) == LONG_MAX && errno == ERANGE);
+    assert(come_string_tol(come_string_new(ctx, "42abc"), 10) == 42 && errno == EINVAL);
+    assert(come_string_tol(come_string_new(ctx, ""), 10) == 0 && errno == EINVAL);
+    assert(come_string_tol(come_string_new(ctx, "7"), 37) == 0 && errno == EINVAL);
+
+    // Doubles are correctly rounded, including halfway and subnormal cases
+    assert(come_string_tod(come_string_new(ctx, "0.1")) == 0.1 && errno == 0);
+    assert(come_string_tod(come_string_new(ctx, "9007199254740993")) == 9007199254740992.0);
+    assert(come_string_tod(come_string_new(ctx, "2.2250738585072011e-308")) == 2.2250738585072011e-308);
+    assert(come_string_tod(come_string_new(ctx, "4.9406564584124654e-324")) == 4.9406564584124654e-324);
+    assert(come_string_tod(come_string_new(ctx, "123456789012345678901234567890e-10")) == 12345678901234567890.1234567890);
+    assert(come_string_tod(come_string_new(ctx, "0x1.8p1")) == 3.0);
+    assert(isinf(come_string_tod(come_string_new(ctx, "-Infinity"))));
+    assert(isinf(come_string_tod(come_string_new(ctx, "1e400"))) && errno == ERANGE);
+    assert(come_string_tod(come_string_new(ctx, "1e-400")) == 0 && errno == ERANGE);
+    assert(come_string_tod(come_string_new(ctx, "1.5x")) == 1.5 && errno == EINVAL);
+
+    // Appending numbers: shortest round-trip doubles, growth moves the string
+    come_string_t* s = come_string_new(ctx, "n=");
+    come_string_append_long(s, -42);
+    come_string_append_long(s, LONG_MIN);
+    assert(strcmp(s->data, "n=-42-9223372036854775808") == 0);
+    const struct { double v; const char* text; } doubles[] = {
+        {0.1, "0.1"}, {1.0 / 3, "0.3333333333333333"}, {100, "100"}, {-2.5, "-2.5"},
+        {1e21, "1e+21"}, {1e20, "100000000000000000000"}, {1.5e-7, "1.5e-7"}, {1e-6, "0.000001"},
+        {5e-324, "5e-324"}, {1.7976931348623157e308, "1.7976931348623157e+308"},
+        {-0.0, "-0"}, {INFINITY, "inf"}, {NAN, "nan"},
+    };
+    for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+        come_string_t* d = come_string_new(ctx, "");
+        come_string_append_double(d, doubles[i].v);
+        assert(strcmp(d->data, doubles[i].text) == 0);
+        if (isfinite(doubles[i].v)) assert(come_string_tod(d) == doubles[i].v);
+    }
+    come_string_t* many = come_string_new(ctx, "");
+    for (long i = 0; i < 1000; i++) come_string_append_long(many, i);
+    assert(many->count == 2890 && strncmp(many->data + 2884, "998999", 6) == 0);
+
+    // A view gets an owned copy
+    come_string_t* v = come_string_view(s, 0, 2);
+    come_string_append_double(v, 0.5);
+    assert(strcmp(v->data, "n=0.5") == 0 && strncmp(s->data, "n=-42", 5) == 0);
+
+    mem_talloc_free(ctx);
+    printf("\033[1;38;2;255;255;255;48;2;0;150;0mNumeric tests passed\033[0m\n");
+}
+
 int main() {
     test_basic();
     test_search();
+    test_validation();
     test_transform();
+    test_case();
+    test_numeric();
     test_memory();
+    test_threads();
     test_trim();
     test_split_join();
     test_regex();
+    test_regex_engine();
+    test_views();
+    test_dup();
+    test_share();
     return 0;
 }